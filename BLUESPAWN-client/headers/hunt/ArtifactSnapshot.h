@@ -0,0 +1,183 @@
+#pragma once
+#include <Windows.h>
+
+#include <string>
+#include <vector>
+#include <optional>
+#include <atomic>
+#include <functional>
+
+#include "util/configurations/Registry.h"
+#include "util/configurations/RegistryValue.h"
+#include "RegistryPlan.h"
+#include "Scope.h"
+
+#include "common/wrappers.hpp"
+#include "util/accounting/ResourceUsage.h"
+
+/**
+ * A snapshot of system artifacts that several hunts consume, such as the installed services and
+ * the autorun values. A single snapshot is created for each run of HuntRegister::RunHunts and is
+ * shared by every hunt in the run, so each of these enumerations is performed at most once per run.
+ *
+ * Each artifact is collected lazily the first time it is requested, and never changes afterwards.
+ * All methods are safe to call from multiple threads at once.
+ */
+class ArtifactSnapshot {
+private:
+
+	/// A lazily collected artifact along with the critical section guarding its collection
+	template<class T>
+	struct Artifact {
+		std::optional<T> value{ std::nullopt };
+		CriticalSection hSection{};
+	};
+
+	mutable Artifact<std::vector<Registry::RegistryKey>> services;
+	mutable Artifact<std::vector<Registry::RegistryValue>> autoruns;
+	mutable Artifact<std::vector<std::wstring>> profiles;
+	mutable Artifact<std::vector<Registry::RegistryKey>> hives;
+	mutable Artifact<std::vector<DWORD>> processes;
+	mutable Artifact<Registry::RegistryPlan::Findings> ruleFindings;
+
+	/// The registry rules of the hunts sharing this snapshot, which are the only rules the plan evaluates
+	std::vector<SIZE_T> vRegistryRules;
+
+	/// The scope to which the registry plan is limited
+	Scope ruleScope;
+
+	/// The number of artifacts collected, and the number of requests served without collecting anything
+	mutable std::atomic<DWORD> dwCollectionsPerformed;
+	mutable std::atomic<DWORD> dwCollectionsSaved;
+
+	/// The resources consumed collecting artifacts, guarded by hUsageSection
+	mutable Accounting::ResourceUsage usage;
+	mutable CriticalSection hUsageSection;
+
+	/**
+	 * Adds the resources consumed collecting an artifact to the snapshot's usage.
+	 *
+	 * @param collection The resources consumed
+	 */
+	void AddUsage(const Accounting::ResourceUsage& collection) const;
+
+	/**
+	 * Retrieves an artifact, collecting it first if this is the first time it has been requested.
+	 *
+	 * The resources consumed collecting the artifact are charged to the snapshot rather than to the hunt
+	 * that happened to request it first, as is the time spent waiting for another hunt to collect it.
+	 *
+	 * @param artifact The artifact to retrieve
+	 * @param collector A function collecting the artifact's value
+	 *
+	 * @return A reference to the artifact's value
+	 */
+	template<class T>
+	const T& Retrieve(Artifact<T>& artifact, const std::function<T()>& collector) const {
+		Accounting::ResourceTracker tracker{};
+		auto lock{ BeginCriticalSection(artifact.hSection) };
+		if(artifact.value){
+			dwCollectionsSaved++;
+		} else {
+			artifact.value = collector();
+			dwCollectionsPerformed++;
+
+			auto collection{ tracker.GetUsage() };
+			AddUsage(collection);
+			Accounting::ExcludeUsage(collection);
+			return *artifact.value;
+		}
+
+		Accounting::ResourceUsage wait{};
+		wait.WallTimeMs = tracker.GetUsage().WallTimeMs;
+		Accounting::ExcludeUsage(wait);
+		return *artifact.value;
+	}
+
+public:
+
+	/// The keys under HKLM (and each user's hive) holding values run at startup or logon
+	static const std::vector<std::wstring> RunKeys;
+
+	/**
+	 * Creates an empty snapshot
+	 *
+	 * @param vRegistryRules The identifiers of the registry rules added by the hunts sharing the snapshot
+	 * @param ruleScope The scope to which the registry plan is limited; the rules only read keys and values in it
+	 */
+	ArtifactSnapshot(const std::vector<SIZE_T>& vRegistryRules, const Scope& ruleScope = Scope{});
+
+	ArtifactSnapshot(const ArtifactSnapshot&) = delete;
+	ArtifactSnapshot operator=(const ArtifactSnapshot&) = delete;
+
+	/**
+	 * Retrieves the keys of the services configured under HKLM\SYSTEM\CurrentControlSet\Services
+	 *
+	 * @return A vector containing a key for each service
+	 */
+	const std::vector<Registry::RegistryKey>& GetServices() const;
+
+	/**
+	 * Retrieves the values under the RunKeys, including their WoW64 and per-user counterparts, followed
+	 * by the string values of their immediate subkeys.
+	 *
+	 * @return A vector containing each autorun value
+	 */
+	const std::vector<Registry::RegistryValue>& GetAutoruns() const;
+
+	/**
+	 * Retrieves the paths of the user profile folders under C:\Users
+	 *
+	 * @return A vector containing the path of each profile folder
+	 */
+	const std::vector<std::wstring>& GetUserProfiles() const;
+
+	/**
+	 * Retrieves the user hives, both those loaded under HKEY_USERS and those of users who aren't logged on
+	 *
+	 * @return A vector containing a key for each loaded hive, followed by the hive file of each user whose hive
+	 *         isn't loaded
+	 */
+	const std::vector<Registry::RegistryKey>& GetUserHives() const;
+
+	/**
+	 * Retrieves the PIDs of the processes running when this artifact was first requested
+	 *
+	 * @return A vector containing the PID of each process
+	 */
+	const std::vector<DWORD>& GetProcesses() const;
+
+	/**
+	 * Retrieves the values found by a registry rule. The first request executes the registry plan, which
+	 * evaluates the rules of every hunt sharing this snapshot at once. Rules of other hunts find nothing.
+	 *
+	 * @param rule The identifier of the rule, as returned by Hunt::AddRegistryRule
+	 *
+	 * @return A vector containing each value found by the rule
+	 */
+	const std::vector<Registry::RegistryValue>& GetRuleFindings(SIZE_T rule) const;
+
+	/**
+	 * Retrieves the number of artifacts that have been collected by this snapshot
+	 *
+	 * @return The number of collections performed
+	 */
+	DWORD GetCollectionsPerformed() const;
+
+	/**
+	 * Retrieves the number of requests for an artifact that were served from the snapshot rather than
+	 * collecting the artifact again.
+	 *
+	 * @return The number of collections saved
+	 */
+	DWORD GetCollectionsSaved() const;
+
+	/**
+	 * Retrieves the resources consumed collecting the artifacts in this snapshot. These are not charged to
+	 * any of the hunts sharing the snapshot. The wall time is the total time spent collecting, and the peak
+	 * working set delta is not measured.
+	 *
+	 * @return The resources consumed
+	 */
+	Accounting::ResourceUsage GetUsage() const;
+};
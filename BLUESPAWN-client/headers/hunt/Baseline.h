@@ -0,0 +1,172 @@
+#pragma once
+#include <Windows.h>
+
+#include <string>
+#include <vector>
+#include <array>
+#include <set>
+#include <atomic>
+
+#include "common/wrappers.hpp"
+
+namespace FileSystem {
+	class File;
+}
+
+namespace Registry {
+	struct RegistryValue;
+}
+
+/**
+ * A set of artifacts known to be present on a reference machine, such as a freshly deployed gold image.
+ * When hunting on machines deployed from the same image, anything in the baseline is expected, so hunts
+ * skip evaluating and reporting it, leaving only the deviations from the image.
+ *
+ * A baseline is captured by hunting on the reference machine in capture mode, in which every artifact
+ * the hunts check against the baseline is recorded rather than skipped. Artifacts are recorded as SHA-256
+ * digests of their identity: registry values by key, name, and data, and files by path and SHA-256 hash.
+ * A cryptographic digest is used since anyone able to write a value chooses its data, and could otherwise
+ * choose data colliding with an artifact in the baseline to hide it. Paths are normalized so that user SIDs
+ * and profile directories don't prevent artifacts in different users' profiles from matching. The digests
+ * are stored sorted, so the baseline file stays compact and lookups are a binary search. The file is opened
+ * with FileSystem::OpenProtectedFile, so a file which users other than SYSTEM and Administrators could write
+ * is refused.
+ *
+ * All methods are safe to call from multiple threads at once.
+ */
+class Baseline {
+private:
+	static Baseline instance;
+
+	enum class Mode {
+		Disabled,
+		Capture,
+		Filter
+	};
+
+	Mode mode;
+
+	/// The SHA-256 digest of an artifact's identity
+	typedef std::array<BYTE, 32> Digest;
+
+	/// The path of the baseline file
+	std::wstring wsPath;
+
+	/// The digests of the artifacts in the baseline, sorted. Used when filtering.
+	std::vector<Digest> vArtifacts;
+
+	/// The digests of the artifacts recorded so far, guarded by hSection. Used when capturing.
+	std::set<Digest> sCaptured;
+
+	CriticalSection hSection;
+
+	/// The number of artifacts found in the baseline, and the number checked
+	std::atomic<DWORD> dwArtifactsMatched;
+	std::atomic<DWORD> dwArtifactsChecked;
+
+	Baseline();
+
+	/**
+	 * Records or looks up an artifact, depending on the mode
+	 *
+	 * @param identity The normalized identity of the artifact
+	 *
+	 * @return true if filtering and the artifact is in the baseline; false otherwise
+	 */
+	bool Check(const std::wstring& identity);
+
+public:
+
+	/**
+	 * Retrieves the baseline used by this process
+	 *
+	 * @return The instance of Baseline
+	 */
+	static Baseline& GetInstance();
+
+	/// Delete copy and move constructors and assignment operators
+	Baseline(const Baseline&) = delete;
+	Baseline& operator=(const Baseline&) = delete;
+	Baseline(Baseline&&) = delete;
+	Baseline& operator=(Baseline&&) = delete;
+
+	/**
+	 * Loads a baseline from a file and begins skipping the artifacts in it.
+	 *
+	 * @param path The path of the baseline file
+	 *
+	 * @return true if the baseline was loaded; false otherwise, in which case nothing is skipped
+	 */
+	bool Load(const std::wstring& path);
+
+	/**
+	 * Begins capturing a baseline, recording every artifact checked until Save is called.
+	 *
+	 * @param path The path to which the baseline will be saved
+	 */
+	void BeginCapture(const std::wstring& path);
+
+	/**
+	 * Writes the captured baseline to the path given to BeginCapture. The baseline is written to a
+	 * temporary file first and then moved over any existing file.
+	 *
+	 * @return true if the baseline was saved; false otherwise
+	 */
+	bool Save();
+
+	/**
+	 * Stops using or capturing a baseline, discarding any loaded or captured artifacts. Used between
+	 * jobs when running as an agent, so that a job only uses a baseline if it asks to.
+	 */
+	void Disable();
+
+	/**
+	 * Indicates whether a baseline is being captured or used.
+	 *
+	 * @return true if a baseline is being captured or used; false otherwise
+	 */
+	bool IsEnabled() const;
+
+	/**
+	 * Checks whether a registry value is in the baseline. When capturing, the value is recorded instead.
+	 *
+	 * @param value The registry value to check
+	 *
+	 * @return true if the value is in the baseline and can be skipped; false otherwise
+	 */
+	bool Contains(const Registry::RegistryValue& value);
+
+	/**
+	 * Checks whether a file is in the baseline. When capturing, the file is recorded instead.
+	 *
+	 * @param file The file to check
+	 *
+	 * @return true if the file is in the baseline and can be skipped; false otherwise
+	 */
+	bool Contains(const FileSystem::File& file);
+
+	/**
+	 * Retrieves the number of artifacts found in the baseline
+	 *
+	 * @return The number of artifacts skipped because they are in the baseline
+	 */
+	DWORD GetArtifactsMatched() const;
+
+	/**
+	 * Retrieves the number of artifacts checked against or recorded in the baseline
+	 *
+	 * @return The number of artifacts checked
+	 */
+	DWORD GetArtifactsChecked() const;
+
+	/**
+	 * Normalizes a path or registry key name so that it matches across machines and users: the path is
+	 * lowercased, user SIDs are replaced with a placeholder, and paths under the profiles directory have
+	 * the name of the profile replaced with a placeholder.
+	 *
+	 * @param path The path to normalize
+	 *
+	 * @return The normalized path
+	 */
+	static std::wstring NormalizePath(const std::wstring& path);
+};
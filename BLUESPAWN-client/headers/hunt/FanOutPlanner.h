@@ -0,0 +1,144 @@
+#pragma once
+#include <Windows.h>
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <optional>
+#include <unordered_map>
+
+#include "util/configurations/Registry.h"
+
+#include "common/wrappers.hpp"
+
+namespace Registry {
+
+	/**
+	 * Resolves a logical registry path, such as a Run key under HKEY_LOCAL_MACHINE, into the physical keys a
+	 * check of it must read: the key itself, its WoW64 view, and the same path under each user's hive. Keys
+	 * reached more than one way, such as a path whose WoW64 view isn't redirected, are only returned once;
+	 * duplicates are recognized by their kernel names in a hash set.
+	 *
+	 * During a run (see BeginFanOutPlanning), the user hives are enumerated once, and each logical path is
+	 * resolved once no matter how many checks read it. While monitoring (see BeginMonitoring), the user hives
+	 * are kept until a user logs on or off and InvalidateUserHives is called. Otherwise, everything is resolved
+	 * on each call. All methods are safe to call from multiple threads at once.
+	 */
+	class FanOutPlanner {
+	private:
+		static FanOutPlanner instance;
+
+		/// The number of callers that currently have a run in progress
+		LONG lRuns;
+
+		/// Whether the system is being monitored, in which case the user hives are kept between runs
+		bool bMonitoring;
+
+		/// The user hives, once enumerated during the current run or while monitoring
+		std::optional<std::vector<RegistryKey>> vUserHives;
+
+		/// Incremented each time the user hives are invalidated, so that a list enumerated before then isn't kept
+		DWORD dwHiveGeneration;
+
+		/// The keys resolved for each logical path during the current run
+		std::unordered_map<std::wstring, std::vector<RegistryKey>> mResolved;
+
+		CriticalSection hSection;
+
+		/// The number of logical paths resolved, and the number of times a resolution was reused
+		std::atomic<DWORD> dwPathsResolved;
+		std::atomic<DWORD> dwPathsReused;
+
+		/// The number of physical keys skipped because they were reached more than one way
+		std::atomic<DWORD> dwDuplicatesSkipped;
+
+		FanOutPlanner();
+
+		/**
+		 * Enumerates the hives checked for each user: those loaded under HKEY_USERS, and those of users
+		 * who aren't logged on
+		 */
+		static std::vector<RegistryKey> EnumerateUserHives();
+
+	public:
+
+		/**
+		 * Retrieves the fan-out planner used by this process
+		 *
+		 * @return The instance of FanOutPlanner
+		 */
+		static FanOutPlanner& GetInstance();
+
+		/// Delete copy and move constructors and assignment operators
+		FanOutPlanner(const FanOutPlanner&) = delete;
+		FanOutPlanner& operator=(const FanOutPlanner&) = delete;
+		FanOutPlanner(FanOutPlanner&&) = delete;
+		FanOutPlanner& operator=(FanOutPlanner&&) = delete;
+
+		/**
+		 * Retrieves the hives checked for each user. During a run, these are only enumerated once; while
+		 * monitoring, they are only enumerated again once they are invalidated.
+		 *
+		 * @return The user hives
+		 */
+		std::vector<RegistryKey> GetUserHives();
+
+		/**
+		 * Resolves a logical path into the unique physical keys to check.
+		 *
+		 * @param hkHive The registry hive under which the path lies
+		 * @param path The path of the key
+		 * @param CheckWow64 If true, the WoW64 view of the key is included
+		 * @param CheckUsers If true, the key under each user's hive is included
+		 *
+		 * @return The key under hkHive, whether or not it exists, followed by every other key found that
+		 *         isn't the same physical key as one before it
+		 */
+		std::vector<RegistryKey> Resolve(HKEY hkHive, const std::wstring& path, bool CheckWow64, bool CheckUsers);
+
+		/// Starts a run, until a matching call to EndRun
+		void BeginRun();
+
+		/// Ends a run once every caller that started one has ended it, discarding everything resolved
+		void EndRun();
+
+		/// Keeps the user hives, once enumerated, until InvalidateUserHives is called, for the life of the process
+		void BeginMonitoring();
+
+		/**
+		 * Discards the user hives, so that they are enumerated again the next time they are needed. This should
+		 * be called when a user logs on or off, loading or unloading their hive.
+		 */
+		void InvalidateUserHives();
+
+		/**
+		 * Retrieves the number of logical paths resolved and the number of resolutions reused
+		 *
+		 * @return A pair holding the number of paths resolved and the number of resolutions reused
+		 */
+		std::pair<DWORD, DWORD> GetPathCounts() const;
+
+		/**
+		 * Retrieves the number of physical keys skipped because they were reached more than one way
+		 *
+		 * @return The number of duplicate keys skipped
+		 */
+		DWORD GetDuplicatesSkipped() const;
+	};
+
+	/**
+	 * Starts a run of the fan-out planner for the lifetime of this object. Runs may be nested and may be
+	 * started on multiple threads; resolutions are discarded once the last of them ends.
+	 */
+	class BeginFanOutPlanning {
+	public:
+		BeginFanOutPlanning();
+		~BeginFanOutPlanning();
+
+		/// Delete copy and move constructors and assignment operators
+		BeginFanOutPlanning(const BeginFanOutPlanning&) = delete;
+		BeginFanOutPlanning& operator=(const BeginFanOutPlanning&) = delete;
+		BeginFanOutPlanning(BeginFanOutPlanning&&) = delete;
+		BeginFanOutPlanning& operator=(BeginFanOutPlanning&&) = delete;
+	};
+}
@@ -3,9 +3,18 @@
 
 #include <string>
 #include <chrono>
+#include <memory>
+#include <optional>
 
 #include "Scope.h"
 #include "HuntInfo.h"
+#include "ArtifactSnapshot.h"
+#include "HuntState.h"
+#include "LayerResults.h"
+#include "Baseline.h"
+
+#include "util/filesystem/FileSystem.h"
+#include "util/threadpool/AsyncResult.h"
 
 #include "reaction/Reaction.h"
 #include "monitor/Event.h"
@@ -26,6 +35,124 @@ protected:
 
 	std::wstring name;
 
+	/**
+	 * Retrieves the artifact snapshot shared by the hunts in the current run. If the hunt isn't being
+	 * run by HuntRegister::RunHunts (i.e. it was triggered by monitoring), a new snapshot is created.
+	 *
+	 * @param scope The scope of the scan. A new snapshot limits this hunt's registry rules to it, so that a
+	 *        scan triggered by a change only evaluates the rules on the values that changed. The snapshot
+	 *        shared by a run is already limited to the scope of the run.
+	 *
+	 * @return The artifact snapshot to use for this scan
+	 */
+	std::shared_ptr<const ArtifactSnapshot> GetArtifacts(const Scope& scope = Scope{}) const;
+
+	/**
+	 * Adds a rule to the registry plan on behalf of this hunt. Rules should be added when the hunt is
+	 * constructed; the plan only evaluates the rules of the hunts being run.
+	 *
+	 * @param rule The rule to add
+	 *
+	 * @return The identifier of the rule, used to retrieve its findings from the artifact snapshot
+	 */
+	SIZE_T AddRegistryRule(Registry::RegistryRule&& rule);
+
+	/**
+	 * Checks whether this hunt needs to evaluate a file. Files in the baseline are always skipped. In
+	 * incremental mode, a file that this hunt found clean in a previous run is also skipped if neither
+	 * the file nor the rules have changed since.
+	 *
+	 * @param file The file to be evaluated
+	 * @param context Anything else the verdict depends on, such as the aggressiveness of the scan
+	 *
+	 * @return true if the file must be evaluated; false if the evaluation can be skipped
+	 */
+	bool FileNeedsEvaluation(const FileSystem::File& file, const std::wstring& context = {}) const;
+
+	/**
+	 * Records the verdict this hunt reached for a file so that later incremental runs can skip it
+	 *
+	 * @param file The file that was evaluated
+	 * @param verdict The verdict reached for the file
+	 * @param context Anything else the verdict depends on, such as the aggressiveness of the scan
+	 */
+	void RecordFileVerdict(const FileSystem::File& file, HuntState::Verdict verdict, const std::wstring& context = {}) const;
+
+	/**
+	 * Checks whether a file is signed, and records the result as this hunt's verdict for the file.
+	 *
+	 * @param file The file to check
+	 *
+	 * @return true if the file is signed; false otherwise
+	 */
+	bool IsFileSigned(const FileSystem::File& file) const;
+
+	/**
+	 * Starts locating an executable and checking its signature on the IO executor. A hunt checking many
+	 * executables should start every lookup before waiting on any of them, so the lookups run at once.
+	 *
+	 * @param name The name or path of the executable, resolved with FileSystem::SearchPathExecutable
+	 *
+	 * @return The result of the lookup: the file if it exists and is unsigned; std::nullopt otherwise
+	 */
+	AsyncResult<std::optional<FileSystem::File>> FindUnsignedFileAsync(const std::wstring& name) const;
+
+	/**
+	 * Indicates whether the deadline for the current run has passed. Scans that can take a long time
+	 * should check this periodically and, once it has passed, stop and return the detections made so far.
+	 *
+	 * @return true if the run has a deadline that has passed; false otherwise
+	 */
+	bool IsPastDeadline() const;
+
+	/**
+	 * Marks the current run of the hunt as incomplete, such as when a collector failed partway through.
+	 * Incomplete runs are reported to the user and aren't used to estimate the hunt's cost.
+	 */
+	void MarkIncomplete();
+
+	/**
+	 * Scans a single level of a layered hunt. Hunts whose levels build on one another override this
+	 * and implement their ScanX functions by calling RunLayers. Each call should do only the work its
+	 * level adds to the levels below it, reusing their artifacts and verdicts through the layer results.
+	 *
+	 * @param level The level to scan
+	 * @param scope The scope of the hunt
+	 * @param reaction The reaction to notify of detections
+	 * @param results The artifacts and verdicts recorded by the levels scanned so far
+	 *
+	 * @return The number of detections made at this level, or -1 if the hunt has no layer at this level
+	 */
+	virtual int ScanLayer(Aggressiveness level, const Scope& scope, Reaction& reaction, LayerResults& results);
+
+	/**
+	 * Runs a layered hunt, scanning each supported level up to and including the level in the hunt
+	 * information with ScanLayer. The levels share a single set of layer results, so a level never
+	 * repeats the collection or evaluation already done by the levels below it.
+	 *
+	 * @param info Information about the hunt being run, including the level at which it is run
+	 * @param scope The scope of the hunt
+	 * @param reaction The reaction to notify of detections
+	 *
+	 * @return The total number of detections made
+	 */
+	int RunLayers(const HuntInfo& info, const Scope& scope, Reaction& reaction);
+
+private:
+	/// The snapshot shared by the hunts in the current run; set by HuntRegister for the duration of a run
+	std::shared_ptr<const ArtifactSnapshot> artifacts;
+
+	/// The time by which the current run must finish, if any; set by HuntRegister for the duration of a run
+	std::optional<std::chrono::steady_clock::time_point> deadline;
+
+	/// Set by MarkIncomplete; cleared by HuntRegister at the start of each run
+	bool bIncomplete;
+
+	/// The identifiers of the registry rules this hunt added to the registry plan
+	std::vector<SIZE_T> vRegistryRules;
+
+	friend class HuntRegister;
+
 public:
 	Hunt(const std::wstring& name);
 
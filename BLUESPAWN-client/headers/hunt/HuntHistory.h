@@ -0,0 +1,99 @@
+#pragma once
+#include <Windows.h>
+
+#include <string>
+#include <map>
+
+#include "HuntInfo.h"
+
+#include "common/wrappers.hpp"
+
+/**
+ * Keeps the cost and yield of past runs of each hunt at each aggressiveness level, persisted to a
+ * small local file. HuntRegister uses the history to estimate how long a hunt will take and how
+ * likely it is to find something, so that it can schedule the most valuable hunts first when running
+ * under a time budget.
+ *
+ * Costs and yields are exponentially weighted moving averages, so the estimates follow changes to
+ * the host over time. All methods are safe to call from multiple threads at once.
+ */
+class HuntHistory {
+private:
+
+	struct Entry {
+		double dAverageCostMs;
+		double dAverageDetections;
+		DWORD dwRuns;
+	};
+
+	/// The cost assumed for a hunt with no history
+	static const double dDefaultCostMs;
+
+	/// The weight given to the newest observation when updating the moving averages
+	static const double dSmoothing;
+
+	std::map<std::wstring, Entry> mEntries;
+	mutable CriticalSection hSection;
+
+	std::wstring wsPath;
+
+	static std::wstring GetKey(const std::wstring& hunt, Aggressiveness level);
+
+public:
+
+	/**
+	 * Loads the history from a file. If the file doesn't exist or can't be parsed, the history starts
+	 * out empty.
+	 *
+	 * @param path The path of the file holding the history
+	 *
+	 * @return true if the history was read from the file; false if it starts out empty
+	 */
+	bool Load(const std::wstring& path);
+
+	/**
+	 * Writes the history back to the file it was loaded from. The history is written to a temporary
+	 * file first and then moved over the existing file.
+	 *
+	 * @return true if the history was saved; false otherwise
+	 */
+	bool Save() const;
+
+	/**
+	 * Estimates the time a hunt will take at a given level, based on its previous runs
+	 *
+	 * @param hunt The name of the hunt
+	 * @param level The level at which the hunt will be run
+	 *
+	 * @return The expected cost in milliseconds
+	 */
+	double GetExpectedCost(const std::wstring& hunt, Aggressiveness level) const;
+
+	/**
+	 * Estimates the value of running a hunt at a given level. Every hunt is worth something, and hunts
+	 * that have found something in previous runs are worth more.
+	 *
+	 * @param hunt The name of the hunt
+	 * @param level The level at which the hunt will be run
+	 *
+	 * @return The expected value of the hunt
+	 */
+	double GetExpectedValue(const std::wstring& hunt, Aggressiveness level) const;
+
+	/**
+	 * Records a complete run of a hunt
+	 *
+	 * @param hunt The name of the hunt
+	 * @param level The level at which the hunt was run
+	 * @param dwCostMs The time the hunt took, in milliseconds
+	 * @param dwDetections The number of detections the hunt made
+	 */
+	void Record(const std::wstring& hunt, Aggressiveness level, DWORD64 dwCostMs, DWORD dwDetections);
+
+	/**
+	 * Retrieves the default location of the history: a file next to the BLUESPAWN executable
+	 *
+	 * @return The default path of the history
+	 */
+	static std::wstring GetDefaultPath();
+};
@@ -1,5 +1,9 @@
 #pragma once
 
+#include <optional>
+
+#include "util/accounting/ResourceUsage.h"
+
 enum class Tactic {
 	InitialAccess = 1,
 	Execution = 2,
@@ -52,5 +56,9 @@ struct HuntInfo {
 	DWORD HuntCategories;
 	DWORD HuntDatasources;
 	SYSTEMTIME HuntStartTime;
+
+	// The resources consumed by the hunt. This is only present in the summary record logged after a hunt finishes.
+	std::optional<Accounting::ResourceUsage> HuntUsage;
+
 	HuntInfo(const std::wstring& HuntName, Aggressiveness HuntAggressiveness, DWORD HuntTactics, DWORD HuntCategories, DWORD HuntDatasources);
 };
\ No newline at end of file
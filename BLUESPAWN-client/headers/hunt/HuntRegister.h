@@ -26,7 +26,19 @@ private:
 public:
 	HuntRegister(const IOBase& oIo);
 
-	void RunHunts(DWORD dwTactics, DWORD dwDataSource, DWORD dwAffectedThings, const Scope& scope, Aggressiveness aggressiveness, const Reaction& reaction, vector<string> vExcludedHunts, vector<string> vIncludedHunts);
+	/**
+	 * Runs every registered hunt that should run in parallel on a work-stealing thread pool. Each hunt
+	 * is isolated from faults in the others, and the log output of each hunt is buffered and reported
+	 * in the order in which the hunts were registered.
+	 *
+	 * Hunts are started in order of their expected value per unit of cost, based on the history of previous
+	 * runs. If a time budget is given, hunts that aren't expected to finish in the time remaining are skipped,
+	 * and long-running hunts stop early once the budget is exhausted. The coverage achieved is reported.
+	 *
+	 * @param dwWorkers The number of hunts to run at once. If zero, one hunt is run per logical processor.
+	 * @param dwTimeBudget The number of seconds the run may take. If zero, the run isn't time limited.
+	 */
+	void RunHunts(DWORD dwTactics, DWORD dwDataSource, DWORD dwAffectedThings, const Scope& scope, Aggressiveness aggressiveness, const Reaction& reaction, vector<string> vExcludedHunts, vector<string> vIncludedHunts, DWORD dwWorkers = 0, DWORD dwTimeBudget = 0);
 	void RunHunt(Hunt& hunt, const Scope& scope, Aggressiveness aggressiveness, const Reaction& reaction);
 
 	bool HuntRegister::HuntShouldRun(Hunt& hunt, vector<string> vExcludedHunts, vector<string> vIncludedHunts);
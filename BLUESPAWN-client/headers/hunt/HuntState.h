@@ -0,0 +1,145 @@
+#pragma once
+#include <Windows.h>
+
+#include <string>
+#include <unordered_map>
+#include <atomic>
+
+#include "common/wrappers.hpp"
+
+/**
+ * The verdicts reached by hunts in previous runs, persisted to disk between runs for incremental mode.
+ * Before performing an expensive evaluation of an artifact (such as verifying the signature of a file
+ * and scanning it with YARA), a hunt can check whether the artifact was found clean by a previous run.
+ * If neither the artifact nor the rules used to evaluate it have changed since, the evaluation can be
+ * skipped. Artifacts that were found suspicious are always evaluated again so that they keep being
+ * reported.
+ *
+ * Artifacts are identified by a key, which should include the name of the hunt evaluating them, and a
+ * fingerprint of the artifact's current state. The rules are identified by a fingerprint of the
+ * BLUESPAWN image and its YARA rules, so any new build or rule update invalidates every verdict.
+ *
+ * All methods are safe to call from multiple threads at once.
+ */
+class HuntState {
+public:
+	enum class Verdict : DWORD {
+		Clean,
+		Suspicious
+	};
+
+private:
+	static HuntState instance;
+
+	/// A single verdict, as stored on disk. Keys are hashed to keep the store compact
+	struct Record {
+		DWORD64 dwKey;
+		DWORD64 dwFingerprint;
+		DWORD64 dwRulesFingerprint;
+		DWORD dwLastSeenRun;
+		Verdict verdict;
+	};
+
+	/// Records not seen for this many runs are dropped when the store is saved
+	static const DWORD dwRecordLifetime;
+
+	std::unordered_map<DWORD64, Record> mRecords;
+	CriticalSection hSection;
+
+	std::wstring wsPath;
+	bool bEnabled;
+
+	/// The number of the current run, incremented each time the store is loaded
+	DWORD dwRun;
+
+	/// The fingerprint of the rules in use for this run
+	DWORD64 dwRulesFingerprint;
+
+	/// The number of artifacts skipped because they were unchanged, and the number that were evaluated
+	std::atomic<DWORD> dwArtifactsSkipped;
+	std::atomic<DWORD> dwArtifactsEvaluated;
+
+	HuntState();
+
+public:
+
+	static HuntState& GetInstance();
+
+	HuntState(const HuntState&) = delete;
+	HuntState operator=(const HuntState&) = delete;
+
+	/**
+	 * Loads the store from a file and enables incremental mode. If the file doesn't exist or can't be
+	 * parsed, the store starts out empty. The file is opened with FileSystem::OpenProtectedFile, so a file
+	 * which users other than SYSTEM and Administrators could write is refused, since its records decide
+	 * which files are never evaluated again.
+	 *
+	 * @param path The path of the file holding the store
+	 *
+	 * @return true if the store was read from the file; false if it starts out empty
+	 */
+	bool Load(const std::wstring& path);
+
+	/**
+	 * Writes the store back to the file it was loaded from, dropping records that haven't been seen
+	 * recently. The store is written to a temporary file first and then moved over the existing file,
+	 * so an interrupted save leaves the previous store intact.
+	 *
+	 * @return true if the store was saved; false otherwise
+	 */
+	bool Save();
+
+	/**
+	 * Disables incremental mode and discards the loaded store without saving it. Used between jobs
+	 * when running as an agent, so that a job only runs incrementally if it asks to.
+	 */
+	void Disable();
+
+	/**
+	 * Indicates whether incremental mode is enabled (i.e. a store has been loaded)
+	 *
+	 * @return true if incremental mode is enabled; false otherwise
+	 */
+	bool IsEnabled() const;
+
+	/**
+	 * Checks whether an artifact was found clean by a previous run, and neither it nor the rules have
+	 * changed since. Always returns false if incremental mode is disabled.
+	 *
+	 * @param key The key identifying the artifact
+	 * @param dwFingerprint The fingerprint of the artifact's current state
+	 *
+	 * @return true if the artifact's evaluation can be skipped; false if it must be evaluated
+	 */
+	bool IsUnchanged(const std::wstring& key, DWORD64 dwFingerprint);
+
+	/**
+	 * Records the verdict reached for an artifact. Does nothing if incremental mode is disabled.
+	 *
+	 * @param key The key identifying the artifact
+	 * @param dwFingerprint The fingerprint of the artifact's current state
+	 * @param verdict The verdict reached for the artifact
+	 */
+	void RecordVerdict(const std::wstring& key, DWORD64 dwFingerprint, Verdict verdict);
+
+	/**
+	 * Retrieves the number of artifacts whose evaluation was skipped in this run
+	 *
+	 * @return The number of artifacts skipped
+	 */
+	DWORD GetArtifactsSkipped() const;
+
+	/**
+	 * Retrieves the number of artifacts that had to be evaluated in this run
+	 *
+	 * @return The number of artifacts evaluated
+	 */
+	DWORD GetArtifactsEvaluated() const;
+
+	/**
+	 * Retrieves the default location of the store: a file next to the BLUESPAWN executable
+	 *
+	 * @return The default path of the store
+	 */
+	static std::wstring GetDefaultPath();
+};
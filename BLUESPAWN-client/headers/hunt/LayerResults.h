@@ -0,0 +1,90 @@
+#pragma once
+#include <Windows.h>
+
+#include <string>
+#include <map>
+#include <memory>
+#include <optional>
+#include <functional>
+
+#include "HuntState.h"
+
+/**
+ * The artifacts and verdicts shared between the levels of a layered hunt (see Hunt::RunLayers). When
+ * a layered hunt is run at some level, each supported level up to and including it is scanned in turn,
+ * and every level receives the same LayerResults. A level can then reuse the artifacts collected by
+ * the levels below it instead of collecting them again, and can skip the artifacts those levels have
+ * already judged, so that a higher level only pays for the checks it adds.
+ *
+ * A LayerResults lives only as long as a single scan, and is used by a single thread.
+ */
+class LayerResults {
+private:
+
+	/// Collected artifacts, keyed by name. The type of each artifact is known only to the hunt using it.
+	std::map<std::wstring, std::shared_ptr<void>> mArtifacts;
+
+	/// Verdicts reached for artifacts, keyed by an identifier of the artifact chosen by the hunt
+	std::map<std::wstring, HuntState::Verdict> mVerdicts;
+
+	/// The number of requests served from artifacts and verdicts recorded by an earlier level
+	DWORD dwArtifactsReused;
+	DWORD dwVerdictsReused;
+
+public:
+
+	LayerResults();
+
+	/**
+	 * Retrieves an artifact, collecting it first if no lower level has collected it. The same type must
+	 * be used every time an artifact with a given name is retrieved.
+	 *
+	 * @param name The name of the artifact
+	 * @param collector A function collecting the artifact
+	 *
+	 * @return A reference to the artifact, valid for the lifetime of this object
+	 */
+	template<class T>
+	T& GetArtifact(const std::wstring& name, const std::function<T()>& collector){
+		auto artifact{ mArtifacts.find(name) };
+		if(artifact != mArtifacts.end()){
+			dwArtifactsReused++;
+			return *std::static_pointer_cast<T>(artifact->second);
+		}
+
+		auto value{ std::make_shared<T>(collector()) };
+		mArtifacts.emplace(name, value);
+		return *value;
+	}
+
+	/**
+	 * Retrieves the verdict a lower level reached for an artifact.
+	 *
+	 * @param artifact The identifier of the artifact
+	 *
+	 * @return The verdict if one has been recorded; std::nullopt otherwise
+	 */
+	std::optional<HuntState::Verdict> GetVerdict(const std::wstring& artifact);
+
+	/**
+	 * Records the verdict reached for an artifact, replacing any verdict recorded for it earlier.
+	 *
+	 * @param artifact The identifier of the artifact
+	 * @param verdict The verdict reached
+	 */
+	void RecordVerdict(const std::wstring& artifact, HuntState::Verdict verdict);
+
+	/**
+	 * Retrieves the number of artifact requests served without collecting anything.
+	 *
+	 * @return The number of artifacts reused
+	 */
+	DWORD GetArtifactsReused() const;
+
+	/**
+	 * Retrieves the number of verdict requests served with a verdict recorded earlier.
+	 *
+	 * @return The number of verdicts reused
+	 */
+	DWORD GetVerdictsReused() const;
+};
@@ -6,6 +6,7 @@
 #include <vector>
 #include <functional>
 #include <string>
+#include <string_view>
 
 /**
  * Forward facing API for checking registry key values against known good or known bad values.
@@ -17,10 +18,14 @@
 
 namespace Registry {
 
-	typedef std::function<bool(const std::wstring&, const std::wstring&)> REG_SZ_CHECK;
+	/**
+	 * Checks are passed views of the data read from the registry, along with the data they were constructed
+	 * with, so that values can be checked without being copied; only the values reported are copied.
+	 */
+	typedef std::function<bool(std::wstring_view, const std::wstring&)> REG_SZ_CHECK;
 	typedef std::function<bool(DWORD, DWORD)> REG_DWORD_CHECK;
-	typedef std::function<bool(const AllocationWrapper&, const AllocationWrapper&)> REG_BINARY_CHECK;
-	typedef std::function<bool(const std::vector<std::wstring>&, const std::vector<std::wstring>&)> REG_MULTI_SZ_CHECK;
+	typedef std::function<bool(const ValueView&, const AllocationWrapper&)> REG_BINARY_CHECK;
+	typedef std::function<bool(const MultiStringView&, const std::vector<std::wstring>&)> REG_MULTI_SZ_CHECK;
 
 	extern REG_SZ_CHECK CheckSzEqual;
 	extern REG_SZ_CHECK CheckSzRegexMatch;
@@ -40,7 +45,8 @@ namespace Registry {
 	extern REG_MULTI_SZ_CHECK CheckMultiSzEmpty; 
 
 	/**
-	 * A container class for registry values and associated data.
+	 * A container class for registry values and associated data. A check built with CheckSzRegexMatch or
+	 * CheckSzRegexNotMatch compiles its pattern when it is built rather than each time a value is checked.
 	 */
 	struct RegistryCheck {
 		std::wstring name;
@@ -59,7 +65,14 @@ namespace Registry {
 
 		RegistryType GetType() const;
 
-		bool operator()(const RegistryData& data) const;
+		/**
+		 * Checks the data of a value, interpreting it as the type of data this check was constructed with
+		 *
+		 * @param view A view of the value's data
+		 *
+		 * @return true if the data is valid; false otherwise
+		 */
+		bool operator()(const ValueView& view) const;
 	};
 
 	/**
@@ -103,4 +116,14 @@ namespace Registry {
 	 * @return A vector containing a RegistryValue object for each RegistryCheck that didn't match its valid conditions
 	 */
 	std::vector<RegistryKey> CheckSubkeys(const HKEY& hkHive, const std::wstring& path, bool CheckWow64 = true, bool CheckUsers = true);
+
+	/**
+	 * Removes the values present in the baseline, if one is in use. When a baseline is being captured,
+	 * the values are recorded in it and none are removed.
+	 *
+	 * @param values The values identified by a check
+	 *
+	 * @return The values not present in the baseline
+	 */
+	std::vector<RegistryValue> RemoveBaselinedValues(std::vector<RegistryValue>&& values);
 }
\ No newline at end of file
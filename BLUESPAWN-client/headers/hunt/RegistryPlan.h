@@ -0,0 +1,142 @@
+#pragma once
+#include <Windows.h>
+
+#include <string>
+#include <vector>
+
+#include "RegistryHunt.h"
+
+#include "common/wrappers.hpp"
+
+class Scope;
+
+namespace Registry {
+
+	/// How serious a finding from a registry rule is
+	enum class RuleSeverity {
+		Low,
+		Medium,
+		High
+	};
+
+	/**
+	 * A declarative registry check: a key, a check of one value under it, and how serious a value failing
+	 * the check is. A rule finds the same values as calling CheckValues with its key and check would.
+	 *
+	 * If the path ends with "\*", the check is applied to the value under each immediate subkey of the
+	 * path instead, as when checking every Image File Execution Options key.
+	 */
+	struct RegistryRule {
+		HKEY hkHive;
+		std::wstring path;
+		RegistryCheck check;
+		RuleSeverity severity;
+
+		bool CheckWow64;
+		bool CheckUsers;
+
+		/**
+		 * Creates a registry rule
+		 *
+		 * @param hkHive The registry hive under which the path lies
+		 * @param path The path to the key under the given hive, optionally ending in "\*"
+		 * @param check The check to apply to the value
+		 * @param severity How serious a value failing the check is
+		 * @param CheckWow64 If true, the WoW64 version of the key is also checked
+		 * @param CheckUsers If true, the key is also checked under each user's hive
+		 */
+		RegistryRule(HKEY hkHive, const std::wstring& path, RegistryCheck&& check, RuleSeverity severity = RuleSeverity::Medium,
+			bool CheckWow64 = true, bool CheckUsers = true);
+
+		/// Indicates whether the rule applies to each subkey of its path rather than the path itself
+		bool AppliesToSubkeys() const;
+	};
+
+	/**
+	 * The registry rules declared by all hunts, compiled into a single query plan. Hunts add their rules when
+	 * they are constructed, and the plan is compiled the first time it is executed. Compiling groups the rules
+	 * by key, so when the plan is executed each key is opened once, each value under it is read once, and every
+	 * rule on that value is evaluated against the same read, no matter how many hunts check it. Keys reached
+	 * through different paths (such as HKEY_CURRENT_USER and the current user's hive under HKEY_USERS) are
+	 * recognized as the same key, and the user hives are enumerated once for the whole plan rather than once
+	 * per check.
+	 *
+	 * The plan is executed once per run through the artifact snapshot (see ArtifactSnapshot::GetRuleFindings),
+	 * evaluating the rules of the hunts in the run.
+	 * All methods are safe to call from multiple threads at once.
+	 */
+	class RegistryPlan {
+	public:
+
+		/// The values found by each rule, indexed by the rule's identifier
+		using Findings = std::vector<std::vector<RegistryValue>>;
+
+	private:
+		static RegistryPlan instance;
+
+		/// A key under which rules are evaluated, along with the rules grouped under it
+		struct PlanKey {
+			HKEY hkHive;
+			std::wstring path;
+			bool bSubkeys;
+
+			/// The identifiers of the rules on this key
+			std::vector<SIZE_T> vRules;
+		};
+
+		std::vector<RegistryRule> vRules;
+
+		/// The compiled plan; rebuilt if rules are added after it is compiled
+		std::vector<PlanKey> vPlan;
+		bool bCompiled;
+
+		CriticalSection hSection;
+
+		RegistryPlan();
+
+		/**
+		 * Groups the rules by key. Must be called in hSection.
+		 */
+		void Compile();
+
+	public:
+
+		/**
+		 * Retrieves the registry plan used by this process
+		 *
+		 * @return The instance of RegistryPlan
+		 */
+		static RegistryPlan& GetInstance();
+
+		/// Delete copy and move constructors and assignment operators
+		RegistryPlan(const RegistryPlan&) = delete;
+		RegistryPlan& operator=(const RegistryPlan&) = delete;
+		RegistryPlan(RegistryPlan&&) = delete;
+		RegistryPlan& operator=(RegistryPlan&&) = delete;
+
+		/**
+		 * Adds a rule to the plan. Rules should be added through Hunt::AddRegistryRule when the hunt declaring them
+		 * is constructed, so that they're evaluated only when that hunt is run.
+		 *
+		 * @param rule The rule to add
+		 *
+		 * @return The identifier of the rule, used to retrieve its findings
+		 */
+		SIZE_T AddRule(RegistryRule&& rule);
+
+		/**
+		 * Executes the plan, compiling it first if needed. Only the given rules are evaluated, so that hunts
+		 * which aren't being run neither open keys nor report findings.
+		 *
+		 * @param hkUserHives The user hives under which rules checking users are evaluated
+		 * @param vSelectedRules The identifiers of the rules to evaluate
+		 * @param lpScope If given, only the keys and values in this scope are read, such as the values whose
+		 *        change triggered a scan while monitoring
+		 *
+		 * @return The values found by each rule, with any values in the baseline removed. Rules which weren't
+		 *         evaluated find nothing.
+		 */
+		Findings Execute(const std::vector<RegistryKey>& hkUserHives, const std::vector<SIZE_T>& vSelectedRules,
+			const Scope* lpScope = nullptr);
+	};
+}
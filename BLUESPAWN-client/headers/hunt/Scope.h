@@ -1,33 +1,240 @@
 #pragma once
 #include <Windows.h>
 #include <vector>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace FileSystem {
+	class File;
+}
+
+namespace Registry {
+	class RegistryKey;
+	struct RegistryValue;
+}
 
 /**
- * Used to define the scope of a hunt. Currently, this operates by requiring the programmer to
- * define a new class for each new scope. This is less than ideal, as scopes should eventually 
- * be defined by the end user. Future implementation will allow the programmer to pass in lambdas
- * which will be handled by the functions built in to the class, removing the need for new scopes.
+ * Used to define the scope of a hunt. A default constructed scope is unrestricted, and includes
+ * everything on the system. Files, registry keys, processes, services, and users can then be added
+ * to restrict the scope to just those items. Once anything has been added, only what was added is
+ * in scope: for example, a scope restricted to a single directory tree includes no registry keys or
+ * processes. Adding a user includes their profile directory and registry hives, and adding a service
+ * includes its registry key. Adding a single registry value includes that value and the key holding
+ * it, but not the key's other values.
+ *
+ * Time windows further filter the scope, independently of the other restrictions. When time windows
+ * are present, only files modified, registry keys written, and processes started within one of the
+ * windows are in scope.
+ *
+ * The scope is compiled as it is built, so that checking an item is cheap: paths and registry keys
+ * are matched against a case-insensitive trie of path components, and times are matched against a
+ * sorted set of disjoint intervals.
  */
 class Scope {
+private:
+
+	/**
+	 * A case-insensitive trie of path components, used to check whether a path lies under any of a set
+	 * of prefixes. Both \ and / are treated as separators.
+	 */
+	class PathTrie {
+		struct Node {
+			std::unordered_map<std::wstring, SIZE_T> children{};
+			bool bTerminal{ false };
+		};
+
+		/// The nodes of the trie, with the root at index 0. Nodes refer to their children by index
+		std::vector<Node> vNodes{ Node{} };
+
+		static std::vector<std::wstring> Split(const std::wstring& path);
+
+	public:
+
+		/// Adds a prefix to the trie
+		void Insert(const std::wstring& path);
+
+		/// Checks whether a path is equal to or under one of the prefixes in the trie
+		bool Contains(const std::wstring& path) const;
+
+		/// Checks whether a path is equal to or under one of the prefixes, or is an ancestor of one
+		bool Overlaps(const std::wstring& path) const;
+	};
+
+	/// Whether anything has been added to restrict the scope
+	bool bRestricted{ false };
+
+	PathTrie paths{};
+	PathTrie keys{};
+	std::unordered_set<DWORD> pids{};
+	std::unordered_set<std::wstring> services{};
+	std::unordered_set<std::wstring> users{};
+
+	/// The lowercase names of the values added to the scope, by the lowercase name of the key holding them
+	std::unordered_map<std::wstring, std::unordered_set<std::wstring>> values{};
+
+	/// Disjoint time windows, as pairs of 100-nanosecond intervals since 1601, sorted by start time
+	std::vector<std::pair<ULONGLONG, ULONGLONG>> vTimeWindows{};
+
+	/// The paths, keys, and services added to the scope, kept for the GetScoped* functions
+	std::vector<std::wstring> vFileNames{};
+	std::vector<std::wstring> vKeyNames{};
+	std::vector<std::wstring> vServiceNames{};
+
+	/// Narrow copies of the above, backing the LPCSTRs returned by the GetScoped* functions
+	std::vector<std::string> vNarrowFileNames{};
+	std::vector<std::string> vNarrowKeyNames{};
+	std::vector<std::string> vNarrowServiceNames{};
+
+	/// Converts a registry path to the form returned by RegistryKey::GetName
+	static std::wstring NormalizeKeyPath(const std::wstring& path);
+
+	/// Checks whether a key, given as returned by RegistryKey::GetName, was added or holds values that were
+	bool KeyIsScoped(const std::wstring& name) const;
+
 public:
+
+	/**
+	 * Adds a file or a directory tree to the scope. Environment variables in the path are expanded.
+	 *
+	 * @param path The path of the file or directory
+	 *
+	 * @return A reference to this scope
+	 */
+	Scope& AddPath(const std::wstring& path);
+
+	/**
+	 * Adds a registry key and all of its subkeys to the scope. The path may begin with either the full
+	 * or abbreviated name of a hive, such as HKEY_LOCAL_MACHINE or HKLM.
+	 *
+	 * @param path The path of the registry key
+	 *
+	 * @return A reference to this scope
+	 */
+	Scope& AddRegistryKey(const std::wstring& path);
+
+	/**
+	 * Adds a single registry value to the scope. The key holding the value is in scope, but its other
+	 * values and its subkeys aren't.
+	 *
+	 * @param key The key holding the value
+	 * @param name The name of the value
+	 *
+	 * @return A reference to this scope
+	 */
+	Scope& AddRegistryValue(const Registry::RegistryKey& key, const std::wstring& name);
+
+	/**
+	 * Adds a process to the scope.
+	 *
+	 * @param pid The PID of the process
+	 *
+	 * @return A reference to this scope
+	 */
+	Scope& AddProcess(DWORD pid);
+
+	/**
+	 * Adds a service to the scope, along with its key under HKLM\SYSTEM\CurrentControlSet\Services.
+	 *
+	 * @param name The name of the service
+	 *
+	 * @return A reference to this scope
+	 */
+	Scope& AddService(const std::wstring& name);
+
+	/**
+	 * Adds a user to the scope, along with their profile directory and registry hives. The user may be
+	 * given by name or by SID.
+	 *
+	 * @param user The name or SID of the user
+	 *
+	 * @return A reference to this scope
+	 */
+	Scope& AddUser(const std::wstring& user);
+
+	/**
+	 * Adds a time window to the scope. Overlapping windows are merged.
+	 *
+	 * @param start The start of the window
+	 * @param end The end of the window
+	 *
+	 * @return A reference to this scope
+	 */
+	Scope& AddTimeWindow(const FILETIME& start, const FILETIME& end);
+
+	/**
+	 * Indicates whether nothing has been added to this scope, so that everything is in scope.
+	 *
+	 * @return true if the scope is unrestricted; false otherwise
+	 */
+	bool IsUnrestricted() const;
+
+	/**
+	 * Checks whether a time falls within the time windows of this scope. If there are no time windows,
+	 * every time is in scope.
+	 *
+	 * @param time The time to check
+	 *
+	 * @return true if the time is in scope; false otherwise
+	 */
+	bool TimeIsInScope(const FILETIME& time) const;
+
+	/**
+	 * Checks whether a directory may contain files in scope, so that walks of directories that
+	 * can't contain anything in scope can be skipped entirely.
+	 *
+	 * @param path The path of the directory
+	 *
+	 * @return true if the directory or one of its descendants may be in scope; false otherwise
+	 */
+	bool FolderIsInScope(const std::wstring& path) const;
+
 	virtual bool FileIsInScope(LPCSTR sFileName) const;
+	virtual bool FileIsInScope(const std::wstring& path) const;
+	virtual bool FileIsInScope(const FileSystem::File& file) const;
 	virtual bool FileIsInScope(HANDLE hFile) const;
+
+	/// Opens a handle to each file in scope. The caller is responsible for closing the handles.
 	virtual std::vector<HANDLE> GetScopedFileHandles() const;
 	virtual std::vector<LPCSTR> GetScopedFileNames() const;
 
 	virtual bool RegistryKeyIsInScope(LPCSTR sKeyPath) const;
+	virtual bool RegistryKeyIsInScope(const Registry::RegistryKey& key) const;
 	virtual bool RegistryKeyIsInScope(HKEY key) const;
+
+	/**
+	 * Checks whether a registry value is in scope, either because it was added or because its key was.
+	 *
+	 * @param value The value to check
+	 *
+	 * @return true if the value is in scope; false otherwise
+	 */
+	virtual bool RegistryValueIsInScope(const Registry::RegistryValue& value) const;
+
+	/// Opens a handle to each registry key in scope. The caller is responsible for closing the handles.
 	virtual std::vector<HKEY> GetScopedKHEYs() const;
 	virtual std::vector<LPCSTR> GetScopedRegKeyNames() const;
 
 	virtual bool ProcessIsInScope(DWORD pid) const;
 	virtual bool ProcessIsInScope(HANDLE hProcess) const;
+
+	/// Opens a handle to each process in scope. The caller is responsible for closing the handles.
 	virtual std::vector<HANDLE> GetScopedProcessHandles() const;
 	virtual std::vector<DWORD> GetScopedProcessPIDs() const;
 
 	virtual bool ServiceIsInScope(LPCSTR sServiceName) const;
 	virtual bool ServiceIsInScope(SC_HANDLE hService) const;
+
+	/// Opens a handle to each service in scope. The caller is responsible for closing the handles.
 	virtual std::vector<SC_HANDLE> GetScopedServiceHandles() const;
 	virtual std::vector<LPCSTR> GetScopedServiceNames() const;
-};
 
+	/**
+	 * Checks whether a user is in scope.
+	 *
+	 * @param user The name or SID of the user
+	 *
+	 * @return true if the user is in scope; false otherwise
+	 */
+	virtual bool UserIsInScope(const std::wstring& user) const;
+};
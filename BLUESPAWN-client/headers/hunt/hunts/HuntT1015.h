@@ -20,8 +20,15 @@ namespace Hunts {
 		std::wstring wsIFEO = L"SOFTWARE\\Microsoft\\Windows NT\\CurrentVersion\\Image File Execution Options\\";
 		std::wstring wsIFEOWow64 = L"SOFTWARE\\Wow6432Node\\Microsoft\\Windows NT\\CurrentVersion\\Image File Execution Options\\";
 
-		int HuntT1015::EvaluateRegistry(Reaction& reaction);
-		int HuntT1015::EvaluateFiles(Reaction& reaction, bool bScanYara);
+		/// The registry rules checking for a Debugger value for each accessibility binary
+		std::vector<SIZE_T> vDebuggerRules;
+
+		int HuntT1015::EvaluateRegistry(const Scope& scope, Reaction& reaction);
+		int HuntT1015::EvaluateFiles(const Scope& scope, Reaction& reaction, LayerResults& results);
+
+	protected:
+		virtual int ScanLayer(Aggressiveness level, const Scope& scope, Reaction& reaction, LayerResults& results) override;
+
 	public:
 		HuntT1015();
 
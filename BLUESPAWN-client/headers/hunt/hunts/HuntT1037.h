@@ -21,12 +21,15 @@ namespace Hunts {
 					L".lnk", L".ps1", L".sct", L".vb", L".vbe", L".vbs", L".vbscript", L".hta" };
 
 		int HuntT1037::EvaluateStartupFile(FileSystem::File file, Reaction& reaction, Aggressiveness level);
+		std::vector<Registry::RegistryValue> GetStartupValues();
+		std::vector<FileSystem::File> GetStartupFiles(const std::vector<Registry::RegistryValue>& values);
+
+	protected:
+		virtual int ScanLayer(Aggressiveness level, const Scope& scope, Reaction& reaction, LayerResults& results) override;
+
 	public:
 		HuntT1037();
 
-		int AnalyzeRegistryStartupKey(Reaction reaction, Aggressiveness level);
-		int AnalayzeStartupFolders(Reaction reaction, Aggressiveness level);
-
 		virtual int ScanCursory(const Scope& scope, Reaction reaction);
 		virtual int ScanNormal(const Scope& scope, Reaction reaction);
 		virtual int ScanIntensive(const Scope& scope, Reaction reaction);
@@ -10,10 +10,14 @@ namespace Hunts {
 	 *
 	 * @scans Cursory Scan not supported.
 	 * @scans Normal checks System logs for event id 7045 for new events
-	 * @scans Intensive checks System logs for event id 7045 for new events
+	 * @scans Intensive checks System logs for event id 7045 for new events, building on the Normal scan
+	 *     by also flagging services with missing images or unusual names
 	 * @monitor Triggers a hunt whenever System log event ID 7045 is generated
 	 */
 	class HuntT1050 : public Hunt {
+	protected:
+		virtual int ScanLayer(Aggressiveness level, const Scope& scope, Reaction& reaction, LayerResults& results) override;
+
 	public:
 		HuntT1050();
 
@@ -15,6 +15,12 @@ namespace Hunts {
 	class HuntT1060 : public Hunt {
 	private:
 		std::vector<std::wstring> RunKeys;
+
+		/// Registry rules for values whose data is launched at logon, and the Session Manager's BootExecute value
+		std::vector<SIZE_T> vWindowsRules;
+		std::vector<SIZE_T> vStartupRules;
+		SIZE_T dwBootExecuteRule;
+
 		int EvaluateFile(const std::wstring& wLaunchString, Reaction& reaction);
 
 	public:
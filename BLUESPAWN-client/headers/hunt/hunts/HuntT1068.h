@@ -14,7 +14,7 @@ namespace Hunts {
 	 */
 	class HuntT1068 : public Hunt {
 	private:
-		int HuntCVE20201048(Reaction reaction);
+		int HuntCVE20201048(const Scope& scope, Reaction reaction);
 	public:
 		HuntT1068();
 
@@ -17,6 +17,10 @@ namespace Hunts {
 	 * @scans Intensive Scan not supported.
 	 */
 	class HuntT1101 : public Hunt {
+	private:
+		/// The registry rules reading the security packages configured for LSA
+		std::vector<SIZE_T> vPackageRules;
+
 	public:
 		HuntT1101();
 
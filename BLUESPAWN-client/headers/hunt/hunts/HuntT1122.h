@@ -12,7 +12,9 @@ namespace Hunts{
 	 *
 	 * @scans Cursory Scan not supported.
 	 * @scans Normal Scan not supported.
-	 * @scans Intensive Enumerates all CLSID values in the registry to detect COM hijacking.
+	 * @scans Intensive Enumerates all CLSID values in the registry to detect COM hijacking. The registrations are
+	 *        kept in a ComRegistrationIndex. When --com-index is given, the index is persisted, so only classes changed since
+	 *        the last run are read again.
 	 */
 	class HuntT1122 : public Hunt {
 	public:
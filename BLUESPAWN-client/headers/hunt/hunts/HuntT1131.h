@@ -16,6 +16,10 @@ namespace Hunts {
 	 * @scans Intensive Scan not supported.
 	 */
 	class HuntT1131 : public Hunt {
+	private:
+		/// The registry rules reading the authentication and notification packages configured for LSA
+		std::vector<SIZE_T> vPackageRules;
+
 	public:
 		HuntT1131();
 
@@ -16,6 +16,11 @@ namespace Hunts{
 	 * @scans Intensive Scan not supported.
 	 */
 	class HuntT1183 : public Hunt {
+	private:
+		/// The registry rules checking the Debugger and GlobalFlag values of each Image File Execution Options key
+		SIZE_T dwDebuggerRule;
+		SIZE_T dwGlobalFlagRule;
+
 	public:
 		HuntT1183();
 
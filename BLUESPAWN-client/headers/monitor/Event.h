@@ -3,6 +3,8 @@
 #include <vector>
 #include <optional>
 #include <functional>
+#include <unordered_map>
+#include <unordered_set>
 #include "reaction/Reaction.h"
 #include "hunt/Scope.h"
 #include "util/eventlogs/EventSubscription.h"
@@ -59,18 +61,89 @@ private:
 	std::vector<EventLogs::XpathQuery> queries;
 };
 
+namespace Registry {
+
+	/// A value added to, removed from, or modified under a watched registry key
+	struct RegistryValueChange {
+		enum class Kind {
+			Added,
+			Removed,
+			Modified
+		} kind;
+
+		/// The key holding the value, which is either the watched key or one of its immediate subkeys
+		RegistryKey key;
+
+		/// The name of the value
+		std::wstring wsValueName;
+	};
+
+	/**
+	 * A callback receiving the values changed under a watched key. An empty vector means that something
+	 * changed which couldn't be narrowed down to a set of values, such as a change deeper in the tree than
+	 * is fingerprinted, and that everything under the key should be treated as changed.
+	 */
+	typedef std::function<void(const std::vector<RegistryValueChange>&)> RegistryChangeCallback;
+}
+
 class RegistryEvent : public Event {
+
+	/// The type and data of a value under the watched key, as last seen
+	struct ValueFingerprint {
+
+		/// The name of the immediate subkey holding the value, or an empty string for values of the key itself
+		std::wstring wsSubkey;
+		std::wstring wsName;
+		DWORD64 qwHash;
+	};
+
+	/// The fingerprints of the values of a single key, by lowercase value name
+	typedef std::unordered_map<std::wstring, ValueFingerprint> Fingerprints;
 	
 	// Event that is triggered when the key changes
 	HandleWrapper hEvent;
 
-	// True if this event watches subkeys. Note that this will be unable to determine
-	// which value (or subkey) was changed.
+	// True if this event watches subkeys. Values of immediate subkeys are fingerprinted along with those
+	// of the key itself; changes deeper in the tree are reported without the values that changed. Only the
+	// subkeys whose last write times changed are fingerprinted again with each notification.
 	bool WatchSubkeys;
 
 	// The registry key being watched
 	Registry::RegistryKey key;
 
+	/// The fingerprints of the values under the key when it was last checked, by lowercase subkey name. The
+	/// values of the key itself are kept under an empty name.
+	mutable std::unordered_map<std::wstring, Fingerprints> mFingerprints;
+
+	/// The last write times of the immediate subkeys of the key when it was last checked, by lowercase name
+	mutable std::unordered_map<std::wstring, FILETIME> mSubkeyWriteTimes;
+
+	/// The last write time of the key itself when it was last checked
+	mutable FILETIME ftLastKeyWrite;
+	CriticalSection hSection;
+
+	/// Callbacks receiving the values changed with each notification
+	std::vector<Registry::RegistryChangeCallback> changeCallbacks;
+
+	/**
+	 * Fingerprints the values of a single key
+	 *
+	 * @param key The key, which is either the watched key or one of its immediate subkeys
+	 * @param wsSubkey The name of the subkey, or an empty string for the watched key
+	 *
+	 * @return The fingerprints, by lowercase value name
+	 */
+	static Fingerprints TakeFingerprints(const Registry::RegistryKey& key, const std::wstring& wsSubkey);
+
+	/**
+	 * Compares the values under the key to those last seen, and remembers the values now present. Values of
+	 * subkeys which haven't been written since they were last seen aren't read again.
+	 *
+	 * @return The values changed, or nullopt if something changed that couldn't be narrowed down to a set of
+	 *         values. An empty vector means nothing relevant changed.
+	 */
+	std::optional<std::vector<Registry::RegistryValueChange>> FindChanges() const;
+
 public:
 
 	RegistryEvent(const Registry::RegistryKey& key, bool WatchSubkeys = false);
@@ -79,6 +152,19 @@ public:
 
 	const Registry::RegistryKey& GetKey() const;
 
+	/**
+	 * Adds a callback to be given the values changed each time the key changes
+	 *
+	 * @param callback The callback
+	 */
+	void AddChangeCallback(const Registry::RegistryChangeCallback& callback);
+
+	/**
+	 * Finds the values changed since the last notification and runs the callbacks, unless nothing relevant
+	 * changed, such as when a value is rewritten with the data it already held.
+	 */
+	virtual void RunCallbacks() const;
+
 	virtual bool Subscribe();
 
 	virtual bool operator==(const Event& e) const;
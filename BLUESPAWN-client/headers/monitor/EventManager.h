@@ -11,6 +11,16 @@ class EventManager {
 
 	public:
 		DWORD SubscribeToEvent(const std::shared_ptr<Event>& e, const std::function<void()>& callback);
+
+		/**
+		 * Subscribes to changes to a registry key, receiving the values that changed with each notification
+		 *
+		 * @param e The event for the key to watch
+		 * @param callback The callback to be given the values changed
+		 *
+		 * @return ERROR_SUCCESS
+		 */
+		DWORD SubscribeToRegistryChanges(const std::shared_ptr<RegistryEvent>& e, const Registry::RegistryChangeCallback& callback);
 		
 		// EventManager is a singleton class; call GetInstance() to get an instance of it.
 		static EventManager& GetInstance();
@@ -41,14 +41,12 @@ struct FILE_DETECTION : public DETECTION {
 		wsFilePath{ f.GetFilePath() }, 
 		fFile{ f } {
 		wsFileName = ToLowerCaseW(wsFilePath.substr(wsFilePath.find_last_of(L"\\/") + 1));
-		if (f.GetMD5Hash()) {
-			md5 = f.GetMD5Hash().value();
-		}
-		if (f.GetSHA1Hash()) {
-			sha1 = f.GetSHA1Hash().value();
-		}
-		if (f.GetSHA256Hash()) {
-			sha256 = f.GetSHA256Hash().value();
+		// The file is read once for all three hashes
+		auto hashes{ f.GetHashes({ HashType::MD5_HASH, HashType::SHA1_HASH, HashType::SHA256_HASH }) };
+		if (hashes) {
+			md5 = hashes->at(HashType::MD5_HASH);
+			sha1 = hashes->at(HashType::SHA1_HASH);
+			sha256 = hashes->at(HashType::SHA256_HASH);
 		}
 		if (f.GetCreationTime()) {
 			created = FormatWindowsTime(f.GetCreationTime().value());
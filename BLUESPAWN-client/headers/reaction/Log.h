@@ -4,24 +4,40 @@
 #include "hunt/HuntInfo.h"
 #include "util/log/huntlogmessage.h"
 
-#include <optional>
+#include "common/wrappers.hpp"
+
+#include <map>
+#include <memory>
 
 namespace Reactions {
 
 	class LogReaction : public Reaction {
 	private:
-		std::optional<Log::HuntLogMessage> _HuntLogMessage;
-		bool HuntBegun = false;
-
-		void LogBeginHunt(const HuntInfo& info);
-		void LogEndHunt();
-
-		/// Handlers for detections that log the detection
-		void LogFileIdentified(std::shared_ptr<FILE_DETECTION> detection);
-		void LogRegistryKeyIdentified(std::shared_ptr<REGISTRY_DETECTION> detection);
-		void LogProcessIdentified(std::shared_ptr<PROCESS_DETECTION> detection);
-		void LogServiceIdentified(std::shared_ptr<SERVICE_DETECTION> detection);
-		void LogEventIdentified(std::shared_ptr<EVENT_DETECTION> detection);
+
+		/**
+		 * Tracks the log message of the hunt running on each thread. Hunts may run in parallel, so
+		 * each thread gets its own message. The state is shared by the handlers rather than owned
+		 * by the LogReaction so that it remains valid when the reaction is copied into a Reaction.
+		 */
+		class HuntLogState {
+			std::map<DWORD, Log::HuntLogMessage> mMessages{};
+			CriticalSection hSection{};
+
+			Log::HuntLogMessage* GetCurrentMessage();
+
+		public:
+			void LogBeginHunt(const HuntInfo& info);
+			void LogEndHunt();
+
+			/// Handlers for detections that log the detection
+			void LogFileIdentified(std::shared_ptr<FILE_DETECTION> detection);
+			void LogRegistryKeyIdentified(std::shared_ptr<REGISTRY_DETECTION> detection);
+			void LogProcessIdentified(std::shared_ptr<PROCESS_DETECTION> detection);
+			void LogServiceIdentified(std::shared_ptr<SERVICE_DETECTION> detection);
+			void LogEventIdentified(std::shared_ptr<EVENT_DETECTION> detection);
+		};
+
+		std::shared_ptr<HuntLogState> state;
 
 	public:
 		LogReaction();
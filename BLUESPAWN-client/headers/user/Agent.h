@@ -0,0 +1,78 @@
+#pragma once
+
+#include <Windows.h>
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <optional>
+
+/**
+ * Serves hunt and mitigation jobs to a local orchestrator over a named pipe. Rather than launching
+ * BLUESPAWN once per job, an orchestrator starts a single agent and sends it each job, so the work
+ * done at startup (compiling YARA rules, constructing hunts and mitigations, compiling the registry
+ * plan) is paid once, and caches such as signature verdicts stay warm from one job to the next.
+ *
+ * Each job is a single pipe message holding the command line options the job would have been run
+ * with, such as "--hunt -l Cursory --hunts T1060". The agent replies with a single message: "OK",
+ * followed by the time the job took, or "ERROR" followed by a description of the problem. Sending
+ * "shutdown" stops the agent. Jobs are run one at a time, in the order they are received. The pipe
+ * only accepts local clients, and its default security only allows administrators and the account
+ * running the agent to submit jobs.
+ */
+class Agent {
+public:
+
+	/// Runs a job given its command line options, returning an empty string on success or a description of the problem
+	using JobHandler = std::function<std::wstring(const std::vector<std::string>&)>;
+
+	/// The name of the pipe served when none is given
+	static const std::wstring DefaultPipeName;
+
+private:
+
+	/// The name of the pipe on which jobs are received
+	std::wstring wsPipeName;
+
+	/// The number of jobs served so far
+	DWORD dwJobsServed;
+
+	/**
+	 * Reads a single message from a connected client
+	 *
+	 * @param hPipe The pipe connected to the client
+	 *
+	 * @return The message if one was read; std::nullopt otherwise
+	 */
+	std::optional<std::string> ReadMessage(HANDLE hPipe) const;
+
+public:
+
+	/**
+	 * Creates an agent serving jobs on a named pipe. The pipe isn't created until Serve is called.
+	 *
+	 * @param wsPipeName The name of the pipe, such as \\.\pipe\BLUESPAWN
+	 */
+	Agent(const std::wstring& wsPipeName = DefaultPipeName);
+
+	/**
+	 * Serves jobs until a shutdown request is received or the pipe can't be served. A single instance of the
+	 * pipe is created and reconnected for each job; if connections fail several times in a row, with a growing
+	 * delay between attempts, the agent stops.
+	 *
+	 * @param handler The function run for each job
+	 *
+	 * @return true if the agent was shut down by a request; false if the pipe couldn't be served
+	 */
+	bool Serve(const JobHandler& handler);
+
+	/**
+	 * Splits a job into its command line options, following the same quoting rules as the command line
+	 * of a process.
+	 *
+	 * @param job The job, as received by the agent
+	 *
+	 * @return The options making up the job
+	 */
+	static std::vector<std::string> SplitJob(const std::string& job);
+};
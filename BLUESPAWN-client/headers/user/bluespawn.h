@@ -27,7 +27,7 @@ class Bluespawn {
 
 		void SetReaction(const Reaction& reaction);
 
-		void dispatch_hunt(Aggressiveness aHuntLevel, vector<string> vExcludedHunts, vector<string> vIncludedHunts);
+		void dispatch_hunt(Aggressiveness aHuntLevel, vector<string> vExcludedHunts, vector<string> vIncludedHunts, const Scope& scope = Scope{}, DWORD dwWorkers = 0, DWORD dwTimeBudget = 0);
 		void dispatch_mitigations_analysis(MitigationMode mode, bool bForceEnforce);
 		void monitor_system(Aggressiveness aHuntLevel);
 		void check_correct_arch();
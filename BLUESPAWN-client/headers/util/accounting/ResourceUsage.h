@@ -0,0 +1,87 @@
+#pragma once
+#include <Windows.h>
+
+#include <string>
+
+namespace Accounting {
+
+	/**
+	 * A summary of the resources consumed while running a hunt. Counters are attributed to the
+	 * thread that performed the work, so anything done by a hunt on another thread isn't counted
+	 * unless it is merged back with MergeCounters.
+	 * The working set is tracked for the process as a whole, so when hunts run in parallel the
+	 * peak working-set delta reflects every hunt running at the time.
+	 */
+	struct ResourceUsage {
+		ULONGLONG WallTimeMs{ 0 };
+		ULONGLONG CpuTimeMs{ 0 };
+		ULONGLONG BytesRead{ 0 };
+		DWORD FilesOpened{ 0 };
+		DWORD RegistryKeysOpened{ 0 };
+		DWORD EventRecordsRendered{ 0 };
+		DWORD YaraScans{ 0 };
+		LONGLONG PeakWorkingSetDelta{ 0 };
+
+		/**
+		 * Formats the usage as a single line of text, suitable for a log message.
+		 *
+		 * @return A string describing the resource usage
+		 */
+		std::string ToString() const;
+	};
+
+	/// Records that the current thread read some number of bytes from a file
+	void RecordBytesRead(ULONGLONG qwBytes);
+
+	/// Records that the current thread opened a file
+	void RecordFileOpened();
+
+	/// Records that the current thread opened a registry key
+	void RecordRegistryKeyOpened();
+
+	/// Records that the current thread rendered an event log record
+	void RecordEventRecordRendered();
+
+	/// Records that the current thread ran a YARA scan
+	void RecordYaraScan();
+
+	/**
+	 * Adds the counters and CPU time in a usage measured on another thread to the current thread, so
+	 * that work a thread hands off to a helper thread is still attributed to it.
+	 *
+	 * @param usage The usage measured on the helper thread
+	 */
+	void MergeCounters(const ResourceUsage& usage);
+
+	/**
+	 * Removes a usage measured on the current thread from the trackers running on it, so that work the
+	 * thread does on behalf of others, such as collecting an artifact shared by several hunts, isn't
+	 * attributed to whatever it happened to be doing at the time. The wall time in the usage is excluded
+	 * too.
+	 *
+	 * @param usage The usage to exclude, measured by a tracker on the current thread
+	 */
+	void ExcludeUsage(const ResourceUsage& usage);
+
+	/**
+	 * Measures the resources consumed by the current thread from the construction of this object
+	 * until GetUsage is called. Trackers may be nested.
+	 */
+	class ResourceTracker {
+		ULONGLONG qwStartTick;
+		ULONGLONG qwStartCpuTime;
+		SIZE_T StartPeakWorkingSet;
+		ResourceUsage StartCounters;
+
+	public:
+		ResourceTracker();
+
+		/**
+		 * Retrieves the resources consumed by the current thread since this tracker was created. This
+		 * must be called on the thread that created the tracker.
+		 *
+		 * @return The resources consumed
+		 */
+		ResourceUsage GetUsage() const;
+	};
+}
@@ -0,0 +1,178 @@
+#pragma once
+
+#include <Windows.h>
+
+#include <string>
+#include <vector>
+#include <map>
+#include <optional>
+#include <functional>
+
+#include "util/configurations/Registry.h"
+
+namespace Registry {
+
+	/// A server registered for a COM class
+	struct ComRegistration {
+
+		/// Indicates how the server is loaded, which determines how the registered path is resolved
+		enum class Kind : DWORD {
+			InProcess,
+			LocalServer
+		} kind;
+
+		/// The CLSID of the class, as named by its key
+		std::wstring wsClsid;
+
+		/// The path of the key holding the registration, the subkey of the class's key holding it, or an empty
+		/// string if the class's key holds it itself, and the name of the value holding it
+		std::wstring wsKeyPath;
+		std::wstring wsSubkey;
+		std::wstring wsValueName;
+
+		/// The server registered, as stored in the registry. In-process servers are resolved with
+		/// FileSystem::SearchPathExecutable, and local servers are command lines.
+		std::wstring wsServer;
+
+		/// The threading model of an in-process server, or an empty string if none is registered
+		std::wstring wsThreadingModel;
+
+		/// The path of the CLSID key under which the class was found, identifying the hive and view it came from
+		std::wstring wsSource;
+
+		/// The CLSID key under which the class was found. This isn't kept in the index file; it's set each time the
+		/// index is updated.
+		std::optional<RegistryKey> root;
+
+		/**
+		 * Opens the key holding the registration beneath the CLSID key it was found under, so that registrations
+		 * in hives which aren't loaded can be opened, which their paths alone can't do.
+		 *
+		 * @return The key holding the registration
+		 */
+		RegistryKey GetKey() const;
+	};
+
+	/**
+	 * An index of the servers registered for every COM class under a set of CLSID keys, such as those of the
+	 * machine, of each user, and of their WoW64 views. The index is built by walking the CLSID keys once, with
+	 * the classes read in batches on the IO executor, and can be persisted between runs in a compact binary file in
+	 * which every string is stored once. The file is opened with FileSystem::OpenProtectedFile, so a file which
+	 * users other than SYSTEM and Administrators could write is refused.
+	 *
+	 * Each class is stored with a stamp of the last write times of its key and of the subkeys registering its
+	 * servers, which the enumeration of the CLSID key and of the class's key provides without opening anything
+	 * further. When the index is updated, only classes whose stamp changed are read again; the registrations of
+	 * every other class are reused. Registered servers are not resolved to files, since the file a search path
+	 * resolves to can change without the registry changing.
+	 *
+	 * A class with a TreatAs key is emulated by the class it names, so COM loads that class's servers in its place.
+	 * The registrations of the class named, if it is found under the same CLSID key, are repeated for the class
+	 * emulated by it as registrations held by its TreatAs key. Only a single TreatAs key is followed.
+	 */
+	class ComRegistrationIndex {
+	private:
+
+		/// The registrations of a single class, along with the stamp they were read under
+		struct ClassEntry {
+			DWORD64 qwStamp;
+			FILETIME ftLastWrite;
+			std::vector<ComRegistration> vRegistrations;
+
+			/// The CLSID named by the class's TreatAs key, or an empty string if it has none
+			std::wstring wsTreatAs;
+
+			/// The CLSID key holding the class, its path, and the name of the class's key. These aren't kept in the
+			/// index file; they're set each time the index is updated.
+			std::optional<RegistryKey> root;
+			std::wstring wsSource;
+			std::wstring wsClsid;
+
+			/// The registrations of the class named by wsTreatAs, as they apply to this class; set by Update
+			std::vector<ComRegistration> vTreatAsRegistrations;
+		};
+
+		/// The classes in the index, keyed by the lowercase path of their key
+		std::map<std::wstring, ClassEntry> mClasses;
+
+		/// The path of the file holding the index
+		std::wstring wsPath;
+
+		/// The path of the file in which hunts keep the index between runs, if they've been asked to
+		static std::optional<std::wstring> wsPersistentPath;
+
+		/**
+		 * Reads the registrations of a single class and the class named by its TreatAs key
+		 *
+		 * @param key The key of the class
+		 * @param wsClsid The name of the key of the class
+		 * @param wsSource The path of the CLSID key holding the class
+		 * @param entry The entry to which the registrations and TreatAs CLSID are added
+		 */
+		static void ReadClass(const RegistryKey& key, const std::wstring& wsClsid, const std::wstring& wsSource, ClassEntry& entry);
+
+	public:
+
+		/**
+		 * Loads the index from a file. If the file doesn't exist or can't be parsed, the index starts out empty
+		 * and every class is read when it's updated.
+		 *
+		 * @param path The path of the file holding the index
+		 *
+		 * @return true if the index was read from the file; false if it starts out empty
+		 */
+		bool Load(const std::wstring& path);
+
+		/**
+		 * Writes the index back to the file it was loaded from. The index is written to a temporary file first
+		 * and then moved over the existing file.
+		 *
+		 * @return true if the index was saved; false otherwise
+		 */
+		bool Save() const;
+
+		/**
+		 * Brings the index up to date with the registry, reading each class added or changed since the index was
+		 * last updated and dropping each class that was removed
+		 *
+		 * @param vRoots The CLSID keys to index
+		 */
+		void Update(const std::vector<RegistryKey>& vRoots);
+
+		/**
+		 * Calls a function for each registration in the index, including those a class takes on from the class
+		 * named by its TreatAs key
+		 *
+		 * @param callback The function called with each registration and the last write time of its class's key
+		 */
+		void EnumerateRegistrations(const std::function<void(const ComRegistration&, const FILETIME&)>& callback) const;
+
+		/**
+		 * Retrieves the number of classes in the index
+		 *
+		 * @return The number of classes
+		 */
+		DWORD GetClassCount() const;
+
+		/**
+		 * Sets the file in which hunts keep the index between runs. This should be set before hunts are run.
+		 *
+		 * @param path The path of the file, or std::nullopt to rebuild the index on every run without saving it
+		 */
+		static void SetPersistentPath(const std::optional<std::wstring>& path);
+
+		/**
+		 * Retrieves the file in which hunts keep the index between runs
+		 *
+		 * @return The path of the file, or std::nullopt if the index isn't kept between runs
+		 */
+		static std::optional<std::wstring> GetPersistentPath();
+
+		/**
+		 * Retrieves the default location of the index: a file next to the BLUESPAWN executable
+		 *
+		 * @return The default path of the index
+		 */
+		static std::wstring GetDefaultPath();
+	};
+}
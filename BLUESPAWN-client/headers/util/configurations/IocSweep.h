@@ -0,0 +1,145 @@
+#pragma once
+
+#include <Windows.h>
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <optional>
+
+#include "common/wrappers.hpp"
+
+#include "util/configurations/Registry.h"
+#include "util/configurations/RegistrySnapshot.h"
+#include "util/patterns/MultiPattern.h"
+
+namespace Registry {
+
+	/// The records of an n-gram index file, defined with the file format in IocSweep.cpp
+	struct NgramIndexHeader;
+	struct NgramIndexEntry;
+
+	/// A registry value whose data contains an indicator of compromise
+	struct IocMatch {
+
+		/// The path of the key holding the value
+		std::wstring wsKeyPath;
+		std::wstring wsValueName;
+
+		/// The indicator found in the value's data
+		std::wstring wsIndicator;
+
+		std::wstring ToString() const;
+	};
+
+	/**
+	 * An index of every sequence of three characters (trigram) in the value data of a registry snapshot, stored
+	 * alongside the snapshot so that repeated sweeps of it only need to read the values which may hold one of
+	 * the indicators swept for. Each trigram is listed with the blobs of value data containing it; an indicator
+	 * can only occur in blobs containing every one of its trigrams, so only the blobs listed for its rarest
+	 * trigram need to be searched. Blobs too large to be worth indexing are always searched.
+	 *
+	 * An index records the hash of the snapshot it was built from, and is ignored if it doesn't match the
+	 * snapshot it's used with.
+	 */
+	class NgramIndex {
+	private:
+
+		/// The path of the index file
+		std::wstring wsPath;
+
+		/// The view of the index file
+		GenericWrapper<LPVOID> lpView;
+
+		/// The size of the view
+		SIZE_T dwSize;
+
+		NgramIndex(const std::wstring& wsPath, LPVOID lpView, SIZE_T dwSize);
+
+		/**
+		 * Validates every section and offset in the index, and checks that it was built from a snapshot
+		 *
+		 * @param snapshot The snapshot the index is to be used with
+		 *
+		 * @return true if the index is valid and was built from the snapshot; false otherwise
+		 */
+		bool Validate(const RegistrySnapshot& snapshot) const;
+
+		/// Retrieves the sections of the index
+		const NgramIndexHeader& GetHeader() const;
+		const NgramIndexEntry* GetEntries() const;
+		const DWORD* GetUnindexedBlobs() const;
+		const DWORD* GetPostings() const;
+
+		/**
+		 * Finds the entry for a trigram
+		 *
+		 * @param qwGram The trigram, as packed by the index
+		 *
+		 * @return The entry, or nullptr if no blob contains the trigram
+		 */
+		const NgramIndexEntry* Find(DWORD64 qwGram) const;
+
+	public:
+
+		/**
+		 * Builds an index of a snapshot and writes it to a file. The index is written to a temporary file first
+		 * and then moved over any existing file.
+		 *
+		 * @param snapshot The snapshot to index
+		 * @param wsPath The path of the index file to write
+		 *
+		 * @return true if the index was written; false otherwise
+		 */
+		static bool Build(const RegistrySnapshot& snapshot, const std::wstring& wsPath);
+
+		/**
+		 * Opens an index file
+		 *
+		 * @param wsPath The path of the index file
+		 * @param snapshot The snapshot the index is to be used with
+		 *
+		 * @return The index, or nullptr if the file couldn't be opened, isn't a valid index, or was built from
+		 *         a different snapshot
+		 */
+		static std::shared_ptr<NgramIndex> Load(const std::wstring& wsPath, const RegistrySnapshot& snapshot);
+
+		/**
+		 * Finds the blobs of value data which may contain any of a set of indicators
+		 *
+		 * @param iocs The indicators
+		 *
+		 * @return The indices of the blobs to search, in ascending order, or nullopt if an indicator is too short
+		 *         to be found with the index and every blob must be searched
+		 */
+		std::optional<std::vector<DWORD>> FindCandidates(const Patterns::MultiPattern& iocs) const;
+	};
+
+	/**
+	 * Walks registry keys and their subtrees once, searching the data of every string, multi-string, and
+	 * binary value for a set of indicators of compromise. Binary data is searched for runs of printable
+	 * characters, both UTF-16 and ASCII. Keys in hive files opened with RegistryKey::OpenHiveFile may be
+	 * swept as well as keys in the registry.
+	 *
+	 * @param vRoots The keys to sweep
+	 * @param iocs The indicators to search for
+	 *
+	 * @return Each value containing an indicator, once for each indicator it contains
+	 */
+	std::vector<IocMatch> SweepForIocs(const std::vector<RegistryKey>& vRoots, const Patterns::MultiPattern& iocs);
+
+	/**
+	 * Searches the values in a registry snapshot for a set of indicators of compromise, in the same way as
+	 * SweepForIocs. Each distinct blob of value data is searched once for each kind of text taken from
+	 * it (strings, or runs of printable characters in binary data), no matter how many values hold it.
+	 *
+	 * @param snapshot The snapshot to sweep
+	 * @param iocs The indicators to search for
+	 * @param wsIndexPath The path of an NgramIndex of the snapshot to use, which is built if it's missing or
+	 *        was built from a different snapshot, or nullopt to search every blob
+	 *
+	 * @return Each value containing an indicator, once for each indicator it contains
+	 */
+	std::vector<IocMatch> SweepSnapshotForIocs(const RegistrySnapshot& snapshot, const Patterns::MultiPattern& iocs,
+		const std::optional<std::wstring>& wsIndexPath = std::nullopt);
+}
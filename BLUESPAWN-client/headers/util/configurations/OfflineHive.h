@@ -0,0 +1,187 @@
+#pragma once
+
+#include <Windows.h>
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <optional>
+
+#include "common/wrappers.hpp"
+
+#include "util/configurations/Registry.h"
+
+namespace Registry {
+
+	/**
+	 * A registry hive file, such as an NTUSER.DAT of a user who isn't logged on or a SOFTWARE hive copied off
+	 * of another machine, read directly from its regf format without being loaded into the registry. The file
+	 * is mapped into memory and its cells are read in place: key (nk) cells, value (vk) cells, the lf, lh, li,
+	 * and ri subkey lists, and big data (db) cells for values larger than a single cell.
+	 *
+	 * Hive files are opened through RegistryKey::OpenHiveFile, which allows every registry check to be run
+	 * against them in the same way as against the live registry. Every offset in the file is checked against
+	 * the bounds of the file before it is read, so a corrupt or malicious hive can't cause reads outside of it.
+	 *
+	 * Transaction logs (.LOG1 and .LOG2) aren't replayed. If the hive wasn't cleanly unloaded, a warning is
+	 * logged, since changes made shortly before it was last written may only be present in its logs.
+	 */
+	class OfflineHive {
+	private:
+
+		/// The path of the hive file
+		std::wstring wsPath;
+
+		/// The view of the hive file
+		GenericWrapper<LPVOID> lpView;
+
+		/// The size of the view
+		SIZE_T dwSize;
+
+		/// The offset of the root key cell
+		DWORD dwRootCell;
+
+		/// Whether the hive uses big data cells for large values
+		bool bBigData;
+
+		OfflineHive(const std::wstring& wsPath, LPVOID lpView, SIZE_T dwSize);
+
+		/**
+		 * Retrieves the data of an allocated cell
+		 *
+		 * @param dwCell The offset of the cell, relative to the start of the hive bins
+		 * @param dwMinimum The number of bytes the cell must have
+		 *
+		 * @return A pointer to the data of the cell and its size, or std::nullopt if the cell is invalid
+		 */
+		std::optional<std::pair<const BYTE*, DWORD>> GetCell(DWORD dwCell, DWORD dwMinimum = 0) const;
+
+		/**
+		 * Adds the key cells in a subkey list to a vector, following index roots (ri) to the lists they hold
+		 *
+		 * @param dwList The offset of the subkey list
+		 * @param vSubkeys The vector to which subkeys are added
+		 * @param dwDepth The number of index roots followed to reach this list
+		 */
+		void AddSubkeys(DWORD dwList, std::vector<DWORD>& vSubkeys, DWORD dwDepth) const;
+
+	public:
+
+		/**
+		 * Opens a hive file
+		 *
+		 * @param wsPath The path of the hive file
+		 *
+		 * @return The hive, or nullptr if the file couldn't be opened or isn't a valid hive
+		 */
+		static std::shared_ptr<OfflineHive> Open(const std::wstring& wsPath);
+
+		/**
+		 * Retrieves the path of the hive file
+		 *
+		 * @return The path of the hive file
+		 */
+		const std::wstring& GetPath() const;
+
+		/**
+		 * Retrieves the root key of the hive
+		 *
+		 * @return The offset of the root key cell
+		 */
+		DWORD GetRootKey() const;
+
+		/**
+		 * Retrieves the name of a key
+		 *
+		 * @param dwKey The offset of the key cell
+		 *
+		 * @return The name of the key, or std::nullopt if the cell isn't a valid key
+		 */
+		std::optional<std::wstring> GetKeyName(DWORD dwKey) const;
+
+		/**
+		 * Retrieves the time at which a key was last written
+		 *
+		 * @param dwKey The offset of the key cell
+		 *
+		 * @return The last write time of the key, or std::nullopt if the cell isn't a valid key
+		 */
+		std::optional<FILETIME> GetKeyLastWriteTime(DWORD dwKey) const;
+
+		/**
+		 * Retrieves the subkeys of a key
+		 *
+		 * @param dwKey The offset of the key cell
+		 *
+		 * @return The offsets of the subkey cells
+		 */
+		std::vector<DWORD> GetSubkeys(DWORD dwKey) const;
+
+		/**
+		 * Finds a key by its path relative to another key. Names are compared case-insensitively.
+		 *
+		 * @param dwKey The offset of the key cell from which the path is followed
+		 * @param path The path to follow, with components separated by backslashes
+		 *
+		 * @return The offset of the key cell found, or std::nullopt if no such key exists
+		 */
+		std::optional<DWORD> FindKey(DWORD dwKey, const std::wstring& path) const;
+
+		/**
+		 * Retrieves the values of a key
+		 *
+		 * @param dwKey The offset of the key cell
+		 *
+		 * @return The offsets of the value cells
+		 */
+		std::vector<DWORD> GetValues(DWORD dwKey) const;
+
+		/**
+		 * Finds a value of a key by its name. Names are compared case-insensitively.
+		 *
+		 * @param dwKey The offset of the key cell
+		 * @param name The name of the value
+		 *
+		 * @return The offset of the value cell, or std::nullopt if the key has no such value
+		 */
+		std::optional<DWORD> FindValue(DWORD dwKey, const std::wstring& name) const;
+
+		/**
+		 * Retrieves the name of a value
+		 *
+		 * @param dwValue The offset of the value cell
+		 *
+		 * @return The name of the value, or std::nullopt if the cell isn't a valid value
+		 */
+		std::optional<std::wstring> GetValueName(DWORD dwValue) const;
+
+		/**
+		 * Retrieves the registry datatype of a value, such as REG_SZ
+		 *
+		 * @param dwValue The offset of the value cell
+		 *
+		 * @return The datatype of the value, or std::nullopt if the cell isn't a valid value
+		 */
+		std::optional<DWORD> GetValueType(DWORD dwValue) const;
+
+		/**
+		 * Retrieves the data of a value. Data held in a single cell is returned in place; data split across
+		 * the segments of a big data cell is assembled in the given buffer.
+		 *
+		 * @param dwValue The offset of the value cell
+		 * @param buffer A buffer in which data may be assembled
+		 *
+		 * @return A pointer to the data and its size, valid while the hive and the buffer exist, or std::nullopt
+		 *         if the cell isn't a valid value
+		 */
+		std::optional<std::pair<const BYTE*, DWORD>> GetValueData(DWORD dwValue, std::vector<BYTE>& buffer) const;
+	};
+
+	/**
+	 * Opens the NTUSER.DAT hive of each user profile on this machine whose hive isn't loaded under HKEY_USERS,
+	 * such as those of users who aren't logged on.
+	 *
+	 * @return The root keys of the hives opened
+	 */
+	std::vector<RegistryKey> GetUnloadedUserHives();
+}
@@ -5,12 +5,16 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <memory>
 #include <optional>
+#include <functional>
 
 #include "common/DynamicLinker.h"
 #include "common/wrappers.hpp"
 
 #include "util/log/Loggable.h"
+#include "util/configurations/RegistryHandleCache.h"
+#include "util/configurations/ValueView.h"
 
 DEFINE_FUNCTION(DWORD, NtQueryKey, NTAPI, HANDLE KeyHandle, int KeyInformationClass, PVOID KeyInformation, ULONG Length, PULONG ResultLength);
 DEFINE_FUNCTION(NTSTATUS, NtQueryValueKey, NTAPI, HANDLE KeyHandle, PUNICODE_STRING ValueName, int KeyInformationClass, PVOID KeyInformation, ULONG Length, PULONG ResultLength);
@@ -32,6 +36,9 @@ namespace Registry {
 	extern std::map<std::wstring, HKEY> vHiveNames;
 	extern std::map<HKEY, std::wstring> vHives;
 
+	struct RegistryValue;
+	class OfflineHive;
+
 	/**
 	 * This class is for interaction with the Windows Registry. A single instance of this
 	 * class represents a key in the registry, not to be confused with a value. Note that each
@@ -68,6 +75,17 @@ namespace Registry {
 		 */
 		RegistryKey(HKEY base, std::wstring path, bool WoW64 = false);
 
+		/**
+		 * Creates a RegistryKey object from a path relative to another key. Unlike converting the base key to an
+		 * HKEY, this works for keys in hive files opened with OpenHiveFile as well as for keys in the registry.
+		 * WoW64 redirection isn't emulated for keys in hive files; Wow6432Node keys must be named explicitly.
+		 *
+		 * @param base The base key.
+		 * @param path The path relative to the base key.
+		 * @param WoW64 Indicate whether this instance should refer to the WoW64 version of a key.
+		 */
+		RegistryKey(const RegistryKey& base, std::wstring path, bool WoW64 = false);
+
 		/**
 		 * Creates a RegistryKey object to reference a key at a given path.
 		 *
@@ -81,8 +99,20 @@ namespace Registry {
 		/** Move operator overload */
 		RegistryKey& operator=(RegistryKey&& key) noexcept;
 
+		/**
+		 * Opens the root key of a hive file, such as an NTUSER.DAT, without loading it into the registry. Keys in
+		 * the hive can be read in the same way as keys in the registry, but can't be changed. The name of each
+		 * key in the hive begins with the path of the hive file.
+		 *
+		 * @param wsFilePath The path of the hive file
+		 *
+		 * @return The root key of the hive, which won't exist if the file couldn't be opened as a hive
+		 */
+		static RegistryKey OpenHiveFile(const std::wstring& wsFilePath);
+
 	private:
-		static std::map<HKEY, int> _ReferenceCounts;
+		/// The handle to the key, shared by every copy of this key and closed once none remain
+		std::shared_ptr<KeyHandle> handle;
 
 		HKEY hkBackingKey;
 
@@ -92,8 +122,31 @@ namespace Registry {
 		HKEY hkHive{};
 		std::wstring path{};
 
+		/// The hive file backing this key, if it was opened from a hive file rather than the registry
+		std::shared_ptr<OfflineHive> offlineHive{};
+		DWORD dwOfflineCell{};
+		std::wstring wsOfflineName{};
+
+		/**
+		 * Creates a RegistryKey object referencing a key in a hive file
+		 *
+		 * @param hive The hive file, or nullptr if the key doesn't exist
+		 * @param dwCell The offset of the key's cell in the hive file
+		 * @param name The name of the key
+		 */
+		RegistryKey(const std::shared_ptr<OfflineHive>& hive, DWORD dwCell, const std::wstring& name);
+
+		/**
+		 * Opens the key at a path relative to a base key, in the view indicated by bWow64. If the handle cache
+		 * is enabled and the key has already been opened, the cached handle is used instead.
+		 *
+		 * @param hkBase The base key
+		 * @param path The path relative to the base key
+		 */
+		void Open(HKEY hkBase, const std::wstring& path);
+
 	public:
-		/** Destructor for a RegistryKey. Decrements a reference count, and if zero, closes the handle */
+		/** Destructor for a RegistryKey. The handle is closed once every copy of the key is destroyed */
 		~RegistryKey();
 
 		/** 
@@ -127,6 +180,18 @@ namespace Registry {
 		 */
 		AllocationWrapper GetRawValue(const std::wstring& wsValueName) const;
 
+		/**
+		 * Reads the type and data of a given value without copying the data. The data is read into a buffer
+		 * reused by every read on the calling thread, so the view returned is only valid until the next value
+		 * is read on this thread, whether through this function, GetValue, or GetValues. This should be used to
+		 * check values that will usually be discarded, with a copy made only of those being kept.
+		 *
+		 * @param wsValueName The name of the value to read
+		 *
+		 * @return A view of the value, or nullopt if the value is not present or couldn't be read
+		 */
+		std::optional<ValueView> GetValueView(const std::wstring& wsValueName) const;
+
 		/**
 		 * Writes bytes to a given value under the key referenced by this object.
 		 *
@@ -188,6 +253,39 @@ namespace Registry {
 		 */
 		std::vector<std::wstring> EnumerateValues() const;
 
+		/**
+		 * Reads every value under the currently referenced registry key as raw bytes, passing each to a callback
+		 * without converting its data. The name and data passed are only valid for the duration of the call.
+		 *
+		 * @param callback The function called with the name, registry datatype, data, and size of each value
+		 *
+		 * @return true if the values were enumerated; false if the key couldn't be read
+		 */
+		bool EnumerateRawValues(const std::function<void(const std::wstring&, DWORD, const BYTE*, DWORD)>& callback) const;
+
+		/**
+		 * Reads every value under the currently referenced registry key, along with its type and data, in a
+		 * single pass over the key. Each value is read with one syscall into a buffer shared by every value,
+		 * rather than separately enumerating, typing, and reading each one. REG_SZ and REG_EXPAND_SZ values
+		 * are read as strings, REG_MULTI_SZ values as lists of strings, REG_DWORD values as DWORDs, and values
+		 * of any other type as raw bytes.
+		 *
+		 * @return The values under the key. Include util/configurations/RegistryValue.h to use the result.
+		 */
+		std::vector<RegistryValue> GetValues() const;
+
+		/**
+		 * Reads a set of named values under the currently referenced registry key, querying each value's type
+		 * and data with a single syscall into a buffer shared by every value. Each value is read as the type
+		 * requested for it, in the same way GetValue would read it.
+		 *
+		 * @param vValues The names of the values to read, along with the type as which to read each
+		 *
+		 * @return For each name, the value read, or std::nullopt if the value isn't present. Include
+		 *         util/configurations/RegistryValue.h to use the result.
+		 */
+		std::vector<std::optional<RegistryValue>> GetValues(const std::vector<std::pair<std::wstring, RegistryType>>& vValues) const;
+
 		/**
 		 * Returns a list of subkeys under the currently referenced registry key.
 		 *
@@ -202,6 +300,17 @@ namespace Registry {
 		 */
 		std::vector<std::wstring> EnumerateSubkeyNames() const;
 
+		/**
+		 * Enumerates the subkeys under the currently referenced registry key along with the time each was last
+		 * written, without opening any of them. A key's last write time changes when its values are set or
+		 * deleted or when subkeys are added to or removed from it, but not when anything deeper changes.
+		 *
+		 * @param callback The function called with the name and last write time of each subkey
+		 *
+		 * @return true if the subkeys were enumerated; false if the key couldn't be read
+		 */
+		bool EnumerateSubkeyWriteTimes(const std::function<void(const std::wstring&, const FILETIME&)>& callback) const;
+
 		/**
 		 * Returns the full path of the referenced registry key witout the Hive.
 		 *
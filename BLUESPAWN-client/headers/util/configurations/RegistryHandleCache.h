@@ -0,0 +1,216 @@
+#pragma once
+
+#include <Windows.h>
+
+#include <string>
+#include <array>
+#include <memory>
+#include <atomic>
+#include <optional>
+#include <unordered_map>
+
+#include "common/wrappers.hpp"
+
+namespace Registry {
+
+	/**
+	 * An open handle to a registry key, shared by every RegistryKey referring to it. The handle is closed
+	 * when the last RegistryKey referring to it is destroyed, unless it is one of the predefined hive keys.
+	 * The name of the key is retrieved the first time it is needed and remembered for the handle's lifetime.
+	 */
+	class KeyHandle {
+	private:
+
+		/// The handle held
+		HKEY hkKey;
+
+		/// The name of the key, once retrieved
+		std::optional<std::wstring> name;
+		CriticalSection hSection;
+
+	public:
+
+		/// The identity under which the handle is cached, or an empty string if it isn't cached
+		std::wstring wsCacheKey;
+
+		/**
+		 * Takes ownership of a handle to a registry key
+		 *
+		 * @param hkKey The handle to take ownership of
+		 */
+		KeyHandle(HKEY hkKey);
+
+		/**
+		 * Closes the handle if it isn't a predefined hive key
+		 */
+		~KeyHandle();
+
+		/// Delete copy and move constructors and assignment operators
+		KeyHandle(const KeyHandle&) = delete;
+		KeyHandle& operator=(const KeyHandle&) = delete;
+		KeyHandle(KeyHandle&&) = delete;
+		KeyHandle& operator=(KeyHandle&&) = delete;
+
+		/**
+		 * Retrieves the handle held
+		 *
+		 * @return The handle
+		 */
+		HKEY GetHandle() const;
+
+		/**
+		 * Retrieves the name of the key, querying it with the given function the first time it is needed
+		 *
+		 * @param query The function used to query the name of the key
+		 *
+		 * @return The name of the key
+		 */
+		std::wstring GetName(std::wstring(*query)(HKEY));
+	};
+
+	/**
+	 * Tracks the handles to registry keys held by this process, and caches the handles opened while hunting.
+	 *
+	 * Every open handle is recorded in a table split into shards by handle value, so that a RegistryKey created
+	 * from a raw HKEY shares the KeyHandle of any RegistryKey already holding it, without every key created or
+	 * destroyed anywhere in the process contending on a single lock.
+	 *
+	 * While caching is enabled (see BeginHandleCaching), opening a key that has already been opened returns the
+	 * handle already held instead of opening the key again. Keys are identified by their hive, their lowercased
+	 * path, and the registry view in which they are opened. Keys opened relative to a handle other than a
+	 * predefined hive key are only cached if that handle is itself cached, since a handle value may otherwise
+	 * be reused for another key once closed. The cache holds on to every handle it returns until caching is
+	 * disabled, at which point it is cleared, so that a key deleted and recreated after a run is never read
+	 * through a stale handle in a later one.
+	 */
+	class KeyHandleCache {
+	private:
+		static constexpr SIZE_T SHARD_COUNT{ 16 };
+
+		/// A portion of the handle table and of the cache
+		struct Shard {
+			/// The live handles in this shard, by handle value
+			std::unordered_map<HKEY, std::weak_ptr<KeyHandle>> mHandles{};
+
+			/// The cached handles in this shard, by identity
+			std::unordered_map<std::wstring, std::shared_ptr<KeyHandle>> mCache{};
+
+			CriticalSection hSection{};
+		};
+
+		std::array<Shard, SHARD_COUNT> shards;
+
+		/// The number of callers that currently have caching enabled
+		std::atomic<LONG> lEnabledCount;
+
+		/// The number of key opens and name queries avoided through the cache
+		std::atomic<DWORD> dwHandlesReused;
+		std::atomic<DWORD> dwNamesReused;
+
+		KeyHandleCache();
+
+		Shard& GetShard(HKEY hkKey);
+		Shard& GetShard(const std::wstring& wsCacheKey);
+
+	public:
+
+		/**
+		 * Retrieves the handle cache used by this process
+		 *
+		 * @return The instance of KeyHandleCache
+		 */
+		static KeyHandleCache& GetInstance();
+
+		/// Delete copy and move constructors and assignment operators
+		KeyHandleCache(const KeyHandleCache&) = delete;
+		KeyHandleCache& operator=(const KeyHandleCache&) = delete;
+		KeyHandleCache(KeyHandleCache&&) = delete;
+		KeyHandleCache& operator=(KeyHandleCache&&) = delete;
+
+		/**
+		 * Wraps a handle in a KeyHandle, sharing the existing KeyHandle if the handle is already held
+		 *
+		 * @param hkKey The handle to wrap
+		 *
+		 * @return The KeyHandle holding the handle
+		 */
+		std::shared_ptr<KeyHandle> Track(HKEY hkKey);
+
+		/**
+		 * Stops tracking a handle that is about to be closed. Called by KeyHandle's destructor.
+		 *
+		 * @param hkKey The handle being closed
+		 */
+		void Untrack(HKEY hkKey);
+
+		/**
+		 * Determines the identity under which a key would be cached.
+		 *
+		 * @param hkBase The key relative to which the key is opened
+		 * @param path The path of the key relative to hkBase
+		 * @param bWow64 Whether the key is opened in the 32-bit registry view
+		 *
+		 * @return The identity of the key, or std::nullopt if caching is disabled or the key can't be cached
+		 */
+		std::optional<std::wstring> GetCacheKey(HKEY hkBase, const std::wstring& path, bool bWow64) const;
+
+		/**
+		 * Retrieves a cached handle
+		 *
+		 * @param wsCacheKey The identity of the key, as returned by GetCacheKey
+		 *
+		 * @return The cached handle, or nullptr if the key isn't cached
+		 */
+		std::shared_ptr<KeyHandle> Find(const std::wstring& wsCacheKey);
+
+		/**
+		 * Adds a newly opened handle to the cache. If another thread cached the same key first, its handle
+		 * is returned instead, and the handle given is closed once no longer referenced.
+		 *
+		 * @param wsCacheKey The identity of the key, as returned by GetCacheKey
+		 * @param handle The newly opened handle
+		 *
+		 * @return The cached handle for the key
+		 */
+		std::shared_ptr<KeyHandle> Insert(const std::wstring& wsCacheKey, const std::shared_ptr<KeyHandle>& handle);
+
+		/// Records that the name of a key was retrieved without querying it
+		void RecordNameReused();
+
+		/// Enables caching, until a matching call to Disable
+		void Enable();
+
+		/// Disables caching once every caller that enabled it has disabled it, clearing the cache
+		void Disable();
+
+		/**
+		 * Retrieves the number of times a cached handle was returned instead of opening a key
+		 *
+		 * @return The number of key opens avoided
+		 */
+		DWORD GetHandlesReused() const;
+
+		/**
+		 * Retrieves the number of times the name of a key was remembered instead of queried
+		 *
+		 * @return The number of name queries avoided
+		 */
+		DWORD GetNamesReused() const;
+	};
+
+	/**
+	 * Enables the registry handle cache for the lifetime of this object. Scopes may be nested and may be
+	 * created on multiple threads; the cache is cleared once the last of them is destroyed.
+	 */
+	class BeginHandleCaching {
+	public:
+		BeginHandleCaching();
+		~BeginHandleCaching();
+
+		/// Delete copy and move constructors and assignment operators
+		BeginHandleCaching(const BeginHandleCaching&) = delete;
+		BeginHandleCaching& operator=(const BeginHandleCaching&) = delete;
+		BeginHandleCaching(BeginHandleCaching&&) = delete;
+		BeginHandleCaching& operator=(BeginHandleCaching&&) = delete;
+	};
+}
@@ -0,0 +1,226 @@
+#pragma once
+
+#include <Windows.h>
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <optional>
+#include <functional>
+
+#include "common/wrappers.hpp"
+
+#include "util/configurations/Registry.h"
+
+namespace Registry {
+
+	/// The records of a snapshot file, defined with the file format in RegistrySnapshot.cpp
+	struct SnapshotHeader;
+	struct SnapshotKey;
+	struct SnapshotValue;
+	struct SnapshotBlob;
+	struct SnapshotString;
+
+	/// A difference between two registry snapshots
+	struct SnapshotDifference {
+		enum class Kind {
+			KeyAdded,
+			KeyRemoved,
+			ValueAdded,
+			ValueRemoved,
+			ValueChanged
+		} kind;
+
+		/// The path of the key added or removed, or of the key holding the value
+		std::wstring wsKeyPath;
+
+		/// The name of the value added, removed, or changed, if the difference concerns a value
+		std::wstring wsValueName;
+
+		/// The data of the value before and after, as displayed to the user, where the value was present
+		std::optional<std::wstring> before;
+		std::optional<std::wstring> after;
+
+		std::wstring ToString() const;
+	};
+
+	/**
+	 * A snapshot of the registry as it was when captured, stored in a compact binary file so that captures can
+	 * be compared over time or between hosts.
+	 *
+	 * A snapshot is written by walking the registry depth-first, streaming the data of each value to the file
+	 * as it is read. Key and value names are interned in a string table, and value data is stored as blobs
+	 * identified by a hash of their contents, so data repeated across many values, such as common paths, is
+	 * stored only once. Keys are stored in preorder with their subkeys and values sorted by name, and each key
+	 * records the end of its subtree and a hash of everything in it.
+	 *
+	 * Two snapshots are compared by merging their sorted keys in a single pass, skipping any subtree whose hash
+	 * is the same in both, so comparing mostly identical snapshots only visits the keys that changed and their
+	 * ancestors. Every offset and index in a snapshot file is validated once when it's loaded.
+	 */
+	class RegistrySnapshot {
+	private:
+
+		/// The path of the snapshot file
+		std::wstring wsPath;
+
+		/// The view of the snapshot file
+		GenericWrapper<LPVOID> lpView;
+
+		/// The size of the view
+		SIZE_T dwSize;
+
+		RegistrySnapshot(const std::wstring& wsPath, LPVOID lpView, SIZE_T dwSize);
+
+		/**
+		 * Validates every section, offset, and index in the snapshot
+		 *
+		 * @return true if the snapshot is valid; false otherwise
+		 */
+		bool Validate() const;
+
+		/// Retrieves the sections of the snapshot
+		const SnapshotHeader& GetHeader() const;
+		const SnapshotKey* GetKeys() const;
+		const SnapshotValue* GetValues() const;
+		const SnapshotBlob* GetBlobs() const;
+		const SnapshotString* GetStrings() const;
+		LPCWSTR GetStringData() const;
+		const BYTE* GetBlobData() const;
+
+		/**
+		 * Retrieves an interned string
+		 *
+		 * @param dwString The index of the string
+		 *
+		 * @return The string
+		 */
+		std::wstring GetString(DWORD dwString) const;
+
+		/**
+		 * Compares interned strings from two snapshots in the order in which names are sorted in a snapshot
+		 *
+		 * @return A negative number, zero, or a positive number as the first string sorts before, the same as,
+		 *         or after the second
+		 */
+		static int CompareStrings(const RegistrySnapshot& first, DWORD dwFirst, const RegistrySnapshot& second, DWORD dwSecond);
+
+		/**
+		 * Adds the differences between two keys, including their values and subkeys, to a vector
+		 *
+		 * @param before The earlier snapshot
+		 * @param dwBefore The index of the key in the earlier snapshot
+		 * @param after The later snapshot
+		 * @param dwAfter The index of the key in the later snapshot
+		 * @param vDifferences The vector to which differences are added
+		 */
+		static void DiffKeys(const RegistrySnapshot& before, DWORD dwBefore, const RegistrySnapshot& after, DWORD dwAfter,
+			std::vector<SnapshotDifference>& vDifferences);
+
+	public:
+
+		/**
+		 * Walks registry keys and their subtrees, writing a snapshot of them to a file. The snapshot is written
+		 * to a temporary file first and then moved over any existing file.
+		 *
+		 * @param vRoots The keys to capture
+		 * @param wsPath The path of the snapshot file to write
+		 *
+		 * @return true if the snapshot was written; false otherwise
+		 */
+		static bool Capture(const std::vector<RegistryKey>& vRoots, const std::wstring& wsPath);
+
+		/**
+		 * Opens a snapshot file
+		 *
+		 * @param wsPath The path of the snapshot file
+		 *
+		 * @return The snapshot, or nullptr if the file couldn't be opened or isn't a valid snapshot
+		 */
+		static std::shared_ptr<RegistrySnapshot> Load(const std::wstring& wsPath);
+
+		/**
+		 * Compares two snapshots
+		 *
+		 * @param before The earlier snapshot
+		 * @param after The later snapshot
+		 *
+		 * @return Each key and value added, removed, or changed between the snapshots. A key added or removed
+		 *         is reported once, without the subkeys and values beneath it.
+		 */
+		static std::vector<SnapshotDifference> Diff(const RegistrySnapshot& before, const RegistrySnapshot& after);
+
+		/**
+		 * Retrieves the path of the snapshot file
+		 *
+		 * @return The path of the snapshot file
+		 */
+		const std::wstring& GetPath() const;
+
+		/**
+		 * Retrieves the number of keys in the snapshot
+		 *
+		 * @return The number of keys
+		 */
+		DWORD GetKeyCount() const;
+
+		/**
+		 * Retrieves the full path of a key in the snapshot
+		 *
+		 * @param dwKey The index of the key
+		 *
+		 * @return The path of the key
+		 */
+		std::wstring GetKeyPath(DWORD dwKey) const;
+
+		/**
+		 * Formats the data of a value in the snapshot for display
+		 *
+		 * @param dwValue The index of the value
+		 *
+		 * @return The data of the value, as displayed to the user
+		 */
+		std::wstring FormatValue(DWORD dwValue) const;
+
+		/**
+		 * Retrieves a hash of every key and value in the snapshot, which is the same for two snapshots only if
+		 * they hold the same keys and values
+		 *
+		 * @return The hash of the snapshot
+		 */
+		DWORD64 GetHash() const;
+
+		/**
+		 * Calls a function for each value in the snapshot, in the order in which values are stored
+		 *
+		 * @param callback The function to call with the index of the key holding the value, the index of the
+		 *        value, its type, and the index of the blob holding its data
+		 */
+		void EnumerateValues(const std::function<void(DWORD, DWORD, DWORD, DWORD)>& callback) const;
+
+		/**
+		 * Retrieves the name of a value in the snapshot
+		 *
+		 * @param dwValue The index of the value
+		 *
+		 * @return The name of the value
+		 */
+		std::wstring GetValueName(DWORD dwValue) const;
+
+		/**
+		 * Retrieves the number of distinct blobs of value data in the snapshot
+		 *
+		 * @return The number of blobs
+		 */
+		DWORD GetBlobCount() const;
+
+		/**
+		 * Retrieves a blob of value data, which remains valid for the lifetime of the snapshot
+		 *
+		 * @param dwBlob The index of the blob
+		 *
+		 * @return A pointer to the data and its size
+		 */
+		std::pair<const BYTE*, DWORD> GetBlob(DWORD dwBlob) const;
+	};
+}
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <Windows.h>
+
+#include <string>
+#include <string_view>
+#include <iterator>
+
+enum class RegistryType;
+
+namespace Registry {
+
+	class RegistryKey;
+	struct RegistryValue;
+
+	/**
+	 * A view of the strings in REG_MULTI_SZ data. Strings are found as the view is iterated over rather than
+	 * being split up front, so checking the strings allocates nothing. Iteration ends at the end of the data
+	 * or at an empty string, which terminates the list.
+	 */
+	class MultiStringView {
+	private:
+
+		/// The data, and its length in characters
+		LPCWSTR lpStrings;
+		SIZE_T dwLength;
+
+	public:
+
+		/// Iterates over the strings in the view, yielding a std::wstring_view of each
+		class Iterator {
+		private:
+			LPCWSTR lpStrings;
+			SIZE_T dwLength;
+
+			/// The start and end of the current string; the end iterator starts at the end of the data
+			SIZE_T dwStart;
+			SIZE_T dwEnd;
+
+			/// Moves to the string starting at a position
+			void Seek(SIZE_T dwPosition);
+
+		public:
+			using iterator_category = std::forward_iterator_tag;
+			using value_type = std::wstring_view;
+			using difference_type = std::ptrdiff_t;
+			using pointer = const std::wstring_view*;
+			using reference = std::wstring_view;
+
+			Iterator(LPCWSTR lpStrings, SIZE_T dwLength, SIZE_T dwPosition);
+
+			std::wstring_view operator*() const;
+			Iterator& operator++();
+			Iterator operator++(int);
+			bool operator==(const Iterator& iterator) const;
+			bool operator!=(const Iterator& iterator) const;
+		};
+
+		MultiStringView(LPCWSTR lpStrings, SIZE_T dwLength);
+
+		Iterator begin() const;
+		Iterator end() const;
+
+		/**
+		 * Indicates whether the view holds no strings
+		 *
+		 * @return true if there are no strings; false otherwise
+		 */
+		bool empty() const;
+
+		/**
+		 * Checks whether one of the strings in the view is equal to a string
+		 *
+		 * @param string The string to look for
+		 *
+		 * @return true if the string is present; false otherwise
+		 */
+		bool Contains(std::wstring_view string) const;
+	};
+
+	/**
+	 * A view of the type and data of a registry value, which doesn't own the data. Views returned by
+	 * RegistryKey::GetValueView point into a buffer reused by every read on the same thread, so a view is only
+	 * valid until the next value is read on that thread; a RegistryValue should be made from a view with
+	 * ToRegistryValue for anything that must be kept, such as a value being reported.
+	 *
+	 * The data may be interpreted as any type, in the same way as RegistryKey::GetValue would read it: strings
+	 * are never read past the end of the data, and a DWORD read from data too short to hold one is 0.
+	 */
+	class ValueView {
+	private:
+		DWORD dwType;
+		const BYTE* lpData;
+		DWORD dwSize;
+
+	public:
+
+		ValueView(DWORD dwType, const BYTE* lpData, DWORD dwSize);
+
+		/**
+		 * Retrieves the registry datatype of the value, such as REG_SZ
+		 *
+		 * @return The type of the value
+		 */
+		DWORD GetType() const;
+
+		/// Retrieves the raw data of the value and its size in bytes
+		const BYTE* GetData() const;
+		DWORD GetSize() const;
+
+		/**
+		 * Interprets the data as a REG_SZ or REG_EXPAND_SZ string, ending at the first null character
+		 *
+		 * @return A view of the string
+		 */
+		std::wstring_view AsString() const;
+
+		/**
+		 * Interprets the data as a REG_MULTI_SZ list of strings
+		 *
+		 * @return A view of the strings
+		 */
+		MultiStringView AsMultiString() const;
+
+		/**
+		 * Interprets the data as a REG_DWORD
+		 *
+		 * @return The DWORD, or 0 if the data is too short to hold one
+		 */
+		DWORD AsDword() const;
+
+		/**
+		 * Copies the data into a RegistryValue, interpreting it as a given type. Include
+		 * util/configurations/RegistryValue.h to use the result.
+		 *
+		 * @param key The key holding the value
+		 * @param name The name of the value
+		 * @param type The type as which the data is interpreted
+		 *
+		 * @return The value
+		 */
+		RegistryValue ToRegistryValue(const RegistryKey& key, const std::wstring& name, RegistryType type) const;
+	};
+}
@@ -1,6 +1,7 @@
 #pragma once
 #include <string>
 #include <unordered_map>
+#include <optional>
 #include <Windows.h>
 #include <winevt.h>
 #include "common/wrappers.hpp"
@@ -19,6 +20,13 @@ namespace EventLogs {
 			std::unordered_map<std::wstring, std::wstring> GetProperties() const;
 			std::wstring GetChannel() const;
 			std::wstring GetTimeCreated() const;
+
+			/**
+			 * Parses the time the event was created, which is given in UTC as YYYY-MM-DDTHH:MM:SS.fffffffZ
+			 *
+			 * @return The time the event was created, or std::nullopt if it couldn't be parsed
+			 */
+			std::optional<FILETIME> GetTimeCreatedAsFileTime() const;
 			std::wstring GetXML() const;
 			unsigned int GetEventID() const;
 			unsigned int GetEventRecordID() const;
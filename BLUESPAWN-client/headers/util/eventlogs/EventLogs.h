@@ -7,6 +7,7 @@
 #include <winevt.h>
 #include "reaction/Reaction.h"
 #include <vector>
+#include <functional>
 #include "util/eventlogs/EventSubscription.h"
 #include "util/eventlogs/EventLogItem.h"
 #include "common/wrappers.hpp"
@@ -26,6 +27,19 @@ namespace EventLogs {
 	*/
 	std::vector<EventLogItem> QueryEvents(const std::wstring& channel, unsigned int id, const std::vector<XpathQuery>& filters = {});
 
+	/**
+	* Streams the events matching a query to a callback as each is read, rather than collecting every
+	* event first.
+	*
+	* @param channel the channel to look for the event log (exe, 'Microsoft-Windows-Sysmon/Operational')
+	* @param id the event ID to filter for
+	* @param callback called with each event found; returning false stops the query
+	* @param filters xpath queries to filter the event log results by
+	* @return true if the query completed; false if it failed or the callback stopped it
+	*/
+	bool EnumerateEvents(const std::wstring& channel, unsigned int id, const std::function<bool(EventLogItem)>& callback, 
+		const std::vector<XpathQuery>& filters = {});
+
 	/**
 	* Get the string value of a parameter in an event
 	*
@@ -72,6 +86,11 @@ namespace EventLogs {
 	*/
 	std::vector<EventLogItem> ProcessResults(const EventWrapper& hEvent, const std::vector<XpathQuery>& filters);
 
+	/**
+	* A utility function called by EnumerateEvents
+	*/
+	bool ProcessResults(const EventWrapper& hEvent, const std::vector<XpathQuery>& filters, const std::function<bool(EventLogItem)>& callback);
+
 	bool IsChannelOpen(const std::wstring& channel);
 	bool OpenChannel(const std::wstring& channel);
 
@@ -0,0 +1,218 @@
+#pragma once
+
+#include <Windows.h>
+
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+#include <atomic>
+#include <functional>
+
+#include "common/DynamicLinker.h"
+#include "common/wrappers.hpp"
+#include "util/accounting/ResourceUsage.h"
+#include "util/log/Log.h"
+
+class ThreadPool;
+
+DEFINE_FUNCTION(NTSTATUS, NtQueryDirectoryFile, NTAPI,
+				HANDLE           FileHandle,
+				HANDLE           Event,
+				PVOID            ApcRoutine,
+				PVOID            ApcContext,
+				PIO_STATUS_BLOCK IoStatusBlock,
+				PVOID            FileInformation,
+				ULONG            Length,
+				int              FileInformationClass,
+				BOOLEAN          ReturnSingleEntry,
+				PUNICODE_STRING  FileName,
+				BOOLEAN          RestartScan);
+
+namespace FileSystem {
+
+	/// A file or directory found by a DirectoryWalker
+	struct DirectoryEntry {
+
+		/// The full path of the entry
+		std::wstring wsPath;
+
+		DWORD dwAttributes;
+		DWORD64 qwSize;
+		FILETIME ftLastWrite;
+
+		/// The depth at which the entry was found; entries directly inside the root of the walk are at depth 0
+		int iDepth;
+	};
+
+	/// Controls which directories a DirectoryWalker enters and which entries it reports
+	struct WalkOptions {
+
+		/// The lowercase extensions, including the leading period, of the files to report. If empty, files are
+		/// reported regardless of their extension.
+		std::unordered_set<std::wstring> extensions{};
+
+		/// Attributes that every reported entry must have, and attributes that no reported entry may have
+		DWORD dwRequiredAttributes{ 0 };
+		DWORD dwExcludedAttributes{ 0 };
+
+		/// The depth beneath the root to search; 0 lists only the root, and -1 searches without limit
+		int iMaxDepth{ -1 };
+
+		/// Whether files and directories are reported
+		bool bReportFiles{ true };
+		bool bReportDirectories{ false };
+
+		/// Whether directories which are reparse points, such as junctions, are entered. They aren't by default,
+		/// since a junction pointing to one of its parents would otherwise be walked forever.
+		bool bFollowReparsePoints{ false };
+
+		/// If given, called with the path of each subdirectory; subdirectories for which it returns false are not
+		/// entered. It may be called from several threads at once.
+		std::function<bool(const std::wstring&)> folderFilter{ nullptr };
+	};
+
+	/**
+	 * Walks a directory tree, listing directories in parallel and streaming matching entries to a callback as
+	 * they are found, so that no more than the directories waiting to be listed is ever held in memory.
+	 *
+	 * Each directory is listed by a task on a work-stealing thread pool, which reads the directory with
+	 * NtQueryDirectoryFile into a large per-thread buffer, so that each call returns hundreds of entries rather
+	 * than the handful FindNextFile returns. Entries are filtered as they are read by extension, using a hashed
+	 * set, and by attribute masks, without opening them. Subdirectories are submitted as tasks of their own.
+	 *
+	 * Every walker shares a single pool with one thread per logical processor, so walks run at once by several
+	 * hunts don't each start threads of their own. A walk started from a thread of that pool lists its
+	 * directories on the calling thread instead of waiting on the pool.
+	 *
+	 * The pool's threads only list directories; they hand the matching entries back to the thread calling Walk,
+	 * which calls the callback. The messages those threads log and the resources they use are captured per
+	 * directory and passed back with the entries, so they land in the log capture and resource tracker of the
+	 * walking thread rather than those of whichever pool thread listed the directory. Entries are reported in no
+	 * particular order.
+	 */
+	class DirectoryWalker {
+	private:
+		WalkOptions options;
+
+		/// Set once the walk is stopped, either by the callback or by Cancel
+		std::atomic<bool> bCancelled;
+
+		/// The number of directories listed, entries read, and entries reported during the last walk
+		std::atomic<DWORD64> qwDirectories;
+		std::atomic<DWORD64> qwEntries;
+		std::atomic<DWORD64> qwReported;
+
+		/// The pool listing the directories of the current walk, or nullptr if they're listed on the walking thread
+		ThreadPool* lpPool;
+
+		/// Matching entries listed by the pool, along with the messages logged and resources used while listing them
+		struct ListedBatch {
+			std::vector<DirectoryEntry> vEntries;
+			Log::LogCapture logs;
+			Accounting::ResourceUsage usage;
+		};
+
+		/// The number of directories submitted to the pool and not yet listed, and the batches listed but not yet
+		/// reported, both guarded by hPendingSection. cvProgress is signalled when a batch is added or a directory
+		/// finishes, and cvBatchesTaken when the walking thread takes the waiting batches.
+		DWORD dwPendingDirectories;
+		std::vector<ListedBatch> vListedBatches;
+		CriticalSection hPendingSection;
+		CONDITION_VARIABLE cvProgress;
+		CONDITION_VARIABLE cvBatchesTaken;
+
+		/// The directories waiting to be listed when the walk runs on the walking thread, with their depths
+		std::vector<std::pair<std::wstring, int>> vWaitingDirectories;
+
+		/**
+		 * Retrieves the pool shared by every walker, creating it if it doesn't exist yet
+		 *
+		 * @return The shared pool
+		 */
+		static ThreadPool& GetSharedPool();
+
+		/**
+		 * Arranges for a directory to be listed, either by submitting a task to the pool or by queueing it for the
+		 * walking thread
+		 *
+		 * @param path The path of the directory
+		 * @param iDepth The depth of the directory's entries
+		 * @param callback The function to which matching entries are reported
+		 */
+		void EnterDirectory(const std::wstring& path, int iDepth, const std::function<bool(const DirectoryEntry&)>& callback);
+
+		/**
+		 * Lists a single directory, reporting its matching entries and entering each subdirectory to be walked.
+		 * An exception raised while listing the directory is logged, and the rest of the walk continues.
+		 *
+		 * @param path The path of the directory
+		 * @param iDepth The depth of the directory's entries
+		 * @param callback The function to which matching entries are reported
+		 */
+		void WalkDirectory(const std::wstring& path, int iDepth, const std::function<bool(const DirectoryEntry&)>& callback);
+
+		/**
+		 * Lists a single directory, as WalkDirectory does, without guarding against exceptions
+		 */
+		void ListDirectory(const std::wstring& path, int iDepth, const std::function<bool(const DirectoryEntry&)>& callback);
+
+		/**
+		 * Hands a batch listed on the pool to the walking thread, waiting first if too many batches are already
+		 * waiting to be reported
+		 *
+		 * @param batch The batch to hand over
+		 */
+		void QueueBatch(ListedBatch&& batch);
+
+		/**
+		 * Reports a batch of entries to the callback on the walking thread, stopping the walk if the callback
+		 * returns false
+		 *
+		 * @param vEntries The entries to report
+		 * @param callback The function to which the entries are reported
+		 */
+		void ReportEntries(const std::vector<DirectoryEntry>& vEntries, const std::function<bool(const DirectoryEntry&)>& callback);
+
+		/**
+		 * Checks whether an entry should be reported
+		 *
+		 * @param name The name of the entry
+		 * @param dwAttributes The attributes of the entry
+		 *
+		 * @return true if the entry should be reported; false otherwise
+		 */
+		bool Matches(const std::wstring_view& name, DWORD dwAttributes) const;
+
+	public:
+
+		DirectoryWalker(const WalkOptions& options);
+
+		DirectoryWalker(const DirectoryWalker&) = delete;
+		DirectoryWalker operator=(const DirectoryWalker&) = delete;
+
+		/**
+		 * Walks the tree beneath a directory, returning once every directory has been listed or the walk has
+		 * been stopped
+		 *
+		 * @param root The directory at which to start
+		 * @param callback Called with each matching entry; returning false stops the walk
+		 *
+		 * @return true if the walk completed; false if it was stopped
+		 */
+		bool Walk(const std::wstring& root, const std::function<bool(const DirectoryEntry&)>& callback);
+
+		/**
+		 * Stops the walk. Directories being listed are abandoned, and nothing further is reported. This may be
+		 * called from any thread, including from the callback.
+		 */
+		void Cancel();
+
+		/**
+		 * Indicates whether the walk has been stopped
+		 *
+		 * @return true if the walk was stopped; false otherwise
+		 */
+		bool IsCancelled() const;
+	};
+}
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <Windows.h>
+
+#include <string>
+#include <map>
+#include <optional>
+#include <functional>
+#include <atomic>
+
+#include "util/filesystem/FileSystem.h"
+#include "common/wrappers.hpp"
+#include "common/Utils.h"
+
+namespace FileSystem {
+
+	/// What is known about a version of a file
+	struct FileVerdicts {
+
+		/// The digests of the file as lowercase hex strings. Only MD5, SHA1, and SHA256 digests are kept.
+		std::map<HashType, std::wstring> hashes;
+
+		/// Whether the file has a valid signature, if that has been checked
+		std::optional<bool> bSigned;
+
+		/// The fingerprint of the YARA rules under which the file was last scanned and found to match nothing
+		std::optional<DWORD64> qwYaraCleanRules;
+	};
+
+	/**
+	 * A cache of the digests, signature verdicts, and YARA verdicts of files, keyed by the identity of each file:
+	 * its volume serial number, file index, size, last write time, and change journal USN. Any write to a file
+	 * changes its identity, so a file found in the cache has the contents it had when its entry was recorded, and
+	 * none of it has to be read again.
+	 *
+	 * The cache is a fixed-size open-addressed table of fixed-size slots. Until Open is called, the table is kept
+	 * in memory for the life of the process. Once opened, it is a file mapped into memory, so that repeated hunts
+	 * skip reading the contents of almost every file. Each slot carries a checksum of its contents which is
+	 * cleared before the slot is written and set once it is complete; a slot torn by a crash or power loss fails
+	 * its checksum and is treated as empty, so the file never has to be rewritten to stay consistent. When the
+	 * slots a file can occupy are full, the oldest of them is replaced.
+	 *
+	 * All methods are safe to call from multiple threads at once.
+	 */
+	class FileCache {
+	private:
+		static FileCache instance;
+
+		/// The number of slots in the table, and the number of slots probed for each file
+		static const DWORD dwSlotCount;
+		static const DWORD dwProbeCount;
+
+		/// The file and mapping backing the table, if it is persisted, and the view of the table
+		HandleWrapper hFile;
+		HandleWrapper hMapping;
+		GenericWrapper<LPVOID> lpView;
+
+		std::wstring wsPath;
+
+		CriticalSection hSection;
+
+		/// The number of lookups which found an entry, and the number which didn't
+		std::atomic<DWORD> dwHits;
+		std::atomic<DWORD> dwMisses;
+
+		FileCache();
+
+		/**
+		 * Writes the header of an empty table to the view, which must already be zeroed
+		 */
+		void Initialize();
+
+	public:
+
+		static FileCache& GetInstance();
+
+		FileCache(const FileCache&) = delete;
+		FileCache operator=(const FileCache&) = delete;
+
+		/**
+		 * Opens a file holding the cache and maps it into memory, creating it if it doesn't exist and emptying it
+		 * if it can't be parsed. Entries recorded in memory before the file was opened are discarded. The file is
+		 * opened with FileSystem::OpenProtectedFile, so a file which users other than SYSTEM and Administrators
+		 * could write is refused. If the file can't be opened, such as when another instance of BLUESPAWN holds it,
+		 * the cache remains in memory.
+		 *
+		 * @param path The path of the file holding the cache
+		 *
+		 * @return true if the cache is backed by the file; false otherwise
+		 */
+		bool Open(const std::wstring& path);
+
+		/**
+		 * Indicates whether the cache is backed by a file
+		 *
+		 * @return true if the cache is persisted between runs; false if it is kept in memory
+		 */
+		bool IsPersistent() const;
+
+		/**
+		 * Empties the cache, returning it to a table kept in memory. If the cache is backed by a file, changes are
+		 * written through to the file first and the file is closed. This is used to keep the verdicts of one job
+		 * run by an agent from being used by the next.
+		 */
+		void Reset();
+
+		/**
+		 * Looks up what is known about a version of a file
+		 *
+		 * @param identity The identity of the file
+		 *
+		 * @return What is known about the file, or std::nullopt if the cache holds nothing for it
+		 */
+		std::optional<FileVerdicts> Find(const FileIdentity& identity);
+
+		/**
+		 * Updates what is known about a version of a file. The update is applied to the entry held for the file,
+		 * or to an empty entry if there is none, so that concurrent updates of different fields aren't lost.
+		 *
+		 * @param identity The identity of the file
+		 * @param update A function which adds what was learned about the file to its entry
+		 */
+		void Update(const FileIdentity& identity, const std::function<void(FileVerdicts&)>& update);
+
+		/**
+		 * Writes any changes to the cache through to its file
+		 */
+		void Flush();
+
+		/**
+		 * Retrieves the number of lookups which found an entry and the number which didn't
+		 *
+		 * @return A pair of the hit count and the miss count
+		 */
+		std::pair<DWORD, DWORD> GetStatistics() const;
+
+		/**
+		 * Retrieves the default location of the cache: a file next to the BLUESPAWN executable
+		 *
+		 * @return The default path of the cache
+		 */
+		static std::wstring GetDefaultPath();
+	};
+}
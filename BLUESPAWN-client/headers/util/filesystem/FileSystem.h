@@ -6,6 +6,8 @@
 #include <vector>
 #include <optional>
 #include <set>
+#include <map>
+#include <functional>
 
 #include "util/log/Loggable.h"
 #include "common/wrappers.hpp"
@@ -30,11 +32,15 @@ DEFINE_FUNCTION(NTSTATUS, NtCreateFile, __kernel_entry NTAPI,
 
 #define SHA1LEN 20
 #define SHA256LEN 32
+#define SHA384LEN 48
+#define SHA512LEN 64
 
 enum class HashType {
 	MD5_HASH,
 	SHA1_HASH,
-	SHA256_HASH
+	SHA256_HASH,
+	SHA384_HASH,
+	SHA512_HASH
 };
 
 namespace FileSystem {
@@ -56,6 +62,32 @@ namespace FileSystem {
 	*	if the file wasn't found. 
 	*/
 	std::optional<std::wstring> SearchPathExecutable(const std::wstring& name);
+
+	/**
+	* Function to check that a file can only be written by SYSTEM and Administrators: it must be owned by one of
+	* them, and its DACL must grant write access to no one else.
+	*
+	* @param hFile A handle to the file, opened with READ_CONTROL
+	*
+	* @return true if the file is protected, false otherwise
+	*/
+	bool IsFileProtected(HANDLE hFile);
+
+	/**
+	* Function to open a file holding state that BLUESPAWN trusts, such as a cache of file verdicts. Files created
+	* are owned by Administrators and grant access only to SYSTEM and Administrators. A file which already exists
+	* is refused unless IsFileProtected holds for it, since anyone able to write such a file could use it to hide
+	* their files from hunts.
+	*
+	* @param path The path of the file
+	* @param dwAccess The access requested, as passed to CreateFileW
+	* @param dwShareMode The sharing mode, as passed to CreateFileW
+	* @param dwDisposition The action to take if the file does or doesn't exist, as passed to CreateFileW
+	*
+	* @return A handle to the file, or INVALID_HANDLE_VALUE if the file couldn't be opened or isn't protected.
+	*     In the latter case, the last error is ERROR_ACCESS_DENIED.
+	*/
+	HandleWrapper OpenProtectedFile(const std::wstring& path, DWORD dwAccess, DWORD dwShareMode, DWORD dwDisposition);
 	
 	struct FileAttribs {
 		std::wstring extension;
@@ -65,6 +97,30 @@ namespace FileSystem {
 		std::vector<std::wstring> extensions;
 	};
 
+	/**
+	 * Identifies a file and the version of its contents. If any of these fields differ between two
+	 * observations of a file, the file should be assumed to have changed.
+	 */
+	struct FileIdentity {
+		DWORD dwVolumeSerial;
+		DWORD64 dwFileIndex;
+		DWORD64 dwFileSize;
+		FILETIME ftLastWrite;
+
+		/// The update sequence number of the file's latest change journal record, or 0 if the volume keeps no
+		/// change journal. This catches changes which preserve the size and restore the last write time.
+		LONGLONG llUsn;
+	};
+
+	/**
+	 * Hashes the identity of a file, giving a fingerprint which changes whenever the file is replaced or written
+	 *
+	 * @param identity The identity of the file
+	 *
+	 * @return The hash of the identity
+	 */
+	DWORD64 HashFileIdentity(const FileIdentity& identity);
+
 	class File : public Loggable {
 
 		//Whether or not this current file actually exists on the filesystem
@@ -103,13 +159,30 @@ namespace FileSystem {
 		bool GetFileInSystemCatalogs() const;
 
 		/**
-		* Function to assist in retrieving file hashes
-		* 
-		* @param HashType
+		* Function to check the signature of the file with WinVerifyTrust, falling back to the system catalogs
+		*
+		* return true if the file is signed, false if it isn't or on error
+		*/
+		bool VerifyFileSignature() const;
+
+		/**
+		* Function to read the whole file once, from the start, in large chunks. When the handle can be reopened for
+		* overlapped reads, the next chunk is read while the current one is processed.
+		*
+		* @param callback The function to call with each chunk, which returns false to stop reading
+		*
+		* return true if the whole file was read, false if a read failed or the callback stopped reading
+		*/
+		bool ReadChunks(const std::function<bool(const BYTE*, DWORD)>& callback) const;
+
+		/**
+		* Function to assist in retrieving a single file hash
+		*
+		* @param type The type of hash to compute
 		*
 		* return std::wstring value of the requested hash type
 		*/
-		std::optional<std::wstring> CalculateHashType(HashType sHashType) const;
+		std::optional<std::wstring> GetHash(HashType type) const;
 	public:
 
 		/**
@@ -180,6 +253,16 @@ namespace FileSystem {
 		*/
 		AllocationWrapper Read(__in_opt unsigned long amount = -1, __in_opt long offset = 0, __out_opt PDWORD amountRead = nullptr) const;
 
+		/**
+		* Function to compute several hashes of the file at once. The file is read a single time, with each chunk
+		* read passed to every digest requested.
+		*
+		* @param types The types of hash to compute
+		*
+		* @return Each hash requested as a lowercase hex string, or std::nullopt if unable to calculate them
+		*/
+		std::optional<std::map<HashType, std::wstring>> GetHashes(const std::set<HashType>& types) const;
+
 		/**
 		* Function to compute the MD5 hash of the file
 		*
@@ -211,7 +294,9 @@ namespace FileSystem {
 		bool MatchesAttributes(IN const FileSearchAttribs& searchAttribs) const;
 
 		/**
-		 * Returns whether or not the current file is signed.
+		 * Returns whether or not the current file is signed. Verdicts are cached for the lifetime of the
+		 * process by the file's identity, so a file is only verified again once it has been replaced or
+		 * written.
 		 *
 		 * @return true if the file is properly signed; false if not signed or an error occured.
 		 */
@@ -348,6 +433,14 @@ namespace FileSystem {
 		*     occurs the function returns std::nullopt and calls SetLastError with the error
 		*/
 		std::optional<FILETIME> GetAccessTime() const;
+
+		/**
+		* Function to get the identity of the file, which changes whenever the file is replaced or written
+		*
+		* @return a FileIdentity struct describing the file. If an error occurs, the function returns
+		*     std::nullopt and calls SetLastError with the error
+		*/
+		std::optional<FileIdentity> GetFileIdentity() const;
 	};
 
 	class Folder {
@@ -444,6 +537,24 @@ namespace FileSystem {
 		*/
 		std::vector<File> GetFiles(__in_opt std::optional<FileSearchAttribs> attribs = std::nullopt, __in_opt int recurDepth = 0);
 
+		/**
+		* Function to walk the files in the folder, handing each file's path to a callback as soon as it is
+		* found rather than collecting every file first. Files are filtered by extension using only the
+		* directory listing, without opening them. Folders are listed in parallel by a DirectoryWalker, but the
+		* callback is always called on the calling thread, and files are found in no particular order. Junctions and other reparse points are not entered.
+		*
+		* @param callback - called with the path of each matching file; returning false stops the walk
+		* @param attribs - the attributes for files to match, std::nullopt matches everything
+		* @param recurDepth - the depth to recursively search, -1 recurses infinitely
+		* @param folderFilter - if given, called with the path of each subfolder; subfolders for which it
+		*     returns false are not entered
+		*
+		* @return true if the walk completed; false if the callback stopped it
+		*/
+		bool EnumerateFiles(__in const std::function<bool(const std::wstring&)>& callback,
+			__in_opt std::optional<FileSearchAttribs> attribs = std::nullopt, __in_opt int recurDepth = 0,
+			__in_opt const std::function<bool(const std::wstring&)>& folderFilter = nullptr) const;
+
 		/**
 		* Function to return all subdirectories in the current folder
 		*
@@ -39,6 +39,9 @@ private:
 
 	YaraStatus status;
 
+	/// A hash of the compiled rule resources, used to detect when the rules have changed
+	DWORD64 dwRulesFingerprint;
+
 public:
 
 	static const YaraScanner& GetInstance();
@@ -50,6 +53,14 @@ public:
 	YaraScanResult ScanMemory(const AllocationWrapper& allocation) const;
 	YaraScanResult ScanMemory(const MemoryWrapper<>& memory) const;
 
+	/**
+	 * Retrieves a fingerprint of the rules loaded by the scanner. The fingerprint changes whenever
+	 * any of the rule sets change, so verdicts recorded with a different fingerprint are stale.
+	 *
+	 * @return The fingerprint of the rules
+	 */
+	DWORD64 GetRulesFingerprint() const;
+
 	YaraScanner(const YaraScanner&) = delete;
 	YaraScanner operator=(const YaraScanner&) = delete;
 	YaraScanner(YaraScanner&&) = delete;
@@ -93,6 +93,14 @@ namespace Log {
 		HuntLogMessage(const HuntLogMessage& message);
 	};
 
+	/**
+	 * Logs a summary record of the resources consumed by a hunt to the hunt sinks at the LogUsage
+	 * level. The structured usage is passed to the sinks in the HuntUsage field of the HuntInfo.
+	 *
+	 * @param info Information about the hunt, with HuntUsage set
+	 */
+	void LogHuntResourceUsage(const HuntInfo& info);
+
 	/**
 	 * Adds a sink to the vector of default sinks to be used in LOG_HUNT_*.
 	 * If the provided sink is equal to any sink in the vector already, this will return false
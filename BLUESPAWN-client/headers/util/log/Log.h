@@ -5,6 +5,7 @@
 #include <sstream>
 #include <functional>
 #include <vector>
+#include <optional>
 
 #include "LogLevel.h"
 #include "Loggable.h"
@@ -159,6 +160,81 @@ namespace Log {
 		}
 	};
 
+	/**
+	 * Buffers log messages rather than forwarding them to their sinks immediately. While a capture
+	 * is active on a thread (see BeginLogCapture), every message terminated on that thread is 
+	 * recorded here instead. This is used when running hunts in parallel so that the output of each
+	 * hunt can be replayed in a deterministic order regardless of which thread ran it.
+	 */
+	class LogCapture {
+	private:
+		struct CapturedMessage {
+			std::shared_ptr<LogSink> sink;
+			LogLevel level;
+			std::string message;
+			std::optional<HuntInfo> info;
+			std::vector<std::shared_ptr<DETECTION>> detections;
+		};
+
+		std::vector<CapturedMessage> vMessages{};
+
+	public:
+
+		/**
+		 * Records a message that would have been sent to a sink.
+		 *
+		 * @param sink The sink to which the message was directed
+		 * @param level The level at which the message was logged
+		 * @param message The message logged
+		 * @param info Information about the hunt associated with the message, if any
+		 * @param detections The detections associated with the message, if any
+		 */
+		void Record(const std::shared_ptr<LogSink>& sink, const LogLevel& level, const std::string& message,
+			        const std::optional<HuntInfo>& info = std::nullopt, const std::vector<std::shared_ptr<DETECTION>>& detections = {});
+
+		/**
+		 * Forwards every recorded message to its sink in the order in which it was recorded, then
+		 * clears the recorded messages. If a capture is active on the calling thread, the messages
+		 * will be recorded by that capture instead.
+		 */
+		void Replay();
+
+		/**
+		 * Sends a message to a sink, or records it in the capture active on the current thread if there
+		 * is one. All messages passed to sinks should go through this function.
+		 *
+		 * @param sink The sink to which the message is directed
+		 * @param level The level at which the message is logged
+		 * @param message The message to log
+		 * @param info Information about the hunt associated with the message, if any
+		 * @param detections The detections associated with the message, if any
+		 */
+		static void Dispatch(const std::shared_ptr<LogSink>& sink, const LogLevel& level, const std::string& message,
+			                 const std::optional<HuntInfo>& info = std::nullopt, const std::vector<std::shared_ptr<DETECTION>>& detections = {});
+
+		/**
+		 * Retrieves the capture active on the current thread, if any.
+		 *
+		 * @return A pointer to the active capture, or nullptr if messages are not being captured.
+		 */
+		static LogCapture* GetCurrent();
+	};
+
+	/**
+	 * Activates a LogCapture on the current thread for the lifetime of this object. When this object
+	 * is destroyed, the capture that was previously active on the thread (if any) is restored.
+	 */
+	class BeginLogCapture {
+		LogCapture* lpPrevious;
+
+	public:
+		explicit BeginLogCapture(LogCapture& capture);
+		~BeginLogCapture();
+
+		BeginLogCapture(const BeginLogCapture&) = delete;
+		BeginLogCapture operator=(const BeginLogCapture&) = delete;
+	};
+
 	/**
 	 * Adds a sink to the vector of default sinks to be used in LOG_ERROR, LOG_WARNING, etc.
 	 * If the provided sink is equal to any sink in the vector already, this will return false
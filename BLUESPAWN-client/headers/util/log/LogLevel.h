@@ -35,7 +35,8 @@ namespace Log {
 			LogInfo,     // Intended for logging information and statuses of hunts
 			LogVerbose1, // Intended for a low level of verbosity
 			LogVerbose2, // Intended for a moderate level of verbosity
-			LogVerbose3; // Intended for a high level of verbosity
+			LogVerbose3, // Intended for a high level of verbosity
+			LogUsage;    // Intended for logging the resources consumed by hunts
 
 		/**
 		 * Creates a new log level, enabled by default, with a given severity.
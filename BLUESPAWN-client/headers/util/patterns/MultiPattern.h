@@ -0,0 +1,138 @@
+#pragma once
+
+#include <Windows.h>
+
+#include <string>
+#include <vector>
+#include <memory>
+
+namespace Patterns {
+
+	/**
+	 * A set of strings searched for together with an Aho-Corasick automaton, which finds every occurrence of
+	 * every string in a text while reading each character of the text once, no matter how many strings are in
+	 * the set. This makes checking data against tens of thousands of indicators, such as domains, paths, mutex
+	 * names, and hashes, about as cheap as checking it against one.
+	 *
+	 * Letters are matched without regard to case, folded as in case-insensitive Patterns. The automaton is
+	 * stored as a trie whose edges are kept in one sorted array, with failure links to the longest suffix of
+	 * each state that is also a prefix of a string in the set. Since a compiled set is never modified, one set
+	 * may be searched by any number of threads at once.
+	 */
+	class MultiPattern {
+	private:
+
+		/// The strings searched for, as given
+		std::vector<std::wstring> vPatterns;
+
+		/// The class of each character, where characters appearing in no string share class 0
+		std::vector<WORD> vClasses;
+		DWORD dwClassCount;
+
+		/// The edges out of each state, which are vEdges[vEdgeStarts[state]] to vEdges[vEdgeStarts[state + 1]],
+		/// as pairs of a class and the state reached, sorted by class
+		std::vector<DWORD> vEdgeStarts;
+		std::vector<std::pair<WORD, DWORD>> vEdges;
+
+		/// The state reached from the root on each class, so that the most common transitions aren't searched for
+		std::vector<DWORD> vRootTransitions;
+
+		/// The state for the longest proper suffix of each state that is also a prefix of a string in the set
+		std::vector<DWORD> vFailures;
+
+		/// The strings ending at each state, which are vOutputs[vOutputStarts[state]] to vOutputs[vOutputStarts[state + 1]]
+		std::vector<DWORD> vOutputStarts;
+		std::vector<DWORD> vOutputs;
+
+		/// The nearest state along the failure links of each state at which a string ends, or 0 if there is none
+		std::vector<DWORD> vOutputLinks;
+
+		/**
+		 * Finds the state reached from a state other than the root on a class of characters
+		 *
+		 * @param dwState The state
+		 * @param wClass The class of characters
+		 *
+		 * @return The state reached, or 0 if there's no edge for the class
+		 */
+		DWORD FindEdge(DWORD dwState, WORD wClass) const;
+
+		/**
+		 * Finds the state reached from a state on a class of characters, following failure links as needed
+		 *
+		 * @param dwState The state
+		 * @param wClass The class of characters, which must not be 0
+		 *
+		 * @return The state reached
+		 */
+		DWORD Advance(DWORD dwState, WORD wClass) const;
+
+	public:
+
+		/**
+		 * Compiles a set of strings into an automaton. Empty strings are ignored.
+		 *
+		 * @param vPatterns The strings to search for
+		 */
+		MultiPattern(const std::vector<std::wstring>& vPatterns);
+
+		/// Delete copy and move constructors and assignment operators
+		MultiPattern(const MultiPattern&) = delete;
+		MultiPattern& operator=(const MultiPattern&) = delete;
+		MultiPattern(MultiPattern&&) = delete;
+		MultiPattern& operator=(MultiPattern&&) = delete;
+
+		/**
+		 * Reads a set of strings from a file holding one per line and compiles it. The file may be UTF-8,
+		 * with or without a byte order mark, or UTF-16 with a byte order mark. Leading and trailing whitespace
+		 * is ignored, as are blank lines and lines beginning with #.
+		 *
+		 * @param wsPath The path of the file
+		 *
+		 * @return The compiled set, or nullptr if the file couldn't be read
+		 */
+		static std::shared_ptr<MultiPattern> LoadFromFile(const std::wstring& wsPath);
+
+		/**
+		 * Finds each string in the set occurring anywhere in a text
+		 *
+		 * @param text The text to search, which needn't be null-terminated
+		 * @param dwLength The number of characters in the text
+		 * @param vMatches A vector to which the index of each string found is added, once for each occurrence
+		 */
+		void Search(LPCWSTR text, SIZE_T dwLength, std::vector<DWORD>& vMatches) const;
+
+		/**
+		 * Checks whether any string in the set occurs in a text
+		 *
+		 * @param text The text to search, which needn't be null-terminated
+		 * @param dwLength The number of characters in the text
+		 *
+		 * @return True if a string in the set occurs in the text; false otherwise
+		 */
+		bool Contains(LPCWSTR text, SIZE_T dwLength) const;
+
+		/**
+		 * Retrieves the number of strings in the set, including any empty strings ignored
+		 *
+		 * @return The number of strings
+		 */
+		DWORD GetPatternCount() const;
+
+		/**
+		 * Retrieves a string in the set
+		 *
+		 * @param dwPattern The index of the string
+		 *
+		 * @return The string, as given
+		 */
+		const std::wstring& GetPattern(DWORD dwPattern) const;
+
+		/**
+		 * Retrieves the number of states in the automaton
+		 *
+		 * @return The number of states
+		 */
+		DWORD GetStateCount() const;
+	};
+}
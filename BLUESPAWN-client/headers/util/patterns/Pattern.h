@@ -0,0 +1,178 @@
+#pragma once
+
+#include <Windows.h>
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <regex>
+#include <optional>
+#include <unordered_map>
+
+#include "common/wrappers.hpp"
+
+namespace Patterns {
+
+	/**
+	 * Retrieves the lowercase form of every UTF-16 code unit, as given by CharLowerBuff. This is how letters
+	 * are folded wherever patterns ignore case.
+	 *
+	 * @return A table of 0x10000 characters, indexed by the character to fold
+	 */
+	const std::vector<WCHAR>& GetLowerCase();
+
+	/**
+	 * A regular expression compiled once into a deterministic finite automaton (DFA) over UTF-16 code units,
+	 * which checks whether an entire string matches it. Matching reads each character once with a single table
+	 * lookup, without backtracking or allocating, and since a compiled pattern is never modified, one pattern
+	 * may be used by any number of threads at once.
+	 *
+	 * The ECMAScript syntax used by std::wregex is supported, except for features a DFA can't represent:
+	 * anchors, word boundaries, lookahead, and backreferences. Patterns using any of these, or whose DFA would
+	 * be too large, are compiled once into a std::wregex instead. In case-insensitive patterns, two characters
+	 * are the same if their lowercase forms, as given by CharLowerBuff, are the same; unlike std::regex::icase,
+	 * this folds every letter in the Basic Multilingual Plane rather than only those of the current C locale.
+	 */
+	class Pattern {
+	private:
+
+		/// The pattern as written
+		std::wstring wsPattern;
+
+		/// The first character of each class of characters the DFA treats identically, in ascending order
+		std::vector<DWORD> vClassStarts;
+
+		/// The class of each character below 0x100, so that the classes of common characters aren't searched for
+		std::vector<WORD> vLowClasses;
+
+		/// The state reached from each state on each class of characters, or -1 if no match is possible
+		std::vector<int> vTransitions;
+
+		/// Whether each state of the DFA accepts the string read to reach it
+		std::vector<bool> vAccepting;
+
+		/// The compiled std::wregex, if the pattern couldn't be compiled into a DFA
+		std::optional<std::wregex> fallback;
+
+		/// Whether the pattern could be compiled at all
+		bool bValid;
+
+		Pattern(const std::wstring& wsPattern, bool bCaseInsensitive);
+
+		/**
+		 * Retrieves the class of a character
+		 *
+		 * @param ch The character
+		 *
+		 * @return The index of the class containing the character
+		 */
+		WORD GetClass(WCHAR ch) const;
+
+		friend class PatternRegistry;
+
+	public:
+
+		/// Delete copy and move constructors and assignment operators
+		Pattern(const Pattern&) = delete;
+		Pattern& operator=(const Pattern&) = delete;
+		Pattern(Pattern&&) = delete;
+		Pattern& operator=(Pattern&&) = delete;
+
+		/**
+		 * Checks whether an entire string matches the pattern
+		 *
+		 * @param text The string to check
+		 *
+		 * @return True if the string matches; false otherwise, or if the pattern is invalid
+		 */
+		bool Matches(const std::wstring& text) const;
+
+		/**
+		 * Checks whether an entire string matches the pattern
+		 *
+		 * @param text The string to check, which needn't be null-terminated
+		 * @param dwLength The number of characters in the string
+		 *
+		 * @return True if the string matches; false otherwise, or if the pattern is invalid
+		 */
+		bool Matches(LPCWSTR text, SIZE_T dwLength) const;
+
+		/**
+		 * Retrieves the pattern as written
+		 *
+		 * @return The pattern
+		 */
+		const std::wstring& GetPattern() const;
+
+		/**
+		 * Indicates whether the pattern was compiled into a DFA, rather than falling back to std::wregex
+		 *
+		 * @return True if the pattern is matched by a DFA
+		 */
+		bool IsDeterministic() const;
+
+		/**
+		 * Indicates whether the pattern could be compiled
+		 *
+		 * @return True if the pattern is valid
+		 */
+		bool IsValid() const;
+	};
+
+	/// A compiled pattern, which may be kept and shared across threads
+	typedef std::shared_ptr<const Pattern> PatternHandle;
+
+	/**
+	 * Compiles patterns and remembers them for the lifetime of the process, so that each distinct pattern is
+	 * compiled only once no matter how many checks use it. Checks should keep the handle returned rather than
+	 * looking a pattern up each time they use it where they can, but looking a pattern up is still far cheaper
+	 * than compiling it. All methods are safe to call from multiple threads at once.
+	 */
+	class PatternRegistry {
+	private:
+
+		/// The patterns compiled, by case sensitivity and pattern
+		std::unordered_map<std::wstring, PatternHandle> mPatterns;
+		CriticalSection hSection;
+
+		/// The number of patterns compiled, and the number of those that fell back to std::wregex
+		std::atomic<DWORD> dwCompiled;
+		std::atomic<DWORD> dwFallbacks;
+
+		PatternRegistry();
+
+	public:
+
+		/**
+		 * Retrieves the pattern registry used by this process
+		 *
+		 * @return The instance of PatternRegistry
+		 */
+		static PatternRegistry& GetInstance();
+
+		/// Delete copy and move constructors and assignment operators
+		PatternRegistry(const PatternRegistry&) = delete;
+		PatternRegistry& operator=(const PatternRegistry&) = delete;
+		PatternRegistry(PatternRegistry&&) = delete;
+		PatternRegistry& operator=(PatternRegistry&&) = delete;
+
+		/**
+		 * Retrieves a compiled pattern, compiling it if it hasn't been compiled before. Invalid patterns are
+		 * logged once and never match anything.
+		 *
+		 * @param wsPattern The pattern, in ECMAScript syntax
+		 * @param bCaseInsensitive If true, the case of letters is ignored when matching
+		 *
+		 * @return The compiled pattern
+		 */
+		PatternHandle Compile(const std::wstring& wsPattern, bool bCaseInsensitive = false);
+
+		/**
+		 * Retrieves the number of distinct patterns compiled and the number of those matched by std::wregex
+		 *
+		 * @return A pair holding the number of patterns compiled and the number that fell back to std::wregex
+		 */
+		std::pair<DWORD, DWORD> GetCompileCounts() const;
+	};
+}
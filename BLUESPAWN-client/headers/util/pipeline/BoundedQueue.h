@@ -0,0 +1,117 @@
+#pragma once
+
+#include <Windows.h>
+
+#include <algorithm>
+#include <deque>
+#include <optional>
+
+#include "common/wrappers.hpp"
+
+/**
+ * A queue holding at most a fixed number of items, used to pass items from one thread to another.
+ * Pushing to a full queue blocks until there is room, so a fast producer is held back to the pace
+ * of its consumer rather than buffering an unbounded number of items.
+ *
+ * Once a queue is closed, further pushes fail immediately, and pops return the items remaining in
+ * the queue before failing. Closing the queue wakes every thread blocked on it.
+ */
+template<class T>
+class BoundedQueue {
+private:
+
+	/// The items in the queue, guarded by hSection
+	std::deque<T> items;
+
+	/// The maximum number of items held in the queue at once
+	SIZE_T dwCapacity;
+
+	/// Whether the queue has been closed, guarded by hSection
+	bool bClosed;
+
+	CriticalSection hSection;
+	CONDITION_VARIABLE cvNotEmpty;
+	CONDITION_VARIABLE cvNotFull;
+
+public:
+
+	/**
+	 * Creates an empty queue.
+	 *
+	 * @param dwCapacity The maximum number of items held in the queue at once. Must be at least 1.
+	 */
+	BoundedQueue(SIZE_T dwCapacity) :
+		dwCapacity{ (std::max)(dwCapacity, static_cast<SIZE_T>(1)) },
+		bClosed{ false }{
+		InitializeConditionVariable(&cvNotEmpty);
+		InitializeConditionVariable(&cvNotFull);
+	}
+
+	/// Copy constructor is deleted, since threads may be blocked on the condition variables
+	BoundedQueue(const BoundedQueue&) = delete;
+	BoundedQueue operator=(const BoundedQueue&) = delete;
+
+	/**
+	 * Adds an item to the back of the queue, blocking while the queue is full.
+	 *
+	 * @param item The item to add
+	 *
+	 * @return true if the item was added; false if the queue has been closed
+	 */
+	bool Push(T item){
+		auto lock{ BeginCriticalSection(hSection) };
+		while(!bClosed && items.size() >= dwCapacity){
+			SleepConditionVariableCS(&cvNotFull, hSection, INFINITE);
+		}
+
+		if(bClosed){
+			return false;
+		}
+
+		items.emplace_back(std::move(item));
+		WakeConditionVariable(&cvNotEmpty);
+		return true;
+	}
+
+	/**
+	 * Removes an item from the front of the queue, blocking while the queue is empty and open.
+	 *
+	 * @return The item removed, or std::nullopt if the queue is closed and empty
+	 */
+	std::optional<T> Pop(){
+		auto lock{ BeginCriticalSection(hSection) };
+		while(!bClosed && items.empty()){
+			SleepConditionVariableCS(&cvNotEmpty, hSection, INFINITE);
+		}
+
+		if(items.empty()){
+			return std::nullopt;
+		}
+
+		std::optional<T> item{ std::move(items.front()) };
+		items.pop_front();
+		WakeConditionVariable(&cvNotFull);
+		return item;
+	}
+
+	/**
+	 * Closes the queue. Items already in the queue may still be popped.
+	 */
+	void Close(){
+		auto lock{ BeginCriticalSection(hSection) };
+		bClosed = true;
+		WakeAllConditionVariable(&cvNotEmpty);
+		WakeAllConditionVariable(&cvNotFull);
+	}
+
+	/**
+	 * Closes the queue and discards any items remaining in it.
+	 */
+	void Abandon(){
+		auto lock{ BeginCriticalSection(hSection) };
+		bClosed = true;
+		items.clear();
+		WakeAllConditionVariable(&cvNotEmpty);
+		WakeAllConditionVariable(&cvNotFull);
+	}
+};
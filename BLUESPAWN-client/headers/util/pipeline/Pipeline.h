@@ -0,0 +1,134 @@
+#pragma once
+
+#include <Windows.h>
+
+#include <functional>
+#include <optional>
+#include <thread>
+#include <atomic>
+
+#include "BoundedQueue.h"
+#include "util/log/Log.h"
+#include "util/accounting/ResourceUsage.h"
+#include "common/Utils.h"
+
+/**
+ * Streams items from a collector to a consumer through a bounded queue. The collector runs on its
+ * own thread and hands each item it finds to the pipeline as soon as it is found, while the thread
+ * that owns the pipeline consumes items with Next. Collection (directory walks, registry
+ * enumeration, event log queries) therefore overlaps with evaluation (signature checks, YARA
+ * scans), and since the queue is bounded, the collector is held back whenever it gets ahead of the
+ * consumer, keeping memory use flat no matter how many items are collected.
+ *
+ * Messages the collector logs are captured and replayed on the owning thread once the collector
+ * finishes, and the resources the collector consumes are added to the owning thread's counters, so
+ * a hunt using a pipeline logs and accounts for the same things it would if it collected the items
+ * itself.
+ *
+ * If the collector raises an exception, it is abandoned and the pipeline ends as though the collector
+ * had finished; Failed then indicates that the items consumed may be incomplete.
+ *
+ * Destroying a pipeline before it has been drained stops the collector the next time it hands over
+ * an item. A pipeline must be destroyed on the thread that created it.
+ */
+template<class T>
+class Pipeline {
+public:
+
+	/// Hands an item to the pipeline, returning false if the collector should stop collecting
+	using Emitter = std::function<bool(T)>;
+
+	/// Collects items, handing each to the emitter it is given
+	using Collector = std::function<void(const Emitter&)>;
+
+private:
+
+	BoundedQueue<T> queue;
+
+	/// Messages logged by the collector thread
+	Log::LogCapture capture;
+
+	/// Resources consumed by the collector thread, set before the thread exits
+	Accounting::ResourceUsage usage;
+
+	/// Set if the collector raised an exception
+	std::atomic<bool> bFailed;
+
+	std::thread collector;
+
+	/// Waits for the collector to finish, then hands its messages and usage to the calling thread
+	void Join(){
+		if(collector.joinable()){
+			collector.join();
+
+			capture.Replay();
+			Accounting::MergeCounters(usage);
+		}
+	}
+
+public:
+
+	/// The number of items held in the queue by default
+	static constexpr SIZE_T dwDefaultCapacity{ 256 };
+
+	/**
+	 * Creates a pipeline and starts its collector.
+	 *
+	 * @param collect The function collecting items. It is called once, on a separate thread.
+	 * @param dwCapacity The maximum number of items collected but not yet consumed
+	 */
+	Pipeline(const Collector& collect, SIZE_T dwCapacity = dwDefaultCapacity) :
+		queue{ dwCapacity },
+		bFailed{ false },
+		collector{ [this, collect](){
+			Log::BeginLogCapture logCapture{ capture };
+			Accounting::ResourceTracker tracker{};
+
+			if(!CallFunctionSafe([this, &collect](){ collect([this](T item){ return queue.Push(std::move(item)); }); })){
+				LOG_ERROR("A pipeline's collector raised an exception and was abandoned");
+				bFailed = true;
+			}
+
+			usage = tracker.GetUsage();
+			queue.Close();
+		} }{}
+
+	/**
+	 * Stops the collector if it is still running and waits for it to exit.
+	 */
+	~Pipeline(){
+		queue.Abandon();
+		Join();
+	}
+
+	/// Copy constructor is deleted. Since the collector thread references `this`, it is very difficult to change.
+	Pipeline(const Pipeline&) = delete;
+	Pipeline operator=(const Pipeline&) = delete;
+
+	/// Move constructor is deleted. Since the collector thread references `this`, it is very difficult to change.
+	Pipeline(Pipeline&&) = delete;
+	Pipeline operator=(Pipeline&&) = delete;
+
+	/**
+	 * Retrieves the next item from the collector, blocking until one is available.
+	 *
+	 * @return The next item, or std::nullopt once the collector has finished and every item has
+	 *         been consumed
+	 */
+	std::optional<T> Next(){
+		auto item{ queue.Pop() };
+		if(!item){
+			Join();
+		}
+		return item;
+	}
+
+	/**
+	 * Indicates whether the collector raised an exception, in which case Next ended the pipeline early.
+	 *
+	 * @return true if the collector failed; false otherwise
+	 */
+	bool Failed() const {
+		return bFailed;
+	}
+};
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <Windows.h>
+
+#include <memory>
+#include <optional>
+
+#include "util/log/Log.h"
+#include "util/accounting/ResourceUsage.h"
+
+#include "common/wrappers.hpp"
+
+class IOExecutor;
+
+/**
+ * The result of a task submitted to the IO executor (see IOExecutor::Async). A hunt starts every
+ * lookup it needs as a task, holds on to their results, and only then waits for each with Get, so
+ * the lookups are all in flight at once rather than blocking the hunt one after another.
+ *
+ * Messages the task logs are captured and replayed on the thread that first calls Get, and the
+ * resources the task consumes are added to that thread's counters, so a hunt logs and accounts for
+ * the same things it would if it performed the lookup itself.
+ *
+ * Copies of an AsyncResult refer to the same task.
+ */
+template<class T>
+class AsyncResult {
+private:
+
+	/// The state shared by the task and every copy of its result
+	struct State {
+		std::optional<T> value{ std::nullopt };
+
+		/// Whether the task raised an exception, leaving value default-constructed
+		bool bFailed{ false };
+
+		/// Messages logged by the task, replayed by the first call to Get
+		Log::LogCapture capture{};
+		bool bReplayed{ false };
+
+		/// Resources consumed by the task, set before the task completes
+		Accounting::ResourceUsage usage{};
+
+		CriticalSection hSection{};
+		CONDITION_VARIABLE cvComplete;
+
+		State(){
+			InitializeConditionVariable(&cvComplete);
+		}
+	};
+
+	std::shared_ptr<State> state;
+
+	AsyncResult() :
+		state{ std::make_shared<State>() }{}
+
+	friend class IOExecutor;
+
+public:
+
+	/**
+	 * Blocks until the task has completed, then retrieves its value. This must not be called from a
+	 * task running on the IO executor, since the task being waited on may be queued behind it.
+	 *
+	 * @return A reference to the value returned by the task, valid for as long as any copy of this
+	 *         result exists
+	 */
+	const T& Get() const {
+		auto lock{ BeginCriticalSection(state->hSection) };
+		while(!state->value){
+			SleepConditionVariableCS(&state->cvComplete, state->hSection, INFINITE);
+		}
+
+		if(!state->bReplayed){
+			state->bReplayed = true;
+			state->capture.Replay();
+			Accounting::MergeCounters(state->usage);
+		}
+
+		return *state->value;
+	}
+
+	/**
+	 * Indicates whether the task has completed, without blocking.
+	 *
+	 * @return true if the task has completed and Get will return immediately; false otherwise
+	 */
+	bool IsComplete() const {
+		auto lock{ BeginCriticalSection(state->hSection) };
+		return state->value.has_value();
+	}
+
+	/**
+	 * Indicates whether the task raised an exception rather than returning a value. This blocks until
+	 * the task has completed.
+	 *
+	 * @return true if the task failed and Get returns a default-constructed value; false otherwise
+	 */
+	bool Failed() const {
+		Get();
+		auto lock{ BeginCriticalSection(state->hSection) };
+		return state->bFailed;
+	}
+};
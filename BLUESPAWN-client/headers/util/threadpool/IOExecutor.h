@@ -0,0 +1,125 @@
+#pragma once
+
+#include <Windows.h>
+
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <functional>
+
+#include "AsyncResult.h"
+
+#include "common/wrappers.hpp"
+#include "common/Utils.h"
+
+/**
+ * Runs the registry, file and event log lookups that hunts would otherwise perform one at a time.
+ * Tasks are queued on an I/O completion port and run by a small set of threads. The port allows only
+ * as many of those threads to run at once as there are processors; when a running thread blocks in
+ * a syscall, the port wakes one of the spare threads in its place, and lets the blocked thread resume
+ * once another finishes. Lookups therefore stay in flight without either leaving processors idle or
+ * needing a thread per lookup.
+ *
+ * A single executor is shared by every hunt in the process. Tasks are not isolated from one another,
+ * and a task must not wait on the result of another task.
+ */
+class IOExecutor {
+private:
+
+	/// The number of threads the port allows to run at once
+	DWORD dwConcurrency;
+
+	/// The completion port on which tasks are queued
+	HandleWrapper hPort;
+
+	std::vector<std::thread> vThreads;
+
+	/// The number of tasks that have been run
+	std::atomic<DWORD> dwTasksRun;
+
+	/// The function run by each thread
+	void RunThread();
+
+	IOExecutor();
+
+public:
+
+	/**
+	 * Retrieves the IO executor used by this process, starting it if this is the first request.
+	 *
+	 * @return The instance of IOExecutor
+	 */
+	static IOExecutor& GetInstance();
+
+	/**
+	 * Stops the threads once every queued task has run.
+	 */
+	~IOExecutor();
+
+	/// Delete copy and move constructors and assignment operators
+	IOExecutor(const IOExecutor&) = delete;
+	IOExecutor& operator=(const IOExecutor&) = delete;
+	IOExecutor(IOExecutor&&) = delete;
+	IOExecutor& operator=(IOExecutor&&) = delete;
+
+	/**
+	 * Queues a task to be run by one of the executor's threads.
+	 *
+	 * @param task The task to run
+	 */
+	void Post(const std::function<void()>& task);
+
+	/**
+	 * Queues a task that produces a value, such as a lookup. If the task raises a C++ exception or a
+	 * structured exception, it is contained, and the result holds a default-constructed value.
+	 *
+	 * @param task The task to run
+	 *
+	 * @return The result of the task, which can be waited on once every other lookup has been started
+	 */
+	template<class T>
+	AsyncResult<T> Async(const std::function<T()>& task){
+		AsyncResult<T> result{};
+		Post([state = result.state, task](){
+			Log::LogCapture capture{};
+			Accounting::ResourceUsage usage{};
+			std::optional<T> value{};
+			bool bFailed{ false };
+			{
+				Log::BeginLogCapture logCapture{ capture };
+				Accounting::ResourceTracker tracker{};
+
+				// A task that throws or faults still completes, with an empty value, so that Get returns
+				bFailed = !CallFunctionSafe([&](){ value = task(); });
+				if(bFailed){
+					LOG_ERROR("A task on the IO executor raised an exception; its result is empty");
+					value.emplace();
+				}
+
+				usage = tracker.GetUsage();
+			}
+
+			auto lock{ BeginCriticalSection(state->hSection) };
+			state->capture = std::move(capture);
+			state->usage = usage;
+			state->bFailed = bFailed;
+			state->value = std::move(value);
+			WakeAllConditionVariable(&state->cvComplete);
+		});
+		return result;
+	}
+
+	/**
+	 * Retrieves the number of threads the executor allows to run at once.
+	 *
+	 * @return The concurrency of the executor
+	 */
+	DWORD GetConcurrency() const;
+
+	/**
+	 * Retrieves the number of tasks the executor has run.
+	 *
+	 * @return The number of tasks run
+	 */
+	DWORD GetTasksRun() const;
+};
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <Windows.h>
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <functional>
+
+#include "common/wrappers.hpp"
+
+/**
+ * A work-stealing thread pool. Each worker owns a queue of tasks; workers take tasks from the
+ * back of their own queue and, when their queue is empty, steal from the front of the queues
+ * owned by the other workers. Tasks submitted from a worker thread are placed on that worker's
+ * queue, and tasks submitted from any other thread are distributed across the queues.
+ *
+ * Tasks are not isolated from one another; callers that need to survive a faulting task should
+ * guard the task themselves (see CallFunctionSafe in common/Utils.h).
+ */
+class ThreadPool {
+private:
+
+	/// A queue of tasks owned by a single worker, along with the critical section guarding it
+	struct WorkQueue {
+		std::deque<std::function<void()>> tasks;
+		CriticalSection hSection;
+	};
+
+	/// The queues owned by each of the workers. The index of a queue matches the index of its worker.
+	std::vector<std::unique_ptr<WorkQueue>> vQueues;
+
+	/// The worker threads
+	std::vector<std::thread> vWorkers;
+
+	/// A semaphore whose count tracks the number of tasks that have been submitted but not yet claimed
+	HandleWrapper hTasksAvailable;
+
+	/// The number of tasks that have been submitted and not yet completed, guarded by hIdleSection
+	DWORD dwPendingTasks;
+
+	/// A critical section and condition variable used to wait for dwPendingTasks to reach zero
+	CriticalSection hIdleSection;
+	CONDITION_VARIABLE cvIdle;
+
+	/// Used to spread tasks submitted from outside the pool across the worker queues
+	std::atomic<DWORD> dwNextQueue;
+
+	/// Instructs the workers to exit once the queues are drained
+	std::atomic<bool> terminate;
+
+	/// Attempts to remove a task from the queues, starting with the queue owned by dwWorker
+	bool TryTakeTask(DWORD dwWorker, std::function<void()>& task);
+
+	/// The function run by each worker thread
+	void RunWorker(DWORD dwWorker);
+
+public:
+
+	/**
+	 * Creates a thread pool and starts its workers.
+	 *
+	 * @param dwWorkers The number of workers to start. If zero, GetDefaultWorkerCount is used.
+	 */
+	ThreadPool(DWORD dwWorkers = 0);
+
+	/**
+	 * Waits for all outstanding tasks to complete, then stops the workers.
+	 */
+	~ThreadPool();
+
+	/// Copy constructor is deleted. Since the worker threads reference `this`, it is very difficult to change.
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool operator=(const ThreadPool&) = delete;
+
+	/// Move constructor is deleted. Since the worker threads reference `this`, it is very difficult to change.
+	ThreadPool(ThreadPool&&) = delete;
+	ThreadPool operator=(ThreadPool&&) = delete;
+
+	/**
+	 * Submits a task to be run by one of the workers.
+	 *
+	 * @param task The task to run.
+	 */
+	void Submit(const std::function<void()>& task);
+
+	/**
+	 * Blocks until every task submitted to the pool has completed. This must not be called from
+	 * a task running in this pool.
+	 */
+	void Wait();
+
+	/**
+	 * Retrieves the number of workers in this pool.
+	 *
+	 * @return The number of workers in this pool
+	 */
+	DWORD GetWorkerCount() const;
+
+	/**
+	 * Indicates whether the calling thread is one of this pool's workers, such as when called from a task.
+	 *
+	 * @return true if the calling thread belongs to this pool; false otherwise
+	 */
+	bool IsCurrentThreadWorker() const;
+
+	/**
+	 * Determines the number of workers to use when none is specified. This is the number of
+	 * logical processors on the system, or 1 if that number can't be determined.
+	 *
+	 * @return The default number of workers
+	 */
+	static DWORD GetDefaultWorkerCount();
+};
@@ -0,0 +1,127 @@
+#include "hunt/ArtifactSnapshot.h"
+#include "hunt/RegistryHunt.h"
+#include "hunt/FanOutPlanner.h"
+
+#include <Psapi.h>
+
+#include "util/filesystem/FileSystem.h"
+#include "util/log/Log.h"
+
+using namespace Registry;
+
+const std::vector<std::wstring> ArtifactSnapshot::RunKeys{
+	L"Software\\Microsoft\\Windows\\CurrentVersion\\Run",
+	L"Software\\Microsoft\\Windows\\CurrentVersion\\RunServices",
+	L"Software\\Microsoft\\Windows\\CurrentVersion\\RunOnce",
+	L"Software\\Microsoft\\Windows\\CurrentVersion\\RunOnceServices",
+	L"Software\\Microsoft\\Windows\\CurrentVersion\\RunOnceEx",
+	L"Software\\Microsoft\\Windows\\CurrentVersion\\RunOnceServicesEx",
+	L"Software\\Microsoft\\Windows\\CurrentVersion\\Policies\\Explorer\\Run",
+};
+
+ArtifactSnapshot::ArtifactSnapshot(const std::vector<SIZE_T>& vRegistryRules, const Scope& ruleScope) :
+	vRegistryRules{ vRegistryRules },
+	ruleScope{ ruleScope },
+	dwCollectionsPerformed{ 0 },
+	dwCollectionsSaved{ 0 }{}
+
+const std::vector<RegistryKey>& ArtifactSnapshot::GetServices() const {
+	return Retrieve<std::vector<RegistryKey>>(services, [](){
+		LOG_VERBOSE(1, "Collecting services for the artifact snapshot");
+		return RegistryKey{ HKEY_LOCAL_MACHINE, L"SYSTEM\\CurrentControlSet\\Services" }.EnumerateSubkeys();
+	});
+}
+
+const std::vector<RegistryValue>& ArtifactSnapshot::GetAutoruns() const {
+	return Retrieve<std::vector<RegistryValue>>(autoruns, [](){
+		LOG_VERBOSE(1, "Collecting autoruns for the artifact snapshot");
+
+		std::vector<RegistryValue> values{};
+		for(auto& key : RunKeys){
+			for(auto& value : CheckKeyValues(HKEY_LOCAL_MACHINE, key)){
+				if(value.type == RegistryType::REG_SZ_T || value.type == RegistryType::REG_EXPAND_SZ_T){
+					values.emplace_back(value);
+				}
+			}
+			for(auto& sub : CheckSubkeys(HKEY_LOCAL_MACHINE, key)){
+				for(auto& value : sub.GetValues()){
+					if(value.type == RegistryType::REG_SZ_T || value.type == RegistryType::REG_EXPAND_SZ_T){
+						values.emplace_back(std::move(value));
+					}
+				}
+			}
+		}
+		return values;
+	});
+}
+
+const std::vector<std::wstring>& ArtifactSnapshot::GetUserProfiles() const {
+	return Retrieve<std::vector<std::wstring>>(profiles, [](){
+		LOG_VERBOSE(1, "Collecting user profiles for the artifact snapshot");
+
+		std::vector<std::wstring> paths{};
+		for(auto& folder : FileSystem::Folder(L"C:\\Users").GetSubdirectories(1)){
+			paths.emplace_back(folder.GetFolderPath());
+		}
+		return paths;
+	});
+}
+
+const std::vector<RegistryKey>& ArtifactSnapshot::GetUserHives() const {
+	return Retrieve<std::vector<RegistryKey>>(hives, [](){
+		LOG_VERBOSE(1, "Collecting loaded user hives for the artifact snapshot");
+		return FanOutPlanner::GetInstance().GetUserHives();
+	});
+}
+
+const std::vector<DWORD>& ArtifactSnapshot::GetProcesses() const {
+	return Retrieve<std::vector<DWORD>>(processes, [](){
+		LOG_VERBOSE(1, "Collecting processes for the artifact snapshot");
+
+		std::vector<DWORD> pids(1024);
+		DWORD dwBytesReturned{ 0 };
+		while(EnumProcesses(pids.data(), static_cast<DWORD>(pids.size() * sizeof(DWORD)), &dwBytesReturned)){
+			// If the buffer was filled, there may have been more processes than could be returned
+			if(dwBytesReturned < pids.size() * sizeof(DWORD)){
+				pids.resize(dwBytesReturned / sizeof(DWORD));
+				return pids;
+			}
+			pids.resize(pids.size() * 2);
+		}
+
+		LOG_ERROR("Unable to enumerate processes - Process related hunts will not run.");
+		return std::vector<DWORD>{};
+	});
+}
+
+const std::vector<RegistryValue>& ArtifactSnapshot::GetRuleFindings(SIZE_T rule) const {
+	auto& findings{ Retrieve<RegistryPlan::Findings>(ruleFindings, [this](){
+		LOG_VERBOSE(1, "Executing the registry plan for the artifact snapshot");
+		return RegistryPlan::GetInstance().Execute(GetUserHives(), vRegistryRules, ruleScope.IsUnrestricted() ? nullptr : &ruleScope);
+	}) };
+	return findings[rule];
+}
+
+DWORD ArtifactSnapshot::GetCollectionsPerformed() const {
+	return dwCollectionsPerformed;
+}
+
+DWORD ArtifactSnapshot::GetCollectionsSaved() const {
+	return dwCollectionsSaved;
+}
+
+void ArtifactSnapshot::AddUsage(const Accounting::ResourceUsage& collection) const {
+	auto lock{ BeginCriticalSection(hUsageSection) };
+	usage.WallTimeMs += collection.WallTimeMs;
+	usage.CpuTimeMs += collection.CpuTimeMs;
+	usage.BytesRead += collection.BytesRead;
+	usage.FilesOpened += collection.FilesOpened;
+	usage.RegistryKeysOpened += collection.RegistryKeysOpened;
+	usage.EventRecordsRendered += collection.EventRecordsRendered;
+	usage.YaraScans += collection.YaraScans;
+}
+
+Accounting::ResourceUsage ArtifactSnapshot::GetUsage() const {
+	auto lock{ BeginCriticalSection(hUsageSection) };
+	return usage;
+}
@@ -0,0 +1,258 @@
+#include "hunt/Baseline.h"
+
+#include <UserEnv.h>
+#include <Wincrypt.h>
+
+#include <algorithm>
+
+#include "util/configurations/RegistryValue.h"
+#include "util/filesystem/FileSystem.h"
+#include "util/log/Log.h"
+#include "common/StringUtils.h"
+#include "common/Utils.h"
+
+#pragma comment(lib, "Userenv.lib")
+
+namespace {
+	/// The header at the start of a baseline file, followed by dwArtifactCount sorted digests
+	struct BaselineHeader {
+		DWORD dwMagic;
+		DWORD dwVersion;
+		DWORD dwArtifactCount;
+		DWORD dwReserved;
+	};
+
+	const DWORD BASELINE_MAGIC{ 0x4C534242 }; // "BBSL"
+	const DWORD BASELINE_VERSION{ 2 };
+
+	/// Retrieves the provider computing digests of artifacts, which is acquired once and never released
+	HCRYPTPROV GetDigestProvider(){
+		static const HCRYPTPROV hProv{ [](){
+			HCRYPTPROV hNewProv{ 0 };
+			if(!CryptAcquireContextW(&hNewProv, nullptr, nullptr, PROV_RSA_AES, CRYPT_VERIFYCONTEXT)){
+				LOG_ERROR(L"Unable to acquire a cryptographic provider for the baseline (Error " << GetLastError() << L")");
+				return HCRYPTPROV{ 0 };
+			}
+			return hNewProv;
+		}() };
+		return hProv;
+	}
+
+	/// Retrieves the lowercased profiles directory, with a trailing backslash
+	std::wstring GetProfilesDirectory(){
+		WCHAR path[MAX_PATH]{};
+		DWORD dwSize{ MAX_PATH };
+		if(!GetProfilesDirectoryW(path, &dwSize)){
+			return L"c:\\users\\";
+		}
+		return ToLowerCaseW(path) + L"\\";
+	}
+}
+
+Baseline Baseline::instance{};
+
+Baseline::Baseline() :
+	mode{ Mode::Disabled },
+	dwArtifactsMatched{ 0 },
+	dwArtifactsChecked{ 0 }{}
+
+Baseline& Baseline::GetInstance(){
+	return instance;
+}
+
+bool Baseline::Load(const std::wstring& path){
+	auto lock{ BeginCriticalSection(hSection) };
+
+	wsPath = path;
+	vArtifacts.clear();
+
+	auto hFile{ FileSystem::OpenProtectedFile(path, GENERIC_READ, FILE_SHARE_READ, OPEN_EXISTING) };
+	if(!hFile){
+		LOG_ERROR(L"Unable to open baseline at " << path << L" (Error " << GetLastError() << L"); nothing will be skipped");
+		return false;
+	}
+
+	BaselineHeader header{};
+	DWORD dwBytesRead{ 0 };
+	if(!ReadFile(hFile, &header, sizeof(header), &dwBytesRead, nullptr) || dwBytesRead != sizeof(header) ||
+	   header.dwMagic != BASELINE_MAGIC || header.dwVersion != BASELINE_VERSION){
+		LOG_ERROR(L"Baseline at " << path << L" is invalid; nothing will be skipped");
+		return false;
+	}
+
+	// The artifact count is checked against the size of the file before anything is allocated for the artifacts
+	LARGE_INTEGER size{};
+	auto qwExpected{ static_cast<DWORD64>(header.dwArtifactCount) * sizeof(Digest) };
+	if(!GetFileSizeEx(hFile, &size) || static_cast<DWORD64>(size.QuadPart) < sizeof(header) ||
+	   qwExpected > static_cast<DWORD64>(size.QuadPart) - sizeof(header) || qwExpected > MAXDWORD){
+		LOG_ERROR(L"Baseline at " << path << L" is truncated; nothing will be skipped");
+		return false;
+	}
+
+	std::vector<Digest> artifacts(header.dwArtifactCount);
+	auto dwExpected{ static_cast<DWORD>(qwExpected) };
+	if(!ReadFile(hFile, artifacts.data(), dwExpected, &dwBytesRead, nullptr) || dwBytesRead != dwExpected){
+		LOG_ERROR(L"Baseline at " << path << L" is truncated; nothing will be skipped");
+		return false;
+	}
+
+	// The file is written sorted, but sorting again guards against a hand-edited or corrupted file
+	if(!std::is_sorted(artifacts.begin(), artifacts.end())){
+		std::sort(artifacts.begin(), artifacts.end());
+	}
+
+	vArtifacts = std::move(artifacts);
+	mode = Mode::Filter;
+
+	LOG_INFO(L"Loaded " << vArtifacts.size() << L" artifacts from baseline at " << path);
+	return true;
+}
+
+void Baseline::BeginCapture(const std::wstring& path){
+	auto lock{ BeginCriticalSection(hSection) };
+
+	wsPath = path;
+	sCaptured.clear();
+	mode = Mode::Capture;
+
+	LOG_INFO(L"Capturing a baseline to " << path);
+}
+
+bool Baseline::Save(){
+	auto lock{ BeginCriticalSection(hSection) };
+
+	if(mode != Mode::Capture){
+		return false;
+	}
+
+	// The set is ordered, so the digests are already sorted
+	std::vector<Digest> artifacts{ sCaptured.begin(), sCaptured.end() };
+
+	auto wsTempPath{ wsPath + L".tmp" };
+	{
+		// The temporary file keeps its protected security descriptor when it's moved over the baseline
+		auto hFile{ FileSystem::OpenProtectedFile(wsTempPath, GENERIC_WRITE, 0, CREATE_ALWAYS) };
+		if(!hFile){
+			LOG_ERROR(L"Unable to create baseline at " << wsTempPath << L" (Error " << GetLastError() << L")");
+			return false;
+		}
+
+		BaselineHeader header{ BASELINE_MAGIC, BASELINE_VERSION, static_cast<DWORD>(artifacts.size()), 0 };
+		auto dwArtifactBytes{ static_cast<DWORD>(artifacts.size() * sizeof(Digest)) };
+		DWORD dwBytesWritten{ 0 };
+		if(!WriteFile(hFile, &header, sizeof(header), &dwBytesWritten, nullptr) ||
+		   !WriteFile(hFile, artifacts.data(), dwArtifactBytes, &dwBytesWritten, nullptr) || !FlushFileBuffers(hFile)){
+			LOG_ERROR(L"Unable to write baseline to " << wsTempPath << L" (Error " << GetLastError() << L")");
+			return false;
+		}
+	}
+
+	if(!MoveFileExW(wsTempPath.c_str(), wsPath.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)){
+		LOG_ERROR(L"Unable to replace baseline at " << wsPath << L" (Error " << GetLastError() << L")");
+		return false;
+	}
+
+	LOG_INFO(L"Saved " << artifacts.size() << L" artifacts to baseline at " << wsPath);
+	return true;
+}
+
+void Baseline::Disable(){
+	auto lock{ BeginCriticalSection(hSection) };
+
+	mode = Mode::Disabled;
+	vArtifacts.clear();
+	sCaptured.clear();
+}
+
+bool Baseline::IsEnabled() const {
+	return mode != Mode::Disabled;
+}
+
+bool Baseline::Check(const std::wstring& identity){
+	dwArtifactsChecked++;
+
+	// An artifact which can't be digested is never skipped
+	Digest digest{};
+	HCRYPTHASH hNewHash{ 0 };
+	if(!GetDigestProvider() || !CryptCreateHash(GetDigestProvider(), CALG_SHA_256, 0, 0, &hNewHash)){
+		return false;
+	}
+	auto hHash{ GenericWrapper<HCRYPTHASH>(hNewHash, CryptDestroyHash, 0) };
+	DWORD cbDigest{ static_cast<DWORD>(digest.size()) };
+	if(!CryptHashData(hHash, reinterpret_cast<const BYTE*>(identity.c_str()), static_cast<DWORD>(identity.length() * sizeof(WCHAR)), 0) ||
+	   !CryptGetHashParam(hHash, HP_HASHVAL, digest.data(), &cbDigest, 0) || cbDigest != digest.size()){
+		LOG_ERROR(L"Unable to digest an artifact for the baseline (Error " << GetLastError() << L")");
+		return false;
+	}
+
+	if(mode == Mode::Capture){
+		auto lock{ BeginCriticalSection(hSection) };
+		sCaptured.emplace(digest);
+		return false;
+	}
+
+	// vArtifacts is only modified by Load, before any hunts are run
+	if(std::binary_search(vArtifacts.begin(), vArtifacts.end(), digest)){
+		dwArtifactsMatched++;
+		return true;
+	}
+	return false;
+}
+
+bool Baseline::Contains(const Registry::RegistryValue& value){
+	if(mode == Mode::Disabled){
+		return false;
+	}
+
+	return Check(NormalizePath(value.key.GetName()) + L"\\" + ToLowerCaseW(value.wValueName) + L"=" + NormalizePath(value.ToString()));
+}
+
+bool Baseline::Contains(const FileSystem::File& file){
+	if(mode == Mode::Disabled || !file.GetFileExists()){
+		return false;
+	}
+
+	auto hash{ file.GetSHA256Hash() };
+	if(!hash){
+		return false;
+	}
+
+	return Check(NormalizePath(file.GetFilePath()) + L"|" + ToLowerCaseW(*hash));
+}
+
+DWORD Baseline::GetArtifactsMatched() const {
+	return dwArtifactsMatched;
+}
+
+DWORD Baseline::GetArtifactsChecked() const {
+	return dwArtifactsChecked;
+}
+
+std::wstring Baseline::NormalizePath(const std::wstring& path){
+	static const std::wstring wsProfiles{ GetProfilesDirectory() };
+	static const std::wstring wsSidPrefix{ L"s-1-5-21-" };
+
+	auto normalized{ ToLowerCaseW(path) };
+
+	// Replace the name of each profile under the profiles directory
+	SIZE_T dwPosition{ 0 };
+	while((dwPosition = normalized.find(wsProfiles, dwPosition)) != std::wstring::npos){
+		auto dwStart{ dwPosition + wsProfiles.length() };
+		auto dwEnd{ normalized.find_first_of(L"\\/", dwStart) };
+		normalized.replace(dwStart, (dwEnd == std::wstring::npos ? normalized.length() : dwEnd) - dwStart, L"<profile>");
+		dwPosition = dwStart;
+	}
+
+	// Replace each user SID, leaving any suffix such as _classes in place
+	dwPosition = 0;
+	while((dwPosition = normalized.find(wsSidPrefix, dwPosition)) != std::wstring::npos){
+		auto dwEnd{ dwPosition + wsSidPrefix.length() };
+		while(dwEnd < normalized.length() && (iswdigit(normalized[dwEnd]) || normalized[dwEnd] == L'-')){
+			dwEnd++;
+		}
+		normalized.replace(dwPosition, dwEnd - dwPosition, L"<sid>");
+		dwPosition++;
+	}
+
+	return normalized;
+}
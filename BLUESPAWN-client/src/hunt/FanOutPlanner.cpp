@@ -0,0 +1,151 @@
+#include "hunt/FanOutPlanner.h"
+
+#include <unordered_set>
+
+#include "util/configurations/OfflineHive.h"
+#include "util/log/Log.h"
+#include "common/StringUtils.h"
+
+namespace Registry {
+
+	FanOutPlanner FanOutPlanner::instance{};
+
+	FanOutPlanner::FanOutPlanner() :
+		lRuns{ 0 },
+		bMonitoring{ false },
+		vUserHives{ std::nullopt },
+		dwHiveGeneration{ 0 },
+		dwPathsResolved{ 0 },
+		dwPathsReused{ 0 },
+		dwDuplicatesSkipped{ 0 }{}
+
+	FanOutPlanner& FanOutPlanner::GetInstance(){
+		return instance;
+	}
+
+	std::vector<RegistryKey> FanOutPlanner::EnumerateUserHives(){
+		auto hives{ RegistryKey{ HKEY_USERS }.EnumerateSubkeys() };
+		for(auto& hive : GetUnloadedUserHives()){
+			hives.emplace_back(hive);
+		}
+		return hives;
+	}
+
+	std::vector<RegistryKey> FanOutPlanner::GetUserHives(){
+		DWORD dwGeneration{};
+		{
+			auto lock{ BeginCriticalSection(hSection) };
+			if(vUserHives){
+				return *vUserHives;
+			}
+			dwGeneration = dwHiveGeneration;
+		}
+
+		auto hives{ EnumerateUserHives() };
+
+		// Hives enumerated while a user logged on or off may already be out of date, so they aren't kept
+		auto lock{ BeginCriticalSection(hSection) };
+		if((lRuns > 0 || bMonitoring) && !vUserHives && dwGeneration == dwHiveGeneration){
+			LOG_VERBOSE(1, L"Found " << hives.size() << L" user hives" << (lRuns > 0 ? L" for this run" : L" while monitoring"));
+			vUserHives = hives;
+		}
+		return hives;
+	}
+
+	std::vector<RegistryKey> FanOutPlanner::Resolve(HKEY hkHive, const std::wstring& path, bool CheckWow64, bool CheckUsers){
+		auto identity{ std::to_wstring(reinterpret_cast<ULONG_PTR>(hkHive)) + L"|" + std::to_wstring(CheckWow64) +
+			std::to_wstring(CheckUsers) + L"|" + ToLowerCaseW(path) };
+		{
+			auto lock{ BeginCriticalSection(hSection) };
+			auto resolved{ mResolved.find(identity) };
+			if(resolved != mResolved.end()){
+				dwPathsReused++;
+				return resolved->second;
+			}
+		}
+
+		// The key under the hive is always checked, so that values required to be present are reported as missing
+		std::vector<RegistryKey> vKeys{ RegistryKey{ hkHive, path } };
+		std::unordered_set<std::wstring> names{};
+		if(vKeys[0].Exists()){
+			names.emplace(ToLowerCaseW(vKeys[0].GetName()));
+		}
+
+		auto AddKey{ [&](RegistryKey&& key){
+			if(!key.Exists()){
+				return;
+			}
+
+			if(names.emplace(ToLowerCaseW(key.GetName())).second){
+				vKeys.emplace_back(std::move(key));
+			} else {
+				dwDuplicatesSkipped++;
+			}
+		} };
+
+		if(CheckWow64){
+			AddKey(RegistryKey{ hkHive, path, true });
+		}
+		if(CheckUsers){
+			for(auto& hive : GetUserHives()){
+				AddKey(RegistryKey{ hive, path, false });
+				if(CheckWow64){
+					AddKey(RegistryKey{ hive, path, true });
+				}
+			}
+		}
+
+		dwPathsResolved++;
+
+		auto lock{ BeginCriticalSection(hSection) };
+		if(lRuns > 0){
+			mResolved.emplace(identity, vKeys);
+		}
+		return vKeys;
+	}
+
+	void FanOutPlanner::BeginRun(){
+		auto lock{ BeginCriticalSection(hSection) };
+		lRuns++;
+	}
+
+	void FanOutPlanner::EndRun(){
+		auto lock{ BeginCriticalSection(hSection) };
+		if(--lRuns <= 0){
+			lRuns = 0;
+			if(!bMonitoring){
+				vUserHives = std::nullopt;
+			}
+			mResolved.clear();
+		}
+	}
+
+	void FanOutPlanner::BeginMonitoring(){
+		auto lock{ BeginCriticalSection(hSection) };
+		bMonitoring = true;
+	}
+
+	void FanOutPlanner::InvalidateUserHives(){
+		auto lock{ BeginCriticalSection(hSection) };
+		LOG_VERBOSE(1, L"The loaded user hives changed; they will be enumerated again");
+		dwHiveGeneration++;
+		vUserHives = std::nullopt;
+		mResolved.clear();
+	}
+
+	std::pair<DWORD, DWORD> FanOutPlanner::GetPathCounts() const {
+		return { dwPathsResolved, dwPathsReused };
+	}
+
+	DWORD FanOutPlanner::GetDuplicatesSkipped() const {
+		return dwDuplicatesSkipped;
+	}
+
+	BeginFanOutPlanning::BeginFanOutPlanning(){
+		FanOutPlanner::GetInstance().BeginRun();
+	}
+
+	BeginFanOutPlanning::~BeginFanOutPlanning(){
+		FanOutPlanner::GetInstance().EndRun();
+	}
+}
@@ -1,6 +1,25 @@
 #include "hunt/Hunt.h"
 #include "hunt/HuntRegister.h"
 #include "reaction/Reaction.h"
+#include "common/StringUtils.h"
+#include "common/Utils.h"
+#include "util/log/Log.h"
+#include "util/threadpool/IOExecutor.h"
+
+namespace {
+	std::wstring GetLevelName(Aggressiveness level){
+		return level == Aggressiveness::Cursory ? L"Cursory" : level == Aggressiveness::Normal ? L"Normal" : L"Intensive";
+	}
+
+	/// Fingerprints a file by its identity, which changes whenever the file is replaced or written
+	std::optional<DWORD64> GetFileFingerprint(const FileSystem::File& file){
+		auto identity{ file.GetFileIdentity() };
+		if(!identity){
+			return std::nullopt;
+		}
+		return FileSystem::HashFileIdentity(*identity);
+	}
+}
 
 HuntInfo::HuntInfo(const std::wstring& HuntName, Aggressiveness HuntAggressiveness, DWORD HuntTactics, DWORD HuntCategories, DWORD HuntDatasources) :
 	HuntName{ HuntName },
@@ -12,13 +31,114 @@ HuntInfo::HuntInfo(const std::wstring& HuntName, Aggressiveness HuntAggressivene
 }
 
 Hunt::Hunt(const std::wstring& name) : 
-	name{ name }{
+	name{ name },
+	bIncomplete{ false }{
 	dwTacticsUsed = 0;
 	dwSourcesInvolved = 0;
 	dwCategoriesAffected = 0;
 	dwSupportedScans = 0;
 }
 
+std::shared_ptr<const ArtifactSnapshot> Hunt::GetArtifacts(const Scope& scope) const {
+	if(artifacts){
+		return artifacts;
+	}
+	return std::make_shared<ArtifactSnapshot>(vRegistryRules, scope);
+}
+
+SIZE_T Hunt::AddRegistryRule(Registry::RegistryRule&& rule){
+	auto id{ Registry::RegistryPlan::GetInstance().AddRule(std::move(rule)) };
+	vRegistryRules.emplace_back(id);
+	return id;
+}
+
+bool Hunt::FileNeedsEvaluation(const FileSystem::File& file, const std::wstring& context) const {
+	if(Baseline::GetInstance().Contains(file)){
+		return false;
+	}
+
+	if(!HuntState::GetInstance().IsEnabled()){
+		return true;
+	}
+
+	auto fingerprint{ GetFileFingerprint(file) };
+	return !fingerprint || !HuntState::GetInstance().IsUnchanged(name + L"|" + context + L"|" + ToLowerCaseW(file.GetFilePath()), *fingerprint);
+}
+
+void Hunt::RecordFileVerdict(const FileSystem::File& file, HuntState::Verdict verdict, const std::wstring& context) const {
+	if(!HuntState::GetInstance().IsEnabled()){
+		return;
+	}
+
+	auto fingerprint{ GetFileFingerprint(file) };
+	if(fingerprint){
+		HuntState::GetInstance().RecordVerdict(name + L"|" + context + L"|" + ToLowerCaseW(file.GetFilePath()), *fingerprint, verdict);
+	}
+}
+
+bool Hunt::IsFileSigned(const FileSystem::File& file) const {
+	auto bSigned{ file.GetFileSigned() };
+	RecordFileVerdict(file, bSigned ? HuntState::Verdict::Clean : HuntState::Verdict::Suspicious);
+	return bSigned;
+}
+
+AsyncResult<std::optional<FileSystem::File>> Hunt::FindUnsignedFileAsync(const std::wstring& name) const {
+	return IOExecutor::GetInstance().Async<std::optional<FileSystem::File>>([name]() -> std::optional<FileSystem::File> {
+		auto filepath{ FileSystem::SearchPathExecutable(name) };
+		if(filepath){
+			FileSystem::File file{ *filepath };
+			if(file.GetFileExists() && !file.GetFileSigned()){
+				return file;
+			}
+		}
+		return std::nullopt;
+	});
+}
+
+bool Hunt::IsPastDeadline() const {
+	return deadline && std::chrono::steady_clock::now() >= *deadline;
+}
+
+void Hunt::MarkIncomplete(){
+	bIncomplete = true;
+}
+
+int Hunt::ScanLayer(Aggressiveness level, const Scope& scope, Reaction& reaction, LayerResults& results){
+	return -1;
+}
+
+int Hunt::RunLayers(const HuntInfo& info, const Scope& scope, Reaction& reaction){
+	LOG_INFO(L"Hunting for " << name << L" at level " << GetLevelName(info.HuntAggressiveness));
+	reaction.BeginHunt(info);
+
+	LayerResults results{};
+	int detections = 0;
+	for(auto level : { Aggressiveness::Cursory, Aggressiveness::Normal, Aggressiveness::Intensive }){
+		if(static_cast<DWORD>(level) > static_cast<DWORD>(info.HuntAggressiveness) || IsPastDeadline()){
+			break;
+		}
+		if(!SupportsScan(level)){
+			continue;
+		}
+
+		auto start{ std::chrono::steady_clock::now() };
+		auto layerDetections{ ScanLayer(level, scope, reaction, results) };
+		auto elapsed{ std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start) };
+		if(layerDetections > 0){
+			detections += layerDetections;
+		}
+
+		LOG_VERBOSE(1, L"Layer " << GetLevelName(level) << L" of " << name << L" took " << elapsed.count() << L" ms and made " 
+			<< (std::max)(layerDetections, 0) << L" detections");
+	}
+
+	LOG_VERBOSE(1, name << L" reused " << results.GetArtifactsReused() << L" artifacts and " << results.GetVerdictsReused() 
+		<< L" verdicts across its layers");
+
+	reaction.EndHunt();
+	return detections;
+}
+
 std::wstring Hunt::GetName() {
 	return name;
 }
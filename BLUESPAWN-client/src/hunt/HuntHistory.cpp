@@ -0,0 +1,106 @@
+#include "hunt/HuntHistory.h"
+
+#include <fstream>
+#include <sstream>
+
+#include "util/log/Log.h"
+#include "common/StringUtils.h"
+
+const double HuntHistory::dDefaultCostMs{ 1000.0 };
+
+const double HuntHistory::dSmoothing{ 0.3 };
+
+std::wstring HuntHistory::GetKey(const std::wstring& hunt, Aggressiveness level){
+	return std::to_wstring(static_cast<DWORD>(level)) + L"|" + hunt;
+}
+
+bool HuntHistory::Load(const std::wstring& path){
+	auto lock{ BeginCriticalSection(hSection) };
+
+	wsPath = path;
+	mEntries.clear();
+
+	std::ifstream file{ path };
+	if(!file){
+		LOG_VERBOSE(1, L"No hunt history found at " << path);
+		return false;
+	}
+
+	// Each line holds a key, the average cost, the average number of detections, and the number of runs
+	std::string line{};
+	while(std::getline(file, line)){
+		std::istringstream fields{ line };
+		std::string key{};
+		Entry entry{};
+		if(std::getline(fields, key, '\t') && fields >> entry.dAverageCostMs >> entry.dAverageDetections >> entry.dwRuns){
+			mEntries.emplace(StringToWidestring(key), entry);
+		} else{
+			LOG_WARNING(L"Ignoring malformed line in hunt history at " << path);
+		}
+	}
+
+	LOG_VERBOSE(1, L"Loaded history for " << mEntries.size() << L" hunts from " << path);
+	return true;
+}
+
+bool HuntHistory::Save() const {
+	auto lock{ BeginCriticalSection(hSection) };
+
+	auto wsTempPath{ wsPath + L".tmp" };
+	{
+		std::ofstream file{ wsTempPath, std::ios::trunc };
+		for(auto& entry : mEntries){
+			file << WidestringToString(entry.first) << '\t' << entry.second.dAverageCostMs << '\t'
+				<< entry.second.dAverageDetections << '\t' << entry.second.dwRuns << '\n';
+		}
+		if(!file.flush()){
+			LOG_ERROR(L"Unable to write hunt history to " << wsTempPath);
+			return false;
+		}
+	}
+
+	if(!MoveFileExW(wsTempPath.c_str(), wsPath.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)){
+		LOG_ERROR(L"Unable to replace hunt history at " << wsPath << L" (Error " << GetLastError() << L")");
+		return false;
+	}
+
+	return true;
+}
+
+double HuntHistory::GetExpectedCost(const std::wstring& hunt, Aggressiveness level) const {
+	auto lock{ BeginCriticalSection(hSection) };
+
+	auto entry{ mEntries.find(GetKey(hunt, level)) };
+	return entry != mEntries.end() ? entry->second.dAverageCostMs : dDefaultCostMs;
+}
+
+double HuntHistory::GetExpectedValue(const std::wstring& hunt, Aggressiveness level) const {
+	auto lock{ BeginCriticalSection(hSection) };
+
+	auto entry{ mEntries.find(GetKey(hunt, level)) };
+	return 1.0 + (entry != mEntries.end() ? entry->second.dAverageDetections : 0.0);
+}
+
+void HuntHistory::Record(const std::wstring& hunt, Aggressiveness level, DWORD64 dwCostMs, DWORD dwDetections){
+	auto lock{ BeginCriticalSection(hSection) };
+
+	auto key{ GetKey(hunt, level) };
+	auto entry{ mEntries.find(key) };
+	if(entry == mEntries.end()){
+		mEntries.emplace(key, Entry{ static_cast<double>(dwCostMs), static_cast<double>(dwDetections), 1 });
+	} else{
+		auto& existing{ entry->second };
+		existing.dAverageCostMs += dSmoothing * (static_cast<double>(dwCostMs) - existing.dAverageCostMs);
+		existing.dAverageDetections += dSmoothing * (static_cast<double>(dwDetections) - existing.dAverageDetections);
+		existing.dwRuns++;
+	}
+}
+
+std::wstring HuntHistory::GetDefaultPath(){
+	WCHAR path[MAX_PATH]{};
+	GetModuleFileNameW(nullptr, path, MAX_PATH);
+
+	std::wstring directory{ path };
+	directory = directory.substr(0, directory.find_last_of(L'\\') + 1);
+	return directory + L"bluespawn-history.dat";
+}
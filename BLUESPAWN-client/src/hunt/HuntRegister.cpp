@@ -1,9 +1,21 @@
 #include "hunt/HuntRegister.h"
 #include <iostream>
 #include <functional>
+#include <chrono>
+#include <numeric>
+#include <algorithm>
+#include <atomic>
+#include "hunt/HuntHistory.h"
 #include "monitor/EventManager.h"
 #include "util/log/Log.h"
+#include "util/log/HuntLogMessage.h"
+#include "util/accounting/ResourceUsage.h"
+#include "util/threadpool/ThreadPool.h"
+#include "util/threadpool/IOExecutor.h"
+#include "util/configurations/RegistryHandleCache.h"
+#include "hunt/FanOutPlanner.h"
 #include "common/StringUtils.h"
+#include "common/Utils.h"
 #include "user/bluespawn.h"
 
 HuntRegister::HuntRegister(const IOBase& io) : io(io) {}
@@ -49,36 +61,208 @@ bool HuntRegister::HuntShouldRun(Hunt& hunt, vector<string> vExcludedHunts, vect
 	return true;
 }
 
-bool CallFunctionSafe(const std::function<void()>& func){
-	__try{
-		func();
-		return true;
-	} __except(EXCEPTION_EXECUTE_HANDLER){
-		return false;
-	}
-}
-
-void HuntRegister::RunHunts(DWORD dwTactics, DWORD dwDataSource, DWORD dwAffectedThings, const Scope& scope, Aggressiveness aggressiveness, const Reaction& reaction, vector<string> vExcludedHunts, vector<string>vIncludedHunts){
+void HuntRegister::RunHunts(DWORD dwTactics, DWORD dwDataSource, DWORD dwAffectedThings, const Scope& scope, Aggressiveness aggressiveness, const Reaction& reaction, vector<string> vExcludedHunts, vector<string>vIncludedHunts, DWORD dwWorkers, DWORD dwTimeBudget){
 	io.InformUser(L"Starting a hunt for " + std::to_wstring(vRegisteredHunts.size()) + L" techniques.");
 	DWORD huntsRan = 0;
 
-  for (auto name : vRegisteredHunts) {
-	  if (HuntShouldRun(*name, vExcludedHunts, vIncludedHunts)) {
-		  int huntRunStatus = 0;
-		  auto level = getLevelForHunt(*name, aggressiveness);
-		  bool status{ false };
-		  status |= level == Aggressiveness::Cursory && CallFunctionSafe([&](){ huntRunStatus = name->ScanCursory(scope, reaction); });
-		  status |= level == Aggressiveness::Normal && CallFunctionSafe([&](){ huntRunStatus = name->ScanNormal(scope, reaction); });
-		  status |= level == Aggressiveness::Intensive && CallFunctionSafe([&](){ huntRunStatus = name->ScanIntensive(scope, reaction); });
-		  if(!status){
-			  Bluespawn::io.InformUser(L"An issue occured in hunt " + name->GetName() + L", preventing it from being run", ImportanceLevel::HIGH);
-		  } else if(huntRunStatus != -1){
-			  huntsRan++;
-		  }
-	  }
-	}
-	if (huntsRan != vRegisteredHunts.size()) {
-		io.InformUser(L"Successfully ran " + std::to_wstring(huntsRan) + L" hunts. There were no scans available for " + std::to_wstring(vRegisteredHunts.size() - huntsRan) + L" of the techniques.");
+	vector<std::shared_ptr<Hunt>> vHuntsToRun{};
+	for(auto name : vRegisteredHunts){
+		if(HuntShouldRun(*name, vExcludedHunts, vIncludedHunts)){
+			vHuntsToRun.emplace_back(name);
+		}
+	}
+
+	// Each hunt records its status and log output in its own slot so that the results can be
+	// reported in registration order, regardless of the order in which the hunts finish.
+	struct HuntSlot {
+		Log::LogCapture capture{};
+		HandleWrapper hCompleted{ CreateEventW(nullptr, true, false, nullptr) };
+		bool status{ false };
+		int huntRunStatus{ 0 };
+		bool bSkipped{ false };
+		bool bCutShort{ false };
+		bool bIncomplete{ false };
+	};
+	vector<std::unique_ptr<HuntSlot>> vSlots{};
+	for(SIZE_T idx = 0; idx < vHuntsToRun.size(); idx++){
+		vSlots.emplace_back(std::make_unique<HuntSlot>());
+	}
+
+	// Hunts are started in order of expected value per unit of cost, estimated from the history of
+	// previous runs, so that the most worthwhile hunts get done first if the time budget runs out.
+	HuntHistory history{};
+	history.Load(HuntHistory::GetDefaultPath());
+
+	vector<double> vExpectedCosts{};
+	vector<double> vPriorities{};
+	for(auto& hunt : vHuntsToRun){
+		auto level = getLevelForHunt(*hunt, aggressiveness);
+		// Hunts without a scan at this level return immediately
+		auto cost{ hunt->SupportsScan(level) ? history.GetExpectedCost(hunt->name, level) : 0.0 };
+		vExpectedCosts.emplace_back(cost);
+		vPriorities.emplace_back(history.GetExpectedValue(hunt->name, level) / (std::max)(cost, 1.0));
+	}
+
+	vector<SIZE_T> vSchedule(vHuntsToRun.size());
+	std::iota(vSchedule.begin(), vSchedule.end(), 0);
+	std::stable_sort(vSchedule.begin(), vSchedule.end(), [&](SIZE_T a, SIZE_T b){ return vPriorities[a] > vPriorities[b]; });
+
+	auto start{ std::chrono::steady_clock::now() };
+	std::optional<std::chrono::steady_clock::time_point> deadline{ std::nullopt };
+	if(dwTimeBudget){
+		deadline = start + std::chrono::seconds(dwTimeBudget);
+	}
+
+	// Registry keys opened by one hunt are reused by the others for the rest of the run
+	Registry::BeginHandleCaching caching{};
+
+	// User hives are enumerated once for the run, and each registry path checked is resolved once
+	Registry::BeginFanOutPlanning planning{};
+
+	// Every hunt in this run shares a single snapshot of the commonly used artifacts, which evaluates the
+	// registry rules of the hunts in this run and no others
+	vector<SIZE_T> vRegistryRules{};
+	for(auto& hunt : vHuntsToRun){
+		vRegistryRules.insert(vRegistryRules.end(), hunt->vRegistryRules.begin(), hunt->vRegistryRules.end());
+	}
+	auto snapshot{ std::make_shared<ArtifactSnapshot>(vRegistryRules, scope) };
+	for(auto& hunt : vHuntsToRun){
+		hunt->artifacts = snapshot;
+		hunt->deadline = deadline;
+		hunt->bIncomplete = false;
+	}
+
+	std::atomic<SIZE_T> dwNextScheduled{ 0 };
+
+	ThreadPool pool{ dwWorkers };
+	for(SIZE_T count = 0; count < vSchedule.size(); count++){
+		// Rather than being bound to a hunt, each task claims the next hunt in the schedule, so hunts are
+		// started in priority order regardless of the order in which the pool runs its tasks.
+		pool.Submit([&](){
+			auto idx{ vSchedule[dwNextScheduled++] };
+			auto& slot{ *vSlots[idx] };
+			auto& hunt{ *vHuntsToRun[idx] };
+
+			// A hunt that isn't expected to finish before the deadline isn't started, leaving the
+			// remaining time for cheaper hunts
+			auto expected{ std::chrono::milliseconds(static_cast<LONGLONG>(vExpectedCosts[idx])) };
+			if(deadline && std::chrono::steady_clock::now() + expected > *deadline){
+				slot.bSkipped = true;
+				SetEvent(slot.hCompleted);
+				return;
+			}
+
+			{
+				Log::BeginLogCapture capture{ slot.capture };
+				Accounting::ResourceTracker tracker{};
+
+				auto level = getLevelForHunt(hunt, aggressiveness);
+				slot.status |= level == Aggressiveness::Cursory && CallFunctionSafe([&](){ slot.huntRunStatus = hunt.ScanCursory(scope, reaction); });
+				slot.status |= level == Aggressiveness::Normal && CallFunctionSafe([&](){ slot.huntRunStatus = hunt.ScanNormal(scope, reaction); });
+				slot.status |= level == Aggressiveness::Intensive && CallFunctionSafe([&](){ slot.huntRunStatus = hunt.ScanIntensive(scope, reaction); });
+
+				HuntInfo info{ hunt.name, level, hunt.dwTacticsUsed, hunt.dwCategoriesAffected, hunt.dwSourcesInvolved };
+				info.HuntUsage = tracker.GetUsage();
+				Log::LogHuntResourceUsage(info);
+
+				// Only complete runs are representative of a hunt's cost
+				slot.bCutShort = hunt.IsPastDeadline();
+				slot.bIncomplete = hunt.bIncomplete;
+				if(slot.status && slot.huntRunStatus != -1 && !slot.bCutShort && !slot.bIncomplete){
+					history.Record(hunt.name, level, info.HuntUsage->WallTimeMs, static_cast<DWORD>(slot.huntRunStatus));
+				}
+			}
+			SetEvent(slot.hCompleted);
+		});
+	}
+
+	vector<std::wstring> vSkippedHunts{};
+	vector<std::wstring> vCutShortHunts{};
+	double dCoveredCost{ 0 };
+	double dTotalCost{ 0 };
+	for(SIZE_T idx = 0; idx < vHuntsToRun.size(); idx++){
+		auto& slot{ *vSlots[idx] };
+		WaitForSingleObject(slot.hCompleted, INFINITE);
+		slot.capture.Replay();
+
+		dTotalCost += vExpectedCosts[idx];
+		if(slot.bSkipped){
+			vSkippedHunts.emplace_back(vHuntsToRun[idx]->GetName());
+			continue;
+		}
+		dCoveredCost += vExpectedCosts[idx];
+
+		if(!slot.status){
+			Bluespawn::io.InformUser(L"An issue occured in hunt " + vHuntsToRun[idx]->GetName() + L", preventing it from being run", ImportanceLevel::HIGH);
+		} else if(slot.huntRunStatus != -1){
+			huntsRan++;
+		}
+
+		if(slot.bCutShort){
+			vCutShortHunts.emplace_back(vHuntsToRun[idx]->GetName());
+		}
+		if(slot.bIncomplete){
+			Bluespawn::io.InformUser(L"Hunt " + vHuntsToRun[idx]->GetName() + L" was unable to collect everything it checks; its results may be incomplete",
+				ImportanceLevel::MEDIUM);
+		}
+	}
+	pool.Wait();
+
+	for(auto& hunt : vHuntsToRun){
+		hunt->artifacts = nullptr;
+		hunt->deadline = std::nullopt;
+	}
+	LOG_INFO("The artifact snapshot performed " << snapshot->GetCollectionsPerformed() << " collections and saved " 
+		<< snapshot->GetCollectionsSaved() << " collections");
+	LOG_INFO("Resource usage for the artifact snapshot, which isn't charged to any hunt: " << snapshot->GetUsage().ToString());
+
+	auto& state{ HuntState::GetInstance() };
+	if(state.IsEnabled()){
+		LOG_INFO("Incremental mode skipped " << state.GetArtifactsSkipped() << " unchanged artifacts and evaluated "
+			<< state.GetArtifactsEvaluated() << " artifacts");
+	}
+
+	auto& baseline{ Baseline::GetInstance() };
+	if(baseline.IsEnabled()){
+		LOG_INFO("The baseline matched " << baseline.GetArtifactsMatched() << " of " << baseline.GetArtifactsChecked() << " artifacts checked");
+	}
+
+	auto& executor{ IOExecutor::GetInstance() };
+	LOG_VERBOSE(1, "The IO executor has run " << executor.GetTasksRun() << " lookups with up to " << executor.GetConcurrency() << " running at once");
+
+	auto& handles{ Registry::KeyHandleCache::GetInstance() };
+	LOG_VERBOSE(1, "The registry handle cache has avoided " << handles.GetHandlesReused() << " key opens and " << handles.GetNamesReused()
+		<< " key name queries");
+
+	auto& planner{ Registry::FanOutPlanner::GetInstance() };
+	auto paths{ planner.GetPathCounts() };
+	LOG_VERBOSE(1, "The registry fan-out planner resolved " << paths.first << " paths, reused " << paths.second << " resolutions, and skipped "
+		<< planner.GetDuplicatesSkipped() << " duplicate keys");
+
+	auto patterns{ Patterns::PatternRegistry::GetInstance().GetCompileCounts() };
+	LOG_VERBOSE(1, "Compiled " << patterns.first << " distinct patterns, " << patterns.second << " of which are matched with std::wregex");
+
+	history.Save();
+
+	auto elapsed{ std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start) };
+	LOG_INFO("Ran " << vHuntsToRun.size() - vSkippedHunts.size() << " hunts on " << pool.GetWorkerCount() << " workers in " << elapsed.count() << " ms");
+
+	if(dwTimeBudget){
+		auto dwCoverage{ static_cast<DWORD>(dTotalCost ? 100 * dCoveredCost / dTotalCost : 100) };
+		io.InformUser(L"Time budget of " + std::to_wstring(dwTimeBudget) + L" seconds: started " + std::to_wstring(vHuntsToRun.size() - vSkippedHunts.size()) + 
+			L" hunts (" + std::to_wstring(vCutShortHunts.size()) + L" cut short by the deadline) and skipped " + std::to_wstring(vSkippedHunts.size()) + 
+			L", covering an estimated " + std::to_wstring(dwCoverage) + L"% of the work.");
+		for(auto& name : vCutShortHunts){
+			LOG_INFO(L"Hunt " << name << L" was cut short by the time budget");
+		}
+		for(auto& name : vSkippedHunts){
+			LOG_INFO(L"Hunt " << name << L" was skipped to meet the time budget");
+		}
+	}
+
+	auto dwUnavailable{ vRegisteredHunts.size() - huntsRan - vSkippedHunts.size() };
+	if (dwUnavailable) {
+		io.InformUser(L"Successfully ran " + std::to_wstring(huntsRan) + L" hunts. There were no scans available for " + std::to_wstring(dwUnavailable) + L" of the techniques.");
 	}
 	else {
 		io.InformUser(L"Successfully ran " + std::to_wstring(huntsRan) + L" hunts.");
@@ -89,6 +273,11 @@ void HuntRegister::RunHunt(Hunt& hunt, const Scope& scope, Aggressiveness aggres
 	io.InformUser(L"Starting scan for " + hunt.GetName());
 	int huntRunStatus = 0;
 
+	Registry::BeginHandleCaching caching{};
+	Registry::BeginFanOutPlanning planning{};
+	hunt.artifacts = std::make_shared<ArtifactSnapshot>(hunt.vRegistryRules, scope);
+	hunt.bIncomplete = false;
+
 	auto level = getLevelForHunt(hunt, aggressiveness);
 	switch (level) {
 		case Aggressiveness::Intensive:
@@ -102,9 +291,15 @@ void HuntRegister::RunHunt(Hunt& hunt, const Scope& scope, Aggressiveness aggres
 			break;
 	}
 
+	hunt.artifacts = nullptr;
+
 	if (huntRunStatus == -1) {
 		io.InformUser(L"No scans for this level available for " + hunt.GetName());
 	}
+	else if(hunt.bIncomplete){
+		io.InformUser(L"Scanned for " + hunt.GetName() + L", but it was unable to collect everything it checks; its results may be incomplete",
+			ImportanceLevel::MEDIUM);
+	}
 	else {
 		io.InformUser(L"Successfully scanned for " + hunt.GetName());
 	}
@@ -112,28 +307,56 @@ void HuntRegister::RunHunt(Hunt& hunt, const Scope& scope, Aggressiveness aggres
 
 void HuntRegister::SetupMonitoring(Aggressiveness aggressiveness, const Reaction& reaction) {
 	auto& EvtManager = EventManager::GetInstance();
+
+	// The user hives are enumerated once while monitoring, and again whenever one is loaded or unloaded under
+	// HKEY_USERS as a user logs on or off
+	auto& planner{ Registry::FanOutPlanner::GetInstance() };
+	planner.BeginMonitoring();
+	auto hiveStatus{ EvtManager.SubscribeToEvent(std::make_shared<RegistryEvent>(Registry::RegistryKey{ HKEY_USERS }),
+		[&planner](){ planner.InvalidateUserHives(); }) };
+	if(hiveStatus != ERROR_SUCCESS){
+		LOG_ERROR(L"Watching for users logging on and off failed with error code " << hiveStatus);
+	}
 	for (auto name : vRegisteredHunts) {
 		auto level = getLevelForHunt(*name, aggressiveness);
 		if(name->SupportsScan(level)) {
 			io.InformUser(L"Setting up monitoring for " + name->GetName());
 			for(auto event : name->GetMonitoringEvents()) {
 
-				std::function<void()> callback;
+				std::function<int(const Scope&, Reaction)> scan;
 
 				switch(level) {
 				case Aggressiveness::Intensive:
-					callback = std::bind(&Hunt::ScanIntensive, name.get(), Scope{}, reaction);
+					scan = std::bind(&Hunt::ScanIntensive, name.get(), std::placeholders::_1, std::placeholders::_2);
 					break;
 				case Aggressiveness::Normal:
-					callback = std::bind(&Hunt::ScanNormal, name.get(), Scope{}, reaction);
+					scan = std::bind(&Hunt::ScanNormal, name.get(), std::placeholders::_1, std::placeholders::_2);
 					break;
 				case Aggressiveness::Cursory:
-					callback = std::bind(&Hunt::ScanCursory, name.get(), Scope{}, reaction);
+					scan = std::bind(&Hunt::ScanCursory, name.get(), std::placeholders::_1, std::placeholders::_2);
 					break;
 				}
 
 				if(name->SupportsScan(level)) {
-					DWORD status = EvtManager.SubscribeToEvent(event, callback);
+					DWORD status{ ERROR_SUCCESS };
+
+					// Registry events pass on the values that changed, so that only those are scanned
+					if(event->type == EventType::Registry){
+						auto huntName{ name->GetName() };
+						status = EvtManager.SubscribeToRegistryChanges(std::static_pointer_cast<RegistryEvent>(event),
+							[scan, reaction, huntName](const std::vector<Registry::RegistryValueChange>& changes){
+								Scope scope{};
+								for(auto& change : changes){
+									LOG_VERBOSE(1, L"Scanning " << change.key << L": " << change.wsValueName << L" with " << huntName << L" after it was " <<
+										(change.kind == Registry::RegistryValueChange::Kind::Added ? L"added" :
+										 change.kind == Registry::RegistryValueChange::Kind::Removed ? L"removed" : L"modified"));
+									scope.AddRegistryValue(change.key, change.wsValueName);
+								}
+								scan(scope, reaction);
+							});
+					} else {
+						status = EvtManager.SubscribeToEvent(event, std::bind(scan, Scope{}, reaction));
+					}
 					if(status != ERROR_SUCCESS){
 						LOG_ERROR(L"Monitoring for " << name->GetName() << L" failed with error code " << status);
 					}
@@ -0,0 +1,201 @@
+#include "hunt/HuntState.h"
+
+#include <vector>
+
+#include "util/filesystem/YaraScanner.h"
+#include "util/filesystem/FileSystem.h"
+#include "util/log/Log.h"
+#include "common/Utils.h"
+
+namespace {
+	/// The header at the start of a store file, followed by dwRecordCount records
+	struct StoreHeader {
+		DWORD dwMagic;
+		DWORD dwVersion;
+		DWORD dwRun;
+		DWORD dwRecordCount;
+	};
+
+	const DWORD STORE_MAGIC{ 0x53534842 }; // "BHSS"
+	const DWORD STORE_VERSION{ 1 };
+
+	/// Fingerprints the rules by combining the link timestamp of the BLUESPAWN image with the YARA rules
+	DWORD64 GetCurrentRulesFingerprint(){
+		auto lpImage{ reinterpret_cast<PBYTE>(GetModuleHandleW(nullptr)) };
+		auto lpNtHeaders{ reinterpret_cast<PIMAGE_NT_HEADERS>(lpImage + reinterpret_cast<PIMAGE_DOS_HEADER>(lpImage)->e_lfanew) };
+		auto dwImageFingerprint{ HashData(&lpNtHeaders->FileHeader.TimeDateStamp, sizeof(DWORD)) };
+
+		auto dwYaraFingerprint{ YaraScanner::GetInstance().GetRulesFingerprint() };
+		return HashData(&dwYaraFingerprint, sizeof(dwYaraFingerprint), dwImageFingerprint);
+	}
+
+	DWORD64 HashKey(const std::wstring& key){
+		return HashData(key.c_str(), key.length() * sizeof(WCHAR));
+	}
+}
+
+HuntState HuntState::instance{};
+
+const DWORD HuntState::dwRecordLifetime{ 16 };
+
+HuntState::HuntState() :
+	bEnabled{ false },
+	dwRun{ 0 },
+	dwRulesFingerprint{ 0 },
+	dwArtifactsSkipped{ 0 },
+	dwArtifactsEvaluated{ 0 }{}
+
+HuntState& HuntState::GetInstance(){
+	return instance;
+}
+
+bool HuntState::Load(const std::wstring& path){
+	auto lock{ BeginCriticalSection(hSection) };
+
+	wsPath = path;
+	bEnabled = true;
+	mRecords.clear();
+	dwRun = 1;
+	dwRulesFingerprint = GetCurrentRulesFingerprint();
+
+	auto hFile{ FileSystem::OpenProtectedFile(path, GENERIC_READ, FILE_SHARE_READ, OPEN_EXISTING) };
+	if(!hFile){
+		if(GetLastError() == ERROR_FILE_NOT_FOUND){
+			LOG_INFO(L"No incremental state found at " << path << L"; every artifact will be evaluated");
+		} else{
+			LOG_WARNING(L"Unable to open incremental state at " << path << L" (Error " << GetLastError() << L"); every artifact will be evaluated");
+		}
+		return false;
+	}
+
+	StoreHeader header{};
+	DWORD dwBytesRead{ 0 };
+	if(!ReadFile(hFile, &header, sizeof(header), &dwBytesRead, nullptr) || dwBytesRead != sizeof(header) ||
+	   header.dwMagic != STORE_MAGIC || header.dwVersion != STORE_VERSION){
+		LOG_WARNING(L"Incremental state at " << path << L" is invalid; every artifact will be evaluated");
+		return false;
+	}
+
+	// The record count is checked against the size of the file before anything is allocated for the records
+	LARGE_INTEGER size{};
+	auto qwExpected{ static_cast<DWORD64>(header.dwRecordCount) * sizeof(Record) };
+	if(!GetFileSizeEx(hFile, &size) || static_cast<DWORD64>(size.QuadPart) < sizeof(header) ||
+	   qwExpected > static_cast<DWORD64>(size.QuadPart) - sizeof(header) || qwExpected > MAXDWORD){
+		LOG_WARNING(L"Incremental state at " << path << L" is truncated; every artifact will be evaluated");
+		return false;
+	}
+
+	std::vector<Record> records(header.dwRecordCount);
+	auto dwExpected{ static_cast<DWORD>(qwExpected) };
+	if(!ReadFile(hFile, records.data(), dwExpected, &dwBytesRead, nullptr) || dwBytesRead != dwExpected){
+		LOG_WARNING(L"Incremental state at " << path << L" is truncated; every artifact will be evaluated");
+		return false;
+	}
+
+	dwRun = header.dwRun + 1;
+	for(auto& record : records){
+		mRecords.emplace(record.dwKey, record);
+	}
+
+	LOG_INFO(L"Loaded " << records.size() << L" verdicts from incremental state at " << path);
+	return true;
+}
+
+bool HuntState::Save(){
+	auto lock{ BeginCriticalSection(hSection) };
+
+	if(!bEnabled){
+		return false;
+	}
+
+	std::vector<Record> records{};
+	for(auto& entry : mRecords){
+		if(dwRun - entry.second.dwLastSeenRun < dwRecordLifetime){
+			records.emplace_back(entry.second);
+		}
+	}
+
+	auto wsTempPath{ wsPath + L".tmp" };
+	{
+		// The temporary file keeps its protected security descriptor when it's moved over the store
+		auto hFile{ FileSystem::OpenProtectedFile(wsTempPath, GENERIC_WRITE, 0, CREATE_ALWAYS) };
+		if(!hFile){
+			LOG_ERROR(L"Unable to create incremental state at " << wsTempPath << L" (Error " << GetLastError() << L")");
+			return false;
+		}
+
+		StoreHeader header{ STORE_MAGIC, STORE_VERSION, dwRun, static_cast<DWORD>(records.size()) };
+		auto dwRecordBytes{ static_cast<DWORD>(records.size() * sizeof(Record)) };
+		DWORD dwBytesWritten{ 0 };
+		if(!WriteFile(hFile, &header, sizeof(header), &dwBytesWritten, nullptr) ||
+		   !WriteFile(hFile, records.data(), dwRecordBytes, &dwBytesWritten, nullptr) || !FlushFileBuffers(hFile)){
+			LOG_ERROR(L"Unable to write incremental state to " << wsTempPath << L" (Error " << GetLastError() << L")");
+			return false;
+		}
+	}
+
+	if(!MoveFileExW(wsTempPath.c_str(), wsPath.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)){
+		LOG_ERROR(L"Unable to replace incremental state at " << wsPath << L" (Error " << GetLastError() << L")");
+		return false;
+	}
+
+	LOG_INFO(L"Saved " << records.size() << L" verdicts to incremental state at " << wsPath);
+	return true;
+}
+
+void HuntState::Disable(){
+	auto lock{ BeginCriticalSection(hSection) };
+
+	bEnabled = false;
+	mRecords.clear();
+}
+
+bool HuntState::IsEnabled() const {
+	return bEnabled;
+}
+
+bool HuntState::IsUnchanged(const std::wstring& key, DWORD64 dwFingerprint){
+	if(!bEnabled){
+		return false;
+	}
+
+	auto lock{ BeginCriticalSection(hSection) };
+	auto record{ mRecords.find(HashKey(key)) };
+	if(record != mRecords.end() && record->second.dwFingerprint == dwFingerprint &&
+	   record->second.dwRulesFingerprint == dwRulesFingerprint && record->second.verdict == Verdict::Clean){
+		record->second.dwLastSeenRun = dwRun;
+		dwArtifactsSkipped++;
+		return true;
+	}
+
+	dwArtifactsEvaluated++;
+	return false;
+}
+
+void HuntState::RecordVerdict(const std::wstring& key, DWORD64 dwFingerprint, Verdict verdict){
+	if(!bEnabled){
+		return;
+	}
+
+	auto dwKey{ HashKey(key) };
+
+	auto lock{ BeginCriticalSection(hSection) };
+	mRecords[dwKey] = Record{ dwKey, dwFingerprint, dwRulesFingerprint, dwRun, verdict };
+}
+
+DWORD HuntState::GetArtifactsSkipped() const {
+	return dwArtifactsSkipped;
+}
+
+DWORD HuntState::GetArtifactsEvaluated() const {
+	return dwArtifactsEvaluated;
+}
+
+std::wstring HuntState::GetDefaultPath(){
+	WCHAR path[MAX_PATH]{};
+	GetModuleFileNameW(nullptr, path, MAX_PATH);
+
+	std::wstring directory{ path };
+	directory = directory.substr(0, directory.find_last_of(L'\\') + 1);
+	return directory + L"bluespawn-state.dat";
+}
@@ -0,0 +1,27 @@
+#include "hunt/LayerResults.h"
+
+LayerResults::LayerResults() :
+	dwArtifactsReused{ 0 },
+	dwVerdictsReused{ 0 }{}
+
+std::optional<HuntState::Verdict> LayerResults::GetVerdict(const std::wstring& artifact){
+	auto verdict{ mVerdicts.find(artifact) };
+	if(verdict == mVerdicts.end()){
+		return std::nullopt;
+	}
+
+	dwVerdictsReused++;
+	return verdict->second;
+}
+
+void LayerResults::RecordVerdict(const std::wstring& artifact, HuntState::Verdict verdict){
+	mVerdicts[artifact] = verdict;
+}
+
+DWORD LayerResults::GetArtifactsReused() const {
+	return dwArtifactsReused;
+}
+
+DWORD LayerResults::GetVerdictsReused() const {
+	return dwVerdictsReused;
+}
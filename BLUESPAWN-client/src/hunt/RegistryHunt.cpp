@@ -1,58 +1,93 @@
 #include "hunt/RegistryHunt.h"
+#include "hunt/Baseline.h"
+#include "hunt/FanOutPlanner.h"
 #include "reaction/Reaction.h"
 
 #include "util/log/HuntLogMessage.h"
 #include "util/log/Log.h"
+#include "util/patterns/Pattern.h"
 
-#include <regex>
 #include <set>
+#include <algorithm>
 
 namespace Registry {
-	REG_SZ_CHECK CheckSzEqual = [](const std::wstring& s1, const std::wstring& s2){ return s1 == s2; };
-	REG_SZ_CHECK CheckSzNotEqual = [](const std::wstring& s1, const std::wstring& s2){ return s1 != s2; };
-	REG_SZ_CHECK CheckSzEmpty = [](const std::wstring& s1, const std::wstring& s2){ return s1.length() == 0; };
-	REG_SZ_CHECK CheckSzRegexMatch = [](const std::wstring& s1, const std::wstring& s2){ return std::regex_match(s1, std::wregex(s2)); };
-	REG_SZ_CHECK CheckSzRegexNotMatch = [](const std::wstring& s1, const std::wstring& s2){ return !std::regex_match(s1, std::wregex(s2)); };
+	REG_SZ_CHECK CheckSzEqual = [](std::wstring_view s1, const std::wstring& s2){ return s1 == s2; };
+	REG_SZ_CHECK CheckSzNotEqual = [](std::wstring_view s1, const std::wstring& s2){ return s1 != s2; };
+	REG_SZ_CHECK CheckSzEmpty = [](std::wstring_view s1, const std::wstring& s2){ return s1.length() == 0; };
+	REG_SZ_CHECK CheckSzRegexMatch = [](std::wstring_view s1, const std::wstring& s2){
+		return Patterns::PatternRegistry::GetInstance().Compile(s2)->Matches(s1.data(), s1.length());
+	};
+	REG_SZ_CHECK CheckSzRegexNotMatch = [](std::wstring_view s1, const std::wstring& s2){
+		return !Patterns::PatternRegistry::GetInstance().Compile(s2)->Matches(s1.data(), s1.length());
+	};
 
 	REG_DWORD_CHECK CheckDwordEqual = [](DWORD d1, DWORD d2){ return d1 == d2; };
 	REG_DWORD_CHECK CheckDwordNotEqual = [](DWORD d1, DWORD d2){ return d1 != d2; };
 
-	REG_BINARY_CHECK CheckBinaryEqual = [](const AllocationWrapper& s1, const AllocationWrapper& s2){
-		return s1.CompareMemory(s2);
+	REG_BINARY_CHECK CheckBinaryEqual = [](const ValueView& s1, const AllocationWrapper& s2){
+		if(!s2){
+			return !s1.GetSize();
+		}
+		return s1.GetSize() == s2.GetSize() && !memcmp(s1.GetData(), static_cast<LPVOID>(s2), s1.GetSize());
 	};
-	REG_BINARY_CHECK CheckBinaryNotEqual = [](const AllocationWrapper& s1, const AllocationWrapper& s2){
-		return !s1.CompareMemory(s2);
+	REG_BINARY_CHECK CheckBinaryNotEqual = [](const ValueView& s1, const AllocationWrapper& s2){
+		return !CheckBinaryEqual(s1, s2);
 	};
-	REG_BINARY_CHECK CheckBinaryNull = [](const AllocationWrapper& s1, const AllocationWrapper& s2){ return !s1; };
+	REG_BINARY_CHECK CheckBinaryNull = [](const ValueView& s1, const AllocationWrapper& s2){ return !s1.GetSize(); };
 
-	REG_MULTI_SZ_CHECK CheckMultiSzSubset = [](const std::vector<std::wstring>& s1, const std::vector<std::wstring>& s2){
-		std::unordered_set<std::wstring> vals = { s2.begin(), s2.end() };
+	// The lists given to checks are short, so they're searched directly rather than being hashed on every check
+	REG_MULTI_SZ_CHECK CheckMultiSzSubset = [](const MultiStringView& s1, const std::vector<std::wstring>& s2){
 		for(auto string : s1){
-			if(vals.find(string) == vals.end()){
+			if(std::find(s2.begin(), s2.end(), string) == s2.end()){
 				return false;
 			}
 		}
 		return true;
 	};
-	REG_MULTI_SZ_CHECK CheckMultiSzExclusion = [](const std::vector<std::wstring>& s1, const std::vector<std::wstring>& s2){
-		std::unordered_set<std::wstring> vals = { s2.begin(), s2.end() };
+	REG_MULTI_SZ_CHECK CheckMultiSzExclusion = [](const MultiStringView& s1, const std::vector<std::wstring>& s2){
 		for(auto string : s1){
-			if(vals.find(string) != vals.end()){
+			if(std::find(s2.begin(), s2.end(), string) != s2.end()){
 				return false;
 			}
 		}
 		return true;
 	};
-	REG_MULTI_SZ_CHECK CheckMultiSzEmpty = [](const std::vector<std::wstring>& s1, const std::vector<std::wstring>& s2){
-		return s1.size() == 0;
+	REG_MULTI_SZ_CHECK CheckMultiSzEmpty = [](const MultiStringView& s1, const std::vector<std::wstring>& s2){
+		return s1.empty();
 	};
 
+	namespace {
+
+		/**
+		 * Replaces CheckSzRegexMatch and CheckSzRegexNotMatch with checks holding the compiled pattern, so that
+		 * checking a value only matches it rather than looking the pattern up first. Other checks are returned
+		 * unchanged.
+		 *
+		 * @param check The check given to a RegistryCheck
+		 * @param wsPattern The data given to the RegistryCheck, which is the pattern for the regex checks
+		 *
+		 * @return The check to use
+		 */
+		REG_SZ_CHECK ResolvePattern(const REG_SZ_CHECK& check, const std::wstring& wsPattern){
+			// Each lambda has a type of its own, so the type of the function held identifies the check
+			auto bMatch{ check.target_type() == CheckSzRegexMatch.target_type() };
+			if(!bMatch && check.target_type() != CheckSzRegexNotMatch.target_type()){
+				return check;
+			}
+
+			auto pattern{ Patterns::PatternRegistry::GetInstance().Compile(wsPattern) };
+			return [pattern, bMatch](std::wstring_view s1, const std::wstring& s2){
+				return pattern->Matches(s1.data(), s1.length()) == bMatch;
+			};
+		}
+	}
+
 	RegistryCheck::RegistryCheck(std::wstring&& wValueName, std::wstring&& wData, bool MissingBad, const REG_SZ_CHECK& check) :
 		name{ std::forward<std::wstring>(wValueName) },
 		value{ std::forward<std::wstring>(wData) },
 		type{ RegistryType::REG_SZ_T },
 		MissingBad{ MissingBad },
-		check{ check }{}
+		check{ ResolvePattern(check, std::get<std::wstring>(value)) }{}
 
 	RegistryCheck::RegistryCheck(std::wstring&& wValueName, DWORD&& dwData, bool MissingBad, const REG_DWORD_CHECK& check) :
 		name{ std::forward<std::wstring>(wValueName) },
@@ -79,191 +114,85 @@ namespace Registry {
 		return type;
 	}
 
-	bool RegistryCheck::operator()(const RegistryData& data) const {
+	bool RegistryCheck::operator()(const ValueView& view) const {
 		if(type == RegistryType::REG_DWORD_T){
-			return (std::get<REG_DWORD_CHECK>(check))(std::get<DWORD>(data), std::get<DWORD>(value));
+			return (std::get<REG_DWORD_CHECK>(check))(view.AsDword(), std::get<DWORD>(value));
 		} else if(type == RegistryType::REG_SZ_T){
-			return (std::get<REG_SZ_CHECK>(check))(std::get<std::wstring>(data), std::get<std::wstring>(value));
+			return (std::get<REG_SZ_CHECK>(check))(view.AsString(), std::get<std::wstring>(value));
 		} else if(type == RegistryType::REG_MULTI_SZ_T){
-			return (std::get<REG_MULTI_SZ_CHECK>(check))(std::get<std::vector<std::wstring>>(data), std::get<std::vector<std::wstring>>(value));
+			return (std::get<REG_MULTI_SZ_CHECK>(check))(view.AsMultiString(), std::get<std::vector<std::wstring>>(value));
 		} else {
-			return (std::get<REG_BINARY_CHECK>(check))(std::get<AllocationWrapper>(data), std::get<AllocationWrapper>(value));
+			return (std::get<REG_BINARY_CHECK>(check))(view, std::get<AllocationWrapper>(value));
 		}
 	}
 
-	std::vector<RegistryValue> CheckValues(const HKEY& hkHive, const std::wstring& path, const std::vector<RegistryCheck>& checks, bool CheckWow64, bool CheckUsers){
-		std::vector<RegistryValue> vIdentifiedValues{};
-		std::vector<RegistryKey> vKeys{ RegistryKey{hkHive, path} };
-		if(CheckWow64){
-			RegistryKey Wow64Key{ hkHive, path, true };
-			if(Wow64Key.Exists() && std::count(vKeys.begin(), vKeys.end(), Wow64Key) == 0){
-				vKeys.emplace_back(Wow64Key);
-			}
+	std::vector<RegistryValue> RemoveBaselinedValues(std::vector<RegistryValue>&& values){
+		auto& baseline{ Baseline::GetInstance() };
+		if(!baseline.IsEnabled()){
+			return std::move(values);
 		}
-		if(CheckUsers){
-			std::vector<RegistryKey> hkUserHives{ RegistryKey{HKEY_USERS}.EnumerateSubkeys() };
-			for(auto& hive : hkUserHives){
-				RegistryKey key{ HKEY(hive), path, false };
-				if(key.Exists() && std::count(vKeys.begin(), vKeys.end(), key) == 0){
-					vKeys.emplace_back(key);
-				}
-				if(CheckWow64){
-					RegistryKey Wow64Key{ HKEY(hive), path, true };
-					if(Wow64Key.Exists() && std::count(vKeys.begin(), vKeys.end(), Wow64Key) == 0){
-						vKeys.emplace_back(Wow64Key);
-					}
-				}
+
+		std::vector<RegistryValue> vRemaining{};
+		for(auto& value : values){
+			if(!baseline.Contains(value)){
+				vRemaining.emplace_back(value);
 			}
 		}
+		return vRemaining;
+	}
+
+	std::vector<RegistryValue> CheckValues(const HKEY& hkHive, const std::wstring& path, const std::vector<RegistryCheck>& checks, bool CheckWow64, bool CheckUsers){
+		std::vector<RegistryValue> vIdentifiedValues{};
+		auto vKeys{ FanOutPlanner::GetInstance().Resolve(hkHive, path, CheckWow64, CheckUsers) };
 
 		for(auto& key : vKeys){
 			LOG_VERBOSE(1, "Checking values under " << key.ToString());
 
-			for(const RegistryCheck& check : checks){
-				if(check.GetType() == RegistryType::REG_SZ_T || check.GetType() == RegistryType::REG_EXPAND_SZ_T){
-					auto data = key.GetValue<std::wstring>(check.name);
-					if(!data.has_value()){
-						if(check.MissingBad){
-							LOG_INFO("Under key " << key << ", desired value " << check.name << " was missing.");
+			// Values are checked in place; only those identified are copied out of the registry
+			for(auto& check : checks){
+				auto view{ key.GetValueView(check.name) };
+				if(!view){
+					if(check.MissingBad){
+						LOG_INFO("Under key " << key << ", desired value " << check.name << " was missing.");
+						if(check.GetType() == RegistryType::REG_SZ_T || check.GetType() == RegistryType::REG_EXPAND_SZ_T){
 							vIdentifiedValues.emplace_back(RegistryValue{ key, check.name, std::move(std::wstring{}) });
-						}
-					} else if(!check(*data)){
-						auto value = RegistryValue{ key, check.name, std::move(*data) };
-						LOG_INFO("Under key " << key << ", value " << value.GetPrintableName() << " had potentially malicious data " << value);
-						vIdentifiedValues.emplace_back(value);
-					}
-				} else if(check.GetType() == RegistryType::REG_MULTI_SZ_T){
-					auto data = key.GetValue<std::vector<std::wstring>>(check.name);
-					if(!data.has_value()){
-						if(check.MissingBad){
-							LOG_INFO("Under key " << key << ", desired value " << check.name << " was missing.");
+						} else if(check.GetType() == RegistryType::REG_MULTI_SZ_T){
 							vIdentifiedValues.emplace_back(RegistryValue{ key, check.name, std::move(std::vector<std::wstring>{}) });
-						}
-					} else if(!check(*data)){
-						auto value = RegistryValue{ key, check.name, std::move(*data) };
-						LOG_INFO("Under key " << key << ", value " << value.GetPrintableName() << " had potentially malicious data " << value);
-						vIdentifiedValues.emplace_back(value);
-					}
-				} else if(check.GetType() == RegistryType::REG_DWORD_T){
-					auto data = key.GetValue<DWORD>(check.name);
-					if(!data.has_value()){
-						if(check.MissingBad){
-							LOG_INFO("Under key " << key << ", desired value " << check.name << " was missing.");
+						} else if(check.GetType() == RegistryType::REG_DWORD_T){
 							vIdentifiedValues.emplace_back(RegistryValue{ key, check.name, std::move(0) });
-						}
-					} else if(!check(*data)){
-						auto value = RegistryValue{ key, check.name, std::move(*data) };
-						LOG_INFO("Under key " << key << ", value " << value.GetPrintableName() << " had potentially malicious data " << value);
-						vIdentifiedValues.emplace_back(value);
-					}
-				} else if(check.GetType() == RegistryType::REG_BINARY_T){
-					auto data = key.GetRawValue(check.name);
-					if(!data){
-						if(check.MissingBad){
-							LOG_INFO("Under key " << key << ", desired value " << check.name << " was missing.");
+						} else {
 							vIdentifiedValues.emplace_back(RegistryValue{ key, check.name, std::move(AllocationWrapper{ nullptr, 0 }) });
 						}
-					} else if(!check(data)){
-						auto value = RegistryValue{ key, check.name, std::move(data) };
-						LOG_INFO("Under key " << key << ", value " << value.GetPrintableName() << " had potentially malicious data " << value);
-						vIdentifiedValues.emplace_back(value);
 					}
+				} else if(!check(*view)){
+					auto value{ view->ToRegistryValue(key, check.name, check.GetType()) };
+					LOG_INFO("Under key " << key << ", value " << value.GetPrintableName() << " had potentially malicious data " << value);
+					vIdentifiedValues.emplace_back(std::move(value));
 				}
 			}
 		}
-		return vIdentifiedValues;
+		return RemoveBaselinedValues(std::move(vIdentifiedValues));
 	}
 
 	std::vector<RegistryValue> CheckKeyValues(const HKEY& hkHive, const std::wstring& path, bool CheckWow64, bool CheckUsers){
 		std::vector<RegistryValue> vIdentifiedValues{};
-		std::vector<RegistryKey> vKeys{ RegistryKey{hkHive, path} };
-		if(CheckWow64){
-			RegistryKey Wow64Key{ hkHive, path, true };
-			if(Wow64Key.Exists() && std::count(vKeys.begin(), vKeys.end(), Wow64Key) == 0){
-				vKeys.emplace_back(Wow64Key);
-			}
-		}
-		if(CheckUsers){
-			std::vector<RegistryKey> hkUserHives{ RegistryKey{HKEY_USERS}.EnumerateSubkeys() };
-			for(auto& hive : hkUserHives){
-				RegistryKey key{ HKEY(hive), path, false };
-				if(key.Exists() && std::count(vKeys.begin(), vKeys.end(), key) == 0){
-					vKeys.emplace_back(key);
-				}
-				if(CheckWow64){
-					RegistryKey Wow64Key{ HKEY(hive), path, true };
-					if(Wow64Key.Exists() && std::count(vKeys.begin(), vKeys.end(), Wow64Key) == 0){
-						vKeys.emplace_back(Wow64Key);
-					}
-				}
-			}
-		}
+		auto vKeys{ FanOutPlanner::GetInstance().Resolve(hkHive, path, CheckWow64, CheckUsers) };
 
 		std::vector<RegistryValue> vRegValues = {};
 		for(auto& key : vKeys){
-			auto values = key.EnumerateValues();
-
-			for(const auto& value : values){
-				auto type = key.GetValueType(value);
-				if(type == RegistryType::REG_SZ_T || type == RegistryType::REG_EXPAND_SZ_T){
-					auto data = key.GetValue<std::wstring>(value);
-					auto regValue = RegistryValue{ key, value, std::move(!data ? L"" : *data) };
-
-					LOG_INFO("Under key " << key << ", value " << regValue.GetPrintableName() << " was present with data " << regValue);
-
-					vRegValues.emplace_back(regValue);
-				} else if(type == RegistryType::REG_MULTI_SZ_T){
-					auto data = key.GetValue<std::vector<std::wstring>>(value);
-					auto regValue = RegistryValue{ key, value, std::move(!data ? std::vector<std::wstring>{} : *data) };
-
-					LOG_INFO("Under key " << key << ", value " << regValue.GetPrintableName() << " was present with data " << regValue);
+			for(auto& value : key.GetValues()){
+				LOG_INFO("Under key " << key << ", value " << value.GetPrintableName() << " was present with data " << value);
 
-					vRegValues.emplace_back(regValue);
-				} else if(type == RegistryType::REG_DWORD_T){
-					auto data = key.GetValue<DWORD>(value);
-					auto regValue = RegistryValue{ key, value, std::move(!data ? 0 : *data) };
-
-					LOG_INFO("Under key " << key << ", value " << regValue.GetPrintableName() << " was present with data " << regValue);
-
-					vRegValues.emplace_back(regValue);
-				} else {
-					auto data = key.GetRawValue(value);
-					auto regValue = RegistryValue{ key, value, std::move(data) };
-
-					LOG_INFO("Under key " << key << ", value " << regValue.GetPrintableName() << " was present with data " << regValue);
-
-					vRegValues.emplace_back(regValue);
-				}
+				vRegValues.emplace_back(std::move(value));
 			}
 		}
 
-		return vRegValues;
+		return RemoveBaselinedValues(std::move(vRegValues));
 	}
 
 	std::vector<RegistryKey> CheckSubkeys(const HKEY& hkHive, const std::wstring& path, bool CheckWow64, bool CheckUsers){
 		std::vector<RegistryValue> vIdentifiedValues{};
-		std::vector<RegistryKey> vKeys{ RegistryKey{hkHive, path} };
-		if(CheckWow64){
-			RegistryKey Wow64Key{ hkHive, path, true };
-			if(Wow64Key.Exists() && std::count(vKeys.begin(), vKeys.end(), Wow64Key) == 0){
-				vKeys.emplace_back(Wow64Key);
-			}
-		}
-		if(CheckUsers){
-			std::vector<RegistryKey> hkUserHives{ RegistryKey{HKEY_USERS}.EnumerateSubkeys() };
-			for(auto& hive : hkUserHives){
-				RegistryKey key{ HKEY(hive), path, false };
-				if(key.Exists() && std::count(vKeys.begin(), vKeys.end(), key) == 0){
-					vKeys.emplace_back(key);
-				}
-				if(CheckWow64){
-					RegistryKey Wow64Key{ HKEY(hive), path, true };
-					if(Wow64Key.Exists() && std::count(vKeys.begin(), vKeys.end(), Wow64Key) == 0){
-						vKeys.emplace_back(Wow64Key);
-					}
-				}
-			}
-		}
+		auto vKeys{ FanOutPlanner::GetInstance().Resolve(hkHive, path, CheckWow64, CheckUsers) };
 
 		std::vector<RegistryKey> subkeys{};
 		for(auto& key : vKeys){
@@ -0,0 +1,271 @@
+#include "hunt/RegistryPlan.h"
+
+#include <map>
+#include <set>
+#include <optional>
+
+#include "hunt/Scope.h"
+#include "util/log/Log.h"
+#include "common/StringUtils.h"
+
+namespace Registry {
+
+	namespace {
+		const std::wstring SUBKEY_WILDCARD{ L"\\*" };
+
+		/// A key found while executing the plan, along with the rules to evaluate under it
+		struct ResolvedKey {
+			RegistryKey key;
+			std::set<SIZE_T> rules;
+		};
+
+		/// Retrieves the type as which values checked with a given type are read
+		RegistryType GetReadType(RegistryType type){
+			return type == RegistryType::REG_EXPAND_SZ_T ? RegistryType::REG_SZ_T : type;
+		}
+
+		/// Creates the empty value reported when a value that must be present is missing
+		RegistryValue GetMissingValue(const RegistryKey& key, const std::wstring& name, RegistryType type){
+			if(type == RegistryType::REG_SZ_T){
+				return RegistryValue{ key, name, std::wstring{} };
+			} else if(type == RegistryType::REG_MULTI_SZ_T){
+				return RegistryValue{ key, name, std::vector<std::wstring>{} };
+			} else if(type == RegistryType::REG_DWORD_T){
+				return RegistryValue{ key, name, DWORD{ 0 } };
+			} else {
+				return RegistryValue{ key, name, AllocationWrapper{ nullptr, 0 } };
+			}
+		}
+
+		std::wstring GetSeverityName(RuleSeverity severity){
+			return severity == RuleSeverity::High ? L"high" : severity == RuleSeverity::Medium ? L"medium" : L"low";
+		}
+	}
+
+	RegistryRule::RegistryRule(HKEY hkHive, const std::wstring& path, RegistryCheck&& check, RuleSeverity severity, bool CheckWow64,
+		bool CheckUsers) :
+		hkHive{ hkHive },
+		path{ path },
+		check{ std::move(check) },
+		severity{ severity },
+		CheckWow64{ CheckWow64 },
+		CheckUsers{ CheckUsers }{}
+
+	bool RegistryRule::AppliesToSubkeys() const {
+		return path.length() >= SUBKEY_WILDCARD.length() &&
+			path.compare(path.length() - SUBKEY_WILDCARD.length(), SUBKEY_WILDCARD.length(), SUBKEY_WILDCARD) == 0;
+	}
+
+	RegistryPlan RegistryPlan::instance{};
+
+	RegistryPlan::RegistryPlan() :
+		bCompiled{ false }{}
+
+	RegistryPlan& RegistryPlan::GetInstance(){
+		return instance;
+	}
+
+	SIZE_T RegistryPlan::AddRule(RegistryRule&& rule){
+		auto lock{ BeginCriticalSection(hSection) };
+
+		vRules.emplace_back(std::move(rule));
+		bCompiled = false;
+		return vRules.size() - 1;
+	}
+
+	void RegistryPlan::Compile(){
+		vPlan.clear();
+
+		std::map<std::pair<HKEY, std::wstring>, SIZE_T> mKeys{};
+		for(SIZE_T id = 0; id < vRules.size(); id++){
+			auto& rule{ vRules[id] };
+			auto bSubkeys{ rule.AppliesToSubkeys() };
+			auto path{ bSubkeys ? rule.path.substr(0, rule.path.length() - SUBKEY_WILDCARD.length()) : rule.path };
+
+			// The wildcard is kept in the grouping key so that a key and its subkeys are grouped separately
+			auto group{ std::make_pair(rule.hkHive, ToLowerCaseW(rule.path)) };
+			auto existing{ mKeys.find(group) };
+			if(existing == mKeys.end()){
+				mKeys.emplace(group, vPlan.size());
+				vPlan.emplace_back(PlanKey{ rule.hkHive, path, bSubkeys, { id } });
+			} else {
+				vPlan[existing->second].vRules.emplace_back(id);
+			}
+		}
+
+		bCompiled = true;
+		LOG_VERBOSE(1, L"Compiled " << vRules.size() << L" registry rules into a plan over " << vPlan.size() << L" keys");
+	}
+
+	RegistryPlan::Findings RegistryPlan::Execute(const std::vector<RegistryKey>& hkUserHives, const std::vector<SIZE_T>& vSelectedRules,
+		const Scope* lpScope){
+		auto lock{ BeginCriticalSection(hSection) };
+
+		if(!bCompiled){
+			Compile();
+		}
+
+		std::vector<bool> vSelected(vRules.size());
+		for(auto id : vSelectedRules){
+			if(id < vRules.size()){
+				vSelected[id] = true;
+			}
+		}
+
+		// The number of keys opened, and the number the rules would have opened if checked one at a time
+		DWORD dwKeysOpened{ 0 };
+		DWORD dwKeysRequested{ 0 };
+
+		// Each key is identified by its full name, so that a key reached through different paths is only read once
+		std::map<std::wstring, ResolvedKey> mResolved{};
+		auto AddRules{ [&](const RegistryKey& key, const std::vector<SIZE_T>& rules){
+			if(lpScope && !lpScope->RegistryKeyIsInScope(key)){
+				return;
+			}
+
+			auto name{ ToLowerCaseW(key.GetName()) };
+			auto resolved{ mResolved.find(name) };
+			if(resolved == mResolved.end()){
+				resolved = mResolved.emplace(name, ResolvedKey{ key, {} }).first;
+			}
+			resolved->second.rules.insert(rules.begin(), rules.end());
+		} };
+
+		// As with CheckValues, a key under the hive itself is checked even when it doesn't exist, so that the values
+		// its rules require are reported as missing. A key that doesn't exist has no name, so it's identified by its
+		// hive and path instead, which can't collide with the name of a key that exists.
+		auto AddMissingKey{ [&](const RegistryKey& key, HKEY hkHive, const std::wstring& path, const std::vector<SIZE_T>& rules){
+			std::vector<SIZE_T> required{};
+			for(auto id : rules){
+				if(vRules[id].check.MissingBad){
+					required.emplace_back(id);
+				}
+			}
+			if(required.empty()){
+				return;
+			}
+
+			auto name{ L"|" + std::to_wstring(reinterpret_cast<ULONG_PTR>(hkHive)) + L"|" + ToLowerCaseW(path) };
+			auto resolved{ mResolved.find(name) };
+			if(resolved == mResolved.end()){
+				resolved = mResolved.emplace(name, ResolvedKey{ key, {} }).first;
+			}
+			resolved->second.rules.insert(required.begin(), required.end());
+		} };
+
+		for(auto& planKey : vPlan){
+			bool bSelected{ false };
+			bool bWow64{ false };
+			bool bUsers{ false };
+			for(auto id : planKey.vRules){
+				if(!vSelected[id]){
+					continue;
+				}
+
+				auto& rule{ vRules[id] };
+				bSelected = true;
+				dwKeysRequested += (1 + rule.CheckWow64) * (1 + (rule.CheckUsers ? static_cast<DWORD>(hkUserHives.size()) : 0));
+				bWow64 |= rule.CheckWow64;
+				bUsers |= rule.CheckUsers;
+			}
+			if(!bSelected){
+				continue;
+			}
+
+			auto Resolve{ [&](const RegistryKey& hive, bool bWow64Key, bool bUserKey){
+				std::vector<SIZE_T> rules{};
+				for(auto id : planKey.vRules){
+					if(vSelected[id] && (!bWow64Key || vRules[id].CheckWow64) && (!bUserKey || vRules[id].CheckUsers)){
+						rules.emplace_back(id);
+					}
+				}
+
+				RegistryKey key{ hive, planKey.path, bWow64Key };
+				dwKeysOpened++;
+				if(!key.Exists()){
+					if(!bWow64Key && !bUserKey && !planKey.bSubkeys){
+						AddMissingKey(key, planKey.hkHive, planKey.path, rules);
+					}
+					return;
+				}
+
+				if(planKey.bSubkeys){
+					for(auto& subkey : key.EnumerateSubkeys()){
+						AddRules(subkey, rules);
+					}
+				} else {
+					AddRules(key, rules);
+				}
+			} };
+
+			Resolve(RegistryKey{ planKey.hkHive }, false, false);
+			if(bWow64){
+				Resolve(RegistryKey{ planKey.hkHive }, true, false);
+			}
+			if(bUsers){
+				for(auto& hive : hkUserHives){
+					Resolve(hive, false, true);
+					if(bWow64){
+						Resolve(hive, true, true);
+					}
+				}
+			}
+		}
+
+		// The number of values read, and the number of reads the rules would have performed if checked one at a time
+		DWORD dwValuesRead{ 0 };
+		DWORD dwValuesRequested{ 0 };
+
+		Findings findings(vRules.size());
+		for(auto& entry : mResolved){
+			auto& key{ entry.second.key };
+			LOG_VERBOSE(1, "Checking values under " << key.ToString());
+
+			std::map<std::pair<std::wstring, RegistryType>, std::vector<SIZE_T>> mValues{};
+			for(auto id : entry.second.rules){
+				auto& check{ vRules[id].check };
+				mValues[{ ToLowerCaseW(check.name), GetReadType(check.GetType()) }].emplace_back(id);
+			}
+
+			// Each value is read once and checked in place by every rule reading it; it's only copied if reported
+			for(auto& value : mValues){
+				auto& name{ vRules[value.second[0]].check.name };
+				if(lpScope && !lpScope->RegistryValueIsInScope(RegistryValue{ key, name, std::wstring{} })){
+					continue;
+				}
+
+				auto data{ key.GetValueView(name) };
+				std::optional<RegistryValue> copy{};
+				dwValuesRead++;
+				dwValuesRequested += static_cast<DWORD>(value.second.size());
+
+				for(auto id : value.second){
+					auto& rule{ vRules[id] };
+					if(!data){
+						if(rule.check.MissingBad){
+							LOG_INFO("Under key " << key << ", desired value " << name << " was missing (" << GetSeverityName(rule.severity)
+								<< " severity).");
+							findings[id].emplace_back(GetMissingValue(key, name, value.first.second));
+						}
+					} else if(!rule.check(*data)){
+						if(!copy){
+							copy = data->ToRegistryValue(key, name, value.first.second);
+						}
+						LOG_INFO("Under key " << key << ", value " << copy->GetPrintableName() << " had potentially malicious data " << *copy
+							<< " (" << GetSeverityName(rule.severity) << " severity)");
+						findings[id].emplace_back(*copy);
+					}
+				}
+			}
+		}
+
+		for(auto& finding : findings){
+			finding = RemoveBaselinedValues(std::move(finding));
+		}
+
+		LOG_VERBOSE(1, L"Registry plan opened " << dwKeysOpened << L" keys instead of " << dwKeysRequested << L" and read " << dwValuesRead
+			<< L" values instead of " << dwValuesRequested);
+
+		return findings;
+	}
+}
@@ -1,53 +1,497 @@
 #include "hunt/Scope.h"
 
+#include <algorithm>
+
+#include <sddl.h>
+#include <Lmcons.h>
+
+#include "util/configurations/Registry.h"
+#include "util/configurations/RegistryValue.h"
+#include "util/filesystem/FileSystem.h"
+#include "util/log/Log.h"
+#include "common/StringUtils.h"
+#include "common/wrappers.hpp"
+
+namespace {
+	ULONGLONG FileTimeToInteger(const FILETIME& time){
+		return (static_cast<ULONGLONG>(time.dwHighDateTime) << 32) | time.dwLowDateTime;
+	}
+
+	std::optional<FILETIME> GetKeyLastWriteTime(HKEY key){
+		FILETIME written{};
+		if(ERROR_SUCCESS != RegQueryInfoKeyW(key, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr,
+											 nullptr, nullptr, &written)){
+			return std::nullopt;
+		}
+		return written;
+	}
+
+	/// Removes the \\?\ prefix added by functions such as GetFinalPathNameByHandle
+	std::wstring StripLongPathPrefix(const std::wstring& path){
+		if(path.compare(0, 4, L"\\\\?\\") == 0){
+			return path.substr(4);
+		}
+		return path;
+	}
+}
+
+std::vector<std::wstring> Scope::PathTrie::Split(const std::wstring& path){
+	std::vector<std::wstring> components{};
+	SIZE_T start{ 0 };
+	while(start < path.length()){
+		auto end{ path.find_first_of(L"\\/", start) };
+		if(end == std::wstring::npos){
+			end = path.length();
+		}
+		if(end > start){
+			components.emplace_back(ToLowerCaseW(path.substr(start, end - start)));
+		}
+		start = end + 1;
+	}
+	return components;
+}
+
+void Scope::PathTrie::Insert(const std::wstring& path){
+	SIZE_T node{ 0 };
+	for(auto& component : Split(path)){
+		auto child{ vNodes[node].children.find(component) };
+		if(child != vNodes[node].children.end()){
+			node = child->second;
+		} else{
+			vNodes.emplace_back(Node{});
+			vNodes[node].children.emplace(component, vNodes.size() - 1);
+			node = vNodes.size() - 1;
+		}
+	}
+	vNodes[node].bTerminal = true;
+}
+
+bool Scope::PathTrie::Contains(const std::wstring& path) const {
+	SIZE_T node{ 0 };
+	if(vNodes[node].bTerminal){
+		return true;
+	}
+	for(auto& component : Split(path)){
+		auto child{ vNodes[node].children.find(component) };
+		if(child == vNodes[node].children.end()){
+			return false;
+		}
+		node = child->second;
+		if(vNodes[node].bTerminal){
+			return true;
+		}
+	}
+	return false;
+}
+
+bool Scope::PathTrie::Overlaps(const std::wstring& path) const {
+	SIZE_T node{ 0 };
+	for(auto& component : Split(path)){
+		if(vNodes[node].bTerminal){
+			return true;
+		}
+		auto child{ vNodes[node].children.find(component) };
+		if(child == vNodes[node].children.end()){
+			return false;
+		}
+		node = child->second;
+	}
+
+	// Every component matched, so the path is either a prefix in the trie or an ancestor of one
+	return true;
+}
+
+std::wstring Scope::NormalizeKeyPath(const std::wstring& path){
+	// Opening the key resolves abbreviations, HKCU, and links such as CurrentControlSet
+	Registry::RegistryKey key{ path };
+	if(key.Exists()){
+		return key.GetName();
+	}
+
+	auto separator{ path.find(L'\\') };
+	auto hive{ path.substr(0, separator) };
+	auto remainder{ separator == std::wstring::npos ? std::wstring{} : path.substr(separator) };
+	if(Registry::vHiveNames.count(hive)){
+		return Registry::vHives[Registry::vHiveNames[hive]] + remainder;
+	}
+	return path;
+}
+
+Scope& Scope::AddPath(const std::wstring& path){
+	auto expanded{ ExpandEnvStringsW(path) };
+
+	WCHAR full[MAX_PATH]{};
+	if(GetFullPathNameW(expanded.c_str(), MAX_PATH, full, nullptr)){
+		expanded = full;
+	}
+
+	bRestricted = true;
+	paths.Insert(expanded);
+	vFileNames.emplace_back(expanded);
+	vNarrowFileNames.emplace_back(WidestringToString(expanded));
+	return *this;
+}
+
+Scope& Scope::AddRegistryKey(const std::wstring& path){
+	auto name{ NormalizeKeyPath(path) };
+
+	bRestricted = true;
+	keys.Insert(name);
+	vKeyNames.emplace_back(name);
+	vNarrowKeyNames.emplace_back(WidestringToString(name));
+	return *this;
+}
+
+Scope& Scope::AddRegistryValue(const Registry::RegistryKey& key, const std::wstring& name){
+	auto keyName{ key.GetName() };
+
+	bRestricted = true;
+	auto& names{ values[ToLowerCaseW(keyName)] };
+	if(names.empty()){
+		vKeyNames.emplace_back(keyName);
+		vNarrowKeyNames.emplace_back(WidestringToString(keyName));
+	}
+	names.emplace(ToLowerCaseW(name));
+	return *this;
+}
+
+Scope& Scope::AddProcess(DWORD pid){
+	bRestricted = true;
+	pids.emplace(pid);
+	return *this;
+}
+
+Scope& Scope::AddService(const std::wstring& name){
+	bRestricted = true;
+	services.emplace(ToLowerCaseW(name));
+	vServiceNames.emplace_back(name);
+	vNarrowServiceNames.emplace_back(WidestringToString(name));
+	return AddRegistryKey(L"HKEY_LOCAL_MACHINE\\SYSTEM\\CurrentControlSet\\Services\\" + name);
+}
+
+Scope& Scope::AddUser(const std::wstring& user){
+	bRestricted = true;
+	users.emplace(ToLowerCaseW(user));
+
+	// Resolve the user's SID, so that their profile and hives can be found
+	std::wstring sid{};
+	if(user.compare(0, 2, L"S-") == 0){
+		sid = user;
+
+		PSID lpSid{ nullptr };
+		if(ConvertStringSidToSidW(user.c_str(), &lpSid)){
+			WCHAR name[UNLEN + 1]{};
+			WCHAR domain[DNLEN + 1]{};
+			DWORD dwNameLength{ UNLEN + 1 };
+			DWORD dwDomainLength{ DNLEN + 1 };
+			SID_NAME_USE use{};
+			if(LookupAccountSidW(nullptr, lpSid, name, &dwNameLength, domain, &dwDomainLength, &use)){
+				users.emplace(ToLowerCaseW(std::wstring{ name }));
+			}
+			LocalFree(lpSid);
+		}
+	} else{
+		BYTE sidBuffer[SECURITY_MAX_SID_SIZE]{};
+		WCHAR domain[DNLEN + 1]{};
+		DWORD dwSidLength{ SECURITY_MAX_SID_SIZE };
+		DWORD dwDomainLength{ DNLEN + 1 };
+		SID_NAME_USE use{};
+		LPWSTR lpSidString{ nullptr };
+		if(LookupAccountNameW(nullptr, user.c_str(), sidBuffer, &dwSidLength, domain, &dwDomainLength, &use) &&
+		   ConvertSidToStringSidW(sidBuffer, &lpSidString)){
+			sid = lpSidString;
+			users.emplace(ToLowerCaseW(sid));
+			LocalFree(lpSidString);
+		}
+	}
+
+	if(!sid.length()){
+		LOG_WARNING(L"Unable to resolve the SID of user " << user << L"; their profile and hives won't be in scope");
+		return *this;
+	}
+
+	Registry::RegistryKey profile{ HKEY_LOCAL_MACHINE, L"SOFTWARE\\Microsoft\\Windows NT\\CurrentVersion\\ProfileList\\" + sid };
+	if(profile.ValueExists(L"ProfileImagePath")){
+		AddPath(*profile.GetValue<std::wstring>(L"ProfileImagePath"));
+	}
+
+	AddRegistryKey(L"HKEY_USERS\\" + sid);
+	return AddRegistryKey(L"HKEY_USERS\\" + sid + L"_Classes");
+}
+
+Scope& Scope::AddTimeWindow(const FILETIME& start, const FILETIME& end){
+	std::pair<ULONGLONG, ULONGLONG> window{ FileTimeToInteger(start), FileTimeToInteger(end) };
+
+	// Merge the new window with every window it overlaps, keeping the windows sorted and disjoint
+	std::vector<std::pair<ULONGLONG, ULONGLONG>> merged{};
+	for(auto& existing : vTimeWindows){
+		if(existing.second < window.first || existing.first > window.second){
+			merged.emplace_back(existing);
+		} else{
+			window.first = (std::min)(window.first, existing.first);
+			window.second = (std::max)(window.second, existing.second);
+		}
+	}
+	merged.emplace_back(window);
+	std::sort(merged.begin(), merged.end());
+
+	vTimeWindows = std::move(merged);
+	return *this;
+}
+
+bool Scope::IsUnrestricted() const {
+	return !bRestricted && vTimeWindows.empty();
+}
+
+bool Scope::TimeIsInScope(const FILETIME& time) const {
+	if(vTimeWindows.empty()){
+		return true;
+	}
+
+	// Find the last window starting at or before the time, and check whether it ends after the time
+	auto value{ FileTimeToInteger(time) };
+	auto window{ std::upper_bound(vTimeWindows.begin(), vTimeWindows.end(), std::make_pair(value, ULLONG_MAX)) };
+	return window != vTimeWindows.begin() && (window - 1)->second >= value;
+}
+
+bool Scope::FolderIsInScope(const std::wstring& path) const {
+	return !bRestricted || paths.Overlaps(StripLongPathPrefix(path));
+}
+
 bool Scope::FileIsInScope(LPCSTR sFileName) const {
+	return FileIsInScope(StringToWidestring(sFileName));
+}
+
+bool Scope::FileIsInScope(const std::wstring& path) const {
+	return !bRestricted || paths.Contains(StripLongPathPrefix(path));
+}
+
+bool Scope::FileIsInScope(const FileSystem::File& file) const {
+	if(!FileIsInScope(file.GetFilePath())){
+		return false;
+	}
+	if(vTimeWindows.size() && file.GetFileExists()){
+		auto modified{ file.GetModifiedTime() };
+		return !modified || TimeIsInScope(*modified);
+	}
 	return true;
 }
+
 bool Scope::FileIsInScope(HANDLE hFile) const {
+	if(bRestricted){
+		WCHAR path[MAX_PATH + 4]{};
+		if(!GetFinalPathNameByHandleW(hFile, path, MAX_PATH + 4, VOLUME_NAME_DOS) || !FileIsInScope(std::wstring{ path })){
+			return false;
+		}
+	}
+	if(vTimeWindows.size()){
+		FILETIME modified{};
+		return !GetFileTime(hFile, nullptr, nullptr, &modified) || TimeIsInScope(modified);
+	}
 	return true;
 }
+
 std::vector<HANDLE> Scope::GetScopedFileHandles() const {
-	return std::vector<HANDLE>();
+	std::vector<HANDLE> handles{};
+	for(auto& path : vFileNames){
+		auto hFile{ CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+								OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, nullptr) };
+		if(hFile != INVALID_HANDLE_VALUE){
+			handles.emplace_back(hFile);
+		}
+	}
+	return handles;
 }
+
 std::vector<LPCSTR> Scope::GetScopedFileNames() const {
-	return std::vector<LPCSTR>();
+	std::vector<LPCSTR> names{};
+	for(auto& name : vNarrowFileNames){
+		names.emplace_back(name.c_str());
+	}
+	return names;
+}
+
+bool Scope::KeyIsScoped(const std::wstring& name) const {
+	return keys.Contains(name) || (values.size() && values.count(ToLowerCaseW(name)));
 }
 
-bool Scope::RegistryKeyIsInScope(LPCSTR pid) const {
+bool Scope::RegistryKeyIsInScope(LPCSTR sKeyPath) const {
+	return !bRestricted || KeyIsScoped(NormalizeKeyPath(StringToWidestring(sKeyPath)));
+}
+
+bool Scope::RegistryKeyIsInScope(const Registry::RegistryKey& key) const {
+	if(bRestricted && !KeyIsScoped(key.GetName())){
+		return false;
+	}
+	if(vTimeWindows.size()){
+		auto written{ GetKeyLastWriteTime(key) };
+		return !written || TimeIsInScope(*written);
+	}
 	return true;
 }
+
 bool Scope::RegistryKeyIsInScope(HKEY key) const {
+	if(bRestricted){
+		if(Registry::vHives.count(key)){
+			if(!KeyIsScoped(Registry::vHives[key])){
+				return false;
+			}
+		} else{
+			// The RegistryKey takes ownership of the handle it's given, so it's given a duplicate
+			HANDLE hDuplicate{ nullptr };
+			if(!DuplicateHandle(GetCurrentProcess(), key, GetCurrentProcess(), &hDuplicate, 0, false, DUPLICATE_SAME_ACCESS) ||
+			   !KeyIsScoped(Registry::RegistryKey{ reinterpret_cast<HKEY>(hDuplicate) }.GetName())){
+				return false;
+			}
+		}
+	}
+	if(vTimeWindows.size()){
+		auto written{ GetKeyLastWriteTime(key) };
+		return !written || TimeIsInScope(*written);
+	}
 	return true;
 }
+
+bool Scope::RegistryValueIsInScope(const Registry::RegistryValue& value) const {
+	if(bRestricted){
+		auto name{ value.key.GetName() };
+		if(!keys.Contains(name)){
+			auto scoped{ values.find(ToLowerCaseW(name)) };
+			if(scoped == values.end() || !scoped->second.count(ToLowerCaseW(value.wValueName))){
+				return false;
+			}
+		}
+	}
+	if(vTimeWindows.size()){
+		auto written{ GetKeyLastWriteTime(value.key) };
+		return !written || TimeIsInScope(*written);
+	}
+	return true;
+}
+
 std::vector<HKEY> Scope::GetScopedKHEYs() const {
-	return std::vector<HKEY>();
+	std::vector<HKEY> handles{};
+	for(auto& name : vKeyNames){
+		auto separator{ name.find(L'\\') };
+		auto hive{ name.substr(0, separator) };
+		if(!Registry::vHiveNames.count(hive)){
+			continue;
+		}
+		if(separator == std::wstring::npos){
+			handles.emplace_back(Registry::vHiveNames[hive]);
+			continue;
+		}
+
+		HKEY key{ nullptr };
+		if(ERROR_SUCCESS == RegOpenKeyExW(Registry::vHiveNames[hive], name.substr(separator + 1).c_str(), 0, KEY_READ, &key)){
+			handles.emplace_back(key);
+		}
+	}
+	return handles;
 }
+
 std::vector<LPCSTR> Scope::GetScopedRegKeyNames() const {
-	return std::vector<LPCSTR>();
+	std::vector<LPCSTR> names{};
+	for(auto& name : vNarrowKeyNames){
+		names.emplace_back(name.c_str());
+	}
+	return names;
 }
 
-bool Scope::ProcessIsInScope(DWORD sProcessName) const {
+bool Scope::ProcessIsInScope(DWORD pid) const {
+	if(bRestricted && !pids.count(pid)){
+		return false;
+	}
+	if(vTimeWindows.size()){
+		HandleWrapper hProcess{ OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, false, pid) };
+		return !hProcess || ProcessIsInScope(hProcess);
+	}
 	return true;
 }
+
 bool Scope::ProcessIsInScope(HANDLE hProcess) const {
+	if(bRestricted && !pids.count(GetProcessId(hProcess))){
+		return false;
+	}
+	if(vTimeWindows.size()){
+		FILETIME created{}, exited{}, kernel{}, user{};
+		return !GetProcessTimes(hProcess, &created, &exited, &kernel, &user) || TimeIsInScope(created);
+	}
 	return true;
 }
+
 std::vector<HANDLE> Scope::GetScopedProcessHandles() const {
-	return std::vector<HANDLE>();
+	std::vector<HANDLE> handles{};
+	for(auto pid : pids){
+		auto hProcess{ OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION | PROCESS_VM_READ, false, pid) };
+		if(hProcess){
+			handles.emplace_back(hProcess);
+		}
+	}
+	return handles;
 }
+
 std::vector<DWORD> Scope::GetScopedProcessPIDs() const {
-	return std::vector<DWORD>();
+	return { pids.begin(), pids.end() };
 }
 
 bool Scope::ServiceIsInScope(LPCSTR sServiceName) const {
-	return true;
+	return !bRestricted || services.count(ToLowerCaseW(StringToWidestring(sServiceName)));
 }
+
 bool Scope::ServiceIsInScope(SC_HANDLE hService) const {
-	return true;
+	if(!bRestricted){
+		return true;
+	}
+
+	// Service handles only expose the display name, which must be mapped back to the service name
+	DWORD dwBytesNeeded{ 0 };
+	QueryServiceConfigW(hService, nullptr, 0, &dwBytesNeeded);
+	std::vector<BYTE> buffer(dwBytesNeeded);
+	auto lpConfig{ reinterpret_cast<LPQUERY_SERVICE_CONFIGW>(buffer.data()) };
+	if(!dwBytesNeeded || !QueryServiceConfigW(hService, lpConfig, dwBytesNeeded, &dwBytesNeeded)){
+		return false;
+	}
+
+	auto hManager{ OpenSCManagerW(nullptr, nullptr, SC_MANAGER_CONNECT) };
+	if(!hManager){
+		return false;
+	}
+
+	WCHAR name[257]{};
+	DWORD dwNameLength{ 257 };
+	auto bFound{ GetServiceKeyNameW(hManager, lpConfig->lpDisplayName, name, &dwNameLength) };
+	CloseServiceHandle(hManager);
+
+	return bFound && services.count(ToLowerCaseW(std::wstring{ name }));
 }
+
 std::vector<SC_HANDLE> Scope::GetScopedServiceHandles() const {
-	return std::vector<SC_HANDLE>();
+	std::vector<SC_HANDLE> handles{};
+
+	auto hManager{ OpenSCManagerW(nullptr, nullptr, SC_MANAGER_CONNECT) };
+	if(!hManager){
+		return handles;
+	}
+	for(auto& name : vServiceNames){
+		auto hService{ OpenServiceW(hManager, name.c_str(), SERVICE_QUERY_CONFIG | SERVICE_QUERY_STATUS) };
+		if(hService){
+			handles.emplace_back(hService);
+		}
+	}
+	CloseServiceHandle(hManager);
+
+	return handles;
 }
+
 std::vector<LPCSTR> Scope::GetScopedServiceNames() const {
-	return std::vector<LPCSTR>();
-}
\ No newline at end of file
+	std::vector<LPCSTR> names{};
+	for(auto& name : vNarrowServiceNames){
+		names.emplace_back(name.c_str());
+	}
+	return names;
+}
+
+bool Scope::UserIsInScope(const std::wstring& user) const {
+	return !bRestricted || users.count(ToLowerCaseW(user));
+}
@@ -31,6 +31,10 @@ namespace Hunts {
 			{ L"UserInit", L"(C:\\\\(Windows|WINDOWS|windows)\\\\(System32|SYSTEM32|system32)\\\\)?(U|u)(SERINIT|serinit)\\.(exe|EXE),?", false, CheckSzRegexMatch }
 		}, true, true) };
 		for(auto& detection : winlogons){
+			if(!scope.RegistryValueIsInScope(detection)){
+				continue;
+			}
+
 			reaction.RegistryKeyIdentified(std::make_shared<REGISTRY_DETECTION>(detection));
 			detections++;
 		}
@@ -42,6 +46,10 @@ namespace Hunts {
 			}
 		}
 		for(auto& detection : notifies){
+			if(!scope.RegistryValueIsInScope(detection)){
+				continue;
+			}
+
 			reaction.RegistryKeyIdentified(std::make_shared<REGISTRY_DETECTION>(detection));
 			detections++;
 
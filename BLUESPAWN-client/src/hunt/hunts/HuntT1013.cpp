@@ -25,7 +25,7 @@ namespace Hunts {
 		auto monitors = RegistryKey{ HKEY_LOCAL_MACHINE, L"SYSTEM\\CurrentControlSet\\Control\\Print\\Monitors" };
 
 		for (auto monitor : monitors.EnumerateSubkeys()) {
-			if (monitor.ValueExists(L"Driver")) {
+			if (scope.RegistryKeyIsInScope(monitor) && monitor.ValueExists(L"Driver")) {
 				auto filepath = FileSystem::SearchPathExecutable(monitor.GetValue<std::wstring>(L"Driver").value());
 
 				if (filepath && FileSystem::CheckFileExists(*filepath)) {
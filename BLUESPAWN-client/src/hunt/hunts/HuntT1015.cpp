@@ -1,9 +1,11 @@
 #include "hunt/hunts/HuntT1015.h"
 #include "hunt/RegistryHunt.h"
+#include "hunt/RegistryPlan.h"
 
 #include "util/filesystem/FileSystem.h"
 #include "util/log/Log.h"
 #include "util/filesystem/YaraScanner.h"
+#include "util/threadpool/IOExecutor.h"
 
 #include "common/Utils.h"
 
@@ -15,18 +17,25 @@ namespace Hunts {
 		dwCategoriesAffected = (DWORD) Category::Configurations | (DWORD) Category::Files;
 		dwSourcesInvolved = (DWORD) DataSource::Registry | (DWORD) DataSource::FileSystem;
 		dwTacticsUsed = (DWORD) Tactic::Persistence | (DWORD) Tactic::PrivilegeEscalation;
+
+		for (auto key : vAccessibilityBinaries) {
+			vDebuggerRules.emplace_back(AddRegistryRule({ HKEY_LOCAL_MACHINE, wsIFEO + key,
+				{ L"Debugger", L"", false, CheckSzEmpty }, RuleSeverity::High, true, false }));
+		}
 	}
 
-	int HuntT1015::EvaluateRegistry(Reaction& reaction) {
+	int HuntT1015::EvaluateRegistry(const Scope& scope, Reaction& reaction) {
 		int detections = 0;
 
 		auto& yara = YaraScanner::GetInstance();
 
-		for (auto key : vAccessibilityBinaries) {
-			std::vector<RegistryValue> debugger{ CheckValues(HKEY_LOCAL_MACHINE, wsIFEO + key, {
-				{ L"Debugger", L"", false, CheckSzEmpty },
-            }, true, false) };
-			for(auto& detection : debugger){
+		auto artifacts{ GetArtifacts() };
+		for (auto rule : vDebuggerRules) {
+			for(auto& detection : artifacts->GetRuleFindings(rule)){
+				if(!scope.RegistryValueIsInScope(detection)){
+					continue;
+				}
+
 				detections++;
 				reaction.RegistryKeyIdentified(std::make_shared<REGISTRY_DETECTION>(detection));
 				LOG_INFO(detection.key.GetName() << L" is configured with a Debugger value of " << detection);
@@ -45,48 +54,59 @@ namespace Hunts {
 		return detections;
 	}
 
-	int HuntT1015::EvaluateFiles(Reaction& reaction, bool bScanYara) {
+	int HuntT1015::EvaluateFiles(const Scope& scope, Reaction& reaction, LayerResults& results) {
 		int detections = 0;
 
+		// The signatures of the binaries are all checked at once, then the results are collected in order
+		std::vector<std::pair<FileSystem::File, AsyncResult<bool>>> checks;
 		for (auto key : vAccessibilityBinaries) {
 			FileSystem::File file = FileSystem::File(L"C:\\Windows\\System32\\" + key);
+			if (!scope.FileIsInScope(file)) {
+				continue;
+			}
+			checks.emplace_back(file, IOExecutor::GetInstance().Async<bool>([file](){ return file.GetFileSigned(); }));
+		}
 
-			if (!file.GetFileSigned()) {
-				if (bScanYara) { 
-					auto& yara = YaraScanner::GetInstance();
-					YaraScanResult result = yara.ScanFile(file);
-				}
-
+		for (auto& check : checks) {
+			auto& file = check.first;
+			if (!check.second.Get()) {
 				LOG_INFO(file.GetFilePath() << L" is not signed!");
 				reaction.FileIdentified(std::make_shared<FILE_DETECTION>(file));
+				results.RecordVerdict(file.GetFilePath(), HuntState::Verdict::Suspicious);
 				detections++;
+			} else {
+				results.RecordVerdict(file.GetFilePath(), HuntState::Verdict::Clean);
 			}
 		}
 
 		return detections;
 	}
 
-	int HuntT1015::ScanCursory(const Scope& scope, Reaction reaction){
-		LOG_INFO(L"Hunting for " << name  << L" at level Cursory");
-		reaction.BeginHunt(GET_INFO());
+	int HuntT1015::ScanLayer(Aggressiveness level, const Scope& scope, Reaction& reaction, LayerResults& results) {
+		if (level == Aggressiveness::Cursory) {
+			int detections = EvaluateRegistry(scope, reaction);
+			detections += EvaluateFiles(scope, reaction, results);
+			return detections;
+		}
 
-		int results = EvaluateRegistry(reaction);
-		results += EvaluateFiles(reaction, false);
+		// The Normal scan adds YARA scans of the binaries the Cursory scan found to be unsigned
+		auto& yara = YaraScanner::GetInstance();
+		for (auto key : vAccessibilityBinaries) {
+			FileSystem::File file = FileSystem::File(L"C:\\Windows\\System32\\" + key);
+			if (results.GetVerdict(file.GetFilePath()) == HuntState::Verdict::Suspicious) {
+				YaraScanResult result = yara.ScanFile(file);
+			}
+		}
 
-		reaction.EndHunt();
-		return results;
+		return 0;
 	}
 
-	int HuntT1015::ScanNormal(const Scope& scope, Reaction reaction) {
-		LOG_INFO(L"Hunting for " << name << L" at level Normal");
-		reaction.BeginHunt(GET_INFO());
-
+	int HuntT1015::ScanCursory(const Scope& scope, Reaction reaction){
+		return RunLayers(GET_INFO(), scope, reaction);
+	}
 
-		int results = EvaluateRegistry(reaction);
-		results += EvaluateFiles(reaction, true);
-		
-		reaction.EndHunt();
-		return results;
+	int HuntT1015::ScanNormal(const Scope& scope, Reaction reaction) {
+		return RunLayers(GET_INFO(), scope, reaction);
 	}
 
 	std::vector<std::shared_ptr<Event>> HuntT1015::GetMonitoringEvents() {
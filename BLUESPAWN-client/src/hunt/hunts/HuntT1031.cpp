@@ -34,6 +34,10 @@ namespace Hunts {
 			}, false, false) };
 
 			for (auto& detection : dnsServerPlugins) {
+				if (!scope.RegistryValueIsInScope(detection)) {
+					continue;
+				}
+
 				reaction.RegistryKeyIdentified(std::make_shared<REGISTRY_DETECTION>(detection));
 				reaction.FileIdentified(std::make_shared<FILE_DETECTION>(FileSystem::File(detection.ToString())));
 				detections += 2;
@@ -49,6 +53,10 @@ namespace Hunts {
 			}, false, false) };
 
 			for (auto& detection : lsassDlls) {
+				if (!scope.RegistryValueIsInScope(detection)) {
+					continue;
+				}
+
 				auto file = FileSystem::File{ detection.ToString() };
 				if (file.GetFileExists() && !file.GetFileSigned()) {
 					reaction.RegistryKeyIdentified(std::make_shared<REGISTRY_DETECTION>(detection));
@@ -64,6 +72,10 @@ namespace Hunts {
 		auto winsock2 = RegistryKey{ HKEY_LOCAL_MACHINE, L"SYSTEM\\CurrentControlSet\\Services\\WinSock2\\Parameters" };
 		
 		for (auto paramdll : { L"AutodialDLL", L"NameSpace_Callout" }) {
+			if (!scope.RegistryValueIsInScope(RegistryValue{ winsock2, paramdll, std::wstring{} })) {
+				continue;
+			}
+
 			auto filepath = winsock2.GetValue<std::wstring>(paramdll);
 			if (filepath) {
 				auto file = FileSystem::File{ filepath.value() };
@@ -80,7 +92,7 @@ namespace Hunts {
 		if (appids.Exists()) {
 			for (auto subkey : appids.EnumerateSubkeys()) {
 				auto filepath = subkey.GetValue<std::wstring>(L"AppFullPath");
-				if (filepath) {
+				if (filepath && scope.RegistryKeyIsInScope(subkey)) {
 					auto file = FileSystem::File{ filepath.value() };
 					if (file.GetFileExists() && !file.GetFileSigned()) {
 						reaction.RegistryKeyIdentified(std::make_shared<REGISTRY_DETECTION>(RegistryValue{ subkey, L"AppFullPath", subkey.GetValue<std::wstring>(L"AppFullPath").value() }));
@@ -98,7 +110,7 @@ namespace Hunts {
 			for (auto subkey : { namespaceCatalog, namespaceCatalog64 }) {
 				for (auto entry : subkey.EnumerateSubkeys()) {
 					auto filepath = entry.GetValue<std::wstring>(L"LibraryPath");
-					if (filepath) {
+					if (filepath && scope.RegistryKeyIsInScope(entry)) {
 						auto file = FileSystem::File{ filepath.value() };
 						if (file.GetFileExists() && !file.GetFileSigned()) {
 							reaction.RegistryKeyIdentified(std::make_shared<REGISTRY_DETECTION>(RegistryValue{ entry, L"LibraryPath", entry.GetValue<std::wstring>(L"LibraryPath").value() }));
@@ -116,7 +128,7 @@ namespace Hunts {
 		auto services = RegistryKey{ HKEY_LOCAL_MACHINE, L"SYSTEM\\CurrentControlSet\\Services" };
 
 		for (auto service : services.EnumerateSubkeys()) {
-			if (!service.ValueExists(L"FailureCommand")) {
+			if (!scope.RegistryKeyIsInScope(service) || !service.ValueExists(L"FailureCommand")) {
 				continue;
 			}
 
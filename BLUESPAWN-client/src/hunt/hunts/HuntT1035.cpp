@@ -24,14 +24,17 @@ namespace Hunts {
 
 		auto cmd{ *key.GetValue<std::wstring>(L"ImagePath") };
 
-		if(IsLolbinMalicious(cmd)){
+		// Services whose image path is in the baseline are expected
+		if(Baseline::GetInstance().Contains(RegistryValue{ key, L"ImagePath", std::wstring{ cmd } })){
+			LOG_VERBOSE(2, L"Service " << key.GetName() << L" is in the baseline");
+		} else if(IsLolbinMalicious(cmd)){
 				reaction.RegistryKeyIdentified(std::make_shared<REGISTRY_DETECTION>(RegistryValue{ key, L"ImagePath", key.GetValue<std::wstring>(L"ImagePath").value() }));
 				detections++;
 		} else{
 			auto filepath = GetImagePathFromCommand(cmd);
 
 			FileSystem::File image = FileSystem::File(filepath);
-			if(image.GetFileExists() && !image.GetFileSigned()){
+			if(image.GetFileExists() && FileNeedsEvaluation(image) && !IsFileSigned(image)){
 				reaction.RegistryKeyIdentified(std::make_shared<REGISTRY_DETECTION>(RegistryValue{ key, L"ImagePath", key.GetValue<std::wstring>(L"ImagePath").value() }));
 
 				auto& yara = YaraScanner::GetInstance();
@@ -56,7 +59,7 @@ namespace Hunts {
 				if (filepath2 && FileSystem::CheckFileExists(*filepath2)) {
 					FileSystem::File servicedll = FileSystem::File(*filepath2);
 
-					if (!servicedll.GetFileSigned()) {
+					if (FileNeedsEvaluation(servicedll) && !IsFileSigned(servicedll)) {
 						reaction.RegistryKeyIdentified(std::make_shared<REGISTRY_DETECTION>(RegistryValue{ regkey, value, regkey.GetValue<std::wstring>(value).value() }));
 
 						auto& yara = YaraScanner::GetInstance();
@@ -79,10 +82,10 @@ namespace Hunts {
 
 		int detections = 0;
 
-		auto services = RegistryKey{ HKEY_LOCAL_MACHINE, L"SYSTEM\\CurrentControlSet\\Services" };
+		auto artifacts{ GetArtifacts() };
 
-		for (auto service : services.EnumerateSubkeys()) {
-			if (service.GetValue<DWORD>(L"Type") >= 0x10u) {
+		for (auto service : artifacts->GetServices()) {
+			if (scope.RegistryKeyIsInScope(service) && service.GetValue<DWORD>(L"Type") >= 0x10u) {
 				detections += EvaluateService(service, reaction);
 			}
 		}
@@ -98,4 +101,4 @@ namespace Hunts {
 
 		return events;
 	}
-}
\ No newline at end of file
+}
\ No newline at end of file
@@ -2,6 +2,7 @@
 
 #include "util/log/Log.h"
 #include "util/filesystem/FileSystem.h"
+#include "util/pipeline/Pipeline.h"
 
 namespace Hunts {
 
@@ -25,7 +26,18 @@ namespace Hunts {
 			auto f = FileSystem::Folder(folder);
 			if (f.GetFolderExists()) {
 				LOG_VERBOSE(1, L"Scanning " << f.GetFolderPath());
-				for (auto value : f.GetFiles(searchFilters, -1)) {
+				Pipeline<std::wstring> files{ [&](const Pipeline<std::wstring>::Emitter& emit) {
+					f.EnumerateFiles([&](const std::wstring& file) {
+						return !scope.FileIsInScope(file) || emit(file);
+					}, searchFilters, -1, [&scope](const std::wstring& subfolder) {
+						return scope.FolderIsInScope(subfolder);
+					});
+				} };
+				while (auto path = files.Next()) {
+					FileSystem::File value{ *path };
+					if (!value.GetFileExists()) {
+						continue;
+					}
 					if (value.GetFileAttribs().extension == L".exe" || value.GetFileAttribs().extension == L".dll") {
 						if (!value.GetFileSigned()) {
 							reaction.FileIdentified(std::make_shared<FILE_DETECTION>(value));
@@ -36,6 +48,10 @@ namespace Hunts {
 						detections++;
 					}
 				}
+				if (files.Failed()) {
+					LOG_ERROR(L"Walking " << f.GetFolderPath() << L" failed partway through; some files in it were not checked");
+					MarkIncomplete();
+				}
 			}
 		}
 
@@ -16,13 +16,13 @@ namespace Hunts{
 	}
 
 	int HuntT1037::EvaluateStartupFile(FileSystem::File file, Reaction& reaction, Aggressiveness level) {
-		//Scan with YARA at all levels
-		LOG_VERBOSE(1, L"Examining " << file.GetFilePath());
-		auto& yara = YaraScanner::GetInstance();
-		YaraScanResult result = yara.ScanFile(file);
-		bool bFileSigned = file.GetFileSigned();
+		// Each level only adds to the checks made at the levels below it
+		if(level == Aggressiveness::Cursory) {
+			LOG_VERBOSE(1, L"Examining " << file.GetFilePath());
+			auto& yara = YaraScanner::GetInstance();
+			YaraScanResult result = yara.ScanFile(file);
+			bool bFileSigned = file.GetFileSigned();
 
-		if(level == Aggressiveness::Cursory || level == Aggressiveness::Normal) {
 			if (file.GetFileAttribs().extension == L".exe" && !bFileSigned) {
 				reaction.FileIdentified(std::make_shared<FILE_DETECTION>(file));
 				return 1;
@@ -31,8 +31,7 @@ namespace Hunts{
 				reaction.FileIdentified(std::make_shared<FILE_DETECTION>(file));
 				return 1;
 			}
-		}
-		if(level == Aggressiveness::Normal) {
+		} else if(level == Aggressiveness::Normal) {
 			if((std::find(sus_exts.begin(), sus_exts.end(), file.GetFileAttribs().extension) != sus_exts.end())) {
 				LOG_INFO(L"Startup with suspicious extension identified.");
 				reaction.FileIdentified(std::make_shared<FILE_DETECTION>(file));
@@ -46,30 +45,22 @@ namespace Hunts{
 		return 0;
 	}
 
-	int Hunts::HuntT1037::AnalyzeRegistryStartupKey(Reaction reaction, Aggressiveness level) {
-		std::map<RegistryKey, std::vector<RegistryValue>> keys;
-
-		int detections = 0;
-		for(auto& detection : CheckValues(HKEY_CURRENT_USER, L"Environment", {
-			    { L"UserInitMprLogonScript", L"", false, CheckSzEmpty }
-			}, true, true)){
-			reaction.RegistryKeyIdentified(std::make_shared<REGISTRY_DETECTION>(detection));
-			detections++;
-
-			FileSystem::File file = FileSystem::File(detection.ToString());
-			detections += EvaluateStartupFile(file, reaction, level);
-        }
-
-		return detections;
+	std::vector<RegistryValue> HuntT1037::GetStartupValues() {
+		return CheckValues(HKEY_CURRENT_USER, L"Environment", {
+			{ L"UserInitMprLogonScript", L"", false, CheckSzEmpty }
+		}, true, true);
 	}
 
-	int Hunts::HuntT1037::AnalayzeStartupFolders(Reaction reaction, Aggressiveness level) {
-		int detections = 0;
+	std::vector<FileSystem::File> HuntT1037::GetStartupFiles(const std::vector<RegistryValue>& values) {
+		std::vector<FileSystem::File> files{};
+		for(auto& value : values){
+			files.emplace_back(FileSystem::File(value.ToString()));
+		}
 
 		std::vector<FileSystem::Folder> startup_directories = { FileSystem::Folder(L"C:\\ProgramData\\Microsoft\\Windows\\Start Menu\\Programs\\StartUp") };
-		auto userFolders = FileSystem::Folder(L"C:\\Users").GetSubdirectories(1);
-		for (auto userFolder : userFolders) {
-			auto folder = FileSystem::Folder(userFolder.GetFolderPath() + L"\\AppData\\Roaming\\Microsoft\\Windows\\Start Menu\\Programs\\StartUp");
+		auto artifacts{ GetArtifacts() };
+		for (auto& profile : artifacts->GetUserProfiles()) {
+			auto folder = FileSystem::Folder(profile + L"\\AppData\\Roaming\\Microsoft\\Windows\\Start Menu\\Programs\\StartUp");
 			if (folder.GetFolderExists()) {
 				startup_directories.emplace_back(folder);
 			}
@@ -77,44 +68,56 @@ namespace Hunts{
 		for (auto folder : startup_directories) {
 			LOG_VERBOSE(1, L"Scanning " << folder.GetFolderPath());
 			for (auto value : folder.GetFiles(std::nullopt, -1)) {
-				detections += EvaluateStartupFile(value, reaction, level);
+				files.emplace_back(value);
 			}
 		}
 
-		return detections;
+		return files;
 	}
 
-	int HuntT1037::ScanCursory(const Scope& scope, Reaction reaction) {
-		LOG_INFO(L"Hunting for " << name << L" at level Cursory");
-		reaction.BeginHunt(GET_INFO());
+	int HuntT1037::ScanLayer(Aggressiveness level, const Scope& scope, Reaction& reaction, LayerResults& results) {
+		auto& values{ results.GetArtifact<std::vector<RegistryValue>>(L"StartupValues", [this](){ return GetStartupValues(); }) };
+		auto& files{ results.GetArtifact<std::vector<FileSystem::File>>(L"StartupFiles", [&](){ return GetStartupFiles(values); }) };
 
-		int detections = AnalyzeRegistryStartupKey(reaction, Aggressiveness::Cursory);
-		detections += AnalayzeStartupFolders(reaction, Aggressiveness::Cursory);
+		int detections = 0;
 
-		reaction.EndHunt();
-		return detections;
-	}
+		// Logon script values are reported at every level, so only the lowest level reports them
+		if(level == Aggressiveness::Cursory) {
+			for(auto& detection : values) {
+				if(!scope.RegistryValueIsInScope(detection)) {
+					continue;
+				}
 
-	int HuntT1037::ScanNormal(const Scope& scope, Reaction reaction) {
-		LOG_INFO(L"Hunting for " << name << L" at level Normal");
-		reaction.BeginHunt(GET_INFO());
+				reaction.RegistryKeyIdentified(std::make_shared<REGISTRY_DETECTION>(detection));
+				detections++;
+			}
+		}
 
-		int detections = AnalyzeRegistryStartupKey(reaction, Aggressiveness::Normal);
-		detections += AnalayzeStartupFolders(reaction, Aggressiveness::Normal);
+		for(auto& file : files) {
+			// Files that a lower level found suspicious have already been reported
+			auto path{ file.GetFilePath() };
+			if(!scope.FileIsInScope(file) || results.GetVerdict(path) == HuntState::Verdict::Suspicious) {
+				continue;
+			}
+
+			auto bSuspicious{ EvaluateStartupFile(file, reaction, level) != 0 };
+			detections += bSuspicious;
+			results.RecordVerdict(path, bSuspicious ? HuntState::Verdict::Suspicious : HuntState::Verdict::Clean);
+		}
 
-		reaction.EndHunt();
 		return detections;
 	}
 
-	int HuntT1037::ScanIntensive(const Scope& scope, Reaction reaction) {
-		LOG_INFO(L"Hunting for " << name << L" at level Intensive");
-		reaction.BeginHunt(GET_INFO());
+	int HuntT1037::ScanCursory(const Scope& scope, Reaction reaction) {
+		return RunLayers(GET_INFO(), scope, reaction);
+	}
 
-		int detections = AnalyzeRegistryStartupKey(reaction, Aggressiveness::Intensive);
-		detections += AnalayzeStartupFolders(reaction, Aggressiveness::Intensive);
+	int HuntT1037::ScanNormal(const Scope& scope, Reaction reaction) {
+		return RunLayers(GET_INFO(), scope, reaction);
+	}
 
-		reaction.EndHunt();
-		return detections;
+	int HuntT1037::ScanIntensive(const Scope& scope, Reaction reaction) {
+		return RunLayers(GET_INFO(), scope, reaction);
 	}
 
 	std::vector<std::shared_ptr<Event>> HuntT1037::GetMonitoringEvents() {
@@ -7,6 +7,7 @@
 #include "util/processes/CheckLolbin.h"
 
 #include "common/Utils.h"
+#include "common/StringUtils.h"
 
 #include <map>
 
@@ -40,157 +41,98 @@ namespace Hunts {
 		return queryResults;
 	}
 
-	int HuntT1050::ScanNormal(const Scope& scope, Reaction reaction) {
-		LOG_INFO(L"Hunting for " << name << L" at level Normal");
-		reaction.BeginHunt(GET_INFO());
-
-		auto queryResults = Get7045Events();
+	int HuntT1050::ScanLayer(Aggressiveness level, const Scope& scope, Reaction& reaction, LayerResults& results) {
+		auto& events{ results.GetArtifact<std::vector<EventLogs::EventLogItem>>(L"7045", [this](){ return Get7045Events(); }) };
 
-		auto& yara = YaraScanner::GetInstance();
 		int detections = 0;
-		
-		std::map<std::pair<std::wstring, std::wstring>, bool> findings{};
-		
-		for(auto result : queryResults){
+
+		// Services identified at this level, mapped to whether they were found to be malicious
+		std::map<std::wstring, bool> findings{};
+
+		for(auto& result : events){
 			auto imageName = result.GetProperty(L"Event/EventData/Data[@Name='ServiceName']");
+			auto time{ result.GetTimeCreatedAsFileTime() };
+			if(!scope.ServiceIsInScope(WidestringToString(imageName).c_str()) || (time && !scope.TimeIsInScope(*time))){
+				continue;
+			}
 
 			auto cmd{ result.GetProperty(L"Event/EventData/Data[@Name='ImagePath']") };
-			std::pair<std::wstring, std::wstring> pair{ imageName, cmd };
+			auto service{ imageName + L"|" + cmd };
 
-			if(findings.count(pair)){
-				if(findings.at(pair)){
-					reaction.EventIdentified(EventLogs::EventLogItemToDetection(result));
-				}
-			} else{
-				if(IsLolbinMalicious(cmd)){
+			if(findings.count(service)){
+				if(findings.at(service)){
 					reaction.EventIdentified(EventLogs::EventLogItemToDetection(result));
-					findings.emplace(pair, true);
-					detections++;
-				} else{
-					auto imagePath = GetImagePathFromCommand(cmd);
-
-					FileSystem::File file = FileSystem::File(imagePath);
-					if(file.GetFileExists() && !file.GetFileSigned()){
-						reaction.EventIdentified(EventLogs::EventLogItemToDetection(result));
-
-						auto& yara = YaraScanner::GetInstance();
-						YaraScanResult result = yara.ScanFile(file);
-
-						reaction.FileIdentified(std::make_shared<FILE_DETECTION>(file));
-
-						detections += 2;
-						findings.emplace(pair, true);
-					}
-
-					// Look for PSExec services
-					else if(imageName.find(L"PSEXESVC") != std::wstring::npos){
-						reaction.EventIdentified(EventLogs::EventLogItemToDetection(result));
-						detections++;
-						findings.emplace(pair, true);
-					}
-
-					// Look for Mimikatz Driver loading
-					else if(imageName.find(L"mimikatz") != std::wstring::npos || imageName.find(L"mimidrv") != std::wstring::npos
-					   || imagePath.find(L"mimidrv.sys") != std::wstring::npos){
-						reaction.EventIdentified(EventLogs::EventLogItemToDetection(result));
-						reaction.FileIdentified(std::make_shared<FILE_DETECTION>(file));
-						detections += 2;
-						findings.emplace(pair, true);
-					}
-
-					// Calculate entropy of service names to look for suspicious services like 
-					// the ones MSF generates https://www.offensive-security.com/metasploit-unleashed/psexec-pass-hash/
-					else if(false && (GetShannonEntropy(imageName) < 3.00 || GetShannonEntropy(imageName) > 5.00)){
-						reaction.EventIdentified(EventLogs::EventLogItemToDetection(result));
-						reaction.FileIdentified(std::make_shared<FILE_DETECTION>(file));
-						detections += 2;
-						findings.emplace(pair, true);
-					} else {
-						findings.emplace(pair, false);
-					}
 				}
+				continue;
 			}
-		}
 
-		reaction.EndHunt();
-		return detections;
-	}
+			// Services that a lower level found malicious have already been reported
+			auto verdict{ results.GetVerdict(service) };
+			if(verdict == HuntState::Verdict::Suspicious){
+				continue;
+			}
 
-	int HuntT1050::ScanIntensive(const Scope& scope, Reaction reaction){
-		LOG_INFO(L"Hunting for " << name << L" at level Intensive");
-		reaction.BeginHunt(GET_INFO());
+			auto imagePath = GetImagePathFromCommand(cmd);
+			FileSystem::File file = FileSystem::File(imagePath);
 
-		auto queryResults = Get7045Events();
+			bool bMalicious{ false };
+			if(level == Aggressiveness::Normal){
+				if(IsLolbinMalicious(cmd)){
+					reaction.EventIdentified(EventLogs::EventLogItemToDetection(result));
+					detections++;
+					bMalicious = true;
+				} else if(file.GetFileExists() && !file.GetFileSigned()){
+					reaction.EventIdentified(EventLogs::EventLogItemToDetection(result));
 
-		auto& yara = YaraScanner::GetInstance();
-		int detections = 0;
+					auto& yara = YaraScanner::GetInstance();
+					YaraScanResult result = yara.ScanFile(file);
 
-		std::map<std::pair<std::wstring, std::wstring>, bool> findings{};
+					reaction.FileIdentified(std::make_shared<FILE_DETECTION>(file));
 
-		for(auto result : queryResults){
-			auto imageName = result.GetProperty(L"Event/EventData/Data[@Name='ServiceName']");
+					detections += 2;
+					bMalicious = true;
+				}
 
-			auto cmd{ result.GetProperty(L"Event/EventData/Data[@Name='ImagePath']") };
-			std::pair<std::wstring, std::wstring> pair{ imageName, cmd };
+				// Look for PSExec services
+				else if(imageName.find(L"PSEXESVC") != std::wstring::npos){
+					reaction.EventIdentified(EventLogs::EventLogItemToDetection(result));
+					detections++;
+					bMalicious = true;
+				}
 
-			if(findings.count(pair)){
-				if(findings.at(pair)){
+				// Look for Mimikatz Driver loading
+				else if(imageName.find(L"mimikatz") != std::wstring::npos || imageName.find(L"mimidrv") != std::wstring::npos
+				   || imagePath.find(L"mimidrv.sys") != std::wstring::npos){
 					reaction.EventIdentified(EventLogs::EventLogItemToDetection(result));
+					reaction.FileIdentified(std::make_shared<FILE_DETECTION>(file));
+					detections += 2;
+					bMalicious = true;
 				}
-			} else{
-				if(IsLolbinMalicious(cmd)){
+			} else if(level == Aggressiveness::Intensive){
+
+				// Calculate entropy of service names to look for suspicious services like 
+				// the ones MSF generates https://www.offensive-security.com/metasploit-unleashed/psexec-pass-hash/
+				if(!file.GetFileExists() || (GetShannonEntropy(imageName) < 3.00 || GetShannonEntropy(imageName) > 5.00)){
 					reaction.EventIdentified(EventLogs::EventLogItemToDetection(result));
-					findings.emplace(pair, true);
-					detections++;
-				} else{
-					auto imagePath = GetImagePathFromCommand(cmd);
-
-					FileSystem::File file = FileSystem::File(imagePath);
-					if(file.GetFileExists() && !file.GetFileSigned()){
-						reaction.EventIdentified(EventLogs::EventLogItemToDetection(result));
-
-						auto& yara = YaraScanner::GetInstance();
-						YaraScanResult result = yara.ScanFile(file);
-
-						reaction.FileIdentified(std::make_shared<FILE_DETECTION>(file));
-
-						detections += 2;
-						findings.emplace(pair, true);
-					}
-
-					// Look for PSExec services
-					else if(imageName.find(L"PSEXESVC") != std::wstring::npos){
-						reaction.EventIdentified(EventLogs::EventLogItemToDetection(result));
-						detections++;
-						findings.emplace(pair, true);
-					}
-
-					// Look for Mimikatz Driver loading
-					else if(imageName.find(L"mimikatz") != std::wstring::npos || imageName.find(L"mimidrv") != std::wstring::npos
-							|| imagePath.find(L"mimidrv.sys") != std::wstring::npos){
-						reaction.EventIdentified(EventLogs::EventLogItemToDetection(result));
-						reaction.FileIdentified(std::make_shared<FILE_DETECTION>(file));
-						detections += 2;
-						findings.emplace(pair, true);
-					}
-
-					// Calculate entropy of service names to look for suspicious services like 
-					// the ones MSF generates https://www.offensive-security.com/metasploit-unleashed/psexec-pass-hash/
-					else if(!file.GetFileExists() || (GetShannonEntropy(imageName) < 3.00 || GetShannonEntropy(imageName) > 5.00)){
-						reaction.EventIdentified(EventLogs::EventLogItemToDetection(result));
-						reaction.FileIdentified(std::make_shared<FILE_DETECTION>(file));
-						detections += 2;
-						findings.emplace(pair, true);
-					} else{
-						findings.emplace(pair, false);
-					}
+					reaction.FileIdentified(std::make_shared<FILE_DETECTION>(file));
+					detections += 2;
+					bMalicious = true;
 				}
 			}
+
+			findings.emplace(service, bMalicious);
+			results.RecordVerdict(service, bMalicious ? HuntState::Verdict::Suspicious : HuntState::Verdict::Clean);
 		}
 
-		reaction.EndHunt();
 		return detections;
+	}
 
+	int HuntT1050::ScanNormal(const Scope& scope, Reaction reaction) {
+		return RunLayers(GET_INFO(), scope, reaction);
+	}
+
+	int HuntT1050::ScanIntensive(const Scope& scope, Reaction reaction){
+		return RunLayers(GET_INFO(), scope, reaction);
 	}
 
 	std::vector<std::shared_ptr<Event>> HuntT1050::GetMonitoringEvents() {
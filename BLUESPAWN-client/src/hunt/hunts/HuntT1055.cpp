@@ -95,21 +95,16 @@ namespace Hunts{
 
 		int identified = 0;
 
-		DWORD processes[1024];
-		DWORD ProcessCount = 0;
-		ZeroMemory(processes, sizeof(processes));
-		auto success = EnumProcesses(processes, sizeof(processes), &ProcessCount);
-		if(success){
-			ProcessCount /= sizeof(DWORD);
-			for(int i = 0; i < ProcessCount; i++){
-				if(scope.ProcessIsInScope(processes[i])){
-					if(ScanProcess(processes[i], reaction)){
-						identified++;
-					}
+		auto artifacts{ GetArtifacts() };
+		for(auto pid : artifacts->GetProcesses()){
+			if(IsPastDeadline()){
+				break;
+			}
+			if(scope.ProcessIsInScope(pid)){
+				if(ScanProcess(pid, reaction)){
+					identified++;
 				}
 			}
-		} else {
-			LOG_ERROR("Unable to enumerate processes - Process related hunts will not run.");
 		}
 
 		reaction.EndHunt();
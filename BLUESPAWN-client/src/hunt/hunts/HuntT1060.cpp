@@ -1,5 +1,6 @@
 #include "hunt/hunts/HuntT1060.h"
 #include "hunt/RegistryHunt.h"
+#include "hunt/RegistryPlan.h"
 
 #include "util/log/Log.h"
 #include "util/configurations/Registry.h"
@@ -19,18 +20,22 @@ namespace Hunts {
 		dwSourcesInvolved = (DWORD) DataSource::Registry;
 		dwTacticsUsed = (DWORD) Tactic::Persistence;
 
-		auto HKLMRun = std::wstring{ L"Software\\Microsoft\\Windows\\CurrentVersion\\Run" };
-		auto HKLMRunServices = std::wstring{ L"Software\\Microsoft\\Windows\\CurrentVersion\\RunServices" };
-		auto HKLMRunOnce = std::wstring{ L"Software\\Microsoft\\Windows\\CurrentVersion\\RunOnce" };
-		auto HKLMRunServicesOnce = std::wstring{ L"Software\\Microsoft\\Windows\\CurrentVersion\\RunOnceServices" };
-		auto HKLMRunOnceEx = std::wstring{ L"Software\\Microsoft\\Windows\\CurrentVersion\\RunOnceEx" };
-		auto HKLMRunServicesOnceEx = std::wstring{ L"Software\\Microsoft\\Windows\\CurrentVersion\\RunOnceServicesEx" };
-		auto HKLMExplorerRun = std::wstring{ L"Software\\Microsoft\\Windows\\CurrentVersion\\Policies\\Explorer\\Run" };
-
-		RunKeys = {
-			HKLMRun, HKLMRunServices, HKLMRunOnce, HKLMRunServicesOnce, 
-			HKLMRunOnceEx, HKLMRunServicesOnceEx, HKLMExplorerRun,
-		};
+		RunKeys = ArtifactSnapshot::RunKeys;
+
+		for(auto value : { L"load", L"run" }){
+			vWindowsRules.emplace_back(AddRegistryRule({ HKEY_CURRENT_USER, L"Software\\Microsoft\\Windows NT\\CurrentVersion\\Windows",
+				{ value, L"", false, CheckSzEmpty }, RuleSeverity::High }));
+		}
+
+		dwBootExecuteRule = AddRegistryRule({ HKEY_LOCAL_MACHINE, L"SYSTEM\\CurrentControlSet\\Control\\Session Manager",
+			{ L"BootExecute", { L"autocheck autochk *" }, false, CheckMultiSzSubset }, RuleSeverity::High });
+
+		vStartupRules.emplace_back(AddRegistryRule({ HKEY_LOCAL_MACHINE, L"SOFTWARE\\Microsoft\\Command Processor",
+			{ L"AutoRun", L"", false, CheckSzEmpty } }));
+		vStartupRules.emplace_back(AddRegistryRule({ HKEY_LOCAL_MACHINE, L"SOFTWARE\\Microsoft\\Windows\\CurrentVersion\\Explorer\\User Shell Folders",
+			{ L"Startup", L"%USERPROFILE%\\AppData\\Roaming\\Microsoft\\Windows\\Start Menu\\Programs\\Startup", false, CheckSzEqual } }));
+		vStartupRules.emplace_back(AddRegistryRule({ HKEY_LOCAL_MACHINE, L"SOFTWARE\\Microsoft\\Windows\\CurrentVersion\\Explorer\\Shell Folders",
+			{ L"Common Startup", L"C:\\ProgramData\\Microsoft\\Windows\\Start Menu\\Programs\\Startup", false, CheckSzEqual } }));
 	}
 
 	int HuntT1060::EvaluateFile(const std::wstring& cmd, Reaction& reaction) {
@@ -43,7 +48,7 @@ namespace Hunts {
 			auto filepath = GetImagePathFromCommand(cmd);
 			auto image{ FileSystem::File(filepath) };
 
-			if(image.GetFileExists() && !image.GetFileSigned()){
+			if(image.GetFileExists() && FileNeedsEvaluation(image) && !IsFileSigned(image)){
 				auto& yara = YaraScanner::GetInstance();
 				YaraScanResult result{ yara.ScanFile(image) };
 
@@ -62,74 +67,47 @@ namespace Hunts {
 
 		int detections = 0;
 		
-		for(auto& key : RunKeys){
-			for (auto& detection : CheckKeyValues(HKEY_LOCAL_MACHINE, key)) {
-				if (EvaluateFile(std::get<std::wstring>(detection.data), reaction)) {
-					reaction.RegistryKeyIdentified(std::make_shared<REGISTRY_DETECTION>(detection));
-					detections++;
-				}
-			}
-			for (auto& sub : CheckSubkeys(HKEY_LOCAL_MACHINE, key)) {
-				for(auto& value : sub.EnumerateValues()){
-					auto type{ sub.GetValueType(value) };
-					if(type == RegistryType::REG_SZ_T || type == RegistryType::REG_EXPAND_SZ_T){
-						RegistryValue detection{ sub, value, *sub.GetValue<std::wstring>(value) };
-						if(EvaluateFile(std::get<std::wstring>(detection.data), reaction)){
-							reaction.RegistryKeyIdentified(std::make_shared<REGISTRY_DETECTION>(detection));
-							detections++;
-						}
-					}
-				}
-			}
-		}
-
-		for (auto& detection : CheckValues(HKEY_CURRENT_USER, L"Software\\Microsoft\\Windows NT\\CurrentVersion\\Windows", {
-			{ L"load", L"", false, CheckSzEmpty },
-			{ L"run", L"", false, CheckSzEmpty }
-		})) {
-			detections += EvaluateFile(std::get<std::wstring>(detection.data), reaction);
-			reaction.RegistryKeyIdentified(std::make_shared<REGISTRY_DETECTION>(detection));
-			detections++;
-		}
-
-		for(auto& detection : CheckValues(HKEY_LOCAL_MACHINE, L"SYSTEM\\CurrentControlSet\\Control\\Session Manager", {
-			{ L"BootExecute", { L"autocheck autochk *" }, false, CheckMultiSzSubset }
-		})) {
+		// When monitoring, the rules are only evaluated on the values whose change triggered the scan
+		auto artifacts{ GetArtifacts(scope) };
+		for(auto& detection : artifacts->GetAutoruns()){
+			if (scope.RegistryValueIsInScope(detection) && EvaluateFile(std::get<std::wstring>(detection.data), reaction)) {
 				reaction.RegistryKeyIdentified(std::make_shared<REGISTRY_DETECTION>(detection));
 				detections++;
+			}
 		}
 
-		for(auto& detection : CheckValues(HKEY_LOCAL_MACHINE, L"SOFTWARE\\Microsoft\\Command Processor", {
-			{ L"AutoRun", L"", false, CheckSzEmpty }
-		})){
-			if (EvaluateFile(std::get<std::wstring>(detection.data), reaction)) {
+		for(auto rule : vWindowsRules){
+			for(auto& detection : artifacts->GetRuleFindings(rule)){
+				if(!scope.RegistryValueIsInScope(detection)){
+					continue;
+				}
+				detections += EvaluateFile(std::get<std::wstring>(detection.data), reaction);
 				reaction.RegistryKeyIdentified(std::make_shared<REGISTRY_DETECTION>(detection));
 				detections++;
 			}
 		}
 
-		for(auto& detection : CheckValues(HKEY_LOCAL_MACHINE, L"SOFTWARE\\Microsoft\\Windows\\CurrentVersion\\Explorer\\User Shell Folders", {
-			{ L"Startup", L"%USERPROFILE%\\AppData\\Roaming\\Microsoft\\Windows\\Start Menu\\Programs\\Startup", false, CheckSzEqual }
-		})){
-			if (EvaluateFile(std::get<std::wstring>(detection.data), reaction)) {
-				reaction.RegistryKeyIdentified(std::make_shared<REGISTRY_DETECTION>(detection));
-				detections++;
+		for(auto& detection : artifacts->GetRuleFindings(dwBootExecuteRule)){
+			if(!scope.RegistryValueIsInScope(detection)){
+				continue;
 			}
+			reaction.RegistryKeyIdentified(std::make_shared<REGISTRY_DETECTION>(detection));
+			detections++;
 		}
 
-		for(auto& detection : CheckValues(HKEY_LOCAL_MACHINE, L"SOFTWARE\\Microsoft\\Windows\\CurrentVersion\\Explorer\\Shell Folders", {
-			{ L"Common Startup", L"C:\\ProgramData\\Microsoft\\Windows\\Start Menu\\Programs\\Startup", false, CheckSzEqual }
-		})){
-			if (EvaluateFile(std::get<std::wstring>(detection.data), reaction)) {
-				reaction.RegistryKeyIdentified(std::make_shared<REGISTRY_DETECTION>(detection));
-				detections++;
+		for(auto rule : vStartupRules){
+			for(auto& detection : artifacts->GetRuleFindings(rule)){
+				if (scope.RegistryValueIsInScope(detection) && EvaluateFile(std::get<std::wstring>(detection.data), reaction)) {
+					reaction.RegistryKeyIdentified(std::make_shared<REGISTRY_DETECTION>(detection));
+					detections++;
+				}
 			}
 		}
 
 		// rover.dll http://www.hexacorn.com/blog/2014/05/21/beyond-good-ol-run-key-part-12/
 		RegistryKey roverkey = RegistryKey{ HKEY_CLASSES_ROOT, L"CLSID\\{16d12736-7a9e-4765-bec6-f301d679caaa}" };
 		FileSystem::File rover = FileSystem::File(L"C:\\windows\\system32\\rover.dll");
-		if (roverkey.Exists() && rover.GetFileExists()) {
+		if (scope.RegistryKeyIsInScope(roverkey) && roverkey.Exists() && rover.GetFileExists()) {
 			reaction.RegistryKeyIdentified(std::make_shared<REGISTRY_DETECTION>(RegistryValue{ roverkey, L"", L"" }));
 			reaction.FileIdentified(std::make_shared<FILE_DETECTION>(rover));
 			detections += 2;
@@ -3,8 +3,7 @@
 #include "util/log/Log.h"
 #include "util/configurations/Registry.h"
 #include "util/filesystem/FileSystem.h"
-
-#include <regex>
+#include "util/patterns/Pattern.h"
 
 using namespace Registry;
 
@@ -17,18 +16,20 @@ namespace Hunts {
 		dwTacticsUsed = (DWORD) Tactic::PrivilegeEscalation;
 	}
 
-	int HuntT1068::HuntCVE20201048(Reaction reaction) {
+	int HuntT1068::HuntCVE20201048(const Scope& scope, Reaction reaction) {
 		int detections = 0;
 
+		// Ensures the file is an actual drive and not, say, a COM port
+		static const auto drivePath{ Patterns::PatternRegistry::GetInstance().Compile(L"([a-zA-z]{1}:\\\\)(.*)") };
+
 		auto ports = RegistryKey{ HKEY_LOCAL_MACHINE, L"SOFTWARE\\Microsoft\\Windows NT\\CurrentVersion\\Ports", true };
 		auto printers = RegistryKey{ HKEY_LOCAL_MACHINE, L"SOFTWARE\\Microsoft\\Windows NT\\CurrentVersion\\Print\\Printers", true };
 
 		for (auto printer : printers.EnumerateSubkeys()) {
-			if (printer.ValueExists(L"Port")) {
+			if (scope.RegistryKeyIsInScope(printer) && printer.ValueExists(L"Port")) {
 				auto filepath = FileSystem::File{ printer.GetValue<std::wstring>(L"Port").value() };
 
-				// Regex ensures the file is an actual drive and not, say, a COM port
-				if (std::regex_match(filepath.GetFilePath(), std::wregex(L"([a-zA-z]{1}:\\\\)(.*)")) && filepath.GetFileExists() && filepath.HasReadAccess()) {
+				if (drivePath->Matches(filepath.GetFilePath()) && filepath.GetFileExists() && filepath.HasReadAccess()) {
 					reaction.RegistryKeyIdentified(std::make_shared<REGISTRY_DETECTION>(RegistryValue{ printer, L"Port", printer.GetValue<std::wstring>(L"Port").value() }));
 					reaction.FileIdentified(std::make_shared<FILE_DETECTION>(filepath));
 					detections += 2;
@@ -37,10 +38,13 @@ namespace Hunts {
 		}
 
 		for (auto value : ports.EnumerateValues()) {
+			if (!scope.RegistryValueIsInScope(RegistryValue{ ports, value, std::wstring{} })) {
+				continue;
+			}
+
 			auto filepath = FileSystem::File{ value };
 
-			// Regex ensures the file is an actual drive and not, say, a COM port
-			if (std::regex_match(filepath.GetFilePath(), std::wregex(L"([a-zA-z]{1}:\\\\)(.*)")) && filepath.GetFileExists() && filepath.HasReadAccess()) {
+			if (drivePath->Matches(filepath.GetFilePath()) && filepath.GetFileExists() && filepath.HasReadAccess()) {
 				reaction.RegistryKeyIdentified(std::make_shared<REGISTRY_DETECTION>(RegistryValue{ ports, value, ports.GetValue<std::wstring>(value).value() }));
 				reaction.FileIdentified(std::make_shared<FILE_DETECTION>(filepath));
 				detections += 2;
@@ -56,7 +60,7 @@ namespace Hunts {
 
 		int detections = 0;
 
-		detections += HuntCVE20201048(reaction);
+		detections += HuntCVE20201048(scope, reaction);
 
 		reaction.EndHunt();
 		return detections;
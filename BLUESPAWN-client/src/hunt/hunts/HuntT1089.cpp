@@ -28,9 +28,13 @@ namespace Hunts {
 		for (auto key : { DomainProfile, StandardProfile, PublicProfile }) {
 			auto allowedapps = RegistryKey{ key, L"AuthorizedApplications\\List" };
 			if (allowedapps.Exists()) {
-				for (auto ProgramException : allowedapps.EnumerateValues()) {
-					reaction.RegistryKeyIdentified(std::make_shared<REGISTRY_DETECTION>(RegistryValue{ allowedapps, ProgramException, allowedapps.GetValue<std::wstring>(ProgramException).value() }));
-					auto program = FileSystem::File{ ProgramException };
+				for (auto& ProgramException : allowedapps.GetValues()) {
+					if (!scope.RegistryValueIsInScope(ProgramException)) {
+						continue;
+					}
+
+					reaction.RegistryKeyIdentified(std::make_shared<REGISTRY_DETECTION>(ProgramException));
+					auto program = FileSystem::File{ ProgramException.wValueName };
 					if (!program.GetFileSigned()) {
 						reaction.FileIdentified(std::make_shared<FILE_DETECTION>(program));
 					}
@@ -39,8 +43,12 @@ namespace Hunts {
 
 			auto ports = RegistryKey{ key, L"GloballyOpenPorts\\List" };
 			if (ports.Exists()) {
-				for (auto PortsException : ports.EnumerateValues()) {
-					reaction.RegistryKeyIdentified(std::make_shared<REGISTRY_DETECTION>(RegistryValue{ ports, PortsException, ports.GetValue<std::wstring>(PortsException).value() }));
+				for (auto& PortsException : ports.GetValues()) {
+					if (!scope.RegistryValueIsInScope(PortsException)) {
+						continue;
+					}
+
+					reaction.RegistryKeyIdentified(std::make_shared<REGISTRY_DETECTION>(PortsException));
 				}
 			}
 		}
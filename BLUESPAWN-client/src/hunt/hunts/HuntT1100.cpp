@@ -2,6 +2,7 @@
 
 #include "util/filesystem/FileSystem.h"
 #include "util/filesystem/YaraScanner.h"
+#include "util/pipeline/Pipeline.h"
 #include "util/log/Log.h"
 
 #include "common/StringUtils.h"
@@ -38,17 +39,34 @@ namespace Hunts {
 		web_exts.emplace_back(sFileExtension);
 	}
 
-	int HuntT1100::AnalyzeDirectoryFiles(std::wstring path, Reaction reaction, Aggressiveness level) {
+	int HuntT1100::AnalyzeDirectoryFiles(std::wstring path, const Scope& scope, Reaction reaction, Aggressiveness level) {
 		int identified = 0;
 
-		auto f = FileSystem::Folder(path);
 		FileSystem::FileSearchAttribs attribs;
 		attribs.extensions = web_exts;
-		std::vector<FileSystem::File> files = f.GetFiles(attribs, -1);
+
+		// Walk the directory on another thread so that reading and scanning files overlaps with the walk
+		Pipeline<std::wstring> files{ [&](const Pipeline<std::wstring>::Emitter& emit) {
+			FileSystem::Folder(path).EnumerateFiles([&](const std::wstring& file) {
+				return !scope.FileIsInScope(file) || emit(file);
+			}, attribs, -1, [&scope](const std::wstring& folder) {
+				return scope.FolderIsInScope(folder);
+			});
+		} };
 		
 		auto& yara = YaraScanner::GetInstance();
+		std::wstring context = level == Aggressiveness::Cursory ? L"Cursory" : L"Normal";
+
+		while (auto filePath = files.Next()) {
+			if (IsPastDeadline()) {
+				break;
+			}
+
+			FileSystem::File entry{ *filePath };
+			if (!entry.GetFileExists() || !scope.FileIsInScope(entry) || !FileNeedsEvaluation(entry, context)) {
+				continue;
+			}
 
-		for (const auto& entry : files) {
 			int k = identified;
 
 			long offset = 0;
@@ -92,6 +110,13 @@ namespace Hunts {
 					reaction.FileIdentified(std::make_shared<FILE_DETECTION>(entry));
 				}
 			}
+
+			RecordFileVerdict(entry, k == identified ? HuntState::Verdict::Clean : HuntState::Verdict::Suspicious, context);
+		}
+
+		if (files.Failed()) {
+			LOG_ERROR(L"Walking " << path << L" failed partway through; some files in it were not checked");
+			MarkIncomplete();
 		}
 
 		return identified;
@@ -105,7 +130,9 @@ namespace Hunts {
 		int identified = 0;
 
 		for (std::wstring path : web_directories) {
-			identified += AnalyzeDirectoryFiles(path, reaction, Aggressiveness::Cursory);
+			if (scope.FolderIsInScope(path)) {
+				identified += AnalyzeDirectoryFiles(path, scope, reaction, Aggressiveness::Cursory);
+			}
 		}
 		reaction.EndHunt();
 		return identified;
@@ -119,7 +146,9 @@ namespace Hunts {
 		int identified = 0;
 
 		for (std::wstring path : web_directories) {
-			identified += AnalyzeDirectoryFiles(path, reaction, Aggressiveness::Normal);
+			if (scope.FolderIsInScope(path)) {
+				identified += AnalyzeDirectoryFiles(path, scope, reaction, Aggressiveness::Normal);
+			}
 		}		
 		reaction.EndHunt();
 		return identified;
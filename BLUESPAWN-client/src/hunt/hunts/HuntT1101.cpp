@@ -1,5 +1,6 @@
 #include "hunt/hunts/HuntT1101.h"
 #include "hunt/RegistryHunt.h"
+#include "hunt/RegistryPlan.h"
 
 #include "util/log/Log.h"
 #include "util/configurations/Registry.h"
@@ -14,6 +15,11 @@ namespace Hunts {
 		dwCategoriesAffected = (DWORD) Category::Configurations;
 		dwSourcesInvolved = (DWORD) DataSource::Registry;
 		dwTacticsUsed = (DWORD) Tactic::Persistence;
+
+		for (auto key : { L"SYSTEM\\CurrentControlSet\\Control\\Lsa", L"SYSTEM\\CurrentControlSet\\Control\\Lsa\\OSConfig" }) {
+			vPackageRules.emplace_back(AddRegistryRule({ HKEY_LOCAL_MACHINE, key,
+				{ L"Security Packages", std::vector<std::wstring>{}, false, CheckMultiSzEmpty }, RuleSeverity::High, false, false }));
+		}
 	}
 
 	int HuntT1101::ScanCursory(const Scope& scope, Reaction reaction){
@@ -22,29 +28,32 @@ namespace Hunts {
 
 		int detections = 0;
 
-		auto lsa = RegistryKey{ HKEY_LOCAL_MACHINE, L"SYSTEM\\CurrentControlSet\\Control\\Lsa" };
-		auto lsa2 = RegistryKey(HKEY_LOCAL_MACHINE, L"SYSTEM\\CurrentControlSet\\Control\\Lsa\\OSConfig");
+		auto artifacts{ GetArtifacts() };
+		// Every package is located and checked at once, and the results are then collected in order
+		std::vector<std::pair<RegistryValue, AsyncResult<std::optional<FileSystem::File>>>> lookups{};
+		for (auto rule : vPackageRules) {
+			for (auto& Packages : artifacts->GetRuleFindings(rule)) {
+				if (!scope.RegistryValueIsInScope(Packages)) {
+					continue;
+				}
 
-		for (auto key : { lsa, lsa2 }) {
-			auto Packages = key.GetValue<std::vector<std::wstring>>(L"Security Packages");
-			if (Packages) {
-				for (auto Package : Packages.value()) {
+				for (auto Package : std::get<std::vector<std::wstring>>(Packages.data)) {
 					if (Package != L"\"\"") {
-						auto filepath = FileSystem::SearchPathExecutable(Package + L".dll");
-
-						if (filepath) {
-							FileSystem::File file = FileSystem::File(filepath.value());
-							if (file.GetFileExists() && !file.GetFileSigned()) {
-								reaction.RegistryKeyIdentified(std::make_shared<REGISTRY_DETECTION>(RegistryValue{ key, L"Security Packages", key.GetValue<std::vector<std::wstring>>(L"Security Packages").value() }));
-								reaction.FileIdentified(std::make_shared<FILE_DETECTION>(file));
-								detections += 2;
-							}
-						}
+						lookups.emplace_back(Packages, FindUnsignedFileAsync(Package + L".dll"));
 					}
 				}
 			}
 		}
 
+		for (auto& lookup : lookups) {
+			auto& file = lookup.second.Get();
+			if (file) {
+				reaction.RegistryKeyIdentified(std::make_shared<REGISTRY_DETECTION>(lookup.first));
+				reaction.FileIdentified(std::make_shared<FILE_DETECTION>(*file));
+				detections += 2;
+			}
+		}
+
 		reaction.EndHunt();
 		return detections;
 	}
@@ -1,16 +1,23 @@
 #include "hunt/hunts/HuntT1122.h"
 #include "hunt/RegistryHunt.h"
+#include "hunt/FanOutPlanner.h"
+#include "hunt/Baseline.h"
 
 #include "util/configurations/Registry.h"
+#include "util/configurations/ComRegistrationIndex.h"
 #include "util/filesystem/Filesystem.h"
 #include "util/log/Log.h"
 #include "util/log/HuntLogMessage.h"
 #include "util/processes/ProcessUtils.h"
 #include "util/processes/CheckLolbin.h"
+#include "util/threadpool/IOExecutor.h"
 
 #include "common/Utils.h"
+#include "common/StringUtils.h"
 
 #include <algorithm>
+#include <map>
+#include <set>
 
 using namespace Registry;
 
@@ -23,83 +30,108 @@ namespace Hunts{
 		dwTacticsUsed = (DWORD) Tactic::Persistence | (DWORD) Tactic::DefenseEvasion;
 	}
 
-#define ADD_FILE(file, ...)                                             \
-	if(files.find(file) != files.end()){                                \
-	    files.at(file).emplace_back(__VA_ARGS__);                       \
-	} else {                                                            \
-		files.emplace(file, std::vector<RegistryValue>{ __VA_ARGS__ }); \
-	}
-
 	int HuntT1122::ScanIntensive(const Scope& scope, Reaction reaction){
 		LOG_INFO("Hunting for " << name << " at level Intensive");
 		reaction.BeginHunt(GET_INFO());
 
 		int detections = 0;
 
-		std::map<std::wstring, std::vector<RegistryValue>> files{};
+		// The index is only kept between runs when asked for; otherwise every class is read
+		ComRegistrationIndex index{};
+		auto path{ ComRegistrationIndex::GetPersistentPath() };
+		if(path){
+			index.Load(*path);
+		}
+		index.Update(FanOutPlanner::GetInstance().Resolve(HKEY_LOCAL_MACHINE, L"SOFTWARE\\Classes\\CLSID", true, true));
+		if(path){
+			index.Save();
+		}
 
-		for(auto key : CheckSubkeys(HKEY_LOCAL_MACHINE, L"SOFTWARE\\Classes\\CLSID", true, true)){
-			RegistryKey subkey{ key, L"InprocServer32" };
-			if(subkey.Exists() && subkey.ValueExists(L"")){
-				auto filename{ *subkey.GetValue<std::wstring>(L"") };
-				auto path{ FileSystem::SearchPathExecutable(filename) };
-				if(path){
-					ADD_FILE(*path, RegistryValue{ subkey, L"", std::move(filename) });
-				}
+		auto& baseline{ Baseline::GetInstance() };
+		// Registrations are opened beneath the CLSID key they were found under, since hives that aren't loaded
+		// can't be opened by path
+		auto MakeValue{ [](const ComRegistration& registration){
+			return RegistryValue{ registration.GetKey(), registration.wsValueName, std::wstring{ registration.wsServer } };
+		} };
+
+		// Each distinct server is resolved once, no matter how many classes register it. COM registrations in the
+		// baseline are skipped entirely.
+		std::map<std::pair<ComRegistration::Kind, std::wstring>, std::vector<const ComRegistration*>> servers{};
+		index.EnumerateRegistrations([&](const ComRegistration& registration, const FILETIME& written){
+			if(!scope.IsUnrestricted() && !scope.RegistryKeyIsInScope(registration.GetKey())){
+				return;
 			}
-			subkey = { key, L"InprocServer" };
-			if(subkey.Exists() && subkey.ValueExists(L"")){
-				auto filename{ *subkey.GetValue<std::wstring>(L"") };
-				auto path{ FileSystem::SearchPathExecutable(filename) };
-				if(path){
-					ADD_FILE(*path, RegistryValue{ subkey, L"", std::move(filename) });
-				}
+			if(baseline.IsEnabled() && baseline.Contains(MakeValue(registration))){
+				return;
 			}
-			if(key.ValueExists(L"InprocHandler32")){
-				auto filename{ *key.GetValue<std::wstring>(L"InprocHandler32") };
-				auto path{ FileSystem::SearchPathExecutable(filename) };
-				if(path){
-					ADD_FILE(*path, RegistryValue{ key, L"InprocHandler32", std::move(filename) });
+			servers[{ registration.kind, ToLowerCaseW(registration.wsServer) }].emplace_back(&registration);
+		});
+
+		std::vector<AsyncResult<std::optional<std::wstring>>> resolutions{};
+		for(auto& server : servers){
+			auto kind{ server.first.first };
+			auto command{ server.second[0]->wsServer };
+			resolutions.emplace_back(IOExecutor::GetInstance().Async<std::optional<std::wstring>>([kind, command]() -> std::optional<std::wstring> {
+				if(kind == ComRegistration::Kind::InProcess){
+					return FileSystem::SearchPathExecutable(command);
 				}
-			}
-			if(key.ValueExists(L"InprocHandler")){
-				auto filename{ *key.GetValue<std::wstring>(L"InprocHandler") };
-				auto path{ FileSystem::SearchPathExecutable(filename) };
-				if(path){
-					ADD_FILE(*path, RegistryValue{ key, L"InprocHandler", std::move(filename) });
+				if(FileSystem::CheckFileExists(command)){
+					return command;
 				}
-			}
-			if(key.ValueExists(L"LocalServer")){
-				auto filename{ *key.GetValue<std::wstring>(L"LocalServer") };
-				ADD_FILE(filename, RegistryValue{ key, L"LocalServer", *subkey.GetValue<std::wstring>(L"") });
-			}
-			subkey = { key, L"LocalServer32" };
-			if(subkey.Exists() && subkey.ValueExists(L"")){
-				auto filename{ *subkey.GetValue<std::wstring>(L"") };
-				ADD_FILE(filename, RegistryValue{ subkey, L"", *subkey.GetValue<std::wstring>(L"") });
-			}
-			if(subkey.Exists() && subkey.ValueExists(L"ServerExecutable")){
-				auto filename{ *subkey.GetValue<std::wstring>(L"ServerExecutable") };
-				ADD_FILE(filename, RegistryValue{ subkey, L"ServerExecutable", *subkey.GetValue<std::wstring>(L"") });
+				auto path{ GetImagePathFromCommand(command) };
+				return FileSystem::CheckFileExists(path) ? std::optional<std::wstring>{ path } : std::nullopt;
+			}));
+		}
+
+		// Each distinct file is then evaluated once, along with every command registering it
+		struct ServerFile {
+			std::vector<const ComRegistration*> registrations;
+			std::set<std::wstring> commands;
+		};
+		std::map<std::wstring, ServerFile> files{};
+		SIZE_T idx{ 0 };
+		for(auto& server : servers){
+			auto& path{ resolutions[idx++].Get() };
+			if(path){
+				auto& file{ files[ToLowerCaseW(*path)] };
+				file.registrations.insert(file.registrations.end(), server.second.begin(), server.second.end());
+				file.commands.emplace(server.first.first == ComRegistration::Kind::InProcess ? *path : server.second[0]->wsServer);
 			}
 		}
 
-		for(auto pair : files){
-			auto path{ pair.first };
-			if(!FileSystem::CheckFileExists(path)){
-				path = GetImagePathFromCommand(path);
-				if(!FileSystem::CheckFileExists(path)){
-					continue;
+		std::vector<std::pair<const ServerFile*, AsyncResult<std::optional<FileSystem::File>>>> checks{};
+		for(auto& entry : files){
+			auto path{ entry.first };
+			auto commands{ entry.second.commands };
+			checks.emplace_back(&entry.second, IOExecutor::GetInstance().Async<std::optional<FileSystem::File>>([this, path, commands]() -> std::optional<FileSystem::File> {
+				FileSystem::File file{ path };
+				if(!file.GetFileExists()){
+					return std::nullopt;
 				}
-			}
 
-			FileSystem::File file{ path };
-			if((!CompareIgnoreCaseW(file.GetFileAttribs().extension, L".dll") && IsLolbinMalicious(pair.first)) || !file.GetFileSigned()){
-				for(auto& value : pair.second){
-					reaction.RegistryKeyIdentified(std::make_shared<REGISTRY_DETECTION>(value));
+				if(!CompareIgnoreCaseW(file.GetFileAttribs().extension, L".dll")){
+					for(auto& command : commands){
+						if(IsLolbinMalicious(command)){
+							return file;
+						}
+					}
+				}
+				if(FileNeedsEvaluation(file) && !IsFileSigned(file)){
+					return file;
+				}
+				return std::nullopt;
+			}));
+		}
+
+		// Every check is waited on, even once past the deadline, since the checks refer to this hunt
+		for(auto& check : checks){
+			auto& file{ check.second.Get() };
+			if(file && !IsPastDeadline()){
+				for(auto registration : check.first->registrations){
+					reaction.RegistryKeyIdentified(std::make_shared<REGISTRY_DETECTION>(MakeValue(*registration)));
 					detections++;
 				}
-				reaction.FileIdentified(std::make_shared<FILE_DETECTION>(file));
+				reaction.FileIdentified(std::make_shared<FILE_DETECTION>(*file));
 				detections++;
 			}
 		}
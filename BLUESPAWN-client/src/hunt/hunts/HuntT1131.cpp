@@ -1,5 +1,6 @@
 #include "hunt/hunts/HuntT1131.h"
 #include "hunt/RegistryHunt.h"
+#include "hunt/RegistryPlan.h"
 
 #include "util/log/Log.h"
 #include "util/configurations/Registry.h"
@@ -15,6 +16,11 @@ namespace Hunts {
 		dwCategoriesAffected = (DWORD) Category::Configurations;
 		dwSourcesInvolved = (DWORD) DataSource::Registry;
 		dwTacticsUsed = (DWORD) Tactic::Persistence;
+
+		for (auto PackageGroup : { L"Authentication Packages", L"Notification Packages" }) {
+			vPackageRules.emplace_back(AddRegistryRule({ HKEY_LOCAL_MACHINE, L"SYSTEM\\CurrentControlSet\\Control\\Lsa",
+				{ PackageGroup, std::vector<std::wstring>{}, false, CheckMultiSzEmpty }, RuleSeverity::High, false, false }));
+		}
 	}
 
 	int HuntT1131::ScanCursory(const Scope& scope, Reaction reaction) {
@@ -23,24 +29,20 @@ namespace Hunts {
 
 		int detections = 0;
 
+		// Every package and extension is located and checked at once, and the results are then collected in order
+		std::vector<std::pair<RegistryValue, AsyncResult<std::optional<FileSystem::File>>>> lookups{};
+
 		// LSA Configuration
-		auto lsa = RegistryKey{ HKEY_LOCAL_MACHINE, L"SYSTEM\\CurrentControlSet\\Control\\Lsa" };
+		auto artifacts{ GetArtifacts() };
+		for (auto rule : vPackageRules) {
+			for (auto& Packages : artifacts->GetRuleFindings(rule)) {
+				if (!scope.RegistryValueIsInScope(Packages)) {
+					continue;
+				}
 
-		for (auto PackageGroup : { L"Authentication Packages", L"Notification Packages" }) {
-			auto Packages = lsa.GetValue<std::vector<std::wstring>>(PackageGroup);
-			if (Packages) {
-				for (auto Package : Packages.value()) {
+				for (auto Package : std::get<std::vector<std::wstring>>(Packages.data)) {
 					if (Package != L"\"\"") {
-						auto filepath = FileSystem::SearchPathExecutable(Package + L".dll");
-
-						if (filepath) {
-							FileSystem::File file = FileSystem::File(filepath.value());
-							if (file.GetFileExists() && !file.GetFileSigned()) {
-								reaction.RegistryKeyIdentified(std::make_shared<REGISTRY_DETECTION>(RegistryValue{ lsa, PackageGroup, lsa.GetValue<std::vector<std::wstring>>(PackageGroup).value() }));
-								reaction.FileIdentified(std::make_shared<FILE_DETECTION>(file));
-								detections += 2;
-							}
-						}
+						lookups.emplace_back(Packages, FindUnsignedFileAsync(Package + L".dll"));
 					}
 				}
 			}
@@ -53,38 +55,30 @@ namespace Hunts {
 			if (subkeyName == L"Interfaces") {
 				for (auto subkey : RegistryKey{ lsaext, L"Interfaces" }.EnumerateSubkeys()) {
 					auto ext = subkey.GetValue<std::wstring>(L"Extension");
-					if (ext) {
-						auto filepath = FileSystem::SearchPathExecutable(ext.value());
-						if (filepath) {
-							FileSystem::File file = FileSystem::File(filepath.value());
-							if (file.GetFileExists() && !file.GetFileSigned()) {
-								reaction.RegistryKeyIdentified(std::make_shared<REGISTRY_DETECTION>(RegistryValue{ subkey, L"Extension", subkey.GetValue<std::wstring>(L"Extension").value() }));
-								reaction.FileIdentified(std::make_shared<FILE_DETECTION>(file));
-								detections += 2;
-							}
-						}
+					if (ext && scope.RegistryKeyIsInScope(subkey)) {
+						lookups.emplace_back(RegistryValue{ subkey, L"Extension", std::wstring{ *ext } }, FindUnsignedFileAsync(*ext));
 					}
 				}
 			}
 			else {
 				auto subkey = RegistryKey{ lsaext, subkeyName };
 				auto exts = subkey.GetValue<std::vector<std::wstring>>(L"Extensions");
-				if (exts) {
+				if (exts && scope.RegistryKeyIsInScope(subkey)) {
 					for (auto ext : exts.value()) {
-						auto filepath = FileSystem::SearchPathExecutable(ext);
-						if (filepath) {
-							FileSystem::File file = FileSystem::File(filepath.value());
-							if (file.GetFileExists() && !file.GetFileSigned()) {
-								reaction.RegistryKeyIdentified(std::make_shared<REGISTRY_DETECTION>(RegistryValue{ subkey, L"Extensions", subkey.GetValue<std::wstring>(L"Extensions").value() }));
-								reaction.FileIdentified(std::make_shared<FILE_DETECTION>(file));
-								detections += 2;
-							}
-						}
+						lookups.emplace_back(RegistryValue{ subkey, L"Extensions", std::vector<std::wstring>(*exts) }, FindUnsignedFileAsync(ext));
 					}
 				}
 			}
 		}
 
+		for (auto& lookup : lookups) {
+			auto& file = lookup.second.Get();
+			if (file) {
+				reaction.RegistryKeyIdentified(std::make_shared<REGISTRY_DETECTION>(lookup.first));
+				reaction.FileIdentified(std::make_shared<FILE_DETECTION>(*file));
+				detections += 2;
+			}
+		}
 
 		reaction.EndHunt();
 		return detections;
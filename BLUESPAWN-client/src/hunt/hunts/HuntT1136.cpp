@@ -2,6 +2,7 @@
 #include "util/eventlogs/EventLogs.h"
 #include "util/log/Log.h"
 #include "util/log/HuntLogMessage.h"
+#include "util/pipeline/Pipeline.h"
 
 namespace Hunts {
 
@@ -25,12 +26,28 @@ namespace Hunts {
 		queries.push_back(EventLogs::XpathQuery(L"Event/EventData/Data", param1));
 		queries.push_back(EventLogs::XpathQuery(L"Event/EventData/Data", param2));
 
-		auto results = EventLogs::QueryEvents(L"Security", 4720, queries);
-		for (auto result : results)
-			reaction.EventIdentified(EventLogs::EventLogItemToDetection(result));
+		Pipeline<EventLogs::EventLogItem> results{ [&queries](const Pipeline<EventLogs::EventLogItem>::Emitter& emit) {
+			EventLogs::EnumerateEvents(L"Security", 4720, emit, queries);
+		} };
+
+		int detections = 0;
+		while (auto result = results.Next()) {
+			auto time{ result->GetTimeCreatedAsFileTime() };
+			if (!scope.UserIsInScope(result->GetProperty(L"Event/EventData/Data[@Name='TargetUserName']")) ||
+				(time && !scope.TimeIsInScope(*time))) {
+				continue;
+			}
+
+			reaction.EventIdentified(EventLogs::EventLogItemToDetection(*result));
+			detections++;
+		}
+		if (results.Failed()) {
+			LOG_ERROR("Reading account creation events failed partway through; some events were not checked");
+			MarkIncomplete();
+		}
 
 		reaction.EndHunt();
-		return results.size();
+		return detections;
 	}
 
 	std::vector<std::shared_ptr<Event>> HuntT1136::GetMonitoringEvents() {
@@ -1,10 +1,14 @@
 #include "hunt/hunts/HuntT1183.h"
 #include "hunt/RegistryHunt.h"
+#include "hunt/RegistryPlan.h"
 
 #include "util/log/Log.h"
 #include "util/configurations/Registry.h"
 
 #include "common/Utils.h"
+#include "common/StringUtils.h"
+
+#include <set>
 
 using namespace Registry;
 
@@ -14,25 +18,28 @@ namespace Hunts{
 		dwCategoriesAffected = (DWORD) Category::Configurations;
 		dwSourcesInvolved = (DWORD) DataSource::Registry;
 		dwTacticsUsed = (DWORD) Tactic::Persistence | (DWORD) Tactic::PrivilegeEscalation;
+
+		dwDebuggerRule = AddRegistryRule({ HKEY_LOCAL_MACHINE, L"SOFTWARE\\Microsoft\\Windows NT\\CurrentVersion\\Image File Execution Options\\*",
+			{ L"Debugger", L"", false, CheckSzEmpty }, RuleSeverity::High });
+		dwGlobalFlagRule = AddRegistryRule({ HKEY_LOCAL_MACHINE, L"SOFTWARE\\Microsoft\\Windows NT\\CurrentVersion\\Image File Execution Options\\*",
+			{ L"GlobalFlag", 0, false, [](DWORD d1, DWORD d2){ return !(d1 & 0x200); } } });
 	}
 
 	int HuntT1183::ScanCursory(const Scope& scope, Reaction reaction){
 		LOG_INFO(L"Hunting for " << name << L" at level Cursory");
 		reaction.BeginHunt(GET_INFO());
 
-		std::vector<RegistryValue> values;
+		auto artifacts{ GetArtifacts() };
+		std::vector<RegistryValue> values{ artifacts->GetRuleFindings(dwDebuggerRule) };
 
-		auto IFEO = RegistryKey{ HKEY_LOCAL_MACHINE, L"SOFTWARE\\Microsoft\\Windows NT\\CurrentVersion\\Image File Execution Options" };
-		for(auto subkey : IFEO.EnumerateSubkeys()){
-			auto name = subkey.GetName();
-			name = name.substr(name.find_last_of(L"\\") + 1);
-			ADD_ALL_VECTOR(values, CheckValues(HKEY_LOCAL_MACHINE, L"SOFTWARE\\Microsoft\\Windows NT\\CurrentVersion\\Image File Execution Options\\" + name, {
-				{ L"Debugger", L"", false, CheckSzEmpty },
-				{ L"GlobalFlag", 0, false, [](DWORD d1, DWORD d2){ return !(d1 & 0x200); } },
-			}));
+		// Processes with FLG_MONITOR_SILENT_PROCESS_EXIT set in their GlobalFlag are checked for silent process exit hooks
+		std::set<std::wstring> names{};
+		for(auto& value : artifacts->GetRuleFindings(dwGlobalFlagRule)){
+			values.emplace_back(value);
 
-			auto GFlags = subkey.GetValue<DWORD>(L"GlobalFlag");
-			if(GFlags && *GFlags & 0x200){
+			auto name = value.key.GetName();
+			name = name.substr(name.find_last_of(L"\\") + 1);
+			if(names.emplace(ToLowerCaseW(name)).second){
 				ADD_ALL_VECTOR(values, CheckValues(HKEY_LOCAL_MACHINE, L"SOFTWARE\\Microsoft\\Windows NT\\CurrentVersion\\SilentProcessExit\\" + name, {
 					{ L"ReportingMode", 0, false, CheckDwordEqual },
 					{ L"MonitorProcess", L"", false, CheckSzEmpty },
@@ -42,6 +49,10 @@ namespace Hunts{
 
 		int detections = 0;
 		for(const auto& value : values){
+			if(!scope.RegistryValueIsInScope(value)){
+				continue;
+			}
+
 			reaction.RegistryKeyIdentified(std::make_shared<REGISTRY_DETECTION>(value));
 			detections++;
 		}
@@ -84,6 +84,10 @@ namespace Hunts{
 
 					for(auto GUID : SIPType.EnumerateSubkeyNames()){
 						RegistryKey GUIDInfo{ SIPType, GUID };
+						if(!scope.RegistryKeyIsInScope(GUIDInfo)){
+							continue;
+						}
+
 						auto dll{ GUIDInfo.GetValue<std::wstring>(L"Dll") };
 						auto func{ GUIDInfo.GetValue<std::wstring>(L"FuncName") };
 						GUID = GUID.substr(1, GUID.length() - 2);
@@ -142,6 +146,10 @@ namespace Hunts{
 
 					for(auto& GUID : ProviderType.EnumerateSubkeyNames()){
 						RegistryKey GUIDInfo{ ProviderType, GUID };
+						if(!scope.RegistryKeyIsInScope(GUIDInfo)){
+							continue;
+						}
+
 						auto dll{ GUIDInfo.GetValue<std::wstring>(L"$DLL") };
 						auto func{ GUIDInfo.GetValue<std::wstring>(L"$Function") };
 						GUID = GUID.substr(1, GUID.length() - 2);
@@ -229,19 +237,22 @@ namespace Hunts{
 					auto check{ keys.front() };
 					keys.pop();
 
-					for(auto val : check.EnumerateValues()){
-						auto type{ check.GetValueType(val) };
-						if(type == RegistryType::REG_SZ_T || type == RegistryType::REG_EXPAND_SZ_T){
-							auto path{ FileSystem::SearchPathExecutable(*check.GetValue<std::wstring>(val)) };
+					for(auto& value : check.GetValues()){
+						if(!scope.RegistryValueIsInScope(value)){
+							continue;
+						}
+
+						if(value.type == RegistryType::REG_SZ_T || value.type == RegistryType::REG_EXPAND_SZ_T){
+							auto path{ FileSystem::SearchPathExecutable(std::get<std::wstring>(value.data)) };
 							if(path){
 								auto file{ FileSystem::File(*path) };
 								if(!file.IsMicrosoftSigned()){
 									reaction.FileIdentified(std::make_shared<FILE_DETECTION>(file));
-									reaction.RegistryKeyIdentified(std::make_shared<REGISTRY_DETECTION>(RegistryValue{ check, val, *check.GetValue<std::wstring>(val) }));
+									reaction.RegistryKeyIdentified(std::make_shared<REGISTRY_DETECTION>(value));
 									detections += 2;
 								}
-							} else if(ToLowerCaseW(val).find(L"dll") != std::wstring::npos){
-								reaction.RegistryKeyIdentified(std::make_shared<REGISTRY_DETECTION>(RegistryValue{ check, val, *check.GetValue<std::wstring>(val) }));
+							} else if(ToLowerCaseW(value.wValueName).find(L"dll") != std::wstring::npos){
+								reaction.RegistryKeyIdentified(std::make_shared<REGISTRY_DETECTION>(value));
 								detections++;
 							}
 						}
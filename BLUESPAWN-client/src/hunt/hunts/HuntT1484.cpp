@@ -18,10 +18,10 @@ namespace Hunts {
 
 		int detections = 0;
 
-		auto userFolders = FileSystem::Folder(L"C:\\Users").GetSubdirectories(1);
-		for (auto userFolder : userFolders) {
-			auto ntuserman = FileSystem::File(userFolder.GetFolderPath() + L"\\ntuser.man");
-			if (ntuserman.GetFileExists()) {
+		auto artifacts{ GetArtifacts() };
+		for (auto& profile : artifacts->GetUserProfiles()) {
+			auto ntuserman = FileSystem::File(profile + L"\\ntuser.man");
+			if (ntuserman.GetFileExists() && scope.FileIsInScope(ntuserman)) {
 				detections++;
 				reaction.FileIdentified(std::make_shared<FILE_DETECTION>(ntuserman));
 			}
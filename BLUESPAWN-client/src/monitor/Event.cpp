@@ -3,6 +3,8 @@
 #include "util/eventlogs/EventLogs.h"
 #include "monitor/EventListener.h"
 #include "user/bluespawn.h"
+#include "common/StringUtils.h"
+#include "common/Utils.h"
 
 Event::Event(EventType type) : type(type) {}
 
@@ -20,6 +22,14 @@ void RunCallback(const HuntEnd& callback){
 	}
 }
 
+void RunChangeCallback(const Registry::RegistryChangeCallback& callback, const std::vector<Registry::RegistryValueChange>& changes){
+	__try{
+		callback(changes);
+	} __except(EXCEPTION_EXECUTE_HANDLER){
+		Bluespawn::io.InformUser(wsCallbackExceptionMessage, ImportanceLevel::HIGH);
+	}
+}
+
 void Event::RunCallbacks() const {
 	for(auto& callback : callbacks){
 		RunCallback(callback);
@@ -68,12 +78,135 @@ RegistryEvent::RegistryEvent(const Registry::RegistryKey& key, bool WatchSubkeys
 	Event(EventType::Registry),
 	key{ key },
 	WatchSubkeys{ WatchSubkeys },
+	ftLastKeyWrite{},
 	hEvent{ CreateEventW(nullptr, false, false, nullptr) }{}
 
+RegistryEvent::Fingerprints RegistryEvent::TakeFingerprints(const Registry::RegistryKey& key, const std::wstring& wsSubkey){
+	Fingerprints fingerprints{};
+	key.EnumerateRawValues([&](const std::wstring& wsName, DWORD dwType, const BYTE* lpData, DWORD dwSize){
+		fingerprints.emplace(ToLowerCaseW(wsName), ValueFingerprint{ wsSubkey, wsName, HashData(lpData, dwSize, HashData(&dwType, sizeof(dwType))) });
+	});
+	return fingerprints;
+}
+
+std::optional<std::vector<Registry::RegistryValueChange>> RegistryEvent::FindChanges() const {
+	using Kind = Registry::RegistryValueChange::Kind;
+
+	// Subkeys are enumerated with their last write times, which change whenever their values do, so only the
+	// subkeys written since the last notification need to be fingerprinted again
+	std::unordered_map<std::wstring, std::pair<std::wstring, FILETIME>> subkeys{};
+	key.EnumerateSubkeyWriteTimes([&subkeys](const std::wstring& name, const FILETIME& written){
+		subkeys.emplace(ToLowerCaseW(name), std::make_pair(name, written));
+	});
+	auto values{ TakeFingerprints(key, L"") };
+	FILETIME ftKeyWritten{};
+	RegQueryInfoKeyW(key, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, &ftKeyWritten);
+
+	std::vector<Registry::RegistryValueChange> changes{};
+	auto Compare{ [&](const Fingerprints& current, const Fingerprints& previous){
+		auto AddChange{ [&](Kind kind, const ValueFingerprint& fingerprint){
+			changes.emplace_back(Registry::RegistryValueChange{ kind,
+				fingerprint.wsSubkey.length() ? Registry::RegistryKey{ key, fingerprint.wsSubkey } : key, fingerprint.wsName });
+		} };
+
+		for(auto& fingerprint : current){
+			auto found{ previous.find(fingerprint.first) };
+			if(found == previous.end()){
+				AddChange(Kind::Added, fingerprint.second);
+			} else if(found->second.qwHash != fingerprint.second.qwHash){
+				AddChange(Kind::Modified, fingerprint.second);
+			}
+		}
+		for(auto& fingerprint : previous){
+			if(!current.count(fingerprint.first)){
+				AddChange(Kind::Removed, fingerprint.second);
+			}
+		}
+	} };
+
+	auto lock{ BeginCriticalSection(hSection) };
+
+	// Subkey names can't be empty, so the values of the key itself are kept under an empty name
+	Compare(values, mFingerprints[L""]);
+	mFingerprints[L""] = std::move(values);
+
+	bool bSubkeysAdded{ false };
+	bool bSubkeysWritten{ false };
+	for(auto& subkey : subkeys){
+		auto previous{ mSubkeyWriteTimes.find(subkey.first) };
+		if(previous == mSubkeyWriteTimes.end()){
+			bSubkeysAdded = true;
+		} else if(!CompareFileTime(&previous->second, &subkey.second.second)){
+			continue;
+		}
+
+		bSubkeysWritten = true;
+		if(WatchSubkeys){
+			auto fingerprints{ TakeFingerprints(Registry::RegistryKey{ key, subkey.second.first }, subkey.second.first) };
+			Compare(fingerprints, mFingerprints[subkey.first]);
+			mFingerprints[subkey.first] = std::move(fingerprints);
+		}
+	}
+
+	bool bSubkeysRemoved{ false };
+	for(auto& subkey : mSubkeyWriteTimes){
+		if(!subkeys.count(subkey.first)){
+			bSubkeysRemoved = true;
+			if(WatchSubkeys){
+				Compare(Fingerprints{}, mFingerprints[subkey.first]);
+				mFingerprints.erase(subkey.first);
+			}
+		}
+	}
+
+	// Without watching subkeys, adding or removing a subkey can't be narrowed down to a set of values. While
+	// watching subkeys, a notification which changed neither the key nor any of its subkeys came from deeper in
+	// the tree than is fingerprinted. Otherwise, a notification that changed no values, such as one for a value
+	// rewritten with the data it already held, changed nothing relevant.
+	bool bKeyWritten{ CompareFileTime(&ftKeyWritten, &ftLastKeyWrite) != 0 };
+	bool bUnknown{ changes.empty() && (WatchSubkeys ? !bKeyWritten && !bSubkeysWritten && !bSubkeysRemoved : bSubkeysAdded || bSubkeysRemoved) };
+
+	mSubkeyWriteTimes.clear();
+	for(auto& subkey : subkeys){
+		mSubkeyWriteTimes.emplace(subkey.first, subkey.second.second);
+	}
+	ftLastKeyWrite = ftKeyWritten;
+
+	if(bUnknown){
+		return std::nullopt;
+	}
+	return changes;
+}
+
+void RegistryEvent::AddChangeCallback(const Registry::RegistryChangeCallback& callback){
+	changeCallbacks.emplace_back(callback);
+}
+
+void RegistryEvent::RunCallbacks() const {
+	auto changes{ FindChanges() };
+	if(!changes){
+		LOG_VERBOSE(1, L"Changes under " << key << L" couldn't be narrowed down to a set of values");
+		changes = std::vector<Registry::RegistryValueChange>{};
+	} else if(changes->empty()){
+		LOG_VERBOSE(2, L"No values changed under " << key << L"; skipping callbacks");
+		return;
+	} else {
+		LOG_VERBOSE(1, changes->size() << L" values changed under " << key);
+	}
+
+	for(auto& callback : changeCallbacks){
+		RunChangeCallback(callback, *changes);
+	}
+	Event::RunCallbacks();
+}
+
 bool RegistryEvent::Subscribe(){
 	LOG_VERBOSE(1, L"Subscribing to Registry Key " << key.ToString());
 	auto& manager{ EventListener::GetInstance() };
 
+	// The values are fingerprinted before the notification is armed, so that no change goes unnoticed
+	FindChanges();
+
 	auto keypath{ key.GetName() };
 	auto status{ RegNotifyChangeKeyValue(key, WatchSubkeys, REG_NOTIFY_CHANGE_NAME | REG_NOTIFY_CHANGE_LAST_SET | REG_NOTIFY_THREAD_AGNOSTIC, hEvent, true) };
 	if(ERROR_SUCCESS != status){
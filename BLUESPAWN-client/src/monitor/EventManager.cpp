@@ -27,5 +27,23 @@ DWORD EventManager::SubscribeToEvent(const std::shared_ptr<Event>& e, const std:
 
 	vEventList.push_back(evt);
 
+	return status;
+}
+
+DWORD EventManager::SubscribeToRegistryChanges(const std::shared_ptr<RegistryEvent>& e, const Registry::RegistryChangeCallback& callback){
+	DWORD status = ERROR_SUCCESS;
+
+	for(auto evt : vEventList){
+		if(*evt == *e){
+			std::static_pointer_cast<RegistryEvent>(evt)->AddChangeCallback(callback);
+			return status;
+		}
+	}
+
+	e->AddChangeCallback(callback);
+	e->Subscribe();
+
+	vEventList.push_back(e);
+
 	return status;
 }
\ No newline at end of file
@@ -6,48 +6,66 @@
 #include "util/log/HuntLogMessage.h"
 
 namespace Reactions {
-	void LogReaction::LogBeginHunt(const HuntInfo& info){
-		_HuntLogMessage = std::optional{ Log::HuntLogMessage{ info, Log::_LogHuntSinks } };
-		HuntBegun = true;
+	Log::HuntLogMessage* LogReaction::HuntLogState::GetCurrentMessage(){
+		auto lock{ BeginCriticalSection(hSection) };
+		auto entry{ mMessages.find(GetCurrentThreadId()) };
+		return entry == mMessages.end() ? nullptr : &entry->second;
 	}
-	void LogReaction::LogEndHunt(){
-		*_HuntLogMessage << Log::endlog;
-		_HuntLogMessage = std::nullopt;
-		HuntBegun = false;
+
+	void LogReaction::HuntLogState::LogBeginHunt(const HuntInfo& info){
+		auto lock{ BeginCriticalSection(hSection) };
+
+		// A hunt that faulted on this thread may not have ended its log message
+		mMessages.erase(GetCurrentThreadId());
+		mMessages.emplace(GetCurrentThreadId(), Log::HuntLogMessage{ info, Log::_LogHuntSinks });
+	}
+	void LogReaction::HuntLogState::LogEndHunt(){
+		auto message{ GetCurrentMessage() };
+		if(message){
+			*message << Log::endlog;
+
+			auto lock{ BeginCriticalSection(hSection) };
+			mMessages.erase(GetCurrentThreadId());
+		}
 	}
-	void LogReaction::LogFileIdentified(std::shared_ptr<FILE_DETECTION> detection){
-		if(HuntBegun){
-			_HuntLogMessage->AddDetection(std::static_pointer_cast<DETECTION>(detection));
+	void LogReaction::HuntLogState::LogFileIdentified(std::shared_ptr<FILE_DETECTION> detection){
+		auto message{ GetCurrentMessage() };
+		if(message){
+			message->AddDetection(std::static_pointer_cast<DETECTION>(detection));
 		} else {
 			LOG_ERROR("Potentially malicious file " << detection->wsFilePath << " detected outside of a hunt!");
 		}
 	}
-	void LogReaction::LogRegistryKeyIdentified(std::shared_ptr<REGISTRY_DETECTION> detection){
-		if(HuntBegun){
-			_HuntLogMessage->AddDetection(std::static_pointer_cast<DETECTION>(detection));
+	void LogReaction::HuntLogState::LogRegistryKeyIdentified(std::shared_ptr<REGISTRY_DETECTION> detection){
+		auto message{ GetCurrentMessage() };
+		if(message){
+			message->AddDetection(std::static_pointer_cast<DETECTION>(detection));
 		} else {
 			LOG_ERROR(L"\tPotentially malicious registry key detected outside of a hunt - " << detection->value.key
 				<< L": " << detection->value.GetPrintableName() << L" with data " << detection->value);
 		}
 	}
-	void LogReaction::LogProcessIdentified(std::shared_ptr<PROCESS_DETECTION> detection){
-		if(HuntBegun){
-			_HuntLogMessage->AddDetection(std::static_pointer_cast<DETECTION>(detection));
+	void LogReaction::HuntLogState::LogProcessIdentified(std::shared_ptr<PROCESS_DETECTION> detection){
+		auto message{ GetCurrentMessage() };
+		if(message){
+			message->AddDetection(std::static_pointer_cast<DETECTION>(detection));
 		} else {
 			LOG_ERROR("Potentially malicious process " << detection->wsImagePath << " (PID " << detection->PID 
 				<< ") detected outside of a hunt!");
 		}
 	}
-	void LogReaction::LogServiceIdentified(std::shared_ptr<SERVICE_DETECTION> detection){
-		if(HuntBegun){
-			_HuntLogMessage->AddDetection(std::static_pointer_cast<DETECTION>(detection));
+	void LogReaction::HuntLogState::LogServiceIdentified(std::shared_ptr<SERVICE_DETECTION> detection){
+		auto message{ GetCurrentMessage() };
+		if(message){
+			message->AddDetection(std::static_pointer_cast<DETECTION>(detection));
 		} else {
 			LOG_ERROR("Potentially malicious service " << detection->wsServiceName << " detected outside of a hunt!");
 		}
 	}
-	void LogReaction::LogEventIdentified(std::shared_ptr<EVENT_DETECTION> detection) {
-		if (HuntBegun) {
-			_HuntLogMessage->AddDetection(std::static_pointer_cast<DETECTION>(detection));
+	void LogReaction::HuntLogState::LogEventIdentified(std::shared_ptr<EVENT_DETECTION> detection) {
+		auto message{ GetCurrentMessage() };
+		if(message){
+			message->AddDetection(std::static_pointer_cast<DETECTION>(detection));
 		}
 		else {
 			//LOG_ERROR("Potentially malicious service " << detection->wsServiceName << " detected outside of a hunt!");
@@ -55,13 +73,13 @@ namespace Reactions {
 	}
 
 	LogReaction::LogReaction() : 
-		_HuntLogMessage{ std::nullopt }{
-		vStartHuntProcs.emplace_back(   std::bind(&LogReaction::LogBeginHunt,             this, std::placeholders::_1));
-		vEndHuntProcs.emplace_back(     std::bind(&LogReaction::LogEndHunt,               this                       ));
-		vRegistryReactions.emplace_back(std::bind(&LogReaction::LogRegistryKeyIdentified, this, std::placeholders::_1));
-		vFileReactions.emplace_back(    std::bind(&LogReaction::LogFileIdentified,        this, std::placeholders::_1));
-		vProcessReactions.emplace_back( std::bind(&LogReaction::LogProcessIdentified,     this, std::placeholders::_1));
-		vServiceReactions.emplace_back( std::bind(&LogReaction::LogServiceIdentified,     this, std::placeholders::_1));
-		vEventReactions.emplace_back(	std::bind(&LogReaction::LogEventIdentified,		  this, std::placeholders::_1));
+		state{ std::make_shared<HuntLogState>() }{
+		vStartHuntProcs.emplace_back(   std::bind(&HuntLogState::LogBeginHunt,             state, std::placeholders::_1));
+		vEndHuntProcs.emplace_back(     std::bind(&HuntLogState::LogEndHunt,               state                       ));
+		vRegistryReactions.emplace_back(std::bind(&HuntLogState::LogRegistryKeyIdentified, state, std::placeholders::_1));
+		vFileReactions.emplace_back(    std::bind(&HuntLogState::LogFileIdentified,        state, std::placeholders::_1));
+		vProcessReactions.emplace_back( std::bind(&HuntLogState::LogProcessIdentified,     state, std::placeholders::_1));
+		vServiceReactions.emplace_back( std::bind(&HuntLogState::LogServiceIdentified,     state, std::placeholders::_1));
+		vEventReactions.emplace_back(	std::bind(&HuntLogState::LogEventIdentified,		   state, std::placeholders::_1));
 	}
 }
\ No newline at end of file
@@ -0,0 +1,135 @@
+#include "user/Agent.h"
+
+#include <shellapi.h>
+
+#include <chrono>
+
+#include "util/log/Log.h"
+#include "common/StringUtils.h"
+#include "common/wrappers.hpp"
+
+#pragma comment(lib, "Shell32.lib")
+
+namespace {
+	/// The largest job the agent accepts
+	const DWORD MAX_JOB_SIZE{ 0x10000 };
+
+	const std::string SHUTDOWN_JOB{ "shutdown" };
+
+	/// The number of consecutive failures to accept a connection after which the agent stops, and the delay
+	/// before retrying after the first failure, which doubles with each failure after it
+	const DWORD MAX_CONNECT_FAILURES{ 5 };
+	const DWORD CONNECT_RETRY_DELAY{ 1000 };
+
+	/// Sends a single message to a connected client
+	bool WriteMessage(HANDLE hPipe, const std::wstring& message){
+		auto buffer{ WidestringToString(message) };
+		DWORD dwBytesWritten{ 0 };
+		return WriteFile(hPipe, buffer.c_str(), static_cast<DWORD>(buffer.length()), &dwBytesWritten, nullptr) && FlushFileBuffers(hPipe);
+	}
+}
+
+const std::wstring Agent::DefaultPipeName{ L"\\\\.\\pipe\\BLUESPAWN" };
+
+Agent::Agent(const std::wstring& wsPipeName) :
+	wsPipeName{ wsPipeName },
+	dwJobsServed{ 0 }{}
+
+std::optional<std::string> Agent::ReadMessage(HANDLE hPipe) const {
+	std::string message{};
+	std::vector<CHAR> buffer(4096);
+	while(true){
+		DWORD dwBytesRead{ 0 };
+		auto bComplete{ ReadFile(hPipe, buffer.data(), static_cast<DWORD>(buffer.size()), &dwBytesRead, nullptr) };
+		if(!bComplete && GetLastError() != ERROR_MORE_DATA){
+			LOG_ERROR(L"Unable to read a job from " << wsPipeName << L" (Error " << GetLastError() << L")");
+			return std::nullopt;
+		}
+
+		message.append(buffer.data(), dwBytesRead);
+		if(message.length() > MAX_JOB_SIZE){
+			LOG_ERROR(L"Rejecting a job larger than " << MAX_JOB_SIZE << L" bytes");
+			return std::nullopt;
+		}
+		if(bComplete){
+			return message;
+		}
+	}
+}
+
+bool Agent::Serve(const JobHandler& handler){
+	LOG_INFO(L"Serving jobs on " << wsPipeName);
+
+	// Only the first instance may create the pipe, so another process can't already be listening on it. The one
+	// instance the pipe allows is kept and reconnected for every job, so no other process can create one between jobs.
+	GenericWrapper<HANDLE> hPipe{ CreateNamedPipeW(wsPipeName.c_str(), PIPE_ACCESS_DUPLEX | FILE_FLAG_FIRST_PIPE_INSTANCE,
+		PIPE_TYPE_MESSAGE | PIPE_READMODE_MESSAGE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS, 1, MAX_JOB_SIZE, MAX_JOB_SIZE, 0, nullptr),
+		CloseHandle, INVALID_HANDLE_VALUE };
+	if(!hPipe){
+		LOG_ERROR(L"Unable to create pipe " << wsPipeName << L" (Error " << GetLastError() << L")");
+		return false;
+	}
+
+	DWORD dwConnectFailures{ 0 };
+	while(true){
+		if(!ConnectNamedPipe(hPipe, nullptr) && GetLastError() != ERROR_PIPE_CONNECTED){
+			auto dwError{ GetLastError() };
+			DisconnectNamedPipe(hPipe);
+			if(++dwConnectFailures >= MAX_CONNECT_FAILURES){
+				LOG_ERROR(L"Unable to accept a connection on " << wsPipeName << L" (Error " << dwError << L"); no longer serving jobs");
+				return false;
+			}
+
+			auto dwDelay{ CONNECT_RETRY_DELAY << (dwConnectFailures - 1) };
+			LOG_ERROR(L"Unable to accept a connection on " << wsPipeName << L" (Error " << dwError << L"); retrying in " << dwDelay << L" ms");
+			Sleep(dwDelay);
+			continue;
+		}
+		dwConnectFailures = 0;
+
+		auto job{ ReadMessage(hPipe) };
+		if(!job){
+			WriteMessage(hPipe, L"ERROR Unable to read the job");
+		} else if(*job == SHUTDOWN_JOB){
+			LOG_INFO(L"Shutting down after serving " << dwJobsServed << L" jobs");
+			WriteMessage(hPipe, L"OK");
+			DisconnectNamedPipe(hPipe);
+			return true;
+		} else {
+			LOG_INFO(L"Running job: " << StringToWidestring(*job));
+
+			auto start{ std::chrono::steady_clock::now() };
+			auto error{ handler(SplitJob(*job)) };
+			auto elapsed{ std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start) };
+			dwJobsServed++;
+
+			if(error.length()){
+				LOG_ERROR(L"Job failed: " << error);
+				WriteMessage(hPipe, L"ERROR " + error);
+			} else {
+				LOG_INFO(L"Job completed in " << elapsed.count() << L" ms");
+				WriteMessage(hPipe, L"OK " + std::to_wstring(elapsed.count()) + L" ms");
+			}
+		}
+
+		DisconnectNamedPipe(hPipe);
+	}
+}
+
+std::vector<std::string> Agent::SplitJob(const std::string& job){
+	// CommandLineToArgvW treats the first argument as the name of the program, which follows different quoting rules
+	auto wsCommandLine{ L"BLUESPAWN.exe " + StringToWidestring(job) };
+
+	int dwArgCount{ 0 };
+	GenericWrapper<LPWSTR*> lpArgs{ CommandLineToArgvW(wsCommandLine.c_str(), &dwArgCount),
+		[](LPWSTR* args){ LocalFree(args); }, nullptr };
+	if(!lpArgs){
+		return {};
+	}
+
+	std::vector<std::string> args{};
+	for(int idx = 1; idx < dwArgCount; idx++){
+		args.emplace_back(WidestringToString(lpArgs[idx]));
+	}
+	return args;
+}
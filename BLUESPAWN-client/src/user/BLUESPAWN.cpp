@@ -1,5 +1,6 @@
 #include "user/bluespawn.h"
 #include "user/CLI.h"
+#include "user/Agent.h"
 #include "util/log/HuntLogMessage.h"
 #include "util/log/DebugSink.h"
 #include "util/log/XMLSink.h"
@@ -12,6 +13,11 @@
 #include "reaction/DeleteFile.h"
 #include "reaction/QuarantineFile.h"
 #include "util/permissions/permissions.h"
+#include "util/configurations/RegistrySnapshot.h"
+#include "util/configurations/IocSweep.h"
+#include "util/configurations/ComRegistrationIndex.h"
+#include "util/filesystem/FileCache.h"
+#include "util/patterns/MultiPattern.h"
 
 #include "hunt/hunts/HuntT1004.h"
 #include "hunt/hunts/HuntT1013.h"
@@ -147,14 +153,13 @@ Bluespawn::Bluespawn(){
 	mitigationRecord.RegisterMitigation(std::make_shared<Mitigations::MitigateV73585>());
 }
 
-void Bluespawn::dispatch_hunt(Aggressiveness aHuntLevel, vector<string> vExcludedHunts, vector<string> vIncludedHunts) {
+void Bluespawn::dispatch_hunt(Aggressiveness aHuntLevel, vector<string> vExcludedHunts, vector<string> vIncludedHunts, const Scope& scope, DWORD dwWorkers, DWORD dwTimeBudget) {
 	Bluespawn::io.InformUser(L"Starting a Hunt");
 	DWORD tactics = UINT_MAX;
 	DWORD dataSources = UINT_MAX;
 	DWORD affectedThings = UINT_MAX;
-	Scope scope{};
 
-	huntRecord.RunHunts(tactics, dataSources, affectedThings, scope, aHuntLevel, reaction, vExcludedHunts, vIncludedHunts);
+	huntRecord.RunHunts(tactics, dataSources, affectedThings, scope, aHuntLevel, reaction, vExcludedHunts, vIncludedHunts, dwWorkers, dwTimeBudget);
 }
 
 void Bluespawn::dispatch_mitigations_analysis(MitigationMode mode, bool bForceEnforce) {
@@ -223,6 +228,277 @@ void Bluespawn::check_correct_arch() {
 	}
 }
 
+/**
+ * Runs the hunt, monitoring, or mitigation job described by a set of parsed options
+ *
+ * @param bluespawn The instance of BLUESPAWN running the job
+ * @param result The parsed options describing the job
+ *
+ * @return true if the options described a job; false if there was nothing to do
+ */
+bool run_job(Bluespawn& bluespawn, cxxopts::ParseResult& result) {
+	if (result.count("hunt") || result.count("monitor")) {
+		std::map<std::string, Reaction> reactions = {
+			{"log", Reactions::LogReaction{}},
+			{"remove-value", Reactions::RemoveValueReaction{ bluespawn.io }},
+			{"suspend", Reactions::SuspendProcessReaction{ bluespawn.io }},
+			{"carve-memory", Reactions::CarveProcessReaction{ bluespawn.io }},
+			{"delete-file", Reactions::DeleteFileReaction{ bluespawn.io }},
+			{"quarantine-file", Reactions::QuarantineFileReaction{ bluespawn.io}},
+		};
+
+		auto UserReactions = result["reaction"].as<std::string>();
+		std::set<std::string> reaction_set;
+		for(unsigned startIdx = 0; startIdx < UserReactions.size();){
+			auto endIdx = min(UserReactions.find(',', startIdx), UserReactions.size());
+			auto sink = UserReactions.substr(startIdx, endIdx - startIdx);
+			reaction_set.emplace(sink);
+			startIdx = endIdx + 1;
+		}
+
+		Reaction combined = {};
+		for(auto reaction : reaction_set){
+			if(reactions.find(reaction) != reactions.end()){
+				combined.Combine(reactions[reaction]);
+			} else {
+				bluespawn.io.AlertUser(L"Unknown reaction \"" + StringToWidestring(reaction) + L"\"", INFINITY, ImportanceLevel::MEDIUM);
+			}
+		}
+
+		bluespawn.SetReaction(combined);
+
+		// Parse the hunt level
+		std::string sHuntLevelFlag = "Normal";
+		Aggressiveness aHuntLevel;
+		try {
+			sHuntLevelFlag = result["level"].as < std::string >();
+		}
+		catch (int e) {}
+
+		if (CompareIgnoreCase<std::string>(sHuntLevelFlag, "Cursory")) {
+			aHuntLevel = Aggressiveness::Cursory;
+		}
+		else if (CompareIgnoreCase<std::string>(sHuntLevelFlag, "Normal")) {
+			aHuntLevel = Aggressiveness::Normal;
+		}
+		else if (CompareIgnoreCase<std::string>(sHuntLevelFlag, "Intensive")) {
+			aHuntLevel = Aggressiveness::Intensive;
+		}
+		else {
+			LOG_ERROR("Error " << sHuntLevelFlag << " - Unknown level. Please specify either Cursory, Normal, or Intensive");
+			LOG_ERROR("Will default to Cursory for this run.");
+			Bluespawn::io.InformUser(L"Error " + StringToWidestring(sHuntLevelFlag) + L" - Unknown level. Please specify either Cursory, Normal, or Intensive");
+			Bluespawn::io.InformUser(L"Will default to Cursory.");
+			aHuntLevel = Aggressiveness::Cursory;
+		}
+
+		//Parse included and excluded hunts
+		std::vector<std::string> vIncludedHunts;
+		std::vector<std::string> vExcludedHunts;
+
+		if (result.count("hunts")) {
+			vIncludedHunts = result["hunts"].as<std::vector<std::string>>();
+		}
+		else if (result.count("exclude-hunts")) {
+			vExcludedHunts = result["exclude-hunts"].as<std::vector<std::string>>();
+		}
+
+		DWORD dwWorkers = result["workers"].as<unsigned>();
+		DWORD dwTimeBudget = result["time-budget"].as<unsigned>();
+
+		// Parse the scope of the hunt
+		Scope scope{};
+		if (result.count("scope-paths")) {
+			for (auto& path : result["scope-paths"].as<std::vector<std::string>>()) {
+				scope.AddPath(StringToWidestring(path));
+			}
+		}
+		if (result.count("scope-keys")) {
+			for (auto& key : result["scope-keys"].as<std::vector<std::string>>()) {
+				scope.AddRegistryKey(StringToWidestring(key));
+			}
+		}
+		if (result.count("scope-pids")) {
+			for (auto pid : result["scope-pids"].as<std::vector<unsigned>>()) {
+				scope.AddProcess(pid);
+			}
+		}
+		if (result.count("scope-services")) {
+			for (auto& service : result["scope-services"].as<std::vector<std::string>>()) {
+				scope.AddService(StringToWidestring(service));
+			}
+		}
+		if (result.count("scope-users")) {
+			for (auto& user : result["scope-users"].as<std::vector<std::string>>()) {
+				scope.AddUser(StringToWidestring(user));
+			}
+		}
+		if (result.count("scope-hours")) {
+			FILETIME now{};
+			GetSystemTimeAsFileTime(&now);
+			ULARGE_INTEGER end{ now.dwLowDateTime, now.dwHighDateTime };
+			ULARGE_INTEGER start{};
+			start.QuadPart = end.QuadPart - result["scope-hours"].as<unsigned>() * 36000000000ULL;
+			scope.AddTimeWindow({ start.LowPart, start.HighPart }, now);
+		}
+
+		if (result.count("hunt") && result.count("incremental")) {
+			auto statePath = StringToWidestring(result["incremental"].as<std::string>());
+			HuntState::GetInstance().Load(statePath.length() ? statePath : HuntState::GetDefaultPath());
+		}
+
+		if (result.count("hunt") && result.count("file-cache")) {
+			auto cachePath = StringToWidestring(result["file-cache"].as<std::string>());
+			FileSystem::FileCache::GetInstance().Open(cachePath.length() ? cachePath : FileSystem::FileCache::GetDefaultPath());
+		}
+
+		if (result.count("hunt") && result.count("com-index")) {
+			auto indexPath = StringToWidestring(result["com-index"].as<std::string>());
+			Registry::ComRegistrationIndex::SetPersistentPath(indexPath.length() ? indexPath : Registry::ComRegistrationIndex::GetDefaultPath());
+		}
+
+		if (result.count("hunt") && result.count("capture-baseline")) {
+			Baseline::GetInstance().BeginCapture(StringToWidestring(result["capture-baseline"].as<std::string>()));
+		} else if (result.count("hunt") && result.count("baseline")) {
+			Baseline::GetInstance().Load(StringToWidestring(result["baseline"].as<std::string>()));
+		}
+
+		if (result.count("hunt")) {
+			bluespawn.dispatch_hunt(aHuntLevel, vExcludedHunts, vIncludedHunts, scope, dwWorkers, dwTimeBudget);
+			if (HuntState::GetInstance().IsEnabled()) {
+				HuntState::GetInstance().Save();
+			}
+			FileSystem::FileCache::GetInstance().Flush();
+			if (result.count("capture-baseline")) {
+				Baseline::GetInstance().Save();
+			}
+		}
+		else if (result.count("monitor"))
+			bluespawn.monitor_system(aHuntLevel);
+
+	}
+	else if (result.count("mitigate")) {
+		bool bForceEnforce = false;
+		if (result.count("force"))
+			bForceEnforce = true;
+
+		MitigationMode mode = MitigationMode::Audit;
+		if (result["mitigate"].as<std::string>() == "e" || result["mitigate"].as<std::string>() == "enforce")
+			mode = MitigationMode::Enforce;
+
+		bluespawn.dispatch_mitigations_analysis(mode, bForceEnforce);
+	}
+	else if (result.count("snapshot-registry")) {
+		Registry::RegistrySnapshot::Capture({ Registry::RegistryKey{ HKEY_LOCAL_MACHINE }, Registry::RegistryKey{ HKEY_USERS } },
+			StringToWidestring(result["snapshot-registry"].as<std::string>()));
+	}
+	else if (result.count("diff-registry")) {
+		auto paths = result["diff-registry"].as<std::vector<std::string>>();
+		if (paths.size() != 2) {
+			LOG_ERROR("--diff-registry takes two snapshots, the earlier followed by the later");
+			return true;
+		}
+
+		auto before = Registry::RegistrySnapshot::Load(StringToWidestring(paths[0]));
+		auto after = Registry::RegistrySnapshot::Load(StringToWidestring(paths[1]));
+		if (before && after) {
+			auto start = GetTickCount64();
+			auto differences = Registry::RegistrySnapshot::Diff(*before, *after);
+			LOG_INFO("Compared registry snapshots of " << before->GetKeyCount() << " and " << after->GetKeyCount() << " keys in "
+				<< GetTickCount64() - start << " ms");
+
+			for (auto& difference : differences) {
+				bluespawn.io.InformUser(difference.ToString());
+			}
+			bluespawn.io.InformUser(L"Found " + std::to_wstring(differences.size()) + L" differences between the registry snapshots");
+		}
+	}
+	else if (result.count("sweep-iocs")) {
+		auto iocs = Patterns::MultiPattern::LoadFromFile(StringToWidestring(result["sweep-iocs"].as<std::string>()));
+		if (!iocs) {
+			return true;
+		}
+
+		std::vector<Registry::IocMatch> matches{};
+		if (result.count("sweep-snapshot")) {
+			auto snapshot = Registry::RegistrySnapshot::Load(StringToWidestring(result["sweep-snapshot"].as<std::string>()));
+			if (!snapshot) {
+				return true;
+			}
+
+			std::optional<std::wstring> index = std::nullopt;
+			if (result.count("sweep-index")) {
+				index = StringToWidestring(result["sweep-index"].as<std::string>());
+			}
+			matches = Registry::SweepSnapshotForIocs(*snapshot, *iocs, index);
+		}
+		else if (result.count("sweep-hive")) {
+			auto hive = Registry::RegistryKey::OpenHiveFile(StringToWidestring(result["sweep-hive"].as<std::string>()));
+			if (!hive.Exists()) {
+				LOG_ERROR("Unable to open " << result["sweep-hive"].as<std::string>() << " as a registry hive");
+				return true;
+			}
+			matches = Registry::SweepForIocs({ hive }, *iocs);
+		}
+		else {
+			matches = Registry::SweepForIocs({ Registry::RegistryKey{ HKEY_LOCAL_MACHINE }, Registry::RegistryKey{ HKEY_USERS } }, *iocs);
+		}
+
+		for (auto& match : matches) {
+			bluespawn.io.InformUser(match.ToString());
+		}
+		bluespawn.io.InformUser(L"Found " + std::to_wstring(matches.size()) + L" indicators in registry values");
+	}
+	else {
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * Runs as an agent, serving hunt and mitigation jobs over a named pipe until asked to shut down
+ *
+ * @param bluespawn The instance of BLUESPAWN running the jobs
+ * @param options The options with which each job is parsed
+ * @param wsPipeName The name of the pipe to serve, or an empty string to use the default
+ */
+void serve_jobs(Bluespawn& bluespawn, cxxopts::Options& options, const std::wstring& wsPipeName) {
+	Agent agent{ wsPipeName.length() ? wsPipeName : Agent::DefaultPipeName };
+	agent.Serve([&](const std::vector<std::string>& args) -> std::wstring {
+		std::vector<char*> argv{ const_cast<char*>("BLUESPAWN.exe") };
+		for (auto& arg : args) {
+			argv.emplace_back(const_cast<char*>(arg.c_str()));
+		}
+		int argc = static_cast<int>(argv.size());
+		char** lpArgv = argv.data();
+
+		try {
+			auto job = options.parse(argc, lpArgv);
+			if (job.count("monitor") || job.count("agent")) {
+				return L"Monitoring and agent jobs can't be run by an agent";
+			}
+
+			// Incremental mode, baselines, and file caches only apply to the jobs that ask for them
+			HuntState::GetInstance().Disable();
+			Baseline::GetInstance().Disable();
+			Registry::ComRegistrationIndex::SetPersistentPath(std::nullopt);
+			FileSystem::FileCache::GetInstance().Reset();
+
+			if (!run_job(bluespawn, job)) {
+				return L"Nothing to do. Use the --hunt or --mitigate flags to run a job";
+			}
+			return {};
+		}
+		catch (cxxopts::OptionParseException e) {
+			return StringToWidestring(e.what());
+		}
+		catch (const std::exception& e) {
+			return L"The job raised an exception: " + StringToWidestring(e.what());
+		}
+	});
+}
+
 int main(int argc, char* argv[]){
 	Bluespawn bluespawn{};
 
@@ -241,12 +517,38 @@ int main(int argc, char* argv[]){
 		("reaction", "Specifies how bluespawn should react to potential threats dicovered during hunts.", cxxopts::value<std::string>()->default_value("log"))
 		("v,verbose", "Verbosity", cxxopts::value<int>()->default_value("0"))
 		("debug", "Enable Debug Output", cxxopts::value<bool>())
+		("snapshot-registry", "Write a snapshot of HKEY_LOCAL_MACHINE and HKEY_USERS to a file, for comparison with --diff-registry.", cxxopts::value<std::string>())
+		("diff-registry", "Compare two registry snapshots, given as the earlier followed by the later, and report every key and value added, removed, or changed.",
+			cxxopts::value<std::vector<std::string>>())
+		("sweep-iocs", "Search every string, multi-string, and binary value in the registry for the indicators listed one per line in a file.", cxxopts::value<std::string>())
+		("sweep-hive", "With --sweep-iocs, sweep a registry hive file such as an NTUSER.DAT instead of the registry.", cxxopts::value<std::string>())
+		("sweep-snapshot", "With --sweep-iocs, sweep a snapshot written by --snapshot-registry instead of the registry.", cxxopts::value<std::string>())
+		("sweep-index", "With --sweep-snapshot, use an n-gram index of the snapshot kept in this file, building it if it's missing or stale, so that repeated sweeps only search values which may match.",
+			cxxopts::value<std::string>())
+		("agent", "Run as an agent, serving hunt and mitigation jobs sent over a named pipe while keeping rules and caches warm between jobs. Optionally specifies the name of the pipe.",
+			cxxopts::value<std::string>()->implicit_value(""))
 		;
 
 	options.add_options("hunt")
 		("l,level", "Aggressiveness of Hunt. Either Cursory, Normal, or Intensive", cxxopts::value<std::string>())
 		("hunts", "List of hunts to run by Mitre ATT&CK name. Will only run these hunts.", cxxopts::value<std::vector<std::string>>())
 		("exclude-hunts", "List of hunts to avoid running by Mitre ATT&CK name. Will run all hunts but these.", cxxopts::value<std::vector<std::string>>())
+		("workers", "Number of hunts to run in parallel. Defaults to the number of logical processors.", cxxopts::value<unsigned>()->default_value("0"))
+		("incremental", "Skip artifacts found clean by a previous incremental hunt if neither they nor the rules have changed since. Optionally specifies the file in which to keep state between runs.", 
+			cxxopts::value<std::string>()->implicit_value(""))
+		("file-cache", "Keep the hashes, signature verdicts, and YARA verdicts of files in a file between runs, so that files unchanged since a previous hunt aren't read again. Optionally specifies the file.",
+			cxxopts::value<std::string>()->implicit_value(""))
+		("com-index", "Keep an index of COM registrations in a file between runs, so that the COM hijacking hunt only reads classes changed since a previous hunt. Optionally specifies the file.",
+			cxxopts::value<std::string>()->implicit_value(""))
+		("baseline", "Skip artifacts present in a baseline captured from a reference machine, reporting only deviations from it.", cxxopts::value<std::string>())
+		("capture-baseline", "Record the artifacts checked by the hunt to a baseline file, for use with --baseline on other machines.", cxxopts::value<std::string>())
+		("time-budget", "Number of seconds the hunt may take. The most valuable hunts are run first, and hunts that won't fit are skipped.", cxxopts::value<unsigned>()->default_value("0"))
+		("scope-paths", "Restrict the hunt to these files and directory trees.", cxxopts::value<std::vector<std::string>>())
+		("scope-keys", "Restrict the hunt to these registry keys and their subkeys.", cxxopts::value<std::vector<std::string>>())
+		("scope-pids", "Restrict the hunt to these processes.", cxxopts::value<std::vector<unsigned>>())
+		("scope-services", "Restrict the hunt to these services.", cxxopts::value<std::vector<std::string>>())
+		("scope-users", "Restrict the hunt to these users' profiles and registry hives.", cxxopts::value<std::vector<std::string>>())
+		("scope-hours", "Restrict the hunt to files, keys, and processes modified or started in this many past hours.", cxxopts::value<unsigned>())
 		;
 
 	options.add_options("mitigate")
@@ -299,90 +601,10 @@ int main(int argc, char* argv[]){
 			print_help(result, options);
 		}
 
-		else if (result.count("hunt") || result.count("monitor")) {
-			std::map<std::string, Reaction> reactions = {
-				{"log", Reactions::LogReaction{}},
-				{"remove-value", Reactions::RemoveValueReaction{ bluespawn.io }},
-				{"suspend", Reactions::SuspendProcessReaction{ bluespawn.io }},
-				{"carve-memory", Reactions::CarveProcessReaction{ bluespawn.io }},
-				{"delete-file", Reactions::DeleteFileReaction{ bluespawn.io }},
-				{"quarantine-file", Reactions::QuarantineFileReaction{ bluespawn.io}},
-			};
-
-			auto UserReactions = result["reaction"].as<std::string>();
-			std::set<std::string> reaction_set;
-			for(unsigned startIdx = 0; startIdx < UserReactions.size();){
-				auto endIdx = min(UserReactions.find(',', startIdx), UserReactions.size());
-				auto sink = UserReactions.substr(startIdx, endIdx - startIdx);
-				reaction_set.emplace(sink);
-				startIdx = endIdx + 1;
-			}
-
-			Reaction combined = {};
-			for(auto reaction : reaction_set){
-				if(reactions.find(reaction) != reactions.end()){
-					combined.Combine(reactions[reaction]);
-				} else {
-					bluespawn.io.AlertUser(L"Unknown reaction \"" + StringToWidestring(reaction) + L"\"", INFINITY, ImportanceLevel::MEDIUM);
-				}
-			}
-
-			bluespawn.SetReaction(combined);
-
-			// Parse the hunt level
-			std::string sHuntLevelFlag = "Normal";
-			Aggressiveness aHuntLevel;
-			try {
-				sHuntLevelFlag = result["level"].as < std::string >();
-			}
-			catch (int e) {}
-
-			if (CompareIgnoreCase<std::string>(sHuntLevelFlag, "Cursory")) {
-				aHuntLevel = Aggressiveness::Cursory;
-			}
-			else if (CompareIgnoreCase<std::string>(sHuntLevelFlag, "Normal")) {
-				aHuntLevel = Aggressiveness::Normal;
-			}
-			else if (CompareIgnoreCase<std::string>(sHuntLevelFlag, "Intensive")) {
-				aHuntLevel = Aggressiveness::Intensive;
-			}
-			else {
-				LOG_ERROR("Error " << sHuntLevelFlag << " - Unknown level. Please specify either Cursory, Normal, or Intensive");
-				LOG_ERROR("Will default to Cursory for this run.");
-				Bluespawn::io.InformUser(L"Error " + StringToWidestring(sHuntLevelFlag) + L" - Unknown level. Please specify either Cursory, Normal, or Intensive");
-				Bluespawn::io.InformUser(L"Will default to Cursory.");
-				aHuntLevel = Aggressiveness::Cursory;
-			}
-
-			//Parse included and excluded hunts
-			std::vector<std::string> vIncludedHunts;
-			std::vector<std::string> vExcludedHunts;
-
-			if (result.count("hunts")) {
-				vIncludedHunts = result["hunts"].as<std::vector<std::string>>();
-			}
-			else if (result.count("exclude-hunts")) {
-				vExcludedHunts = result["exclude-hunts"].as<std::vector<std::string>>();
-			}
-
-			if (result.count("hunt"))
-				bluespawn.dispatch_hunt(aHuntLevel, vExcludedHunts, vIncludedHunts);
-			else if (result.count("monitor"))
-				bluespawn.monitor_system(aHuntLevel);
-
-		}
-		else if (result.count("mitigate")) {
-			bool bForceEnforce = false;
-			if (result.count("force"))
-				bForceEnforce = true;
-
-			MitigationMode mode = MitigationMode::Audit;
-			if (result["mitigate"].as<std::string>() == "e" || result["mitigate"].as<std::string>() == "enforce")
-				mode = MitigationMode::Enforce;
-
-			bluespawn.dispatch_mitigations_analysis(mode, bForceEnforce);
+		else if (result.count("agent")) {
+			serve_jobs(bluespawn, options, StringToWidestring(result["agent"].as<std::string>()));
 		}
-		else {
+		else if (!run_job(bluespawn, result)) {
 			LOG_ERROR("Nothing to do. Use the -h or --hunt flags to launch a hunt");
 		}
 	}
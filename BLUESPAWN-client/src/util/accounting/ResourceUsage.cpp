@@ -0,0 +1,102 @@
+#include "util/accounting/ResourceUsage.h"
+
+#include <Psapi.h>
+
+#include <sstream>
+
+namespace Accounting {
+
+	namespace {
+		/// The counters for the current thread. Only the counting fields of ResourceUsage, the CPU time
+		/// merged from or excluded by other usages, and the wall time excluded are used. Excluded usage
+		/// is subtracted, relying on unsigned wraparound to cancel out in the differences trackers take.
+		thread_local ResourceUsage ThreadCounters{};
+
+		ULONGLONG GetThreadCpuTimeMs(){
+			FILETIME ftCreation{}, ftExit{}, ftKernel{}, ftUser{};
+			if(!GetThreadTimes(GetCurrentThread(), &ftCreation, &ftExit, &ftKernel, &ftUser)){
+				return 0;
+			}
+
+			ULARGE_INTEGER kernel{ ftKernel.dwLowDateTime, ftKernel.dwHighDateTime };
+			ULARGE_INTEGER user{ ftUser.dwLowDateTime, ftUser.dwHighDateTime };
+
+			// FILETIMEs are measured in 100 nanosecond intervals
+			return (kernel.QuadPart + user.QuadPart) / 10000;
+		}
+
+		SIZE_T GetPeakWorkingSet(){
+			PROCESS_MEMORY_COUNTERS counters{};
+			if(!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))){
+				return 0;
+			}
+			return counters.PeakWorkingSetSize;
+		}
+	}
+
+	std::string ResourceUsage::ToString() const {
+		std::stringstream stream{};
+		stream << "wall time " << WallTimeMs << " ms, cpu time " << CpuTimeMs << " ms, " << BytesRead << " bytes read, "
+			<< FilesOpened << " files opened, " << RegistryKeysOpened << " registry keys opened, " << EventRecordsRendered
+			<< " event records rendered, " << YaraScans << " yara scans, peak working set delta " << PeakWorkingSetDelta << " bytes";
+		return stream.str();
+	}
+
+	void RecordBytesRead(ULONGLONG qwBytes){
+		ThreadCounters.BytesRead += qwBytes;
+	}
+
+	void RecordFileOpened(){
+		ThreadCounters.FilesOpened++;
+	}
+
+	void RecordRegistryKeyOpened(){
+		ThreadCounters.RegistryKeysOpened++;
+	}
+
+	void RecordEventRecordRendered(){
+		ThreadCounters.EventRecordsRendered++;
+	}
+
+	void RecordYaraScan(){
+		ThreadCounters.YaraScans++;
+	}
+
+	void MergeCounters(const ResourceUsage& usage){
+		ThreadCounters.CpuTimeMs += usage.CpuTimeMs;
+		ThreadCounters.BytesRead += usage.BytesRead;
+		ThreadCounters.FilesOpened += usage.FilesOpened;
+		ThreadCounters.RegistryKeysOpened += usage.RegistryKeysOpened;
+		ThreadCounters.EventRecordsRendered += usage.EventRecordsRendered;
+		ThreadCounters.YaraScans += usage.YaraScans;
+	}
+
+	void ExcludeUsage(const ResourceUsage& usage){
+		ThreadCounters.WallTimeMs += usage.WallTimeMs;
+		ThreadCounters.CpuTimeMs -= usage.CpuTimeMs;
+		ThreadCounters.BytesRead -= usage.BytesRead;
+		ThreadCounters.FilesOpened -= usage.FilesOpened;
+		ThreadCounters.RegistryKeysOpened -= usage.RegistryKeysOpened;
+		ThreadCounters.EventRecordsRendered -= usage.EventRecordsRendered;
+		ThreadCounters.YaraScans -= usage.YaraScans;
+	}
+
+	ResourceTracker::ResourceTracker() :
+		qwStartTick{ GetTickCount64() },
+		qwStartCpuTime{ GetThreadCpuTimeMs() },
+		StartPeakWorkingSet{ GetPeakWorkingSet() },
+		StartCounters{ ThreadCounters }{}
+
+	ResourceUsage ResourceTracker::GetUsage() const {
+		ResourceUsage usage{};
+		usage.WallTimeMs = GetTickCount64() - qwStartTick - (ThreadCounters.WallTimeMs - StartCounters.WallTimeMs);
+		usage.CpuTimeMs = GetThreadCpuTimeMs() - qwStartCpuTime + ThreadCounters.CpuTimeMs - StartCounters.CpuTimeMs;
+		usage.BytesRead = ThreadCounters.BytesRead - StartCounters.BytesRead;
+		usage.FilesOpened = ThreadCounters.FilesOpened - StartCounters.FilesOpened;
+		usage.RegistryKeysOpened = ThreadCounters.RegistryKeysOpened - StartCounters.RegistryKeysOpened;
+		usage.EventRecordsRendered = ThreadCounters.EventRecordsRendered - StartCounters.EventRecordsRendered;
+		usage.YaraScans = ThreadCounters.YaraScans - StartCounters.YaraScans;
+		usage.PeakWorkingSetDelta = static_cast<LONGLONG>(GetPeakWorkingSet()) - static_cast<LONGLONG>(StartPeakWorkingSet);
+		return usage;
+	}
+}
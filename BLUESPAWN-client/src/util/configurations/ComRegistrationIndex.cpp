@@ -0,0 +1,435 @@
+#include "util/configurations/ComRegistrationIndex.h"
+
+#include <unordered_map>
+#include <algorithm>
+
+#include "util/log/Log.h"
+#include "util/filesystem/FileSystem.h"
+#include "util/threadpool/IOExecutor.h"
+#include "common/StringUtils.h"
+#include "common/Utils.h"
+
+namespace Registry {
+
+	namespace {
+
+		/**
+		 * An index file holds a header, followed by the length of each string, the characters of every string
+		 * one after another, a record for each class, and a record for each registration. The registrations of
+		 * each class follow those of the class before it. Strings are referred to by their index.
+		 */
+		struct IndexHeader {
+			DWORD dwMagic;
+			DWORD dwVersion;
+			DWORD dwStringCount;
+			DWORD dwClassCount;
+			DWORD dwRegistrationCount;
+		};
+
+		struct ClassRecord {
+			DWORD dwPath;
+			DWORD dwRegistrationCount;
+			DWORD64 qwStamp;
+			FILETIME ftLastWrite;
+			DWORD dwTreatAs;
+		};
+
+		struct RegistrationRecord {
+			DWORD dwKind;
+			DWORD dwClsid;
+			DWORD dwKeyPath;
+			DWORD dwSubkey;
+			DWORD dwValueName;
+			DWORD dwServer;
+			DWORD dwThreadingModel;
+			DWORD dwSource;
+		};
+
+		const DWORD INDEX_MAGIC{ 0x49435342 }; // "BSCI"
+		const DWORD INDEX_VERSION{ 2 };
+
+		/// The largest index file that will be read
+		const LONGLONG MAX_FILE_SIZE{ 1ll << 28 };
+
+		/// The number of classes read by each task on the IO executor
+		const SIZE_T BATCH_SIZE{ 256 };
+
+		/// The subkeys of a class's key that register its servers or the class emulating it. Their last write times
+		/// make up its stamp.
+		const std::vector<std::wstring> vServerKeys{ L"InprocServer32", L"InprocServer", L"LocalServer32", L"TreatAs" };
+
+		/// Interns strings for an index file
+		class StringTable {
+		private:
+			std::unordered_map<std::wstring, DWORD> mIndices;
+
+		public:
+			std::vector<DWORD> vLengths;
+			std::wstring wsCharacters;
+
+			DWORD Add(const std::wstring& string){
+				auto index{ mIndices.find(string) };
+				if(index != mIndices.end()){
+					return index->second;
+				}
+
+				auto dwIndex{ static_cast<DWORD>(vLengths.size()) };
+				mIndices.emplace(string, dwIndex);
+				vLengths.emplace_back(static_cast<DWORD>(string.length()));
+				wsCharacters += string;
+				return dwIndex;
+			}
+		};
+
+		/// Appends the bytes of an array of records to a buffer
+		template<class T>
+		void Append(std::vector<BYTE>& buffer, const T* lpRecords, SIZE_T dwCount){
+			auto lpBytes{ reinterpret_cast<const BYTE*>(lpRecords) };
+			buffer.insert(buffer.end(), lpBytes, lpBytes + dwCount * sizeof(T));
+		}
+
+		/// Reads an array of records from a buffer at an offset, advancing the offset past them
+		template<class T>
+		bool Consume(const std::vector<BYTE>& buffer, SIZE_T& dwOffset, std::vector<T>& vRecords, SIZE_T dwCount){
+			if(dwCount > (buffer.size() - dwOffset) / sizeof(T)){
+				return false;
+			}
+
+			vRecords.resize(dwCount);
+			CopyMemory(vRecords.data(), buffer.data() + dwOffset, dwCount * sizeof(T));
+			dwOffset += dwCount * sizeof(T);
+			return true;
+		}
+	}
+
+	std::optional<std::wstring> ComRegistrationIndex::wsPersistentPath{ std::nullopt };
+
+	RegistryKey ComRegistration::GetKey() const {
+		if(!root){
+			return RegistryKey{ wsKeyPath };
+		}
+		return RegistryKey{ *root, wsSubkey.length() ? wsClsid + L"\\" + wsSubkey : wsClsid };
+	}
+
+	void ComRegistrationIndex::ReadClass(const RegistryKey& key, const std::wstring& wsClsid, const std::wstring& wsSource, ClassEntry& entry){
+		auto Add{ [&](ComRegistration::Kind kind, const RegistryKey& holder, const std::wstring& wsSubkey, const std::wstring& wsValueName,
+					  const std::wstring& wsThreadingModel){
+			auto server{ holder.GetValue<std::wstring>(wsValueName) };
+			if(server){
+				entry.vRegistrations.emplace_back(ComRegistration{ kind, wsClsid, holder.GetName(), wsSubkey, wsValueName, *server, wsThreadingModel,
+					wsSource });
+			}
+		} };
+
+		for(auto& name : { L"InprocServer32", L"InprocServer" }){
+			RegistryKey subkey{ key, name };
+			if(subkey.Exists()){
+				Add(ComRegistration::Kind::InProcess, subkey, name, L"", subkey.GetValue<std::wstring>(L"ThreadingModel").value_or(L""));
+			}
+		}
+		Add(ComRegistration::Kind::InProcess, key, L"", L"InprocHandler32", L"");
+		Add(ComRegistration::Kind::InProcess, key, L"", L"InprocHandler", L"");
+		Add(ComRegistration::Kind::LocalServer, key, L"", L"LocalServer", L"");
+
+		RegistryKey subkey{ key, L"LocalServer32" };
+		if(subkey.Exists()){
+			Add(ComRegistration::Kind::LocalServer, subkey, L"LocalServer32", L"", L"");
+			Add(ComRegistration::Kind::LocalServer, subkey, L"LocalServer32", L"ServerExecutable", L"");
+		}
+
+		RegistryKey treatAs{ key, L"TreatAs" };
+		if(treatAs.Exists()){
+			entry.wsTreatAs = treatAs.GetValue<std::wstring>(L"").value_or(L"");
+		}
+	}
+
+	bool ComRegistrationIndex::Load(const std::wstring& path){
+		wsPath = path;
+		mClasses.clear();
+
+		auto hFile{ FileSystem::OpenProtectedFile(path, GENERIC_READ, FILE_SHARE_READ, OPEN_EXISTING) };
+		if(!hFile){
+			if(GetLastError() == ERROR_FILE_NOT_FOUND){
+				LOG_INFO(L"No COM registration index found at " << path << L"; every class will be read");
+			} else {
+				LOG_WARNING(L"Unable to open the COM registration index at " << path << L" (Error " << GetLastError() << L"); every class will be read");
+			}
+			return false;
+		}
+
+		LARGE_INTEGER size{};
+		if(!GetFileSizeEx(hFile, &size) || size.QuadPart > MAX_FILE_SIZE){
+			LOG_WARNING(L"The COM registration index at " << path << L" is too large; every class will be read");
+			return false;
+		}
+
+		std::vector<BYTE> buffer(static_cast<SIZE_T>(size.QuadPart));
+		DWORD dwBytesRead{};
+		if(buffer.size() && (!ReadFile(hFile, buffer.data(), static_cast<DWORD>(buffer.size()), &dwBytesRead, nullptr) ||
+							 dwBytesRead != buffer.size())){
+			LOG_WARNING(L"Unable to read the COM registration index at " << path << L" (Error " << GetLastError() << L"); every class will be read");
+			return false;
+		}
+
+		SIZE_T dwOffset{ 0 };
+		std::vector<IndexHeader> header{};
+		std::vector<DWORD> vLengths{};
+		std::vector<WCHAR> vCharacters{};
+		std::vector<ClassRecord> vClasses{};
+		std::vector<RegistrationRecord> vRegistrations{};
+		if(!Consume(buffer, dwOffset, header, 1) || header[0].dwMagic != INDEX_MAGIC || header[0].dwVersion != INDEX_VERSION ||
+		   !Consume(buffer, dwOffset, vLengths, header[0].dwStringCount)){
+			LOG_WARNING(L"The COM registration index at " << path << L" is invalid; every class will be read");
+			return false;
+		}
+
+		SIZE_T dwCharacters{ 0 };
+		for(auto dwLength : vLengths){
+			dwCharacters += dwLength;
+		}
+		if(!Consume(buffer, dwOffset, vCharacters, dwCharacters) || !Consume(buffer, dwOffset, vClasses, header[0].dwClassCount) ||
+		   !Consume(buffer, dwOffset, vRegistrations, header[0].dwRegistrationCount)){
+			LOG_WARNING(L"The COM registration index at " << path << L" is truncated; every class will be read");
+			return false;
+		}
+
+		std::vector<std::wstring> vStrings{};
+		SIZE_T dwStart{ 0 };
+		for(auto dwLength : vLengths){
+			vStrings.emplace_back(vCharacters.data() + dwStart, dwLength);
+			dwStart += dwLength;
+		}
+
+		// Every string index and registration count is validated before anything is added to the index
+		auto dwStringCount{ static_cast<DWORD>(vStrings.size()) };
+		SIZE_T dwRegistrationsClaimed{ 0 };
+		for(auto& record : vClasses){
+			dwRegistrationsClaimed += record.dwRegistrationCount;
+			if(record.dwPath >= dwStringCount || record.dwTreatAs >= dwStringCount){
+				dwRegistrationsClaimed = vRegistrations.size() + 1;
+				break;
+			}
+		}
+		bool bValid{ dwRegistrationsClaimed == vRegistrations.size() };
+		for(auto& record : vRegistrations){
+			bValid = bValid && record.dwKind <= static_cast<DWORD>(ComRegistration::Kind::LocalServer) &&
+				(std::max)({ record.dwClsid, record.dwKeyPath, record.dwSubkey, record.dwValueName, record.dwServer, record.dwThreadingModel,
+							 record.dwSource }) < dwStringCount;
+		}
+		if(!bValid){
+			LOG_WARNING(L"The COM registration index at " << path << L" is invalid; every class will be read");
+			return false;
+		}
+
+		SIZE_T dwRegistration{ 0 };
+		for(auto& record : vClasses){
+			ClassEntry entry{ record.qwStamp, record.ftLastWrite, {}, vStrings[record.dwTreatAs] };
+			for(DWORD idx = 0; idx < record.dwRegistrationCount; idx++){
+				auto& registration{ vRegistrations[dwRegistration++] };
+				entry.vRegistrations.emplace_back(ComRegistration{ static_cast<ComRegistration::Kind>(registration.dwKind),
+					vStrings[registration.dwClsid], vStrings[registration.dwKeyPath], vStrings[registration.dwSubkey], vStrings[registration.dwValueName],
+					vStrings[registration.dwServer], vStrings[registration.dwThreadingModel], vStrings[registration.dwSource] });
+			}
+			mClasses.emplace(vStrings[record.dwPath], std::move(entry));
+		}
+
+		LOG_INFO(L"Loaded " << mClasses.size() << L" COM classes from the registration index at " << path);
+		return true;
+	}
+
+	bool ComRegistrationIndex::Save() const {
+		StringTable strings{};
+		std::vector<ClassRecord> vClasses{};
+		std::vector<RegistrationRecord> vRegistrations{};
+		for(auto& entry : mClasses){
+			vClasses.emplace_back(ClassRecord{ strings.Add(entry.first), static_cast<DWORD>(entry.second.vRegistrations.size()),
+				entry.second.qwStamp, entry.second.ftLastWrite, strings.Add(entry.second.wsTreatAs) });
+			for(auto& registration : entry.second.vRegistrations){
+				vRegistrations.emplace_back(RegistrationRecord{ static_cast<DWORD>(registration.kind), strings.Add(registration.wsClsid),
+					strings.Add(registration.wsKeyPath), strings.Add(registration.wsSubkey), strings.Add(registration.wsValueName),
+					strings.Add(registration.wsServer), strings.Add(registration.wsThreadingModel), strings.Add(registration.wsSource) });
+			}
+		}
+
+		IndexHeader header{ INDEX_MAGIC, INDEX_VERSION, static_cast<DWORD>(strings.vLengths.size()), static_cast<DWORD>(vClasses.size()),
+			static_cast<DWORD>(vRegistrations.size()) };
+		std::vector<BYTE> buffer{};
+		Append(buffer, &header, 1);
+		Append(buffer, strings.vLengths.data(), strings.vLengths.size());
+		Append(buffer, strings.wsCharacters.data(), strings.wsCharacters.length());
+		Append(buffer, vClasses.data(), vClasses.size());
+		Append(buffer, vRegistrations.data(), vRegistrations.size());
+
+		auto wsTempPath{ wsPath + L".tmp" };
+		{
+			// The temporary file keeps its protected security descriptor when it's moved over the index
+			auto hFile{ FileSystem::OpenProtectedFile(wsTempPath, GENERIC_WRITE, 0, CREATE_ALWAYS) };
+			if(!hFile){
+				LOG_ERROR(L"Unable to create the COM registration index at " << wsTempPath << L" (Error " << GetLastError() << L")");
+				return false;
+			}
+
+			DWORD dwBytesWritten{ 0 };
+			if(!WriteFile(hFile, buffer.data(), static_cast<DWORD>(buffer.size()), &dwBytesWritten, nullptr) || !FlushFileBuffers(hFile)){
+				LOG_ERROR(L"Unable to write the COM registration index to " << wsTempPath << L" (Error " << GetLastError() << L")");
+				return false;
+			}
+		}
+
+		if(!MoveFileExW(wsTempPath.c_str(), wsPath.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)){
+			LOG_ERROR(L"Unable to replace the COM registration index at " << wsPath << L" (Error " << GetLastError() << L")");
+			return false;
+		}
+
+		LOG_VERBOSE(1, L"Saved " << mClasses.size() << L" COM classes to the registration index at " << wsPath << L" (" <<
+			buffer.size() << L" bytes)");
+		return true;
+	}
+
+	void ComRegistrationIndex::Update(const std::vector<RegistryKey>& vRoots){
+		auto start{ GetTickCount64() };
+
+		// The classes under each CLSID key are listed first, with their last write times, then split into batches
+		struct Batch {
+			RegistryKey root;
+			std::wstring wsSource;
+			std::vector<std::pair<std::wstring, FILETIME>> vClasses;
+		};
+		std::vector<Batch> vBatches{};
+		for(auto& root : vRoots){
+			if(!root.Exists()){
+				continue;
+			}
+
+			auto wsSource{ root.GetName() };
+			vBatches.emplace_back(Batch{ root, wsSource, {} });
+			root.EnumerateSubkeyWriteTimes([&](const std::wstring& name, const FILETIME& written){
+				if(vBatches.back().vClasses.size() == BATCH_SIZE){
+					vBatches.emplace_back(Batch{ root, wsSource, {} });
+				}
+				vBatches.back().vClasses.emplace_back(name, written);
+			});
+		}
+
+		// The tasks only read the index, which isn't changed until every task has completed
+		typedef std::vector<std::pair<std::wstring, std::pair<ClassEntry, bool>>> BatchResult;
+		std::vector<AsyncResult<BatchResult>> vResults{};
+		for(auto& batch : vBatches){
+			vResults.emplace_back(IOExecutor::GetInstance().Async<BatchResult>([this, &batch](){
+				BatchResult results{};
+				for(auto& entry : batch.vClasses){
+					RegistryKey key{ batch.root, entry.first };
+					if(!key.Exists()){
+						continue;
+					}
+
+					std::vector<FILETIME> vServerTimes(vServerKeys.size());
+					auto bStamped{ key.EnumerateSubkeyWriteTimes([&](const std::wstring& name, const FILETIME& written){
+						for(SIZE_T idx = 0; idx < vServerKeys.size(); idx++){
+							if(CompareIgnoreCaseW(name, vServerKeys[idx])){
+								vServerTimes[idx] = written;
+							}
+						}
+					}) };
+					auto qwStamp{ HashData(&entry.second, sizeof(entry.second)) };
+					qwStamp = HashData(vServerTimes.data(), vServerTimes.size() * sizeof(FILETIME), qwStamp);
+
+					auto path{ ToLowerCaseW(batch.wsSource + L"\\" + entry.first) };
+					auto previous{ mClasses.find(path) };
+					auto bReused{ bStamped && previous != mClasses.end() && previous->second.qwStamp == qwStamp };
+					ClassEntry result{};
+					if(bReused){
+						result = previous->second;
+					} else {
+						result = ClassEntry{ qwStamp, entry.second };
+						ReadClass(key, entry.first, batch.wsSource, result);
+					}
+
+					// The CLSID key is kept so that registrations can be opened beneath it, even in hives that aren't loaded
+					result.root = batch.root;
+					result.wsSource = batch.wsSource;
+					result.wsClsid = entry.first;
+					for(auto& registration : result.vRegistrations){
+						registration.root = batch.root;
+					}
+					results.emplace_back(path, std::make_pair(std::move(result), bReused));
+				}
+				return results;
+			}));
+		}
+
+		std::map<std::wstring, ClassEntry> mUpdated{};
+		DWORD dwClassesRead{ 0 };
+		DWORD dwClassesReused{ 0 };
+		for(auto& result : vResults){
+			for(auto& entry : result.Get()){
+				(entry.second.second ? dwClassesReused : dwClassesRead)++;
+				mUpdated.emplace(entry.first, entry.second.first);
+			}
+		}
+		auto dwClassesRemoved{ static_cast<DWORD>(mClasses.size()) };
+		for(auto& entry : mUpdated){
+			dwClassesRemoved -= mClasses.count(entry.first) ? 1 : 0;
+		}
+		mClasses = std::move(mUpdated);
+
+		// Once every class is known, each class emulated by another takes on the registrations of the class emulating it
+		for(auto& entry : mClasses){
+			auto& emulated{ entry.second };
+			emulated.vTreatAsRegistrations.clear();
+			if(emulated.wsTreatAs.empty()){
+				continue;
+			}
+
+			auto emulating{ mClasses.find(ToLowerCaseW(emulated.wsSource + L"\\" + emulated.wsTreatAs)) };
+			if(emulating == mClasses.end() || &emulating->second == &emulated){
+				continue;
+			}
+			for(auto& registration : emulating->second.vRegistrations){
+				auto treated{ registration };
+				treated.wsClsid = emulated.wsClsid;
+				treated.wsKeyPath = emulated.wsSource + L"\\" + emulated.wsClsid + L"\\TreatAs";
+				treated.wsSubkey = L"TreatAs";
+				treated.wsValueName = L"";
+				treated.wsSource = emulated.wsSource;
+				treated.root = emulated.root;
+				emulated.vTreatAsRegistrations.emplace_back(std::move(treated));
+			}
+		}
+
+		LOG_INFO(L"Indexed " << mClasses.size() << L" COM classes under " << vRoots.size() << L" keys in " << GetTickCount64() - start <<
+			L" ms: " << dwClassesRead << L" read, " << dwClassesReused << L" unchanged, " << dwClassesRemoved << L" removed");
+	}
+
+	void ComRegistrationIndex::EnumerateRegistrations(const std::function<void(const ComRegistration&, const FILETIME&)>& callback) const {
+		for(auto& entry : mClasses){
+			for(auto& registration : entry.second.vRegistrations){
+				callback(registration, entry.second.ftLastWrite);
+			}
+			for(auto& registration : entry.second.vTreatAsRegistrations){
+				callback(registration, entry.second.ftLastWrite);
+			}
+		}
+	}
+
+	DWORD ComRegistrationIndex::GetClassCount() const {
+		return static_cast<DWORD>(mClasses.size());
+	}
+
+	void ComRegistrationIndex::SetPersistentPath(const std::optional<std::wstring>& path){
+		wsPersistentPath = path;
+	}
+
+	std::optional<std::wstring> ComRegistrationIndex::GetPersistentPath(){
+		return wsPersistentPath;
+	}
+
+	std::wstring ComRegistrationIndex::GetDefaultPath(){
+		WCHAR path[MAX_PATH]{};
+		GetModuleFileNameW(nullptr, path, MAX_PATH);
+
+		std::wstring directory{ path };
+		directory = directory.substr(0, directory.find_last_of(L'\\') + 1);
+		return directory + L"bluespawn-com-index.dat";
+	}
+}
@@ -0,0 +1,577 @@
+#include "util/configurations/IocSweep.h"
+
+#include <algorithm>
+#include <unordered_map>
+
+#include "util/patterns/Pattern.h"
+#include "util/log/Log.h"
+#include "util/accounting/ResourceUsage.h"
+
+namespace Registry {
+
+	/// The header at the start of an index file. Every offset is from the start of the file and a multiple of 8.
+	struct NgramIndexHeader {
+		DWORD dwMagic;
+		DWORD dwVersion;
+
+		/// The hash and number of blobs of the snapshot from which the index was built
+		DWORD64 qwSnapshotHash;
+		DWORD dwBlobCount;
+
+		DWORD dwEntryCount;
+		DWORD dwUnindexedCount;
+		DWORD dwReserved;
+		DWORD64 qwPostingCount;
+
+		DWORD64 qwEntriesOffset;
+		DWORD64 qwUnindexedOffset;
+		DWORD64 qwPostingsOffset;
+	};
+
+	/// A trigram and the blobs containing it. Entries are sorted by trigram.
+	struct NgramIndexEntry {
+		DWORD64 qwGram;
+
+		/// The blobs containing the trigram, which are listed in ascending order in the postings
+		DWORD64 qwFirstPosting;
+		DWORD dwPostingCount;
+		DWORD dwReserved;
+	};
+
+	namespace {
+		const DWORD INDEX_MAGIC{ 0x494E5342 }; // "BSNI"
+		const DWORD INDEX_VERSION{ 2 };
+
+		/// The fewest printable characters in a row in binary data that are searched
+		const SIZE_T MIN_PRINTABLE_RUN{ 4 };
+
+		/// The largest blob indexed; larger blobs are rare, and are always searched instead
+		const DWORD MAX_INDEXED_BLOB{ 1 << 16 };
+
+		/// The deepest keys are nested in the registry, which also bounds how far registry links are followed
+		const DWORD MAX_DEPTH{ 512 };
+
+		/// How the text searched for indicators is taken from the data of a value, which depends on its type
+		enum class TextKind {
+			String,  // The data is searched as it is
+			Binary,  // The data is searched for runs of printable characters
+			Numeric, // The data isn't searched
+		};
+		const DWORD TEXT_KIND_COUNT{ 3 };
+
+		/// Retrieves how the text searched for indicators is taken from the data of values of a type
+		TextKind GetTextKind(DWORD dwType){
+			if(dwType == REG_SZ || dwType == REG_EXPAND_SZ || dwType == REG_MULTI_SZ || dwType == REG_LINK){
+				return TextKind::String;
+			} else if(dwType == REG_DWORD || dwType == REG_DWORD_BIG_ENDIAN || dwType == REG_QWORD){
+				return TextKind::Numeric;
+			}
+			return TextKind::Binary;
+		}
+
+		/// Retrieves the bit representing a text kind in a set of kinds
+		BYTE GetKindBit(TextKind kind){
+			return static_cast<BYTE>(1 << static_cast<DWORD>(kind));
+		}
+
+		bool IsPrintable(WCHAR ch){
+			return (ch >= 0x20 && ch < 0x7F) || ch == L'\t';
+		}
+
+		/**
+		 * Retrieves the text searched for indicators in the data of a value. Strings are searched as they are,
+		 * with their terminating nulls separating them. Other data is searched for runs of printable characters,
+		 * first as UTF-16 and then as ASCII, with nulls separating the runs. Since no indicator contains a null,
+		 * no indicator is found spanning two strings or runs.
+		 *
+		 * @param kind How the text is taken from the data, as given by the type of the value
+		 * @param lpData The data of the value
+		 * @param dwSize The size of the data
+		 * @param buffer A buffer to hold the text when it isn't the data itself
+		 *
+		 * @return A pointer to the text, which needn't be aligned, and its length in characters
+		 */
+		std::pair<LPCWSTR, SIZE_T> GetSearchText(TextKind kind, const BYTE* lpData, DWORD dwSize, std::wstring& buffer){
+			if(kind == TextKind::String){
+				return { reinterpret_cast<LPCWSTR>(lpData), dwSize / sizeof(WCHAR) };
+			}
+
+			buffer.clear();
+			if(kind == TextKind::Numeric){
+				return { buffer.c_str(), 0 };
+			}
+
+			SIZE_T dwStart{ 0 };
+			auto EndRun{ [&buffer, &dwStart](){
+				if(buffer.length() - dwStart < MIN_PRINTABLE_RUN){
+					buffer.resize(dwStart);
+				} else {
+					buffer += L'\0';
+				}
+				dwStart = buffer.length();
+			} };
+
+			for(DWORD idx = 0; idx + 1 < dwSize; idx += 2){
+				auto ch{ static_cast<WCHAR>(lpData[idx] | (lpData[idx + 1] << 8)) };
+				if(IsPrintable(ch)){
+					buffer += ch;
+				} else {
+					EndRun();
+				}
+			}
+			EndRun();
+
+			for(DWORD idx = 0; idx < dwSize; idx++){
+				if(IsPrintable(lpData[idx])){
+					buffer += static_cast<WCHAR>(lpData[idx]);
+				} else {
+					EndRun();
+				}
+			}
+			EndRun();
+
+			return { buffer.c_str(), buffer.length() };
+		}
+
+		/// Packs three folded characters into a trigram
+		DWORD64 PackGram(WCHAR first, WCHAR second, WCHAR third){
+			return (static_cast<DWORD64>(first) << 32) | (static_cast<DWORD64>(second) << 16) | third;
+		}
+
+		/**
+		 * Retrieves the kinds of text taken from each blob in a snapshot, as a set of bits given by GetKindBit.
+		 * Values of different types may hold identical data, so a blob is searched once for each kind of text
+		 * taken from it, and the index holds the trigrams of each.
+		 */
+		std::vector<BYTE> GetBlobTextKinds(const RegistrySnapshot& snapshot){
+			std::vector<BYTE> vKinds(snapshot.GetBlobCount());
+			snapshot.EnumerateValues([&](DWORD dwKey, DWORD dwValue, DWORD dwType, DWORD dwBlob){
+				vKinds[dwBlob] |= GetKindBit(GetTextKind(dwType));
+			});
+			return vKinds;
+		}
+
+		/// Checks that a table of records lies within a view and is aligned
+		bool IsTableValid(DWORD64 qwOffset, DWORD64 qwCount, SIZE_T dwRecordSize, SIZE_T dwSize){
+			return qwOffset % 8 == 0 && qwOffset <= dwSize && qwCount <= (dwSize - qwOffset) / dwRecordSize;
+		}
+
+		/// Writes data to a file, returning whether all of it was written
+		bool WriteAll(HANDLE hFile, LPCVOID lpData, SIZE_T dwSize){
+			auto lpBytes{ reinterpret_cast<const BYTE*>(lpData) };
+			while(dwSize){
+				auto dwChunk{ static_cast<DWORD>((std::min)(dwSize, static_cast<SIZE_T>(1 << 30))) };
+				DWORD dwBytesWritten{ 0 };
+				if(!WriteFile(hFile, lpBytes, dwChunk, &dwBytesWritten, nullptr) || dwBytesWritten != dwChunk){
+					return false;
+				}
+				lpBytes += dwChunk;
+				dwSize -= dwChunk;
+			}
+			return true;
+		}
+
+		/// Pads the size of a section to a multiple of 8
+		DWORD64 Align(DWORD64 qwSize){
+			return (qwSize + 7) & ~7ull;
+		}
+	}
+
+	std::wstring IocMatch::ToString() const {
+		return wsKeyPath + L"\\" + (wsValueName.length() ? wsValueName : L"(Default)") + L" contains " + wsIndicator;
+	}
+
+	NgramIndex::NgramIndex(const std::wstring& wsPath, LPVOID lpView, SIZE_T dwSize) :
+		wsPath{ wsPath },
+		lpView{ lpView, [](LPVOID lpView){ UnmapViewOfFile(lpView); }, nullptr },
+		dwSize{ dwSize }{}
+
+	bool NgramIndex::Build(const RegistrySnapshot& snapshot, const std::wstring& wsPath){
+		auto start{ GetTickCount64() };
+		auto& lower{ Patterns::GetLowerCase() };
+
+		auto vKinds{ GetBlobTextKinds(snapshot) };
+		std::unordered_map<DWORD64, std::vector<DWORD>> mPostings{};
+		std::vector<DWORD> vUnindexed{};
+		std::vector<DWORD64> vGrams{};
+		std::wstring buffer{};
+		for(DWORD dwBlob = 0; dwBlob < snapshot.GetBlobCount(); dwBlob++){
+			auto blob{ snapshot.GetBlob(dwBlob) };
+			if(blob.second > MAX_INDEXED_BLOB){
+				vUnindexed.emplace_back(dwBlob);
+				continue;
+			}
+
+			vGrams.clear();
+			for(DWORD dwKind = 0; dwKind < TEXT_KIND_COUNT; dwKind++){
+				auto kind{ static_cast<TextKind>(dwKind) };
+				if(!(vKinds[dwBlob] & GetKindBit(kind))){
+					continue;
+				}
+
+				auto text{ GetSearchText(kind, blob.first, blob.second, buffer) };
+				for(SIZE_T idx = 0; idx + 2 < text.second; idx++){
+					WCHAR first{ lower[text.first[idx]] };
+					WCHAR second{ lower[text.first[idx + 1]] };
+					WCHAR third{ lower[text.first[idx + 2]] };
+					if(first && second && third){
+						vGrams.emplace_back(PackGram(first, second, third));
+					}
+				}
+			}
+
+			std::sort(vGrams.begin(), vGrams.end());
+			vGrams.erase(std::unique(vGrams.begin(), vGrams.end()), vGrams.end());
+			for(auto qwGram : vGrams){
+				mPostings[qwGram].emplace_back(dwBlob);
+			}
+		}
+
+		std::vector<NgramIndexEntry> vEntries{};
+		vEntries.reserve(mPostings.size());
+		for(auto& postings : mPostings){
+			vEntries.emplace_back(NgramIndexEntry{ postings.first, 0, static_cast<DWORD>(postings.second.size()), 0 });
+		}
+		std::sort(vEntries.begin(), vEntries.end(), [](const NgramIndexEntry& first, const NgramIndexEntry& second){
+			return first.qwGram < second.qwGram;
+		});
+
+		// Blobs were indexed in ascending order, so each trigram's postings already are
+		std::vector<DWORD> vPostings{};
+		for(auto& entry : vEntries){
+			auto& postings{ mPostings[entry.qwGram] };
+			entry.qwFirstPosting = vPostings.size();
+			vPostings.insert(vPostings.end(), postings.begin(), postings.end());
+			std::vector<DWORD>{}.swap(postings);
+		}
+
+		NgramIndexHeader header{};
+		header.dwMagic = INDEX_MAGIC;
+		header.dwVersion = INDEX_VERSION;
+		header.qwSnapshotHash = snapshot.GetHash();
+		header.dwBlobCount = snapshot.GetBlobCount();
+		header.dwEntryCount = static_cast<DWORD>(vEntries.size());
+		header.dwUnindexedCount = static_cast<DWORD>(vUnindexed.size());
+		header.qwPostingCount = vPostings.size();
+		header.qwEntriesOffset = sizeof(NgramIndexHeader);
+		header.qwUnindexedOffset = header.qwEntriesOffset + vEntries.size() * sizeof(NgramIndexEntry);
+		header.qwPostingsOffset = Align(header.qwUnindexedOffset + vUnindexed.size() * sizeof(DWORD));
+
+		auto wsTempPath{ wsPath + L".tmp" };
+		{
+			HandleWrapper hFile{ CreateFileW(wsTempPath.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, 0, nullptr) };
+			if(!hFile){
+				LOG_ERROR(L"Unable to create n-gram index at " << wsTempPath << L" (Error " << GetLastError() << L")");
+				return false;
+			}
+
+			static const BYTE padding[8]{};
+			auto dwPadding{ static_cast<SIZE_T>(header.qwPostingsOffset - header.qwUnindexedOffset - vUnindexed.size() * sizeof(DWORD)) };
+			if(!WriteAll(hFile, &header, sizeof(header)) ||
+			   !WriteAll(hFile, vEntries.data(), vEntries.size() * sizeof(NgramIndexEntry)) ||
+			   !WriteAll(hFile, vUnindexed.data(), vUnindexed.size() * sizeof(DWORD)) ||
+			   !WriteAll(hFile, padding, dwPadding) ||
+			   !WriteAll(hFile, vPostings.data(), vPostings.size() * sizeof(DWORD)) ||
+			   !FlushFileBuffers(hFile)){
+				LOG_ERROR(L"Unable to write n-gram index to " << wsTempPath << L" (Error " << GetLastError() << L")");
+				return false;
+			}
+		}
+
+		if(!MoveFileExW(wsTempPath.c_str(), wsPath.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)){
+			LOG_ERROR(L"Unable to replace n-gram index at " << wsPath << L" (Error " << GetLastError() << L")");
+			return false;
+		}
+
+		LOG_INFO(L"Indexed " << vEntries.size() << L" trigrams in " << snapshot.GetBlobCount() - vUnindexed.size() << L" of " <<
+			snapshot.GetBlobCount() << L" blobs of " << snapshot.GetPath() << L" to " << wsPath << L" in " << GetTickCount64() - start << L" ms");
+		return true;
+	}
+
+	std::shared_ptr<NgramIndex> NgramIndex::Load(const std::wstring& wsPath, const RegistrySnapshot& snapshot){
+		HandleWrapper hFile{ CreateFileW(wsPath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, 0, nullptr) };
+		if(!hFile){
+			LOG_VERBOSE(1, L"Unable to open n-gram index " << wsPath << L" (Error " << GetLastError() << L")");
+			return nullptr;
+		}
+		Accounting::RecordFileOpened();
+
+		LARGE_INTEGER size{};
+		if(!GetFileSizeEx(hFile, &size) || static_cast<ULONGLONG>(size.QuadPart) < sizeof(NgramIndexHeader) ||
+		   static_cast<ULONGLONG>(size.QuadPart) > static_cast<ULONGLONG>(static_cast<SIZE_T>(-1))){
+			LOG_WARNING(L"N-gram index " << wsPath << L" is invalid");
+			return nullptr;
+		}
+
+		HandleWrapper hMapping{ CreateFileMappingW(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr) };
+		if(!hMapping){
+			LOG_ERROR(L"Unable to map n-gram index " << wsPath << L" (Error " << GetLastError() << L")");
+			return nullptr;
+		}
+
+		// The view remains valid once the file and mapping handles are closed
+		auto lpView{ MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0) };
+		if(!lpView){
+			LOG_ERROR(L"Unable to map n-gram index " << wsPath << L" (Error " << GetLastError() << L")");
+			return nullptr;
+		}
+
+		std::shared_ptr<NgramIndex> index{ new NgramIndex(wsPath, lpView, static_cast<SIZE_T>(size.QuadPart)) };
+		if(!index->Validate(snapshot)){
+			LOG_WARNING(L"N-gram index " << wsPath << L" is invalid or was built from a different snapshot");
+			return nullptr;
+		}
+
+		return index;
+	}
+
+	bool NgramIndex::Validate(const RegistrySnapshot& snapshot) const {
+		auto& header{ GetHeader() };
+		if(header.dwMagic != INDEX_MAGIC || header.dwVersion != INDEX_VERSION || header.qwSnapshotHash != snapshot.GetHash() ||
+		   header.dwBlobCount != snapshot.GetBlobCount()){
+			return false;
+		}
+
+		if(!IsTableValid(header.qwEntriesOffset, header.dwEntryCount, sizeof(NgramIndexEntry), dwSize) ||
+		   !IsTableValid(header.qwUnindexedOffset, header.dwUnindexedCount, sizeof(DWORD), dwSize) ||
+		   !IsTableValid(header.qwPostingsOffset, header.qwPostingCount, sizeof(DWORD), dwSize)){
+			return false;
+		}
+
+		// Blob indices are checked as they're read, since there are far more postings than entries
+		auto entries{ GetEntries() };
+		for(DWORD idx = 0; idx < header.dwEntryCount; idx++){
+			if(entries[idx].qwFirstPosting > header.qwPostingCount ||
+			   entries[idx].dwPostingCount > header.qwPostingCount - entries[idx].qwFirstPosting ||
+			   (idx && entries[idx - 1].qwGram >= entries[idx].qwGram)){
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	const NgramIndexHeader& NgramIndex::GetHeader() const {
+		return *reinterpret_cast<const NgramIndexHeader*>(static_cast<LPVOID>(lpView));
+	}
+
+	const NgramIndexEntry* NgramIndex::GetEntries() const {
+		return reinterpret_cast<const NgramIndexEntry*>(reinterpret_cast<const BYTE*>(static_cast<LPVOID>(lpView)) + GetHeader().qwEntriesOffset);
+	}
+
+	const DWORD* NgramIndex::GetUnindexedBlobs() const {
+		return reinterpret_cast<const DWORD*>(reinterpret_cast<const BYTE*>(static_cast<LPVOID>(lpView)) + GetHeader().qwUnindexedOffset);
+	}
+
+	const DWORD* NgramIndex::GetPostings() const {
+		return reinterpret_cast<const DWORD*>(reinterpret_cast<const BYTE*>(static_cast<LPVOID>(lpView)) + GetHeader().qwPostingsOffset);
+	}
+
+	const NgramIndexEntry* NgramIndex::Find(DWORD64 qwGram) const {
+		auto begin{ GetEntries() };
+		auto end{ begin + GetHeader().dwEntryCount };
+		auto entry{ std::lower_bound(begin, end, qwGram, [](const NgramIndexEntry& entry, DWORD64 qwGram){
+			return entry.qwGram < qwGram;
+		}) };
+		return entry != end && entry->qwGram == qwGram ? entry : nullptr;
+	}
+
+	std::optional<std::vector<DWORD>> NgramIndex::FindCandidates(const Patterns::MultiPattern& iocs) const {
+		auto& lower{ Patterns::GetLowerCase() };
+		auto& header{ GetHeader() };
+		auto postings{ GetPostings() };
+
+		std::vector<bool> vCandidates(header.dwBlobCount);
+		for(DWORD dwPattern = 0; dwPattern < iocs.GetPatternCount(); dwPattern++){
+			auto& pattern{ iocs.GetPattern(dwPattern) };
+			if(pattern.empty()){
+				continue;
+			} else if(pattern.length() < 3){
+				return std::nullopt;
+			}
+
+			// A blob containing the indicator contains each of its trigrams, so only the rarest need be checked
+			const NgramIndexEntry* rarest{ nullptr };
+			for(SIZE_T idx = 0; idx + 2 < pattern.length(); idx++){
+				auto entry{ Find(PackGram(lower[pattern[idx]], lower[pattern[idx + 1]], lower[pattern[idx + 2]])) };
+				if(!entry){
+					rarest = nullptr;
+					break;
+				} else if(!rarest || entry->dwPostingCount < rarest->dwPostingCount){
+					rarest = entry;
+				}
+			}
+
+			if(rarest){
+				for(auto posting = rarest->qwFirstPosting; posting < rarest->qwFirstPosting + rarest->dwPostingCount; posting++){
+					if(postings[posting] < header.dwBlobCount){
+						vCandidates[postings[posting]] = true;
+					}
+				}
+			}
+		}
+
+		auto unindexed{ GetUnindexedBlobs() };
+		for(DWORD idx = 0; idx < header.dwUnindexedCount; idx++){
+			if(unindexed[idx] < header.dwBlobCount){
+				vCandidates[unindexed[idx]] = true;
+			}
+		}
+
+		std::vector<DWORD> vBlobs{};
+		for(DWORD dwBlob = 0; dwBlob < header.dwBlobCount; dwBlob++){
+			if(vCandidates[dwBlob]){
+				vBlobs.emplace_back(dwBlob);
+			}
+		}
+		return vBlobs;
+	}
+
+	std::vector<IocMatch> SweepForIocs(const std::vector<RegistryKey>& vRoots, const Patterns::MultiPattern& iocs){
+		auto start{ GetTickCount64() };
+
+		std::vector<IocMatch> vMatches{};
+		std::vector<DWORD> vFound{};
+		std::wstring buffer{};
+		DWORD dwKeys{ 0 };
+		DWORD64 qwValues{ 0 };
+		DWORD64 qwBytes{ 0 };
+
+		std::vector<std::pair<RegistryKey, DWORD>> vStack{};
+		for(auto root = vRoots.rbegin(); root != vRoots.rend(); root++){
+			vStack.emplace_back(*root, 0);
+		}
+		while(vStack.size()){
+			auto key{ vStack.back().first };
+			auto dwDepth{ vStack.back().second };
+			vStack.pop_back();
+			if(!key.Exists()){
+				continue;
+			}
+
+			dwKeys++;
+			key.EnumerateRawValues([&](const std::wstring& wsName, DWORD dwType, const BYTE* lpData, DWORD dwSize){
+				qwValues++;
+				qwBytes += dwSize;
+
+				auto text{ GetSearchText(GetTextKind(dwType), lpData, dwSize, buffer) };
+				vFound.clear();
+				iocs.Search(text.first, text.second, vFound);
+				if(vFound.size()){
+					std::sort(vFound.begin(), vFound.end());
+					vFound.erase(std::unique(vFound.begin(), vFound.end()), vFound.end());
+					for(auto dwPattern : vFound){
+						vMatches.emplace_back(IocMatch{ key.GetName(), wsName, iocs.GetPattern(dwPattern) });
+					}
+				}
+			});
+
+			if(dwDepth < MAX_DEPTH){
+				auto subkeys{ key.EnumerateSubkeys() };
+				for(auto subkey = subkeys.rbegin(); subkey != subkeys.rend(); subkey++){
+					vStack.emplace_back(*subkey, dwDepth + 1);
+				}
+			}
+		}
+
+		LOG_INFO(L"Swept " << qwValues << L" values (" << qwBytes << L" bytes) in " << dwKeys << L" keys for " << iocs.GetPatternCount() <<
+			L" indicators in " << GetTickCount64() - start << L" ms, finding " << vMatches.size() << L" matches");
+		return vMatches;
+	}
+
+	std::vector<IocMatch> SweepSnapshotForIocs(const RegistrySnapshot& snapshot, const Patterns::MultiPattern& iocs,
+		const std::optional<std::wstring>& wsIndexPath){
+		auto start{ GetTickCount64() };
+
+		std::optional<std::vector<DWORD>> candidates{ std::nullopt };
+		if(wsIndexPath){
+			auto index{ NgramIndex::Load(*wsIndexPath, snapshot) };
+			if(!index && NgramIndex::Build(snapshot, *wsIndexPath)){
+				index = NgramIndex::Load(*wsIndexPath, snapshot);
+			}
+			if(index){
+				candidates = index->FindCandidates(iocs);
+				if(!candidates){
+					LOG_INFO(L"Some indicators are too short to be found with the n-gram index; searching every value instead");
+				}
+			}
+		}
+
+		// Group the values by the blob holding their data, noting the kinds of text taken from each blob
+		auto dwBlobs{ snapshot.GetBlobCount() };
+		std::vector<BYTE> vKinds(dwBlobs);
+		std::vector<DWORD> vValueStarts(static_cast<SIZE_T>(dwBlobs) + 1);
+		snapshot.EnumerateValues([&](DWORD dwKey, DWORD dwValue, DWORD dwType, DWORD dwBlob){
+			vValueStarts[dwBlob + 1]++;
+			vKinds[dwBlob] |= GetKindBit(GetTextKind(dwType));
+		});
+		for(DWORD dwBlob = 0; dwBlob < dwBlobs; dwBlob++){
+			vValueStarts[dwBlob + 1] += vValueStarts[dwBlob];
+		}
+
+		// A value in the snapshot: its key, its name, and the kind of text taken from its data
+		struct SnapshotValue {
+			DWORD dwKey;
+			DWORD dwValue;
+			TextKind kind;
+		};
+
+		std::vector<SnapshotValue> vValues(vValueStarts[dwBlobs]);
+		auto vPositions{ vValueStarts };
+		snapshot.EnumerateValues([&](DWORD dwKey, DWORD dwValue, DWORD dwType, DWORD dwBlob){
+			vValues[vPositions[dwBlob]++] = { dwKey, dwValue, GetTextKind(dwType) };
+		});
+
+		std::vector<IocMatch> vMatches{};
+		std::vector<DWORD> vFound{};
+		std::wstring buffer{};
+		DWORD dwSearched{ 0 };
+		auto Search{ [&](DWORD dwBlob){
+			dwSearched++;
+
+			// The blob's text is searched once for each kind, and matches are reported for the values of that kind
+			auto blob{ snapshot.GetBlob(dwBlob) };
+			for(DWORD dwKind = 0; dwKind < TEXT_KIND_COUNT; dwKind++){
+				auto kind{ static_cast<TextKind>(dwKind) };
+				if(kind == TextKind::Numeric || !(vKinds[dwBlob] & GetKindBit(kind))){
+					continue;
+				}
+
+				auto text{ GetSearchText(kind, blob.first, blob.second, buffer) };
+				vFound.clear();
+				iocs.Search(text.first, text.second, vFound);
+				if(vFound.empty()){
+					continue;
+				}
+
+				std::sort(vFound.begin(), vFound.end());
+				vFound.erase(std::unique(vFound.begin(), vFound.end()), vFound.end());
+				for(auto value = vValueStarts[dwBlob]; value < vValueStarts[dwBlob + 1]; value++){
+					if(vValues[value].kind != kind){
+						continue;
+					}
+
+					auto wsKeyPath{ snapshot.GetKeyPath(vValues[value].dwKey) };
+					auto wsValueName{ snapshot.GetValueName(vValues[value].dwValue) };
+					for(auto dwPattern : vFound){
+						vMatches.emplace_back(IocMatch{ wsKeyPath, wsValueName, iocs.GetPattern(dwPattern) });
+					}
+				}
+			}
+		} };
+
+		if(candidates){
+			for(auto dwBlob : *candidates){
+				Search(dwBlob);
+			}
+		} else {
+			for(DWORD dwBlob = 0; dwBlob < dwBlobs; dwBlob++){
+				Search(dwBlob);
+			}
+		}
+
+		LOG_INFO(L"Swept " << dwSearched << L" of " << dwBlobs << L" distinct values in " << snapshot.GetPath() << L" for " <<
+			iocs.GetPatternCount() << L" indicators in " << GetTickCount64() - start << L" ms, finding " << vMatches.size() << L" matches");
+		return vMatches;
+	}
+}
@@ -0,0 +1,410 @@
+#include "util/configurations/OfflineHive.h"
+
+#include <algorithm>
+#include <cwctype>
+
+#include "util/log/Log.h"
+#include "util/accounting/ResourceUsage.h"
+
+namespace Registry {
+
+	namespace {
+		/// The size of the base block preceding the hive bins
+		const DWORD BASE_BLOCK_SIZE{ 0x1000 };
+
+		/// The largest amount of data held in a single cell before big data cells are used
+		const DWORD BIG_DATA_THRESHOLD{ 16344 };
+
+		/// Key cells with this flag have names stored as single byte characters
+		const WORD KEY_COMP_NAME{ 0x0020 };
+
+		/// Value cells with this flag have names stored as single byte characters
+		const WORD VALUE_COMP_NAME{ 0x0001 };
+
+		/// Values with this bit set in their data size hold their data in the data offset field
+		const DWORD DATA_IS_INLINE{ 0x80000000 };
+
+		/// The number of nested index roots followed before a subkey list is considered corrupt
+		const DWORD MAX_INDEX_DEPTH{ 4 };
+
+		/// Reads a field from a cell, which may not be aligned
+		template<class T>
+		T ReadField(const BYTE* lpData, DWORD dwOffset){
+			T value{};
+			CopyMemory(&value, lpData + dwOffset, sizeof(T));
+			return value;
+		}
+
+		bool HasSignature(const BYTE* lpData, const char* signature){
+			return lpData[0] == signature[0] && lpData[1] == signature[1];
+		}
+
+		/// Reads a name stored in a cell, either as single byte characters or as UTF-16
+		std::wstring ReadName(const BYTE* lpName, DWORD dwLength, bool bCompressed){
+			std::wstring name{};
+			if(bCompressed){
+				name.reserve(dwLength);
+				for(DWORD idx = 0; idx < dwLength; idx++){
+					name.push_back(static_cast<WCHAR>(lpName[idx]));
+				}
+			} else {
+				name.resize(dwLength / sizeof(WCHAR));
+				CopyMemory(name.data(), lpName, name.size() * sizeof(WCHAR));
+			}
+			return name;
+		}
+
+		/// Compares a name stored in a cell to another name, ignoring case, without copying it
+		bool NameEquals(const BYTE* lpName, DWORD dwLength, bool bCompressed, const std::wstring& name){
+			auto dwChars{ bCompressed ? dwLength : dwLength / static_cast<DWORD>(sizeof(WCHAR)) };
+			if(dwChars != name.length()){
+				return false;
+			}
+
+			for(DWORD idx = 0; idx < dwChars; idx++){
+				WCHAR ch{ bCompressed ? static_cast<WCHAR>(lpName[idx]) : ReadField<WCHAR>(lpName, idx * sizeof(WCHAR)) };
+				if(ch != name[idx] && std::towupper(ch) != std::towupper(name[idx])){
+					return false;
+				}
+			}
+			return true;
+		}
+	}
+
+	OfflineHive::OfflineHive(const std::wstring& wsPath, LPVOID lpView, SIZE_T dwSize) :
+		wsPath{ wsPath },
+		lpView{ lpView, [](LPVOID lpView){ UnmapViewOfFile(lpView); }, nullptr },
+		dwSize{ dwSize },
+		dwRootCell{ 0 },
+		bBigData{ false }{}
+
+	std::shared_ptr<OfflineHive> OfflineHive::Open(const std::wstring& wsPath){
+		HandleWrapper hFile{ CreateFileW(wsPath.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+			OPEN_EXISTING, 0, nullptr) };
+		if(!hFile){
+			LOG_VERBOSE(1, L"Unable to open hive file " << wsPath << L" (error " << GetLastError() << L")");
+			return nullptr;
+		}
+		Accounting::RecordFileOpened();
+
+		LARGE_INTEGER size{};
+		if(!GetFileSizeEx(hFile, &size) || size.QuadPart < BASE_BLOCK_SIZE || static_cast<ULONGLONG>(size.QuadPart) > MAXDWORD){
+			LOG_ERROR(L"Hive file " << wsPath << L" is not a valid hive");
+			return nullptr;
+		}
+
+		HandleWrapper hMapping{ CreateFileMappingW(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr) };
+		if(!hMapping){
+			LOG_ERROR(L"Unable to map hive file " << wsPath << L" (error " << GetLastError() << L")");
+			return nullptr;
+		}
+
+		// The view remains valid once the file and mapping handles are closed
+		auto lpView{ MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0) };
+		if(!lpView){
+			LOG_ERROR(L"Unable to map hive file " << wsPath << L" (error " << GetLastError() << L")");
+			return nullptr;
+		}
+
+		std::shared_ptr<OfflineHive> hive{ new OfflineHive(wsPath, lpView, static_cast<SIZE_T>(size.QuadPart)) };
+
+		auto lpBase{ reinterpret_cast<const BYTE*>(lpView) };
+		if(lpBase[0] != 'r' || lpBase[1] != 'e' || lpBase[2] != 'g' || lpBase[3] != 'f' || ReadField<DWORD>(lpBase, 0x14) != 1){
+			LOG_ERROR(L"Hive file " << wsPath << L" is not a valid hive");
+			return nullptr;
+		}
+
+		// Anything past the end of the hive bins isn't part of the hive
+		auto dwBinsSize{ ReadField<DWORD>(lpBase, 0x28) };
+		if(dwBinsSize && BASE_BLOCK_SIZE + static_cast<SIZE_T>(dwBinsSize) < hive->dwSize){
+			hive->dwSize = BASE_BLOCK_SIZE + static_cast<SIZE_T>(dwBinsSize);
+		}
+
+		hive->bBigData = ReadField<DWORD>(lpBase, 0x18) > 3;
+		hive->dwRootCell = ReadField<DWORD>(lpBase, 0x24);
+		if(!hive->GetKeyName(hive->dwRootCell)){
+			LOG_ERROR(L"Hive file " << wsPath << L" has an invalid root key");
+			return nullptr;
+		}
+
+		// The sequence numbers only differ if the hive was being written when it was last unloaded
+		if(ReadField<DWORD>(lpBase, 0x04) != ReadField<DWORD>(lpBase, 0x08)){
+			LOG_WARNING(L"Hive file " << wsPath << L" was not cleanly unloaded; changes held only in its transaction logs won't be seen");
+		}
+
+		LOG_VERBOSE(2, L"Opened hive file " << wsPath << L" (" << hive->dwSize << L" bytes)");
+		return hive;
+	}
+
+	std::optional<std::pair<const BYTE*, DWORD>> OfflineHive::GetCell(DWORD dwCell, DWORD dwMinimum) const {
+		auto qwOffset{ static_cast<ULONGLONG>(BASE_BLOCK_SIZE) + dwCell };
+		if(qwOffset + sizeof(LONG) > dwSize){
+			return std::nullopt;
+		}
+
+		auto lpCell{ reinterpret_cast<const BYTE*>(static_cast<LPVOID>(lpView)) + qwOffset };
+
+		// Allocated cells have negative sizes, which include the size field itself
+		auto lSize{ ReadField<LONG>(lpCell, 0) };
+		if(lSize >= 0 || lSize == LONG_MIN){
+			return std::nullopt;
+		}
+
+		auto dwCellSize{ static_cast<DWORD>(-lSize) };
+		if(dwCellSize < sizeof(LONG) || qwOffset + dwCellSize > dwSize || dwCellSize - sizeof(LONG) < dwMinimum){
+			return std::nullopt;
+		}
+
+		return std::make_pair(lpCell + sizeof(LONG), static_cast<DWORD>(dwCellSize - sizeof(LONG)));
+	}
+
+	const std::wstring& OfflineHive::GetPath() const {
+		return wsPath;
+	}
+
+	DWORD OfflineHive::GetRootKey() const {
+		return dwRootCell;
+	}
+
+	std::optional<std::wstring> OfflineHive::GetKeyName(DWORD dwKey) const {
+		auto cell{ GetCell(dwKey, 0x4C) };
+		if(!cell || !HasSignature(cell->first, "nk")){
+			return std::nullopt;
+		}
+
+		auto dwLength{ static_cast<DWORD>(ReadField<WORD>(cell->first, 0x48)) };
+		if(0x4C + dwLength > cell->second){
+			return std::nullopt;
+		}
+
+		return ReadName(cell->first + 0x4C, dwLength, ReadField<WORD>(cell->first, 0x02) & KEY_COMP_NAME);
+	}
+
+	std::optional<FILETIME> OfflineHive::GetKeyLastWriteTime(DWORD dwKey) const {
+		auto cell{ GetCell(dwKey, 0x4C) };
+		if(!cell || !HasSignature(cell->first, "nk")){
+			return std::nullopt;
+		}
+
+		return ReadField<FILETIME>(cell->first, 0x04);
+	}
+
+	void OfflineHive::AddSubkeys(DWORD dwList, std::vector<DWORD>& vSubkeys, DWORD dwDepth) const {
+		auto cell{ GetCell(dwList, 4) };
+		if(!cell){
+			return;
+		}
+
+		auto lpList{ cell->first };
+		auto dwCount{ static_cast<DWORD>(ReadField<WORD>(lpList, 0x02)) };
+		if(HasSignature(lpList, "lf") || HasSignature(lpList, "lh")){
+			// Each element holds the offset of a key and a hint used to speed up lookups
+			for(DWORD idx = 0; idx < dwCount && 4 + idx * 8 + 4 <= cell->second; idx++){
+				vSubkeys.emplace_back(ReadField<DWORD>(lpList, 4 + idx * 8));
+			}
+		} else if(HasSignature(lpList, "li")){
+			for(DWORD idx = 0; idx < dwCount && 4 + idx * 4 + 4 <= cell->second; idx++){
+				vSubkeys.emplace_back(ReadField<DWORD>(lpList, 4 + idx * 4));
+			}
+		} else if(HasSignature(lpList, "ri") && dwDepth < MAX_INDEX_DEPTH){
+			for(DWORD idx = 0; idx < dwCount && 4 + idx * 4 + 4 <= cell->second; idx++){
+				AddSubkeys(ReadField<DWORD>(lpList, 4 + idx * 4), vSubkeys, dwDepth + 1);
+			}
+		}
+	}
+
+	std::vector<DWORD> OfflineHive::GetSubkeys(DWORD dwKey) const {
+		auto cell{ GetCell(dwKey, 0x4C) };
+		if(!cell || !HasSignature(cell->first, "nk") || !ReadField<DWORD>(cell->first, 0x14)){
+			return {};
+		}
+
+		std::vector<DWORD> vSubkeys{};
+		AddSubkeys(ReadField<DWORD>(cell->first, 0x1C), vSubkeys, 0);
+		return vSubkeys;
+	}
+
+	std::optional<DWORD> OfflineHive::FindKey(DWORD dwKey, const std::wstring& path) const {
+		SIZE_T start{ 0 };
+		while(start <= path.length()){
+			auto end{ path.find(L'\\', start) };
+			if(end == std::wstring::npos){
+				end = path.length();
+			}
+
+			// Empty components, such as those from leading or doubled backslashes, are skipped
+			if(end > start){
+				auto name{ path.substr(start, end - start) };
+
+				std::optional<DWORD> found{ std::nullopt };
+				for(auto dwSubkey : GetSubkeys(dwKey)){
+					auto cell{ GetCell(dwSubkey, 0x4C) };
+					if(!cell || !HasSignature(cell->first, "nk")){
+						continue;
+					}
+
+					auto dwLength{ static_cast<DWORD>(ReadField<WORD>(cell->first, 0x48)) };
+					if(0x4C + dwLength <= cell->second &&
+						NameEquals(cell->first + 0x4C, dwLength, ReadField<WORD>(cell->first, 0x02) & KEY_COMP_NAME, name)){
+						found = dwSubkey;
+						break;
+					}
+				}
+
+				if(!found){
+					return std::nullopt;
+				}
+				dwKey = *found;
+			}
+
+			start = end + 1;
+		}
+
+		return dwKey;
+	}
+
+	std::vector<DWORD> OfflineHive::GetValues(DWORD dwKey) const {
+		auto cell{ GetCell(dwKey, 0x4C) };
+		if(!cell || !HasSignature(cell->first, "nk")){
+			return {};
+		}
+
+		auto dwCount{ ReadField<DWORD>(cell->first, 0x24) };
+		if(!dwCount){
+			return {};
+		}
+
+		auto list{ GetCell(ReadField<DWORD>(cell->first, 0x28)) };
+		if(!list){
+			return {};
+		}
+
+		std::vector<DWORD> vValues{};
+		for(DWORD idx = 0; idx < dwCount && (idx + 1) * sizeof(DWORD) <= list->second; idx++){
+			vValues.emplace_back(ReadField<DWORD>(list->first, idx * sizeof(DWORD)));
+		}
+		return vValues;
+	}
+
+	std::optional<DWORD> OfflineHive::FindValue(DWORD dwKey, const std::wstring& name) const {
+		for(auto dwValue : GetValues(dwKey)){
+			auto cell{ GetCell(dwValue, 0x14) };
+			if(!cell || !HasSignature(cell->first, "vk")){
+				continue;
+			}
+
+			auto dwLength{ static_cast<DWORD>(ReadField<WORD>(cell->first, 0x02)) };
+			if(0x14 + dwLength <= cell->second &&
+				NameEquals(cell->first + 0x14, dwLength, ReadField<WORD>(cell->first, 0x10) & VALUE_COMP_NAME, name)){
+				return dwValue;
+			}
+		}
+		return std::nullopt;
+	}
+
+	std::optional<std::wstring> OfflineHive::GetValueName(DWORD dwValue) const {
+		auto cell{ GetCell(dwValue, 0x14) };
+		if(!cell || !HasSignature(cell->first, "vk")){
+			return std::nullopt;
+		}
+
+		auto dwLength{ static_cast<DWORD>(ReadField<WORD>(cell->first, 0x02)) };
+		if(0x14 + dwLength > cell->second){
+			return std::nullopt;
+		}
+
+		return ReadName(cell->first + 0x14, dwLength, ReadField<WORD>(cell->first, 0x10) & VALUE_COMP_NAME);
+	}
+
+	std::optional<DWORD> OfflineHive::GetValueType(DWORD dwValue) const {
+		auto cell{ GetCell(dwValue, 0x14) };
+		if(!cell || !HasSignature(cell->first, "vk")){
+			return std::nullopt;
+		}
+
+		return ReadField<DWORD>(cell->first, 0x0C);
+	}
+
+	std::optional<std::pair<const BYTE*, DWORD>> OfflineHive::GetValueData(DWORD dwValue, std::vector<BYTE>& buffer) const {
+		auto cell{ GetCell(dwValue, 0x14) };
+		if(!cell || !HasSignature(cell->first, "vk")){
+			return std::nullopt;
+		}
+
+		auto dwDataSize{ ReadField<DWORD>(cell->first, 0x04) };
+		auto dwDataOffset{ ReadField<DWORD>(cell->first, 0x08) };
+
+		// Data of up to four bytes is held in place of the offset
+		if(dwDataSize & DATA_IS_INLINE){
+			return std::make_pair(cell->first + 0x08, (std::min)(dwDataSize & ~DATA_IS_INLINE, static_cast<DWORD>(sizeof(DWORD))));
+		}
+
+		if(!dwDataSize){
+			return std::make_pair(cell->first, DWORD{ 0 });
+		}
+
+		if(bBigData && dwDataSize > BIG_DATA_THRESHOLD){
+			auto header{ GetCell(dwDataOffset, 8) };
+			if(header && HasSignature(header->first, "db")){
+				auto dwSegments{ static_cast<DWORD>(ReadField<WORD>(header->first, 0x02)) };
+				auto list{ GetCell(ReadField<DWORD>(header->first, 0x04)) };
+				if(!list){
+					return std::nullopt;
+				}
+
+				buffer.clear();
+				buffer.reserve(dwDataSize);
+				for(DWORD idx = 0; idx < dwSegments && (idx + 1) * sizeof(DWORD) <= list->second && buffer.size() < dwDataSize; idx++){
+					auto segment{ GetCell(ReadField<DWORD>(list->first, idx * sizeof(DWORD))) };
+					if(!segment){
+						return std::nullopt;
+					}
+
+					auto dwCopied{ (std::min)({ segment->second, BIG_DATA_THRESHOLD, static_cast<DWORD>(dwDataSize - buffer.size()) }) };
+					buffer.insert(buffer.end(), segment->first, segment->first + dwCopied);
+				}
+				return std::make_pair(static_cast<const BYTE*>(buffer.data()), static_cast<DWORD>(buffer.size()));
+			}
+		}
+
+		auto data{ GetCell(dwDataOffset) };
+		if(!data){
+			return std::nullopt;
+		}
+		return std::make_pair(data->first, (std::min)(dwDataSize, data->second));
+	}
+
+	std::vector<RegistryKey> GetUnloadedUserHives(){
+		std::vector<RegistryKey> vHives{};
+
+		RegistryKey profiles{ HKEY_LOCAL_MACHINE, L"SOFTWARE\\Microsoft\\Windows NT\\CurrentVersion\\ProfileList" };
+		for(auto& sid : profiles.EnumerateSubkeyNames()){
+			if(RegistryKey{ HKEY_USERS, sid }.Exists()){
+				continue;
+			}
+
+			auto path{ RegistryKey{ profiles, sid }.GetValue<std::wstring>(L"ProfileImagePath") };
+			if(!path){
+				continue;
+			}
+
+			std::vector<WCHAR> expanded(MAX_PATH);
+			auto dwLength{ ExpandEnvironmentStringsW(path->c_str(), expanded.data(), static_cast<DWORD>(expanded.size())) };
+			if(dwLength > expanded.size()){
+				expanded.resize(dwLength);
+				dwLength = ExpandEnvironmentStringsW(path->c_str(), expanded.data(), static_cast<DWORD>(expanded.size()));
+			}
+			if(!dwLength || dwLength > expanded.size()){
+				continue;
+			}
+
+			auto hive{ RegistryKey::OpenHiveFile(std::wstring{ expanded.data() } + L"\\NTUSER.DAT") };
+			if(hive.Exists()){
+				LOG_VERBOSE(1, L"Including the unloaded hive of " << sid << L" from " << hive.GetName());
+				vHives.emplace_back(hive);
+			}
+		}
+
+		return vHives;
+	}
+}
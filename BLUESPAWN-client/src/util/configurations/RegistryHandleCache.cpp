@@ -0,0 +1,210 @@
+#include "util/configurations/RegistryHandleCache.h"
+
+#include <vector>
+
+#include "common/StringUtils.h"
+
+namespace Registry {
+
+	namespace {
+		/// Indicates whether a handle is one of the predefined hive keys, such as HKEY_LOCAL_MACHINE, which are never closed
+		bool IsPredefinedKey(HKEY hkKey){
+			return (ULONG_PTR(hkKey) & 0xFFFFFFFF80000000) != 0;
+		}
+	}
+
+	KeyHandle::KeyHandle(HKEY hkKey) :
+		hkKey{ hkKey },
+		name{ std::nullopt }{}
+
+	KeyHandle::~KeyHandle(){
+		if(hkKey && !IsPredefinedKey(hkKey)){
+			KeyHandleCache::GetInstance().Untrack(hkKey);
+			CloseHandle(hkKey);
+		}
+	}
+
+	HKEY KeyHandle::GetHandle() const {
+		return hkKey;
+	}
+
+	std::wstring KeyHandle::GetName(std::wstring(*query)(HKEY)){
+		auto lock{ BeginCriticalSection(hSection) };
+		if(name){
+			KeyHandleCache::GetInstance().RecordNameReused();
+		} else {
+			auto queried{ query(hkKey) };
+
+			// A failed query isn't remembered so that it may be retried
+			if(queried.empty()){
+				return queried;
+			}
+			name = std::move(queried);
+		}
+		return *name;
+	}
+
+	KeyHandleCache::KeyHandleCache() :
+		lEnabledCount{ 0 },
+		dwHandlesReused{ 0 },
+		dwNamesReused{ 0 }{}
+
+	KeyHandleCache& KeyHandleCache::GetInstance(){
+		// Constructed on first use, since keys may be created while other static objects are initialized
+		static KeyHandleCache instance{};
+		return instance;
+	}
+
+	KeyHandleCache::Shard& KeyHandleCache::GetShard(HKEY hkKey){
+		// Handle values are multiples of four, so the low bits are discarded
+		return shards[(ULONG_PTR(hkKey) >> 2) % SHARD_COUNT];
+	}
+
+	KeyHandleCache::Shard& KeyHandleCache::GetShard(const std::wstring& wsCacheKey){
+		return shards[std::hash<std::wstring>{}(wsCacheKey) % SHARD_COUNT];
+	}
+
+	std::shared_ptr<KeyHandle> KeyHandleCache::Track(HKEY hkKey){
+		if(!hkKey || IsPredefinedKey(hkKey)){
+			return std::make_shared<KeyHandle>(hkKey);
+		}
+
+		auto& shard{ GetShard(hkKey) };
+		auto lock{ BeginCriticalSection(shard.hSection) };
+
+		auto existing{ shard.mHandles.find(hkKey) };
+		if(existing != shard.mHandles.end()){
+			auto handle{ existing->second.lock() };
+			if(handle){
+				return handle;
+			}
+		}
+
+		auto handle{ std::make_shared<KeyHandle>(hkKey) };
+		shard.mHandles[hkKey] = handle;
+		return handle;
+	}
+
+	void KeyHandleCache::Untrack(HKEY hkKey){
+		auto& shard{ GetShard(hkKey) };
+		auto lock{ BeginCriticalSection(shard.hSection) };
+
+		// If the handle was tracked again while its previous KeyHandle was being destroyed, the new entry is kept
+		auto existing{ shard.mHandles.find(hkKey) };
+		if(existing != shard.mHandles.end() && existing->second.expired()){
+			shard.mHandles.erase(existing);
+		}
+	}
+
+	std::optional<std::wstring> KeyHandleCache::GetCacheKey(HKEY hkBase, const std::wstring& path, bool bWow64) const {
+		if(lEnabledCount <= 0 || !hkBase){
+			return std::nullopt;
+		}
+
+		std::wstring wsBase{};
+		if(IsPredefinedKey(hkBase)){
+			wsBase = std::to_wstring(ULONG_PTR(hkBase));
+		} else {
+			std::shared_ptr<KeyHandle> base{ nullptr };
+			{
+				auto& shard{ const_cast<KeyHandleCache*>(this)->GetShard(hkBase) };
+				auto lock{ BeginCriticalSection(shard.hSection) };
+
+				auto existing{ shard.mHandles.find(hkBase) };
+				if(existing != shard.mHandles.end()){
+					base = existing->second.lock();
+				}
+			}
+			if(!base || base->wsCacheKey.empty()){
+				return std::nullopt;
+			}
+
+			// The base must still be cached; a handle left over from before the cache was last cleared may
+			// refer to a key that has since been deleted and recreated
+			auto& shard{ const_cast<KeyHandleCache*>(this)->GetShard(base->wsCacheKey) };
+			auto lock{ BeginCriticalSection(shard.hSection) };
+
+			auto cached{ shard.mCache.find(base->wsCacheKey) };
+			if(cached == shard.mCache.end() || cached->second != base){
+				return std::nullopt;
+			}
+			wsBase = base->wsCacheKey;
+		}
+
+		return wsBase + (bWow64 ? L"|32|" : L"|64|") + ToLowerCaseW(path);
+	}
+
+	std::shared_ptr<KeyHandle> KeyHandleCache::Find(const std::wstring& wsCacheKey){
+		auto& shard{ GetShard(wsCacheKey) };
+		auto lock{ BeginCriticalSection(shard.hSection) };
+
+		auto existing{ shard.mCache.find(wsCacheKey) };
+		if(existing == shard.mCache.end()){
+			return nullptr;
+		}
+
+		dwHandlesReused++;
+		return existing->second;
+	}
+
+	std::shared_ptr<KeyHandle> KeyHandleCache::Insert(const std::wstring& wsCacheKey, const std::shared_ptr<KeyHandle>& handle){
+		if(lEnabledCount <= 0){
+			return handle;
+		}
+
+		auto& shard{ GetShard(wsCacheKey) };
+		auto lock{ BeginCriticalSection(shard.hSection) };
+
+		auto existing{ shard.mCache.find(wsCacheKey) };
+		if(existing != shard.mCache.end()){
+			return existing->second;
+		}
+
+		// Set before the handle is shared, so other threads never see it change
+		if(handle->wsCacheKey.empty()){
+			handle->wsCacheKey = wsCacheKey;
+		}
+		shard.mCache.emplace(wsCacheKey, handle);
+		return handle;
+	}
+
+	void KeyHandleCache::RecordNameReused(){
+		dwNamesReused++;
+	}
+
+	void KeyHandleCache::Enable(){
+		lEnabledCount++;
+	}
+
+	void KeyHandleCache::Disable(){
+		if(--lEnabledCount > 0){
+			return;
+		}
+
+		// The handles are released outside of the shard locks, since closing them untracks them
+		std::vector<std::shared_ptr<KeyHandle>> vReleased{};
+		for(auto& shard : shards){
+			auto lock{ BeginCriticalSection(shard.hSection) };
+			for(auto& entry : shard.mCache){
+				vReleased.emplace_back(std::move(entry.second));
+			}
+			shard.mCache.clear();
+		}
+	}
+
+	DWORD KeyHandleCache::GetHandlesReused() const {
+		return dwHandlesReused;
+	}
+
+	DWORD KeyHandleCache::GetNamesReused() const {
+		return dwNamesReused;
+	}
+
+	BeginHandleCaching::BeginHandleCaching(){
+		KeyHandleCache::GetInstance().Enable();
+	}
+
+	BeginHandleCaching::~BeginHandleCaching(){
+		KeyHandleCache::GetInstance().Disable();
+	}
+}
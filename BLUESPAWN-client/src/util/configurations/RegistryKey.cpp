@@ -4,8 +4,11 @@
 #include <optional>
 
 #include "util/configurations/Registry.h"
+#include "util/configurations/RegistryValue.h"
+#include "util/configurations/OfflineHive.h"
 #include "common/StringUtils.h"
 #include "common/Internals.h"
+#include "util/accounting/ResourceUsage.h"
 
 LINK_FUNCTION(NtQueryKey, ntdll.dll);
 LINK_FUNCTION(NtQueryValueKey, ntdll.dll);
@@ -37,154 +40,247 @@ namespace Registry {
 		{HKEY_CURRENT_CONFIG, L"HKEY_CURRENT_CONFIG"},
 	};
 
-	std::map<HKEY, int> RegistryKey::_ReferenceCounts = {};
+	namespace {
+		/// Queries the name of the key referenced by a handle, with the hive named as it is in the registry editor
+		std::wstring QueryKeyName(HKEY hkKey){
+			// Taken largely from https://stackoverflow.com/questions/937044/determine-path-to-registry-key-from-hkey-handle-in-c
+			std::wstring keyPath = {};
+			if(hkKey && Linker::NtQueryKey){
+				DWORD size = 0;
+				DWORD result = 0;
+				result = Linker::NtQueryKey(hkKey, 3, 0, 0, &size);
+				if(result == ((NTSTATUS) 0xC0000023L)){
+					size = size + sizeof(wchar_t);
+					wchar_t* buffer = new wchar_t[size / sizeof(wchar_t)];
+					if(buffer != NULL){
+						result = Linker::NtQueryKey(hkKey, 3, buffer, size, &size);
+						if(result == 0){
+							buffer[size / sizeof(wchar_t)] = L'\0';
+							keyPath = std::wstring(buffer + 2);
+						}
+						delete[] buffer;
+						auto location = keyPath.find(L"\\REGISTRY\\MACHINE");
+						if(location != std::string::npos){
+							keyPath.replace(location, 17, L"HKEY_LOCAL_MACHINE");
+						}
+						location = keyPath.find(L"\\REGISTRY\\USER");
+						if(location != std::string::npos){
+							keyPath.replace(location, 14, L"HKEY_USERS");
+						}
+					}
+				}
+			}
+			return keyPath;
+		}
+
+		/// Retrieves the type as which a value of the given registry datatype is read
+		RegistryType GetRegistryType(DWORD dwType){
+			if(dwType == REG_SZ){
+				return RegistryType::REG_SZ_T;
+			} else if(dwType == REG_EXPAND_SZ){
+				return RegistryType::REG_EXPAND_SZ_T;
+			} else if(dwType == REG_MULTI_SZ){
+				return RegistryType::REG_MULTI_SZ_T;
+			} else if(dwType == REG_DWORD){
+				return RegistryType::REG_DWORD_T;
+			}
+
+			return RegistryType::REG_BINARY_T;
+		}
+
+		/**
+		 * The buffer into which GetValueView reads values. Views of the data in it are handed out, so it's only
+		 * resized when a value doesn't fit, and is never shared between threads.
+		 */
+		thread_local std::vector<BYTE> vViewBuffer(sizeof(KEY_VALUE_PARTIAL_INFORMATION) + 512);
+	}
 	
 	RegistryKey::RegistryKey(const RegistryKey& key) noexcept :
+		handle{ key.handle },
+		hkBackingKey{ key.hkBackingKey },
 		bKeyExists{ key.bKeyExists },
 		bWow64{ key.bWow64 },
-		hkBackingKey{ key.hkBackingKey }{
-
-		if(_ReferenceCounts.find(hkBackingKey) == _ReferenceCounts.end()){
-			_ReferenceCounts[hkBackingKey] = 1;
-		} else {
-			_ReferenceCounts[hkBackingKey]++;
-		}
-	}
+		hkHive{ key.hkHive },
+		path{ key.path },
+		offlineHive{ key.offlineHive },
+		dwOfflineCell{ key.dwOfflineCell },
+		wsOfflineName{ key.wsOfflineName }{}
 
 	RegistryKey& RegistryKey::operator=(const RegistryKey& key) noexcept {
+		this->handle = key.handle;
+		this->hkBackingKey = key.hkBackingKey;
 		this->bKeyExists = key.bKeyExists;
 		this->bWow64 = key.bWow64;
-		this->hkBackingKey = key.hkBackingKey;
-
-		if(_ReferenceCounts.find(hkBackingKey) == _ReferenceCounts.end()){
-			_ReferenceCounts[hkBackingKey] = 1;
-		} else {
-			_ReferenceCounts[hkBackingKey]++;
-		}
+		this->hkHive = key.hkHive;
+		this->path = key.path;
+		this->offlineHive = key.offlineHive;
+		this->dwOfflineCell = key.dwOfflineCell;
+		this->wsOfflineName = key.wsOfflineName;
 
 		return *this;
 	}
 
 	RegistryKey::RegistryKey(RegistryKey&& key) noexcept :
+		handle{ std::move(key.handle) },
+		hkBackingKey{ key.hkBackingKey },
 		bKeyExists{ key.bKeyExists },
 		bWow64{ key.bWow64 },
-		hkBackingKey{ key.hkBackingKey }{
+		hkHive{ key.hkHive },
+		path{ std::move(key.path) },
+		offlineHive{ std::move(key.offlineHive) },
+		dwOfflineCell{ key.dwOfflineCell },
+		wsOfflineName{ std::move(key.wsOfflineName) }{
 
 		key.bKeyExists = false;
 		key.bWow64 = false;
 		key.path = {};
 		key.hkHive = nullptr;
 		key.hkBackingKey = nullptr;
+		key.dwOfflineCell = 0;
 	}
 
 	RegistryKey& RegistryKey::operator=(RegistryKey&& key) noexcept {
+		this->handle = std::move(key.handle);
+		this->hkBackingKey = key.hkBackingKey;
 		this->bKeyExists = key.bKeyExists;
 		this->bWow64 = key.bWow64;
-		this->hkBackingKey = key.hkBackingKey;
+		this->hkHive = key.hkHive;
+		this->path = std::move(key.path);
+		this->offlineHive = std::move(key.offlineHive);
+		this->dwOfflineCell = key.dwOfflineCell;
+		this->wsOfflineName = std::move(key.wsOfflineName);
 
 		key.bKeyExists = false;
 		key.bWow64 = false;
 		key.path = {};
 		key.hkHive = nullptr;
 		key.hkBackingKey = nullptr;
+		key.dwOfflineCell = 0;
 
 		return *this;
 	}
 
 	/// TODO - Add smart WoW64 checking
 	RegistryKey::RegistryKey(HKEY key) :
+		handle{ KeyHandleCache::GetInstance().Track(key) },
+		hkBackingKey{ key },
 		bKeyExists{ true },
-		bWow64{ false },
-		hkBackingKey{ key }{
-
+		bWow64{ false }{}
 
-		if(_ReferenceCounts.find(hkBackingKey) == _ReferenceCounts.end()){
-			_ReferenceCounts[hkBackingKey] = 1;
-		} else {
-			_ReferenceCounts[hkBackingKey]++;
-		}
-	}
+	RegistryKey::RegistryKey(HKEY hive, std::wstring path, bool WoW64) :
+		hkBackingKey{ nullptr },
+		bKeyExists{ false }{
 
-	RegistryKey::RegistryKey(HKEY hive, std::wstring path, bool WoW64){
 		auto wLowerPath = ToLowerCase(path);
 
 		bWow64 = WoW64 || wLowerPath.find(L"wow6432node") != std::wstring::npos;
-		LSTATUS status = RegOpenKeyExW(hive, path.c_str(), 0, KEY_ALL_ACCESS | (bWow64 ? KEY_WOW64_32KEY : KEY_WOW64_64KEY), &hkBackingKey);
-		if(status == ERROR_ACCESS_DENIED){
-			status = RegOpenKeyExW(hive, path.c_str(), 0, KEY_READ | KEY_NOTIFY | (bWow64 ? KEY_WOW64_32KEY : KEY_WOW64_64KEY), &hkBackingKey);
-		}
+		Open(hive, path);
+	}
 
-		if(status != ERROR_SUCCESS){
-			bKeyExists = false;
+	RegistryKey::RegistryKey(const RegistryKey& base, std::wstring path, bool WoW64) :
+		hkBackingKey{ nullptr },
+		bKeyExists{ false }{
 
-			this->hkHive = hive;
-			this->path = path;
-		} else {
-			bKeyExists = true;
+		auto wLowerPath = ToLowerCase(path);
 
-			if(_ReferenceCounts.find(hkBackingKey) == _ReferenceCounts.end()){
-				_ReferenceCounts[hkBackingKey] = 1;
-			} else {
-				_ReferenceCounts[hkBackingKey]++;
+		bWow64 = WoW64 || wLowerPath.find(L"wow6432node") != std::wstring::npos;
+		if(base.offlineHive){
+			auto cell{ base.offlineHive->FindKey(base.dwOfflineCell, path) };
+			if(cell){
+				offlineHive = base.offlineHive;
+				dwOfflineCell = *cell;
+				wsOfflineName = base.wsOfflineName + L"\\" + path;
+				bKeyExists = true;
 			}
+		} else {
+			Open(base, path);
 		}
 	}
+
+	RegistryKey::RegistryKey(const std::shared_ptr<OfflineHive>& hive, DWORD dwCell, const std::wstring& name) :
+		hkBackingKey{ nullptr },
+		bKeyExists{ hive != nullptr },
+		bWow64{ false },
+		offlineHive{ hive },
+		dwOfflineCell{ dwCell },
+		wsOfflineName{ name }{}
+
+	RegistryKey RegistryKey::OpenHiveFile(const std::wstring& wsFilePath){
+		auto hive{ OfflineHive::Open(wsFilePath) };
+		return RegistryKey{ hive, hive ? hive->GetRootKey() : 0, wsFilePath };
+	}
 	
-	RegistryKey::RegistryKey(std::wstring name, bool WoW64){
+	RegistryKey::RegistryKey(std::wstring name, bool WoW64) :
+		hkBackingKey{ nullptr },
+		bKeyExists{ false },
+		bWow64{ false }{
+
 		name = ToUpperCase(name);
 
 		SIZE_T slash = name.find_first_of(L"/\\");
 
 		std::wstring HiveName = slash == std::wstring::npos ? name : name.substr(0, slash);
 
-		if(vHiveNames.find(HiveName) == vHiveNames.end()){
-			this->bKeyExists = false;
-			this->bWow64 = false;
-			this->hkBackingKey = nullptr;
-		}
-
-		else {
+		if(vHiveNames.find(HiveName) != vHiveNames.end()){
 			hkHive = vHiveNames[HiveName];
 
-			if(slash == name.length()){
+			if(slash == std::wstring::npos || slash + 1 == name.length()){
+				this->handle = KeyHandleCache::GetInstance().Track(hkHive);
 				this->bKeyExists = true;
-				this->bWow64 = false;
 				this->hkBackingKey = hkHive;
 			}
 
 			else {
-				path = name.substr(slash + 1, name.length());
-				auto wLowerPath = ToLowerCase(path);
+				auto wLowerPath = ToLowerCase(name.substr(slash + 1, name.length()));
 
 				bWow64 = WoW64 || wLowerPath.find(L"wow6432node") != std::wstring::npos;
-				LSTATUS status = RegOpenKeyEx(hkHive, path.c_str(), 0, KEY_ALL_ACCESS | (WoW64 ? KEY_WOW64_32KEY : KEY_WOW64_64KEY), &hkBackingKey);
-				if(status == ERROR_ACCESS_DENIED){
-					status = RegOpenKeyEx(hkHive, path.c_str(), 0, KEY_READ | KEY_NOTIFY | (WoW64 ? KEY_WOW64_32KEY : KEY_WOW64_64KEY), &hkBackingKey);
-				}
-
-				if(status == ERROR_SUCCESS){
-					if(_ReferenceCounts.find(hkBackingKey) == _ReferenceCounts.end()){
-						_ReferenceCounts[hkBackingKey] = 1;
-					} else {
-						_ReferenceCounts[hkBackingKey]++;
-					}
-
-					bKeyExists = true;
-				} else {
-					bKeyExists = false;
-				}
+				Open(hkHive, name.substr(slash + 1, name.length()));
 			}
 		}
 	}
 
-	RegistryKey::~RegistryKey(){
-		if(_ReferenceCounts.find(hkBackingKey) != _ReferenceCounts.end()){
-			if(!--_ReferenceCounts[hkBackingKey] && !(ULONG_PTR(hkBackingKey) & 0xFFFFFFFF80000000)){
-				CloseHandle(hkBackingKey);
+	void RegistryKey::Open(HKEY hkBase, const std::wstring& path){
+		this->hkHive = hkBase;
+		this->path = path;
+
+		auto& cache{ KeyHandleCache::GetInstance() };
+		auto wsCacheKey{ cache.GetCacheKey(hkBase, path, bWow64) };
+		if(wsCacheKey){
+			auto cached{ cache.Find(*wsCacheKey) };
+			if(cached){
+				handle = cached;
+				hkBackingKey = handle->GetHandle();
+				bKeyExists = true;
+				return;
 			}
 		}
+
+		HKEY hkKey{ nullptr };
+		auto view{ bWow64 ? KEY_WOW64_32KEY : KEY_WOW64_64KEY };
+		LSTATUS status = RegOpenKeyExW(hkBase, path.c_str(), 0, KEY_ALL_ACCESS | view, &hkKey);
+		if(status == ERROR_ACCESS_DENIED){
+			status = RegOpenKeyExW(hkBase, path.c_str(), 0, KEY_READ | KEY_NOTIFY | view, &hkKey);
+		}
+
+		// Keys that don't exist aren't cached, since they may be created later in the run
+		if(status != ERROR_SUCCESS){
+			bKeyExists = false;
+			hkBackingKey = nullptr;
+			return;
+		}
+
+		Accounting::RecordRegistryKeyOpened();
+
+		handle = cache.Track(hkKey);
+		if(wsCacheKey){
+			handle = cache.Insert(*wsCacheKey, handle);
+		}
+		hkBackingKey = handle->GetHandle();
+		bKeyExists = true;
 	}
 
+	RegistryKey::~RegistryKey(){}
+
 	bool RegistryKey::Exists() const {
 		return bKeyExists;
 	}
@@ -194,6 +290,10 @@ namespace Registry {
 			return false;
 		}
 
+		if(offlineHive){
+			return offlineHive->FindValue(dwOfflineCell, wsValueName).has_value();
+		}
+
 		UNICODE_STRING RegistryKeyName{ 
 			static_cast<USHORT>(wsValueName.length() * 2), 
 			static_cast<USHORT>(wsValueName.length() * 2), 
@@ -216,15 +316,14 @@ namespace Registry {
 			return false;
 		}
 
-		LSTATUS status = RegCreateKeyEx(hkHive, path.c_str(), 0, nullptr, 0, KEY_ALL_ACCESS, nullptr, &hkBackingKey, nullptr);
+		HKEY hkKey{ nullptr };
+		LSTATUS status = RegCreateKeyEx(hkHive, path.c_str(), 0, nullptr, 0, KEY_ALL_ACCESS, nullptr, &hkKey, nullptr);
 		if(status == ERROR_SUCCESS){
+			handle = KeyHandleCache::GetInstance().Track(hkKey);
+			hkBackingKey = hkKey;
 			bKeyExists = true;
 
-			if(_ReferenceCounts.find(hkBackingKey) == _ReferenceCounts.end()){
-				_ReferenceCounts[hkBackingKey] = 1;
-			} else {
-				_ReferenceCounts[hkBackingKey]++;
-			}
+			Accounting::RecordRegistryKeyOpened();
 
 			return true;
 		}
@@ -234,12 +333,65 @@ namespace Registry {
 		return false;
 	}
 
+	std::optional<ValueView> RegistryKey::GetValueView(const std::wstring& wsValueName) const {
+		if(!Exists()){
+			SetLastError(FILE_DOES_NOT_EXIST);
+			return std::nullopt;
+		}
+
+		if(offlineHive){
+			auto value{ offlineHive->FindValue(dwOfflineCell, wsValueName) };
+			auto dwType{ value ? offlineHive->GetValueType(*value) : std::nullopt };
+			auto data{ dwType ? offlineHive->GetValueData(*value, vViewBuffer) : std::nullopt };
+			if(!data){
+				SetLastError(ERROR_FILE_NOT_FOUND);
+				return std::nullopt;
+			}
+			return ValueView{ *dwType, data->first, data->second };
+		}
+
+		UNICODE_STRING RegistryKeyName{
+			static_cast<USHORT>(wsValueName.length() * 2),
+			static_cast<USHORT>(wsValueName.length() * 2),
+			const_cast<PWSTR>(wsValueName.c_str())
+		};
+
+		ULONG size{};
+		NTSTATUS status{ Linker::NtQueryValueKey(hkBackingKey, &RegistryKeyName, 2, vViewBuffer.data(), static_cast<ULONG>(vViewBuffer.size()), &size) }; //2 is KeyValuePartialInformation
+		if(status == ((NTSTATUS) 0x80000005L) || status == ((NTSTATUS) 0xC0000023L)){ //STATUS_BUFFER_OVERFLOW or STATUS_BUFFER_TOO_SMALL
+			vViewBuffer.resize(size);
+			status = Linker::NtQueryValueKey(hkBackingKey, &RegistryKeyName, 2, vViewBuffer.data(), static_cast<ULONG>(vViewBuffer.size()), &size);
+		}
+
+		if(!NT_SUCCESS(status)){
+			SetLastError(status);
+			return std::nullopt;
+		}
+
+		auto KeyValueInfo{ reinterpret_cast<KEY_VALUE_PARTIAL_INFORMATION*>(vViewBuffer.data()) };
+		return ValueView{ KeyValueInfo->Type, KeyValueInfo->Data, KeyValueInfo->DataLength };
+	}
+
 	AllocationWrapper RegistryKey::GetRawValue(const std::wstring& ValueName) const {
 		if(!Exists()){
 			SetLastError(FILE_DOES_NOT_EXIST);
 			return { nullptr, 0 };
 		}
 
+		if(offlineHive){
+			std::vector<BYTE> buffer{};
+			auto value{ offlineHive->FindValue(dwOfflineCell, ValueName) };
+			auto data{ value ? offlineHive->GetValueData(*value, buffer) : std::nullopt };
+			if(!data){
+				SetLastError(ERROR_FILE_NOT_FOUND);
+				return { nullptr, 0 };
+			}
+
+			auto lpbValue = new BYTE[data->second];
+			MoveMemory(lpbValue, data->first, data->second);
+			return { lpbValue, data->second, AllocationWrapper::CPP_ARRAY_ALLOC };
+		}
+
 		UNICODE_STRING RegistryKeyName{
 			static_cast<USHORT>(ValueName.length() * 2),
 			static_cast<USHORT>(ValueName.length() * 2),
@@ -274,6 +426,16 @@ namespace Registry {
 			return std::nullopt;
 		}
 
+		if(offlineHive){
+			auto value{ offlineHive->FindValue(dwOfflineCell, ValueName) };
+			auto dwType{ value ? offlineHive->GetValueType(*value) : std::nullopt };
+			if(!dwType){
+				SetLastError(ERROR_FILE_NOT_FOUND);
+				return std::nullopt;
+			}
+			return GetRegistryType(*dwType);
+		}
+
 		UNICODE_STRING RegistryKeyName{
 			static_cast<USHORT>(ValueName.length() * 2),
 			static_cast<USHORT>(ValueName.length() * 2),
@@ -295,55 +457,133 @@ namespace Registry {
 			return std::nullopt;
 		}
 
-		if(dwType == REG_SZ){
-			return RegistryType::REG_SZ_T;
-		} else if(dwType == REG_EXPAND_SZ){
-			return RegistryType::REG_EXPAND_SZ_T;
-		} else if(dwType == REG_MULTI_SZ){
-			return RegistryType::REG_MULTI_SZ_T;
-		} else if(dwType == REG_DWORD){
-			return RegistryType::REG_DWORD_T;
+		return GetRegistryType(dwType);
+	}
+
+	bool RegistryKey::EnumerateRawValues(const std::function<void(const std::wstring&, DWORD, const BYTE*, DWORD)>& callback) const {
+		if(!Exists()){
+			SetLastError(ERROR_NOT_FOUND);
+			return false;
 		}
 
-		return RegistryType::REG_BINARY_T;
+		if(offlineHive){
+			std::vector<BYTE> buffer{};
+			for(auto dwValue : offlineHive->GetValues(dwOfflineCell)){
+				auto name{ offlineHive->GetValueName(dwValue) };
+				auto dwType{ offlineHive->GetValueType(dwValue) };
+				auto data{ offlineHive->GetValueData(dwValue, buffer) };
+				if(name && dwType && data){
+					callback(*name, *dwType, data->first, data->second);
+				}
+			}
+			return true;
+		}
+
+		DWORD dwValueCount{};
+		DWORD dwLongestName{};
+		DWORD dwLongestData{};
+		LSTATUS status = RegQueryInfoKeyW(hkBackingKey, nullptr, nullptr, 0, nullptr, nullptr, nullptr, &dwValueCount,
+			                              &dwLongestName, &dwLongestData, nullptr, nullptr);
+		if(status != ERROR_SUCCESS){
+			SetLastError(status);
+			return false;
+		}
+
+		// The data buffer is never empty, since RegEnumValue only reports the size of the data when given no buffer
+		std::vector<WCHAR> name(dwLongestName + 1);
+		std::vector<BYTE> data((std::max)(dwLongestData, 1UL));
+
+		for(DWORD idx = 0; idx < dwValueCount; idx++){
+			DWORD dwNameLength{ static_cast<DWORD>(name.size()) };
+			DWORD dwDataSize{ static_cast<DWORD>(data.size()) };
+			DWORD dwType{};
+			status = RegEnumValueW(hkBackingKey, idx, name.data(), &dwNameLength, nullptr, &dwType, data.data(), &dwDataSize);
+
+			// The value grew after the key was queried; the buffers are grown to fit and the value is read again
+			if(status == ERROR_MORE_DATA){
+				name.resize(16384);
+				data.resize((std::max)(dwDataSize, static_cast<DWORD>(data.size())));
+
+				dwNameLength = static_cast<DWORD>(name.size());
+				dwDataSize = static_cast<DWORD>(data.size());
+				status = RegEnumValueW(hkBackingKey, idx, name.data(), &dwNameLength, nullptr, &dwType, data.data(), &dwDataSize);
+			}
+
+			if(status == ERROR_NO_MORE_ITEMS){
+				break;
+			} else if(status != ERROR_SUCCESS){
+				continue;
+			}
+
+			callback(std::wstring(name.data(), dwNameLength), dwType, data.data(), dwDataSize);
+		}
+
+		return true;
+	}
+
+	std::vector<RegistryValue> RegistryKey::GetValues() const {
+		std::vector<RegistryValue> values{};
+		EnumerateRawValues([&](const std::wstring& name, DWORD dwType, const BYTE* lpData, DWORD dwDataSize){
+			values.emplace_back(ValueView{ dwType, lpData, dwDataSize }.ToRegistryValue(*this, name, GetRegistryType(dwType)));
+		});
+		return values;
+	}
+
+	std::vector<std::optional<RegistryValue>> RegistryKey::GetValues(const std::vector<std::pair<std::wstring, RegistryType>>& vValues) const {
+		if(!Exists()){
+			SetLastError(ERROR_NOT_FOUND);
+			return std::vector<std::optional<RegistryValue>>(vValues.size());
+		}
+
+		// RegQueryMultipleValues isn't used, since it fails outright if any one of the values is missing
+		std::vector<std::optional<RegistryValue>> values{};
+		for(auto& value : vValues){
+			auto view{ GetValueView(value.first) };
+			if(view){
+				values.emplace_back(view->ToRegistryValue(*this, value.first, value.second));
+			} else {
+				values.emplace_back(std::nullopt);
+			}
+		}
+
+		return values;
 	}
 
 	template<class T>
 	std::optional<T> RegistryKey::GetValue(const std::wstring& wsValueName) const {
-		if(ValueExists(wsValueName)){
-			return GetRawValue(wsValueName).Dereference<T>();
+		auto view{ GetValueView(wsValueName) };
+		if(!view || view->GetSize() < sizeof(T)){
+			return std::nullopt;
 		}
-		return std::nullopt;
+
+		T value{};
+		MoveMemory(&value, view->GetData(), sizeof(T));
+		return value;
 	}
 
 	template std::optional<DWORD> RegistryKey::GetValue(const std::wstring& wsValueName) const;
 
 	template<>
 	std::optional<std::wstring> RegistryKey::GetValue(const std::wstring& wsValueName) const {
-		if(ValueExists(wsValueName)){
-			return GetRawValue(wsValueName).ReadWString();
+		auto view{ GetValueView(wsValueName) };
+		if(!view){
+			return std::nullopt;
 		}
-		return std::nullopt;
+		return std::wstring{ view->AsString() };
 	}
 
 	template<>
 	std::optional<std::vector<std::wstring>> RegistryKey::GetValue(const std::wstring& wsValueName) const {
-		if(ValueExists(wsValueName)){
-			std::vector<std::wstring> strings{};
-
-			LPCWSTR data = reinterpret_cast<LPCWSTR>((LPVOID) GetRawValue(wsValueName));
-
-			while(*data){
-				std::wstring str = data;
-				strings.emplace_back(data);
-
-				data += str.length() + 1;
-			}
-
-			return strings;
+		auto view{ GetValueView(wsValueName) };
+		if(!view){
+			return std::nullopt;
 		}
 
-		return std::nullopt;
+		std::vector<std::wstring> strings{};
+		for(auto string : view->AsMultiString()){
+			strings.emplace_back(string);
+		}
+		return strings;
 	}
 
 	bool RegistryKey::SetRawValue(const std::wstring& name, AllocationWrapper bytes, DWORD dwType) const {
@@ -351,6 +591,12 @@ namespace Registry {
 			return false;
 		}
 
+		// Hive files are only ever read
+		if(offlineHive){
+			SetLastError(ERROR_NOT_SUPPORTED);
+			return false;
+		}
+
 		LSTATUS status = RegSetValueEx(hkBackingKey, name.c_str(), 0, dwType, reinterpret_cast<BYTE*>((LPVOID) bytes), bytes.GetSize());
 		if(status != ERROR_SUCCESS){
 			SetLastError(status);
@@ -433,6 +679,17 @@ namespace Registry {
 			return {};
 		}
 
+		if(offlineHive){
+			std::vector<RegistryKey> vSubKeys{};
+			for(auto dwSubkey : offlineHive->GetSubkeys(dwOfflineCell)){
+				auto name{ offlineHive->GetKeyName(dwSubkey) };
+				if(name){
+					vSubKeys.push_back(RegistryKey{ offlineHive, dwSubkey, wsOfflineName + L"\\" + *name });
+				}
+			}
+			return vSubKeys;
+		}
+
 		DWORD dwSubkeyCount{};
 		DWORD dwLongestSubkey{};
 		LSTATUS status = RegQueryInfoKey(hkBackingKey, nullptr, nullptr, 0, &dwSubkeyCount, &dwLongestSubkey, 
@@ -465,6 +722,17 @@ namespace Registry {
 			return {};
 		}
 
+		if(offlineHive){
+			std::vector<std::wstring> vSubKeys{};
+			for(auto dwSubkey : offlineHive->GetSubkeys(dwOfflineCell)){
+				auto name{ offlineHive->GetKeyName(dwSubkey) };
+				if(name){
+					vSubKeys.push_back(*name);
+				}
+			}
+			return vSubKeys;
+		}
+
 		DWORD dwSubkeyCount{};
 		DWORD dwLongestSubkey{};
 		LSTATUS status = RegQueryInfoKeyW(hkBackingKey, nullptr, nullptr, 0, &dwSubkeyCount, &dwLongestSubkey,
@@ -488,12 +756,65 @@ namespace Registry {
 		return vSubKeys;
 	}
 
+	bool RegistryKey::EnumerateSubkeyWriteTimes(const std::function<void(const std::wstring&, const FILETIME&)>& callback) const {
+		if(!Exists()){
+			SetLastError(ERROR_NOT_FOUND);
+			return false;
+		}
+
+		if(offlineHive){
+			for(auto dwSubkey : offlineHive->GetSubkeys(dwOfflineCell)){
+				auto name{ offlineHive->GetKeyName(dwSubkey) };
+				auto written{ offlineHive->GetKeyLastWriteTime(dwSubkey) };
+				if(name && written){
+					callback(*name, *written);
+				}
+			}
+			return true;
+		}
+
+		DWORD dwSubkeyCount{};
+		DWORD dwLongestSubkey{};
+		LSTATUS status = RegQueryInfoKeyW(hkBackingKey, nullptr, nullptr, 0, &dwSubkeyCount, &dwLongestSubkey,
+										 nullptr, nullptr, nullptr, nullptr, nullptr, nullptr);
+		if(status != ERROR_SUCCESS){
+			SetLastError(status);
+			return false;
+		}
+
+		// Subkey names are at most 255 characters, which covers subkeys added after the key was queried
+		std::vector<WCHAR> name((std::max)(dwLongestSubkey, 255UL) + 1);
+		for(DWORD idx = 0; idx < dwSubkeyCount; idx++){
+			DWORD dwNameLength{ static_cast<DWORD>(name.size()) };
+			FILETIME written{};
+			status = RegEnumKeyExW(hkBackingKey, idx, name.data(), &dwNameLength, nullptr, nullptr, nullptr, &written);
+			if(status == ERROR_NO_MORE_ITEMS){
+				break;
+			} else if(status == ERROR_SUCCESS){
+				callback(std::wstring(name.data(), dwNameLength), written);
+			}
+		}
+
+		return true;
+	}
+
 	std::vector<std::wstring> RegistryKey::EnumerateValues() const {
 		if(!Exists()){
 			SetLastError(ERROR_NOT_FOUND);
 			return {};
 		}
 
+		if(offlineHive){
+			std::vector<std::wstring> vValues{};
+			for(auto dwValue : offlineHive->GetValues(dwOfflineCell)){
+				auto name{ offlineHive->GetValueName(dwValue) };
+				if(name){
+					vValues.push_back(*name);
+				}
+			}
+			return vValues;
+		}
+
 		DWORD dwValueCount{};
 		DWORD dwLongestValue{};
 		LSTATUS status = RegQueryInfoKey(hkBackingKey, nullptr, nullptr, 0, nullptr, nullptr, nullptr, &dwValueCount, 
@@ -502,16 +823,14 @@ namespace Registry {
 		std::vector<std::wstring> vSubKeys{};
 
 		if(status == ERROR_SUCCESS && dwValueCount) {
+			std::vector<WCHAR> name(dwLongestValue + 1);
 			for(unsigned i = 0; i < dwValueCount; i++) {
-				DWORD length = dwLongestValue * 2;
-				LPWSTR lpwName = new WCHAR[length];
-				status = RegEnumValueW(hkBackingKey, i, lpwName, &length, nullptr, nullptr, nullptr, nullptr);
+				DWORD length = static_cast<DWORD>(name.size());
+				status = RegEnumValueW(hkBackingKey, i, name.data(), &length, nullptr, nullptr, nullptr, nullptr);
 
 				if(status == ERROR_SUCCESS) {
-					vSubKeys.push_back({ lpwName, length });
+					vSubKeys.push_back({ name.data(), length });
 				}
-
-				delete[] lpwName;
 			}
 		} else {
 			SetLastError(status);
@@ -539,34 +858,15 @@ namespace Registry {
 			return {};
 		}
 
-		// Taken largely from https://stackoverflow.com/questions/937044/determine-path-to-registry-key-from-hkey-handle-in-c
-		std::wstring keyPath = {};
-		if(hkBackingKey && Linker::NtQueryKey){
-			DWORD size = 0;
-			DWORD result = 0;
-			result = Linker::NtQueryKey(hkBackingKey, 3, 0, 0, &size);
-			if(result == ((NTSTATUS) 0xC0000023L)){
-				size = size + sizeof(wchar_t);
-				wchar_t* buffer = new wchar_t[size / sizeof(wchar_t)];
-				if(buffer != NULL){
-					result = Linker::NtQueryKey(hkBackingKey, 3, buffer, size, &size);
-					if(result == 0){
-						buffer[size / sizeof(wchar_t)] = L'\0';
-						keyPath = std::wstring(buffer + 2);
-					}
-					delete[] buffer;
-					auto location = keyPath.find(L"\\REGISTRY\\MACHINE");
-					if(location != std::string::npos){
-						keyPath.replace(location, 17, L"HKEY_LOCAL_MACHINE");
-					}
-					location = keyPath.find(L"\\REGISTRY\\USER");
-					if(location != std::string::npos){
-						keyPath.replace(location, 14, L"HKEY_USERS");
-					}
-				}
-			}
+		if(offlineHive){
+			return wsOfflineName;
 		}
-		return keyPath;
+
+		// Every copy of a key shares its handle, so the name is only queried once per handle
+		if(!handle){
+			return QueryKeyName(hkBackingKey);
+		}
+		return handle->GetName(QueryKeyName);
 	}
 
 	std::wstring RegistryKey::ToString() const {
@@ -574,14 +874,24 @@ namespace Registry {
 	}
 
 	bool RegistryKey::operator==(const RegistryKey& key) const {
-		return hkBackingKey == key.hkBackingKey;
+		return hkBackingKey == key.hkBackingKey && offlineHive == key.offlineHive && dwOfflineCell == key.dwOfflineCell;
 	}
 
 	bool RegistryKey::operator<(const RegistryKey& key) const {
-		return hkBackingKey < key.hkBackingKey;
+		if(hkBackingKey != key.hkBackingKey){
+			return hkBackingKey < key.hkBackingKey;
+		} else if(offlineHive != key.offlineHive){
+			return offlineHive < key.offlineHive;
+		}
+		return dwOfflineCell < key.dwOfflineCell;
 	}
 
 	bool RegistryKey::RemoveValue(const std::wstring& wsValueName) const {
+		if(offlineHive){
+			SetLastError(ERROR_NOT_SUPPORTED);
+			return false;
+		}
+
 		UNICODE_STRING RegistryKeyName{ 
 			static_cast<USHORT>(wsValueName.length() * 2), 
 			static_cast<USHORT>(wsValueName.length() * 2),
@@ -0,0 +1,750 @@
+#include "util/configurations/RegistrySnapshot.h"
+
+#include <Wincrypt.h>
+
+#include <algorithm>
+#include <unordered_map>
+
+#include "util/log/Log.h"
+#include "util/accounting/ResourceUsage.h"
+
+namespace Registry {
+
+	/// The header at the start of a snapshot file. Every offset is from the start of the file and a multiple of 8.
+	struct SnapshotHeader {
+		DWORD dwMagic;
+		DWORD dwVersion;
+
+		DWORD dwKeyCount;
+		DWORD dwValueCount;
+		DWORD dwBlobCount;
+		DWORD dwStringCount;
+
+		/// The number of characters in the string data
+		DWORD64 qwStringDataLength;
+
+		/// The value data, which is written as the registry is walked, before any of the tables
+		DWORD64 qwBlobDataOffset;
+		DWORD64 qwBlobDataSize;
+
+		DWORD64 qwBlobsOffset;
+		DWORD64 qwStringsOffset;
+		DWORD64 qwStringDataOffset;
+		DWORD64 qwValuesOffset;
+		DWORD64 qwKeysOffset;
+	};
+
+	/// A key, stored in preorder. The first key is a root with an empty name, under which each captured key lies.
+	struct SnapshotKey {
+		DWORD dwName;
+		DWORD dwParent;
+
+		/// The index following the last key in this key's subtree
+		DWORD dwSubtreeEnd;
+
+		/// The values of this key, which are stored together and sorted by name
+		DWORD dwFirstValue;
+		DWORD dwValueCount;
+
+		DWORD dwReserved;
+
+		/// A SHA-256 digest of the name, values, and subkeys of this key and everything beneath it
+		BYTE rgbHash[32];
+	};
+
+	/// A value of a key
+	struct SnapshotValue {
+		DWORD dwName;
+		DWORD dwType;
+		DWORD dwBlob;
+		DWORD dwReserved;
+	};
+
+	/// The data of one or more values with the same contents
+	struct SnapshotBlob {
+		/// A SHA-256 digest of the size and contents of the data
+		BYTE rgbHash[32];
+
+		/// The offset of the data from the start of the value data
+		DWORD64 qwOffset;
+		DWORD dwSize;
+		DWORD dwReserved;
+	};
+
+	/// An interned key or value name
+	struct SnapshotString {
+		/// The offset of the string from the start of the string data, in characters
+		DWORD64 qwOffset;
+		DWORD dwLength;
+		DWORD dwReserved;
+	};
+
+	namespace {
+		const DWORD SNAPSHOT_MAGIC{ 0x53525342 }; // "BSRS"
+		const DWORD SNAPSHOT_VERSION{ 2 };
+
+		/// Marks the parent of the root key
+		const DWORD NO_PARENT{ 0xFFFFFFFF };
+
+		/// The deepest keys are nested in the registry, which also bounds how far registry links are followed
+		const DWORD MAX_DEPTH{ 512 };
+
+		/// The amount of data buffered before it's written to the snapshot file
+		const SIZE_T WRITE_BUFFER_SIZE{ 1 << 20 };
+
+		/// The number of bytes of binary data displayed for a value
+		const DWORD MAX_DISPLAYED_BYTES{ 64 };
+
+		/// Compares names in the order in which they're sorted in a snapshot: ordinally, ignoring case
+		int CompareNames(LPCWSTR lpFirst, DWORD dwFirstLength, LPCWSTR lpSecond, DWORD dwSecondLength){
+			return CompareStringOrdinal(lpFirst, dwFirstLength, lpSecond, dwSecondLength, TRUE) - CSTR_EQUAL;
+		}
+
+		bool NameLess(const std::wstring& first, const std::wstring& second){
+			return CompareNames(first.c_str(), static_cast<DWORD>(first.length()), second.c_str(), static_cast<DWORD>(second.length())) < 0;
+		}
+
+		/// The size of the digests of keys and blobs
+		const DWORD DIGEST_SIZE{ 32 };
+
+		/**
+		 * An incremental SHA-256 digest. Digests, rather than a faster non-cryptographic hash, decide which blobs
+		 * are the same and which subtrees can be skipped when diffing, since anyone able to write a value could
+		 * otherwise choose data colliding with a value that was already captured and hide the change.
+		 */
+		class Digest {
+		private:
+			GenericWrapper<HCRYPTHASH> hHash;
+
+		public:
+			Digest(HCRYPTPROV hProv) :
+				hHash{ 0, CryptDestroyHash, 0 }{
+				HCRYPTHASH hNewHash{ 0 };
+				if(hProv && CryptCreateHash(hProv, CALG_SHA_256, 0, 0, &hNewHash)){
+					hHash = { hNewHash, CryptDestroyHash, 0 };
+				}
+			}
+
+			bool Add(LPCVOID lpData, SIZE_T dwSize){
+				return hHash && CryptHashData(hHash, reinterpret_cast<const BYTE*>(lpData), static_cast<DWORD>(dwSize), 0);
+			}
+
+			/// Adds a string, preceded by its length so that consecutive strings can't be confused
+			bool Add(const std::wstring& string){
+				auto dwLength{ static_cast<DWORD>(string.length()) };
+				return Add(&dwLength, sizeof(dwLength)) && Add(string.c_str(), string.length() * sizeof(WCHAR));
+			}
+
+			bool Finish(BYTE* lpHash){
+				DWORD cbHash{ DIGEST_SIZE };
+				return hHash && CryptGetHashParam(hHash, HP_HASHVAL, lpHash, &cbHash, 0) && cbHash == DIGEST_SIZE;
+			}
+		};
+
+		/// Checks that a table of records lies within a view and is aligned
+		bool IsTableValid(DWORD64 qwOffset, DWORD64 qwCount, SIZE_T dwRecordSize, SIZE_T dwSize){
+			return qwOffset % 8 == 0 && qwOffset <= dwSize && qwCount <= (dwSize - qwOffset) / dwRecordSize;
+		}
+
+		/**
+		 * Walks the registry and streams a snapshot of it to a file. Value data is written as it's read, while
+		 * the tables, which are much smaller, are kept in memory and written once the walk is complete.
+		 */
+		class SnapshotWriter {
+		private:
+			HANDLE hFile;
+			std::vector<BYTE> vBuffer;
+
+			/// The number of bytes written or buffered
+			DWORD64 qwPosition;
+			bool bFailed;
+
+			SnapshotHeader header;
+			std::vector<SnapshotKey> vKeys;
+			std::vector<SnapshotValue> vValues;
+			std::vector<SnapshotBlob> vBlobs;
+			std::vector<SnapshotString> vStrings;
+			std::wstring wsStringData;
+
+			/// The index of each string and blob already stored, by the string and by the blob's digest
+			std::unordered_map<std::wstring, DWORD> mStrings;
+			std::unordered_map<std::string, DWORD> mBlobs;
+
+			GenericWrapper<HCRYPTPROV> hProv;
+
+			bool Flush(){
+				DWORD dwBytesWritten{ 0 };
+				if(!bFailed && vBuffer.size() &&
+				   !WriteFile(hFile, vBuffer.data(), static_cast<DWORD>(vBuffer.size()), &dwBytesWritten, nullptr)){
+					bFailed = true;
+				}
+				vBuffer.clear();
+				return !bFailed;
+			}
+
+			bool Write(LPCVOID lpData, SIZE_T dwSize){
+				auto lpBytes{ reinterpret_cast<const BYTE*>(lpData) };
+				vBuffer.insert(vBuffer.end(), lpBytes, lpBytes + dwSize);
+				qwPosition += dwSize;
+				if(vBuffer.size() >= WRITE_BUFFER_SIZE){
+					return Flush();
+				}
+				return !bFailed;
+			}
+
+			/// Pads the file so that the next table is aligned
+			void Align(){
+				BYTE padding[8]{};
+				Write(padding, static_cast<SIZE_T>((8 - qwPosition % 8) % 8));
+			}
+
+			template<class T>
+			DWORD64 WriteTable(const std::vector<T>& table){
+				Align();
+				auto qwOffset{ qwPosition };
+				Write(table.data(), table.size() * sizeof(T));
+				return qwOffset;
+			}
+
+			DWORD AddString(const std::wstring& string){
+				auto existing{ mStrings.find(string) };
+				if(existing != mStrings.end()){
+					return existing->second;
+				}
+
+				auto dwIndex{ static_cast<DWORD>(vStrings.size()) };
+				vStrings.emplace_back(SnapshotString{ wsStringData.length(), static_cast<DWORD>(string.length()), 0 });
+				wsStringData += string;
+				mStrings.emplace(string, dwIndex);
+				return dwIndex;
+			}
+
+			DWORD AddBlob(const BYTE* lpData, DWORD dwSize){
+				SnapshotBlob blob{ {}, header.qwBlobDataSize, dwSize, 0 };
+				Digest digest{ hProv };
+				if(!digest.Add(&dwSize, sizeof(dwSize)) || !digest.Add(lpData, dwSize) || !digest.Finish(blob.rgbHash)){
+					bFailed = true;
+				}
+
+				std::string hash(reinterpret_cast<const char*>(blob.rgbHash), DIGEST_SIZE);
+				auto existing{ mBlobs.find(hash) };
+				if(existing != mBlobs.end()){
+					return existing->second;
+				}
+
+				auto dwIndex{ static_cast<DWORD>(vBlobs.size()) };
+				vBlobs.emplace_back(blob);
+				Write(lpData, dwSize);
+				header.qwBlobDataSize += dwSize;
+				mBlobs.emplace(std::move(hash), dwIndex);
+				return dwIndex;
+			}
+
+			/**
+			 * Adds a key and everything beneath it to the snapshot
+			 *
+			 * @return The index of the key, whose digest is set once its subtree has been added
+			 */
+			DWORD Walk(const RegistryKey& key, const std::wstring& name, DWORD dwParent, DWORD dwDepth){
+				auto dwIndex{ static_cast<DWORD>(vKeys.size()) };
+				vKeys.emplace_back(SnapshotKey{ AddString(name), dwParent, 0, static_cast<DWORD>(vValues.size()), 0, 0, {} });
+				Digest digest{ hProv };
+				auto bHashed{ digest.Add(name) };
+
+				std::vector<std::pair<std::wstring, SnapshotValue>> values{};
+				key.EnumerateRawValues([&](const std::wstring& wsName, DWORD dwType, const BYTE* lpData, DWORD dwDataSize){
+					values.emplace_back(wsName, SnapshotValue{ 0, dwType, AddBlob(lpData, dwDataSize), 0 });
+				});
+				std::sort(values.begin(), values.end(), [](const auto& first, const auto& second){ return NameLess(first.first, second.first); });
+
+				for(auto& value : values){
+					value.second.dwName = AddString(value.first);
+					vValues.emplace_back(value.second);
+
+					bHashed = bHashed && digest.Add(value.first) && digest.Add(&value.second.dwType, sizeof(DWORD)) &&
+						digest.Add(vBlobs[value.second.dwBlob].rgbHash, DIGEST_SIZE);
+				}
+				vKeys[dwIndex].dwValueCount = static_cast<DWORD>(values.size());
+
+				if(dwDepth < MAX_DEPTH){
+					auto subkeys{ key.EnumerateSubkeyNames() };
+					std::sort(subkeys.begin(), subkeys.end(), NameLess);
+					for(auto& subkey : subkeys){
+						RegistryKey child{ key, subkey };
+						if(child.Exists()){
+							auto dwChild{ Walk(child, subkey, dwIndex, dwDepth + 1) };
+							bHashed = bHashed && digest.Add(vKeys[dwChild].rgbHash, DIGEST_SIZE);
+						}
+					}
+				}
+
+				vKeys[dwIndex].dwSubtreeEnd = static_cast<DWORD>(vKeys.size());
+				if(!bHashed || !digest.Finish(vKeys[dwIndex].rgbHash)){
+					bFailed = true;
+				}
+				return dwIndex;
+			}
+
+		public:
+			SnapshotWriter(HANDLE hFile) :
+				hFile{ hFile },
+				qwPosition{ 0 },
+				bFailed{ false },
+				header{},
+				hProv{ 0, [](HCRYPTPROV hProv){ CryptReleaseContext(hProv, 0); }, 0 }{
+
+				HCRYPTPROV hNewProv{ 0 };
+				if(CryptAcquireContext(&hNewProv, nullptr, nullptr, PROV_RSA_AES, CRYPT_VERIFYCONTEXT)){
+					hProv = { hNewProv, [](HCRYPTPROV hProv){ CryptReleaseContext(hProv, 0); }, 0 };
+				} else{
+					bFailed = true;
+				}
+
+				// The header is rewritten once the tables have been written
+				header.dwMagic = SNAPSHOT_MAGIC;
+				header.dwVersion = SNAPSHOT_VERSION;
+				Write(&header, sizeof(header));
+				header.qwBlobDataOffset = qwPosition;
+			}
+
+			/**
+			 * Walks the keys to capture, beneath a root key with an empty name
+			 *
+			 * @param vRoots The keys to capture
+			 */
+			void WalkRoots(const std::vector<RegistryKey>& vRoots){
+				std::vector<std::pair<std::wstring, RegistryKey>> roots{};
+				for(auto& root : vRoots){
+					if(root.Exists()){
+						roots.emplace_back(root.GetName(), root);
+					}
+				}
+				std::sort(roots.begin(), roots.end(), [](const auto& first, const auto& second){ return NameLess(first.first, second.first); });
+
+				vKeys.emplace_back(SnapshotKey{ AddString(L""), NO_PARENT, 0, 0, 0, 0, {} });
+				Digest digest{ hProv };
+				auto bHashed{ digest.Add(std::wstring{}) };
+				for(auto& root : roots){
+					auto dwRoot{ Walk(root.second, root.first, 0, 0) };
+					bHashed = bHashed && digest.Add(vKeys[dwRoot].rgbHash, DIGEST_SIZE);
+				}
+				vKeys[0].dwSubtreeEnd = static_cast<DWORD>(vKeys.size());
+				if(!bHashed || !digest.Finish(vKeys[0].rgbHash)){
+					bFailed = true;
+				}
+			}
+
+			/**
+			 * Writes the tables and the header
+			 *
+			 * @return true if the entire snapshot was written; false otherwise
+			 */
+			bool Finish(){
+				header.dwKeyCount = static_cast<DWORD>(vKeys.size());
+				header.dwValueCount = static_cast<DWORD>(vValues.size());
+				header.dwBlobCount = static_cast<DWORD>(vBlobs.size());
+				header.dwStringCount = static_cast<DWORD>(vStrings.size());
+				header.qwStringDataLength = wsStringData.length();
+
+				header.qwBlobsOffset = WriteTable(vBlobs);
+				header.qwStringsOffset = WriteTable(vStrings);
+				Align();
+				header.qwStringDataOffset = qwPosition;
+				Write(wsStringData.c_str(), wsStringData.length() * sizeof(WCHAR));
+				header.qwValuesOffset = WriteTable(vValues);
+				header.qwKeysOffset = WriteTable(vKeys);
+				if(!Flush() || bFailed){
+					return false;
+				}
+
+				LARGE_INTEGER start{};
+				DWORD dwBytesWritten{ 0 };
+				return SetFilePointerEx(hFile, start, nullptr, FILE_BEGIN) &&
+					WriteFile(hFile, &header, sizeof(header), &dwBytesWritten, nullptr) && FlushFileBuffers(hFile);
+			}
+
+			DWORD GetKeyCount() const {
+				return static_cast<DWORD>(vKeys.size());
+			}
+
+			DWORD GetValueCount() const {
+				return static_cast<DWORD>(vValues.size());
+			}
+
+			DWORD GetBlobCount() const {
+				return static_cast<DWORD>(vBlobs.size());
+			}
+
+			DWORD64 GetSize() const {
+				return qwPosition;
+			}
+		};
+	}
+
+	std::wstring SnapshotDifference::ToString() const {
+		auto wsValue{ wsKeyPath + L"\\" + (wsValueName.length() ? wsValueName : L"(Default)") };
+		switch(kind){
+		case Kind::KeyAdded:
+			return L"Key added: " + wsKeyPath;
+		case Kind::KeyRemoved:
+			return L"Key removed: " + wsKeyPath;
+		case Kind::ValueAdded:
+			return L"Value added: " + wsValue + L" = " + after.value_or(L"");
+		case Kind::ValueRemoved:
+			return L"Value removed: " + wsValue + L" (was " + before.value_or(L"") + L")";
+		default:
+			return L"Value changed: " + wsValue + L" from " + before.value_or(L"") + L" to " + after.value_or(L"");
+		}
+	}
+
+	RegistrySnapshot::RegistrySnapshot(const std::wstring& wsPath, LPVOID lpView, SIZE_T dwSize) :
+		wsPath{ wsPath },
+		lpView{ lpView, [](LPVOID lpView){ UnmapViewOfFile(lpView); }, nullptr },
+		dwSize{ dwSize }{}
+
+	bool RegistrySnapshot::Capture(const std::vector<RegistryKey>& vRoots, const std::wstring& wsPath){
+		auto start{ GetTickCount64() };
+
+		auto wsTempPath{ wsPath + L".tmp" };
+		DWORD dwKeys{ 0 };
+		DWORD dwValues{ 0 };
+		DWORD dwBlobs{ 0 };
+		DWORD64 qwSize{ 0 };
+		{
+			HandleWrapper hFile{ CreateFileW(wsTempPath.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, 0, nullptr) };
+			if(!hFile){
+				LOG_ERROR(L"Unable to create registry snapshot at " << wsTempPath << L" (Error " << GetLastError() << L")");
+				return false;
+			}
+
+			SnapshotWriter writer{ hFile };
+			writer.WalkRoots(vRoots);
+			if(!writer.Finish()){
+				LOG_ERROR(L"Unable to write registry snapshot to " << wsTempPath << L" (Error " << GetLastError() << L")");
+				return false;
+			}
+
+			dwKeys = writer.GetKeyCount();
+			dwValues = writer.GetValueCount();
+			dwBlobs = writer.GetBlobCount();
+			qwSize = writer.GetSize();
+		}
+
+		if(!MoveFileExW(wsTempPath.c_str(), wsPath.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)){
+			LOG_ERROR(L"Unable to replace registry snapshot at " << wsPath << L" (Error " << GetLastError() << L")");
+			return false;
+		}
+
+		LOG_INFO(L"Saved a snapshot of " << dwKeys << L" keys and " << dwValues << L" values (" << dwBlobs << L" distinct) to "
+			<< wsPath << L" in " << qwSize << L" bytes and " << GetTickCount64() - start << L" ms");
+		return true;
+	}
+
+	std::shared_ptr<RegistrySnapshot> RegistrySnapshot::Load(const std::wstring& wsPath){
+		HandleWrapper hFile{ CreateFileW(wsPath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, 0, nullptr) };
+		if(!hFile){
+			LOG_ERROR(L"Unable to open registry snapshot " << wsPath << L" (Error " << GetLastError() << L")");
+			return nullptr;
+		}
+		Accounting::RecordFileOpened();
+
+		LARGE_INTEGER size{};
+		if(!GetFileSizeEx(hFile, &size) || static_cast<ULONGLONG>(size.QuadPart) < sizeof(SnapshotHeader) ||
+		   static_cast<ULONGLONG>(size.QuadPart) > static_cast<ULONGLONG>(static_cast<SIZE_T>(-1))){
+			LOG_ERROR(L"Registry snapshot " << wsPath << L" is invalid");
+			return nullptr;
+		}
+
+		HandleWrapper hMapping{ CreateFileMappingW(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr) };
+		if(!hMapping){
+			LOG_ERROR(L"Unable to map registry snapshot " << wsPath << L" (Error " << GetLastError() << L")");
+			return nullptr;
+		}
+
+		// The view remains valid once the file and mapping handles are closed
+		auto lpView{ MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0) };
+		if(!lpView){
+			LOG_ERROR(L"Unable to map registry snapshot " << wsPath << L" (Error " << GetLastError() << L")");
+			return nullptr;
+		}
+
+		std::shared_ptr<RegistrySnapshot> snapshot{ new RegistrySnapshot(wsPath, lpView, static_cast<SIZE_T>(size.QuadPart)) };
+		if(!snapshot->Validate()){
+			LOG_ERROR(L"Registry snapshot " << wsPath << L" is invalid");
+			return nullptr;
+		}
+
+		LOG_VERBOSE(1, L"Loaded a registry snapshot of " << snapshot->GetKeyCount() << L" keys from " << wsPath);
+		return snapshot;
+	}
+
+	bool RegistrySnapshot::Validate() const {
+		auto& header{ GetHeader() };
+		if(header.dwMagic != SNAPSHOT_MAGIC || header.dwVersion != SNAPSHOT_VERSION || header.dwKeyCount == 0){
+			return false;
+		}
+
+		if(!IsTableValid(header.qwBlobDataOffset, header.qwBlobDataSize, 1, dwSize) ||
+		   !IsTableValid(header.qwBlobsOffset, header.dwBlobCount, sizeof(SnapshotBlob), dwSize) ||
+		   !IsTableValid(header.qwStringsOffset, header.dwStringCount, sizeof(SnapshotString), dwSize) ||
+		   !IsTableValid(header.qwStringDataOffset, header.qwStringDataLength, sizeof(WCHAR), dwSize) ||
+		   !IsTableValid(header.qwValuesOffset, header.dwValueCount, sizeof(SnapshotValue), dwSize) ||
+		   !IsTableValid(header.qwKeysOffset, header.dwKeyCount, sizeof(SnapshotKey), dwSize)){
+			return false;
+		}
+
+		auto blobs{ GetBlobs() };
+		for(DWORD idx = 0; idx < header.dwBlobCount; idx++){
+			if(blobs[idx].qwOffset > header.qwBlobDataSize || blobs[idx].dwSize > header.qwBlobDataSize - blobs[idx].qwOffset){
+				return false;
+			}
+		}
+
+		auto strings{ GetStrings() };
+		for(DWORD idx = 0; idx < header.dwStringCount; idx++){
+			if(strings[idx].qwOffset > header.qwStringDataLength || strings[idx].dwLength > header.qwStringDataLength - strings[idx].qwOffset){
+				return false;
+			}
+		}
+
+		auto values{ GetValues() };
+		for(DWORD idx = 0; idx < header.dwValueCount; idx++){
+			if(values[idx].dwName >= header.dwStringCount || values[idx].dwBlob >= header.dwBlobCount){
+				return false;
+			}
+		}
+
+		// Keys are stored in preorder, so each key's parent must be the innermost subtree still open at the key, and
+		// the key's subtree must end within its parent's. Subtrees then nest exactly as parents do, and can't be
+		// nested more deeply than the walk goes, which bounds the recursion of DiffKeys.
+		auto keys{ GetKeys() };
+		std::vector<DWORD> vOpenKeys{};
+		for(DWORD idx = 0; idx < header.dwKeyCount; idx++){
+			auto& key{ keys[idx] };
+			if(key.dwName >= header.dwStringCount || key.dwSubtreeEnd <= idx || key.dwSubtreeEnd > header.dwKeyCount ||
+			   static_cast<DWORD64>(key.dwFirstValue) + key.dwValueCount > header.dwValueCount){
+				return false;
+			}
+
+			while(vOpenKeys.size() && idx >= keys[vOpenKeys.back()].dwSubtreeEnd){
+				vOpenKeys.pop_back();
+			}
+
+			if(idx == 0){
+				if(key.dwParent != NO_PARENT || key.dwSubtreeEnd != header.dwKeyCount){
+					return false;
+				}
+			} else {
+				if(vOpenKeys.empty() || key.dwParent != vOpenKeys.back() || key.dwSubtreeEnd > keys[key.dwParent].dwSubtreeEnd){
+					return false;
+				}
+			}
+
+			vOpenKeys.emplace_back(idx);
+			if(vOpenKeys.size() > MAX_DEPTH + 2){
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	const SnapshotHeader& RegistrySnapshot::GetHeader() const {
+		return *reinterpret_cast<const SnapshotHeader*>(static_cast<LPVOID>(lpView));
+	}
+
+	const SnapshotKey* RegistrySnapshot::GetKeys() const {
+		return reinterpret_cast<const SnapshotKey*>(reinterpret_cast<const BYTE*>(static_cast<LPVOID>(lpView)) + GetHeader().qwKeysOffset);
+	}
+
+	const SnapshotValue* RegistrySnapshot::GetValues() const {
+		return reinterpret_cast<const SnapshotValue*>(reinterpret_cast<const BYTE*>(static_cast<LPVOID>(lpView)) + GetHeader().qwValuesOffset);
+	}
+
+	const SnapshotBlob* RegistrySnapshot::GetBlobs() const {
+		return reinterpret_cast<const SnapshotBlob*>(reinterpret_cast<const BYTE*>(static_cast<LPVOID>(lpView)) + GetHeader().qwBlobsOffset);
+	}
+
+	const SnapshotString* RegistrySnapshot::GetStrings() const {
+		return reinterpret_cast<const SnapshotString*>(reinterpret_cast<const BYTE*>(static_cast<LPVOID>(lpView)) + GetHeader().qwStringsOffset);
+	}
+
+	LPCWSTR RegistrySnapshot::GetStringData() const {
+		return reinterpret_cast<LPCWSTR>(reinterpret_cast<const BYTE*>(static_cast<LPVOID>(lpView)) + GetHeader().qwStringDataOffset);
+	}
+
+	const BYTE* RegistrySnapshot::GetBlobData() const {
+		return reinterpret_cast<const BYTE*>(static_cast<LPVOID>(lpView)) + GetHeader().qwBlobDataOffset;
+	}
+
+	std::wstring RegistrySnapshot::GetString(DWORD dwString) const {
+		auto& string{ GetStrings()[dwString] };
+		return std::wstring(GetStringData() + string.qwOffset, string.dwLength);
+	}
+
+	int RegistrySnapshot::CompareStrings(const RegistrySnapshot& first, DWORD dwFirst, const RegistrySnapshot& second, DWORD dwSecond){
+		auto& firstString{ first.GetStrings()[dwFirst] };
+		auto& secondString{ second.GetStrings()[dwSecond] };
+		return CompareNames(first.GetStringData() + firstString.qwOffset, firstString.dwLength,
+			second.GetStringData() + secondString.qwOffset, secondString.dwLength);
+	}
+
+	const std::wstring& RegistrySnapshot::GetPath() const {
+		return wsPath;
+	}
+
+	DWORD RegistrySnapshot::GetKeyCount() const {
+		return GetHeader().dwKeyCount;
+	}
+
+	std::wstring RegistrySnapshot::GetKeyPath(DWORD dwKey) const {
+		auto keys{ GetKeys() };
+		std::vector<DWORD> vPath{};
+		for(auto idx = dwKey; idx != 0 && idx != NO_PARENT; idx = keys[idx].dwParent){
+			vPath.emplace_back(idx);
+		}
+
+		std::wstring path{};
+		for(auto idx = vPath.rbegin(); idx != vPath.rend(); idx++){
+			if(path.length()){
+				path += L"\\";
+			}
+			path += GetString(keys[*idx].dwName);
+		}
+		return path;
+	}
+
+	std::wstring RegistrySnapshot::FormatValue(DWORD dwValue) const {
+		auto& value{ GetValues()[dwValue] };
+		auto& blob{ GetBlobs()[value.dwBlob] };
+		auto lpData{ GetBlobData() + blob.qwOffset };
+
+		if(value.dwType == REG_SZ || value.dwType == REG_EXPAND_SZ){
+			std::wstring string(reinterpret_cast<LPCWSTR>(lpData), blob.dwSize / sizeof(WCHAR));
+			return string.substr(0, string.find(L'\0'));
+		} else if(value.dwType == REG_MULTI_SZ){
+			std::wstring strings(reinterpret_cast<LPCWSTR>(lpData), blob.dwSize / sizeof(WCHAR));
+			std::wstring display{};
+			SIZE_T dwStart{ 0 };
+			while(dwStart < strings.length() && strings[dwStart]){
+				auto dwEnd{ strings.find(L'\0', dwStart) };
+				if(dwEnd == std::wstring::npos){
+					dwEnd = strings.length();
+				}
+				display += (display.length() ? L", " : L"") + strings.substr(dwStart, dwEnd - dwStart);
+				dwStart = dwEnd + 1;
+			}
+			return display;
+		} else if(value.dwType == REG_DWORD && blob.dwSize >= sizeof(DWORD)){
+			return std::to_wstring(*reinterpret_cast<const DWORD*>(lpData));
+		} else if(value.dwType == REG_QWORD && blob.dwSize >= sizeof(DWORD64)){
+			return std::to_wstring(*reinterpret_cast<const DWORD64*>(lpData));
+		}
+
+		static const WCHAR digits[]{ L"0123456789ABCDEF" };
+		std::wstring display{};
+		for(DWORD idx = 0; idx < blob.dwSize && idx < MAX_DISPLAYED_BYTES; idx++){
+			display += digits[lpData[idx] >> 4];
+			display += digits[lpData[idx] & 0xF];
+		}
+		if(blob.dwSize > MAX_DISPLAYED_BYTES){
+			display += L"... (" + std::to_wstring(blob.dwSize) + L" bytes)";
+		}
+		return display;
+	}
+
+	DWORD64 RegistrySnapshot::GetHash() const {
+		DWORD64 qwHash{ 0 };
+		CopyMemory(&qwHash, GetKeys()[0].rgbHash, sizeof(qwHash));
+		return qwHash;
+	}
+
+	void RegistrySnapshot::EnumerateValues(const std::function<void(DWORD, DWORD, DWORD, DWORD)>& callback) const {
+		auto keys{ GetKeys() };
+		auto values{ GetValues() };
+		for(DWORD dwKey = 0; dwKey < GetHeader().dwKeyCount; dwKey++){
+			for(auto dwValue = keys[dwKey].dwFirstValue; dwValue < keys[dwKey].dwFirstValue + keys[dwKey].dwValueCount; dwValue++){
+				callback(dwKey, dwValue, values[dwValue].dwType, values[dwValue].dwBlob);
+			}
+		}
+	}
+
+	std::wstring RegistrySnapshot::GetValueName(DWORD dwValue) const {
+		return GetString(GetValues()[dwValue].dwName);
+	}
+
+	DWORD RegistrySnapshot::GetBlobCount() const {
+		return GetHeader().dwBlobCount;
+	}
+
+	std::pair<const BYTE*, DWORD> RegistrySnapshot::GetBlob(DWORD dwBlob) const {
+		auto& blob{ GetBlobs()[dwBlob] };
+		return { GetBlobData() + blob.qwOffset, blob.dwSize };
+	}
+
+	std::vector<SnapshotDifference> RegistrySnapshot::Diff(const RegistrySnapshot& before, const RegistrySnapshot& after){
+		std::vector<SnapshotDifference> vDifferences{};
+		DiffKeys(before, 0, after, 0, vDifferences);
+		return vDifferences;
+	}
+
+	void RegistrySnapshot::DiffKeys(const RegistrySnapshot& before, DWORD dwBefore, const RegistrySnapshot& after, DWORD dwAfter,
+		std::vector<SnapshotDifference>& vDifferences){
+		auto keysBefore{ before.GetKeys() };
+		auto keysAfter{ after.GetKeys() };
+		auto& keyBefore{ keysBefore[dwBefore] };
+		auto& keyAfter{ keysAfter[dwAfter] };
+		if(!memcmp(keyBefore.rgbHash, keyAfter.rgbHash, DIGEST_SIZE)){
+			return;
+		}
+
+		// Values and subkeys are sorted by name, so both are compared by merging them
+		auto valuesBefore{ before.GetValues() };
+		auto valuesAfter{ after.GetValues() };
+		auto blobsBefore{ before.GetBlobs() };
+		auto blobsAfter{ after.GetBlobs() };
+		auto dwValue{ keyBefore.dwFirstValue };
+		auto dwOtherValue{ keyAfter.dwFirstValue };
+		auto dwValuesEnd{ keyBefore.dwFirstValue + keyBefore.dwValueCount };
+		auto dwOtherValuesEnd{ keyAfter.dwFirstValue + keyAfter.dwValueCount };
+		while(dwValue < dwValuesEnd || dwOtherValue < dwOtherValuesEnd){
+			auto comparison{ dwValue == dwValuesEnd ? 1 : dwOtherValue == dwOtherValuesEnd ? -1 :
+				CompareStrings(before, valuesBefore[dwValue].dwName, after, valuesAfter[dwOtherValue].dwName) };
+			if(comparison < 0){
+				vDifferences.emplace_back(SnapshotDifference{ SnapshotDifference::Kind::ValueRemoved, before.GetKeyPath(dwBefore),
+					before.GetString(valuesBefore[dwValue].dwName), before.FormatValue(dwValue), std::nullopt });
+				dwValue++;
+			} else if(comparison > 0){
+				vDifferences.emplace_back(SnapshotDifference{ SnapshotDifference::Kind::ValueAdded, after.GetKeyPath(dwAfter),
+					after.GetString(valuesAfter[dwOtherValue].dwName), std::nullopt, after.FormatValue(dwOtherValue) });
+				dwOtherValue++;
+			} else {
+				if(valuesBefore[dwValue].dwType != valuesAfter[dwOtherValue].dwType ||
+				   memcmp(blobsBefore[valuesBefore[dwValue].dwBlob].rgbHash, blobsAfter[valuesAfter[dwOtherValue].dwBlob].rgbHash, DIGEST_SIZE)){
+					vDifferences.emplace_back(SnapshotDifference{ SnapshotDifference::Kind::ValueChanged, after.GetKeyPath(dwAfter),
+						after.GetString(valuesAfter[dwOtherValue].dwName), before.FormatValue(dwValue), after.FormatValue(dwOtherValue) });
+				}
+				dwValue++;
+				dwOtherValue++;
+			}
+		}
+
+		auto dwKey{ dwBefore + 1 };
+		auto dwOtherKey{ dwAfter + 1 };
+		while(dwKey < keyBefore.dwSubtreeEnd || dwOtherKey < keyAfter.dwSubtreeEnd){
+			auto comparison{ dwKey == keyBefore.dwSubtreeEnd ? 1 : dwOtherKey == keyAfter.dwSubtreeEnd ? -1 :
+				CompareStrings(before, keysBefore[dwKey].dwName, after, keysAfter[dwOtherKey].dwName) };
+			if(comparison < 0){
+				vDifferences.emplace_back(SnapshotDifference{ SnapshotDifference::Kind::KeyRemoved, before.GetKeyPath(dwKey) });
+				dwKey = keysBefore[dwKey].dwSubtreeEnd;
+			} else if(comparison > 0){
+				vDifferences.emplace_back(SnapshotDifference{ SnapshotDifference::Kind::KeyAdded, after.GetKeyPath(dwOtherKey) });
+				dwOtherKey = keysAfter[dwOtherKey].dwSubtreeEnd;
+			} else {
+				DiffKeys(before, dwKey, after, dwOtherKey, vDifferences);
+				dwKey = keysBefore[dwKey].dwSubtreeEnd;
+				dwOtherKey = keysAfter[dwOtherKey].dwSubtreeEnd;
+			}
+		}
+	}
+}
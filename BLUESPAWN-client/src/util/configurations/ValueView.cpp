@@ -0,0 +1,129 @@
+#include "util/configurations/ValueView.h"
+
+#include <algorithm>
+
+#include "util/configurations/Registry.h"
+#include "util/configurations/RegistryValue.h"
+
+namespace Registry {
+
+	MultiStringView::Iterator::Iterator(LPCWSTR lpStrings, SIZE_T dwLength, SIZE_T dwPosition) :
+		lpStrings{ lpStrings },
+		dwLength{ dwLength },
+		dwStart{ dwLength },
+		dwEnd{ dwLength }{
+		Seek(dwPosition);
+	}
+
+	void MultiStringView::Iterator::Seek(SIZE_T dwPosition){
+		if(dwPosition >= dwLength){
+			dwStart = dwEnd = dwLength;
+			return;
+		}
+
+		dwStart = dwEnd = dwPosition;
+		while(dwEnd < dwLength && lpStrings[dwEnd]){
+			dwEnd++;
+		}
+
+		// An empty string terminates the list
+		if(dwEnd == dwStart){
+			dwStart = dwEnd = dwLength;
+		}
+	}
+
+	std::wstring_view MultiStringView::Iterator::operator*() const {
+		return std::wstring_view(lpStrings + dwStart, dwEnd - dwStart);
+	}
+
+	MultiStringView::Iterator& MultiStringView::Iterator::operator++(){
+		Seek(dwEnd + 1);
+		return *this;
+	}
+
+	MultiStringView::Iterator MultiStringView::Iterator::operator++(int){
+		auto previous{ *this };
+		Seek(dwEnd + 1);
+		return previous;
+	}
+
+	bool MultiStringView::Iterator::operator==(const Iterator& iterator) const {
+		return lpStrings == iterator.lpStrings && dwStart == iterator.dwStart;
+	}
+
+	bool MultiStringView::Iterator::operator!=(const Iterator& iterator) const {
+		return !(*this == iterator);
+	}
+
+	MultiStringView::MultiStringView(LPCWSTR lpStrings, SIZE_T dwLength) :
+		lpStrings{ lpStrings },
+		dwLength{ dwLength }{}
+
+	MultiStringView::Iterator MultiStringView::begin() const {
+		return Iterator{ lpStrings, dwLength, 0 };
+	}
+
+	MultiStringView::Iterator MultiStringView::end() const {
+		return Iterator{ lpStrings, dwLength, dwLength };
+	}
+
+	bool MultiStringView::empty() const {
+		return begin() == end();
+	}
+
+	bool MultiStringView::Contains(std::wstring_view string) const {
+		return std::find(begin(), end(), string) != end();
+	}
+
+	ValueView::ValueView(DWORD dwType, const BYTE* lpData, DWORD dwSize) :
+		dwType{ dwType },
+		lpData{ lpData },
+		dwSize{ dwSize }{}
+
+	DWORD ValueView::GetType() const {
+		return dwType;
+	}
+
+	const BYTE* ValueView::GetData() const {
+		return lpData;
+	}
+
+	DWORD ValueView::GetSize() const {
+		return dwSize;
+	}
+
+	std::wstring_view ValueView::AsString() const {
+		auto lpString{ reinterpret_cast<LPCWSTR>(lpData) };
+		return std::wstring_view(lpString, wcsnlen(lpString, dwSize / sizeof(WCHAR)));
+	}
+
+	MultiStringView ValueView::AsMultiString() const {
+		return MultiStringView{ reinterpret_cast<LPCWSTR>(lpData), dwSize / sizeof(WCHAR) };
+	}
+
+	DWORD ValueView::AsDword() const {
+		return dwSize >= sizeof(DWORD) ? *reinterpret_cast<const DWORD*>(lpData) : 0;
+	}
+
+	RegistryValue ValueView::ToRegistryValue(const RegistryKey& key, const std::wstring& name, RegistryType type) const {
+		if(type == RegistryType::REG_SZ_T || type == RegistryType::REG_EXPAND_SZ_T){
+			return RegistryValue{ key, name, std::wstring{ AsString() } };
+		} else if(type == RegistryType::REG_MULTI_SZ_T){
+			std::vector<std::wstring> strings{};
+			for(auto string : AsMultiString()){
+				strings.emplace_back(string);
+			}
+			return RegistryValue{ key, name, std::move(strings) };
+		} else if(type == RegistryType::REG_DWORD_T){
+			return RegistryValue{ key, name, AsDword() };
+		} else {
+			if(!dwSize){
+				return RegistryValue{ key, name, AllocationWrapper{ nullptr, 0 } };
+			}
+
+			auto lpbValue = new BYTE[dwSize];
+			MoveMemory(lpbValue, lpData, dwSize);
+			return RegistryValue{ key, name, AllocationWrapper{ lpbValue, dwSize, AllocationWrapper::CPP_ARRAY_ALLOC } };
+		}
+	}
+}
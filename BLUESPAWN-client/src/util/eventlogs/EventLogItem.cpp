@@ -1,5 +1,7 @@
 #include "util/eventlogs/EventLogItem.h"
 
+#include <cstdio>
+
 namespace EventLogs {
 
 	std::wstring EventLogItem::GetProperty(std::wstring prop) const {
@@ -20,6 +22,19 @@ namespace EventLogs {
 	std::wstring EventLogItem::GetTimeCreated() const {
 		return this->timeCreated;
 	}
+	std::optional<FILETIME> EventLogItem::GetTimeCreatedAsFileTime() const {
+		SYSTEMTIME time{};
+		if(swscanf_s(timeCreated.c_str(), L"%hu-%hu-%huT%hu:%hu:%hu", &time.wYear, &time.wMonth, &time.wDay, &time.wHour,
+					 &time.wMinute, &time.wSecond) != 6){
+			return std::nullopt;
+		}
+
+		FILETIME filetime{};
+		if(!SystemTimeToFileTime(&time, &filetime)){
+			return std::nullopt;
+		}
+		return filetime;
+	}
 	std::wstring EventLogItem::GetXML() const {
 		return this->rawXML;
 	}
@@ -3,6 +3,7 @@
 #include "reaction/Detections.h"
 #include "util/log/Log.h"
 #include "common/Utils.h"
+#include "util/accounting/ResourceUsage.h"
 
 const int SIZE_DATA = 4096;
 const int ARRAY_SIZE = 10;
@@ -78,9 +79,18 @@ namespace EventLogs {
 
 	// Enumerate all the events in the result set. 
 	std::vector<EventLogItem> EventLogs::ProcessResults(const EventWrapper& hResults, const std::vector<XpathQuery>& filters) {
-		EVT_HANDLE hEvents[ARRAY_SIZE];
-
 		std::vector<EventLogItem> results;
+		ProcessResults(hResults, filters, [&results](EventLogItem item){
+			results.push_back(item);
+			return true;
+		});
+		return results;
+	}
+
+	bool EventLogs::ProcessResults(const EventWrapper& hResults, const std::vector<XpathQuery>& filters, 
+		const std::function<bool(EventLogItem)>& callback) {
+		EVT_HANDLE hEvents[ARRAY_SIZE]{};
+
 		std::vector<std::wstring> params;
 		for(auto query : filters){
 			if(!query.SearchesByValue()){
@@ -89,12 +99,16 @@ namespace EventLogs {
 		}
 
 		DWORD dwReturned{};
-		while(EvtNext(hResults, ARRAY_SIZE, hEvents, INFINITE, 0, &dwReturned)){
+		bool bStopped{ false };
+		while(!bStopped && EvtNext(hResults, ARRAY_SIZE, hEvents, INFINITE, 0, &dwReturned)){
 			for(DWORD i = 0; i < dwReturned; i++) {
 
-				auto item = EventToEventLogItem(hEvents[i], params);
-				if(item){
-					results.push_back(*item);
+				if(!bStopped){
+					Accounting::RecordEventRecordRendered();
+					auto item = EventToEventLogItem(hEvents[i], params);
+					if(item && !callback(*item)){
+						bStopped = true;
+					}
 				}
 
 				EvtClose(hEvents[i]);
@@ -108,11 +122,16 @@ namespace EventLogs {
 			}
 		}
 
+		if(bStopped){
+			return false;
+		}
+
 		if(GetLastError() != ERROR_NO_MORE_ITEMS){
 			LOG_ERROR("EventLogs::ProcessResults: EvtNext failed with " << GetLastError());
+			return false;
 		}
 
-		return results;
+		return true;
 	}
 
 	std::optional<EventLogItem> EventToEventLogItem(const EventWrapper& hEvent, const std::vector<std::wstring>& params){
@@ -155,6 +174,16 @@ namespace EventLogs {
 	std::vector<EventLogItem> EventLogs::QueryEvents(const std::wstring& channel, unsigned int id, const std::vector<XpathQuery>& filters) {
 
 		std::vector<EventLogItem> items;
+		EnumerateEvents(channel, id, [&items](EventLogItem item){
+			items.push_back(item);
+			return true;
+		}, filters);
+
+		return items;
+	}
+
+	bool EventLogs::EnumerateEvents(const std::wstring& channel, unsigned int id, const std::function<bool(EventLogItem)>& callback,
+		const std::vector<XpathQuery>& filters) {
 
 		auto query = std::wstring(L"Event/System[EventID=") + std::to_wstring(id) + std::wstring(L"]");
 		for (auto param : filters)
@@ -163,17 +192,15 @@ namespace EventLogs {
 		EventWrapper hResults = EvtQuery(NULL, channel.c_str(), query.c_str(), EvtQueryChannelPath | EvtQueryReverseDirection);
 		if (NULL == hResults) {
 			if (ERROR_EVT_CHANNEL_NOT_FOUND == GetLastError())
-				LOG_ERROR("EventLogs::QueryEvents: The channel was not found.");
+				LOG_ERROR("EventLogs::EnumerateEvents: The channel was not found.");
 			else if (ERROR_EVT_INVALID_QUERY == GetLastError())
-				LOG_ERROR(L"EventLogs::QueryEvents: The query " << query << L" is not valid.");
+				LOG_ERROR(L"EventLogs::EnumerateEvents: The query " << query << L" is not valid.");
 			else
-				LOG_ERROR("EventLogs::QueryEvents: EvtQuery failed with " << GetLastError());
-		}
-		else {
-			items = ProcessResults(hResults, filters);
+				LOG_ERROR("EventLogs::EnumerateEvents: EvtQuery failed with " << GetLastError());
+			return false;
 		}
 
-		return items;
+		return ProcessResults(hResults, filters, callback);
 	}
 
 	std::vector<EventSubscription> subscriptions = {};
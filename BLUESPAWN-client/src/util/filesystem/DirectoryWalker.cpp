@@ -0,0 +1,283 @@
+#include "util/filesystem/DirectoryWalker.h"
+
+#include <vector>
+#include <cwctype>
+
+#include "util/threadpool/ThreadPool.h"
+#include "common/Internals.h"
+#include "common/Utils.h"
+
+LINK_FUNCTION(NtQueryDirectoryFile, ntdll.dll)
+
+namespace FileSystem {
+
+	namespace {
+
+		/// The information class requesting FILE_DIRECTORY_INFORMATION from NtQueryDirectoryFile
+		const int FILE_DIRECTORY_INFORMATION_CLASS{ 1 };
+
+		/// The size of the buffer into which directories are listed. Each call fills as much of the buffer as it
+		/// can, so a larger buffer means fewer calls for large directories.
+		const ULONG DIRECTORY_BUFFER_SIZE{ 256 * 1024 };
+
+		/// The number of matching entries reported to the callback at a time
+		const SIZE_T REPORT_BATCH_SIZE{ 256 };
+
+		/// The number of batches the pool may list ahead of the callback before the threads listing them wait
+		const SIZE_T MAX_WAITING_BATCHES{ 64 };
+	}
+
+	DirectoryWalker::DirectoryWalker(const WalkOptions& options) :
+		options{ options },
+		bCancelled{ false },
+		qwDirectories{ 0 },
+		qwEntries{ 0 },
+		qwReported{ 0 },
+		lpPool{ nullptr },
+		dwPendingDirectories{ 0 }{
+
+		InitializeConditionVariable(&cvProgress);
+		InitializeConditionVariable(&cvBatchesTaken);
+	}
+
+	ThreadPool& DirectoryWalker::GetSharedPool(){
+		// The pool is never destroyed, so that its workers aren't joined while the process is exiting
+		static auto lpSharedPool{ new ThreadPool{} };
+		return *lpSharedPool;
+	}
+
+	bool DirectoryWalker::Matches(const std::wstring_view& name, DWORD dwAttributes) const {
+		if((dwAttributes & options.dwRequiredAttributes) != options.dwRequiredAttributes || (dwAttributes & options.dwExcludedAttributes)){
+			return false;
+		}
+
+		if(dwAttributes & FILE_ATTRIBUTE_DIRECTORY){
+			return options.bReportDirectories;
+		}
+		if(!options.bReportFiles){
+			return false;
+		}
+
+		if(options.extensions.empty()){
+			return true;
+		}
+
+		// Extensions are short enough to fit in the small string buffer, so this doesn't allocate
+		auto dwPeriod{ name.find_last_of(L'.') };
+		if(dwPeriod == std::wstring_view::npos){
+			return false;
+		}
+		std::wstring extension{ name.substr(dwPeriod) };
+		for(auto& ch : extension){
+			ch = towlower(ch);
+		}
+		return options.extensions.count(extension) != 0;
+	}
+
+	void DirectoryWalker::EnterDirectory(const std::wstring& path, int iDepth, const std::function<bool(const DirectoryEntry&)>& callback){
+		if(!lpPool){
+			vWaitingDirectories.emplace_back(path, iDepth);
+			return;
+		}
+
+		EnterCriticalSection(hPendingSection);
+		dwPendingDirectories++;
+		LeaveCriticalSection(hPendingSection);
+
+		lpPool->Submit([this, path, iDepth, &callback](){
+			ListedBatch batch{};
+			{
+				Log::BeginLogCapture capture{ batch.logs };
+				Accounting::ResourceTracker tracker{};
+				WalkDirectory(path, iDepth, callback);
+				batch.usage = tracker.GetUsage();
+			}
+
+			EnterCriticalSection(hPendingSection);
+			vListedBatches.emplace_back(std::move(batch));
+			dwPendingDirectories--;
+			WakeAllConditionVariable(&cvProgress);
+			LeaveCriticalSection(hPendingSection);
+		});
+	}
+
+	void DirectoryWalker::QueueBatch(ListedBatch&& batch){
+		EnterCriticalSection(hPendingSection);
+		while(vListedBatches.size() >= MAX_WAITING_BATCHES && !bCancelled){
+			SleepConditionVariableCS(&cvBatchesTaken, hPendingSection, INFINITE);
+		}
+		vListedBatches.emplace_back(std::move(batch));
+		WakeAllConditionVariable(&cvProgress);
+		LeaveCriticalSection(hPendingSection);
+	}
+
+	void DirectoryWalker::ReportEntries(const std::vector<DirectoryEntry>& vEntries, const std::function<bool(const DirectoryEntry&)>& callback){
+		for(auto& entry : vEntries){
+			if(bCancelled){
+				break;
+			}
+			qwReported++;
+			if(!callback(entry)){
+				Cancel();
+			}
+		}
+	}
+
+	void DirectoryWalker::WalkDirectory(const std::wstring& path, int iDepth, const std::function<bool(const DirectoryEntry&)>& callback){
+		if(!CallFunctionSafe([&](){ ListDirectory(path, iDepth, callback); })){
+			LOG_ERROR("Listing folder " << path << " raised an exception; its remaining entries were skipped");
+		}
+	}
+
+	void DirectoryWalker::ListDirectory(const std::wstring& path, int iDepth, const std::function<bool(const DirectoryEntry&)>& callback){
+		if(bCancelled){
+			return;
+		}
+
+		// A drive letter on its own names the current directory on that drive rather than its root
+		auto openPath{ path.length() && path.back() == L':' ? path + L"\\" : path };
+		HandleWrapper hDirectory{ CreateFileW(openPath.c_str(), FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+		                                      nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, nullptr) };
+		if(!hDirectory){
+			LOG_ERROR("Couldn't open folder " << path);
+			return;
+		}
+		qwDirectories++;
+
+		thread_local std::vector<BYTE> vBuffer(DIRECTORY_BUFFER_SIZE);
+		bool bEnterSubdirectories{ options.iMaxDepth == -1 || iDepth < options.iMaxDepth };
+
+		// Entries listed on the pool are handed to the walking thread, which calls the callback
+		std::vector<DirectoryEntry> vMatches{};
+		auto Report{ [&](){
+			if(vMatches.empty()){
+				return;
+			}
+			if(lpPool){
+				QueueBatch(ListedBatch{ std::move(vMatches) });
+			} else{
+				ReportEntries(vMatches, callback);
+			}
+			vMatches.clear();
+		} };
+
+		BOOLEAN bRestart{ TRUE };
+		while(!bCancelled){
+			IO_STATUS_BLOCK IoStatus{};
+			auto status{ Linker::NtQueryDirectoryFile(hDirectory, nullptr, nullptr, nullptr, &IoStatus, vBuffer.data(), DIRECTORY_BUFFER_SIZE,
+			                                          FILE_DIRECTORY_INFORMATION_CLASS, FALSE, nullptr, bRestart) };
+			bRestart = FALSE;
+			if(status == ((NTSTATUS) 0x80000006L)){ // STATUS_NO_MORE_FILES
+				break;
+			}
+			if(!NT_SUCCESS(status)){
+				LOG_ERROR("Unable to list folder " << path << " (NTSTATUS " << status << ")");
+				break;
+			}
+
+			auto lpEntry{ reinterpret_cast<PFILE_DIRECTORY_INFORMATION>(vBuffer.data()) };
+			while(true){
+				qwEntries++;
+
+				std::wstring_view name{ lpEntry->FileName, lpEntry->FileNameLength / sizeof(WCHAR) };
+				auto dwAttributes{ lpEntry->FileAttributes };
+				if(name != L"." && name != L".."){
+					auto bDirectory{ (dwAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0 };
+					auto bMatches{ Matches(name, dwAttributes) };
+					auto bEnter{ bDirectory && bEnterSubdirectories &&
+						(options.bFollowReparsePoints || !(dwAttributes & FILE_ATTRIBUTE_REPARSE_POINT)) };
+
+					if(bMatches || bEnter){
+						// A root such as C:\ already ends with a separator
+						std::wstring entryPath{ path };
+						if(entryPath.length() && entryPath.back() != L'\\'){
+							entryPath.push_back(L'\\');
+						}
+						entryPath.append(name);
+
+						if(bEnter && (!options.folderFilter || options.folderFilter(entryPath))){
+							EnterDirectory(entryPath, iDepth + 1, callback);
+						}
+
+						if(bMatches){
+							vMatches.emplace_back(DirectoryEntry{
+								std::move(entryPath),
+								dwAttributes,
+								static_cast<DWORD64>(lpEntry->EndOfFile.QuadPart),
+								FILETIME{ lpEntry->LastWriteTime.LowPart, static_cast<DWORD>(lpEntry->LastWriteTime.HighPart) },
+								iDepth
+							});
+							if(vMatches.size() >= REPORT_BATCH_SIZE){
+								Report();
+							}
+						}
+					}
+				}
+
+				if(!lpEntry->NextEntryOffset){
+					break;
+				}
+				lpEntry = reinterpret_cast<PFILE_DIRECTORY_INFORMATION>(reinterpret_cast<BYTE*>(lpEntry) + lpEntry->NextEntryOffset);
+			}
+		}
+
+		Report();
+	}
+
+	bool DirectoryWalker::Walk(const std::wstring& root, const std::function<bool(const DirectoryEntry&)>& callback){
+		qwDirectories = qwEntries = qwReported = 0;
+
+		auto start{ GetTickCount64() };
+
+		// Waiting on the shared pool from one of its own threads could leave no thread free to list directories
+		auto& pool{ GetSharedPool() };
+		lpPool = options.iMaxDepth == 0 || pool.IsCurrentThreadWorker() ? nullptr : &pool;
+
+		EnterDirectory(root, 0, callback);
+		if(lpPool){
+			// Batches are still taken once the walk is cancelled so that the threads waiting to queue them finish,
+			// and so that what they logged is replayed here
+			EnterCriticalSection(hPendingSection);
+			while(dwPendingDirectories || vListedBatches.size()){
+				if(vListedBatches.empty()){
+					SleepConditionVariableCS(&cvProgress, hPendingSection, INFINITE);
+					continue;
+				}
+
+				auto batches{ std::move(vListedBatches) };
+				vListedBatches.clear();
+				WakeAllConditionVariable(&cvBatchesTaken);
+				LeaveCriticalSection(hPendingSection);
+
+				for(auto& batch : batches){
+					batch.logs.Replay();
+					Accounting::MergeCounters(batch.usage);
+					ReportEntries(batch.vEntries, callback);
+				}
+
+				EnterCriticalSection(hPendingSection);
+			}
+			LeaveCriticalSection(hPendingSection);
+		} else{
+			while(vWaitingDirectories.size()){
+				auto directory{ std::move(vWaitingDirectories.back()) };
+				vWaitingDirectories.pop_back();
+				WalkDirectory(directory.first, directory.second, callback);
+			}
+		}
+
+		auto dwElapsed{ GetTickCount64() - start };
+		LOG_VERBOSE(1, L"Walked " << qwDirectories.load() << L" folders and " << qwEntries.load() << L" entries beneath " << root << L" in " <<
+			dwElapsed << L" ms, reporting " << qwReported.load() << L" entries" << (dwElapsed ? L" (" + std::to_wstring(qwEntries.load() * 1000 / dwElapsed) + L" entries/s)" : L""));
+
+		return !bCancelled;
+	}
+
+	void DirectoryWalker::Cancel(){
+		bCancelled = true;
+	}
+
+	bool DirectoryWalker::IsCancelled() const {
+		return bCancelled;
+	}
+}
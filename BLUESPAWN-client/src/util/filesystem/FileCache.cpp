@@ -0,0 +1,355 @@
+#include "util/filesystem/FileCache.h"
+
+#include <cstddef>
+#include <vector>
+#include <tuple>
+
+#include "util/log/Log.h"
+
+namespace FileSystem {
+
+	namespace {
+
+		/// Identifies a file holding a file cache
+		const DWORD CACHE_MAGIC{ 0x43465342 }; // "BSFC"
+		const DWORD CACHE_VERSION{ 1 };
+
+		struct CacheHeader {
+			DWORD dwMagic;
+			DWORD dwVersion;
+			DWORD dwSlotCount;
+			DWORD dwSlotSize;
+		};
+
+		/// The fields of a slot recording which of its fields hold something
+		enum SlotFlags : DWORD {
+			SLOT_MD5 = 1,
+			SLOT_SHA1 = 2,
+			SLOT_SHA256 = 4,
+			SLOT_SIGNATURE_CHECKED = 8,
+			SLOT_SIGNED = 16,
+			SLOT_YARA_CLEAN = 32
+		};
+
+		/// A single entry, as stored in the table. A slot whose checksum is 0 or doesn't match its contents is empty.
+		struct CacheSlot {
+			DWORD64 qwChecksum;
+
+			DWORD dwVolumeSerial;
+			DWORD dwFlags;
+			DWORD64 qwFileIndex;
+			DWORD64 qwFileSize;
+			FILETIME ftLastWrite;
+			LONGLONG llUsn;
+
+			/// The time at which the slot was last written, used to pick which slot to replace
+			DWORD64 qwRecorded;
+
+			DWORD64 qwYaraRules;
+			BYTE rgbMD5[MD5LEN];
+			BYTE rgbSHA1[SHA1LEN];
+			BYTE rgbSHA256[SHA256LEN];
+		};
+
+		/// The contents of a slot covered by its checksum, which excludes any padding at its end
+		const SIZE_T SLOT_DATA_OFFSET{ offsetof(CacheSlot, dwVolumeSerial) };
+		const SIZE_T SLOT_DATA_SIZE{ offsetof(CacheSlot, rgbSHA256) + SHA256LEN - SLOT_DATA_OFFSET };
+
+		DWORD64 GetSlotChecksum(const CacheSlot& slot){
+			auto qwChecksum{ HashData(reinterpret_cast<const BYTE*>(&slot) + SLOT_DATA_OFFSET, SLOT_DATA_SIZE) };
+			return qwChecksum ? qwChecksum : 1;
+		}
+
+		bool IsSlotValid(const CacheSlot& slot){
+			return slot.qwChecksum && slot.qwChecksum == GetSlotChecksum(slot);
+		}
+
+		bool SlotMatches(const CacheSlot& slot, const FileIdentity& identity){
+			return slot.dwVolumeSerial == identity.dwVolumeSerial && slot.qwFileIndex == identity.dwFileIndex &&
+				slot.qwFileSize == identity.dwFileSize && slot.llUsn == identity.llUsn &&
+				CompareFileTime(&slot.ftLastWrite, &identity.ftLastWrite) == 0;
+		}
+
+		/// The digests kept in a slot, each with the flag indicating it's present, its field, and its length
+		std::vector<std::tuple<HashType, DWORD, BYTE*, DWORD>> GetSlotDigests(CacheSlot& slot){
+			return {
+				{ HashType::MD5_HASH, SLOT_MD5, slot.rgbMD5, MD5LEN },
+				{ HashType::SHA1_HASH, SLOT_SHA1, slot.rgbSHA1, SHA1LEN },
+				{ HashType::SHA256_HASH, SLOT_SHA256, slot.rgbSHA256, SHA256LEN },
+			};
+		}
+
+		std::wstring ToHex(const BYTE* lpData, DWORD dwSize){
+			std::wstring rgbDigits{ L"0123456789abcdef" };
+			std::wstring hex{};
+			for(DWORD i = 0; i < dwSize; i++){
+				hex += rgbDigits[(lpData[i] >> 4) & 0xf];
+				hex += rgbDigits[lpData[i] & 0xf];
+			}
+			return hex;
+		}
+
+		bool FromHex(const std::wstring& hex, BYTE* lpData, DWORD dwSize){
+			if(hex.length() != dwSize * 2){
+				return false;
+			}
+			for(DWORD i = 0; i < dwSize * 2; i++){
+				auto ch{ hex[i] };
+				BYTE nibble{};
+				if(ch >= L'0' && ch <= L'9'){
+					nibble = static_cast<BYTE>(ch - L'0');
+				} else if(ch >= L'a' && ch <= L'f'){
+					nibble = static_cast<BYTE>(ch - L'a' + 10);
+				} else if(ch >= L'A' && ch <= L'F'){
+					nibble = static_cast<BYTE>(ch - L'A' + 10);
+				} else{
+					return false;
+				}
+				lpData[i / 2] = (i % 2) ? (lpData[i / 2] | nibble) : static_cast<BYTE>(nibble << 4);
+			}
+			return true;
+		}
+
+		/// Reads what a slot records about its file
+		FileVerdicts ReadSlot(CacheSlot& slot){
+			FileVerdicts verdicts{};
+			for(auto& digest : GetSlotDigests(slot)){
+				if(slot.dwFlags & std::get<1>(digest)){
+					verdicts.hashes.emplace(std::get<0>(digest), ToHex(std::get<2>(digest), std::get<3>(digest)));
+				}
+			}
+			if(slot.dwFlags & SLOT_SIGNATURE_CHECKED){
+				verdicts.bSigned = (slot.dwFlags & SLOT_SIGNED) != 0;
+			}
+			if(slot.dwFlags & SLOT_YARA_CLEAN){
+				verdicts.qwYaraCleanRules = slot.qwYaraRules;
+			}
+			return verdicts;
+		}
+
+		SIZE_T GetTableSize(DWORD dwSlotCount){
+			return sizeof(CacheHeader) + static_cast<SIZE_T>(dwSlotCount) * sizeof(CacheSlot);
+		}
+	}
+
+	FileCache FileCache::instance{};
+
+	const DWORD FileCache::dwSlotCount{ 1 << 17 };
+	const DWORD FileCache::dwProbeCount{ 8 };
+
+	FileCache::FileCache() :
+		hFile{ nullptr },
+		hMapping{ nullptr },
+		lpView{ VirtualAlloc(nullptr, GetTableSize(dwSlotCount), MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE),
+		        [](LPVOID lpView){ VirtualFree(lpView, 0, MEM_RELEASE); }, nullptr },
+		dwHits{ 0 },
+		dwMisses{ 0 }{
+
+		// VirtualAlloc returns zeroed pages, and only the pages holding slots that are used are ever touched
+		if(lpView){
+			Initialize();
+		}
+	}
+
+	FileCache& FileCache::GetInstance(){
+		return instance;
+	}
+
+	void FileCache::Initialize(){
+		auto header{ reinterpret_cast<CacheHeader*>(lpView.Get()) };
+		header->dwMagic = CACHE_MAGIC;
+		header->dwVersion = CACHE_VERSION;
+		header->dwSlotCount = dwSlotCount;
+		header->dwSlotSize = sizeof(CacheSlot);
+	}
+
+	bool FileCache::Open(const std::wstring& path){
+		auto lock{ BeginCriticalSection(hSection) };
+		if(IsPersistent() && path == wsPath){
+			return true;
+		}
+
+		// The file isn't shared for writing, so a second instance of BLUESPAWN keeps its cache in memory instead. The
+		// file must be writable only by SYSTEM and Administrators, since its entries decide which files are never read.
+		auto hNewFile{ OpenProtectedFile(path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, OPEN_ALWAYS) };
+		if(!hNewFile){
+			LOG_WARNING(L"Unable to open file cache " << path << L" (error " << GetLastError() << L"); file verdicts will not be kept between runs");
+			return false;
+		}
+
+		ULARGE_INTEGER size{};
+		size.QuadPart = GetTableSize(dwSlotCount);
+		HandleWrapper hNewMapping{ CreateFileMappingW(hNewFile, nullptr, PAGE_READWRITE, size.HighPart, size.LowPart, nullptr) };
+		if(!hNewMapping){
+			LOG_WARNING(L"Unable to map file cache " << path << L" (error " << GetLastError() << L"); file verdicts will not be kept between runs");
+			return false;
+		}
+
+		auto lpNewView{ MapViewOfFile(hNewMapping, FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, 0) };
+		if(!lpNewView){
+			LOG_WARNING(L"Unable to map file cache " << path << L" (error " << GetLastError() << L"); file verdicts will not be kept between runs");
+			return false;
+		}
+
+		hFile = hNewFile;
+		hMapping = hNewMapping;
+		lpView = { lpNewView, [](LPVOID lpView){ UnmapViewOfFile(lpView); }, nullptr };
+		wsPath = path;
+
+		auto header{ reinterpret_cast<CacheHeader*>(lpView.Get()) };
+		if(header->dwMagic != CACHE_MAGIC || header->dwVersion != CACHE_VERSION || header->dwSlotCount != dwSlotCount ||
+		   header->dwSlotSize != sizeof(CacheSlot)){
+			LOG_INFO(L"Starting a new file cache at " << path);
+			ZeroMemory(lpView, GetTableSize(dwSlotCount));
+			Initialize();
+		} else{
+			LOG_INFO(L"Opened file cache " << path);
+		}
+
+		return true;
+	}
+
+	bool FileCache::IsPersistent() const {
+		return hMapping && lpView;
+	}
+
+	void FileCache::Reset(){
+		auto lock{ BeginCriticalSection(hSection) };
+		if(IsPersistent()){
+			if(!FlushViewOfFile(lpView, 0) || !FlushFileBuffers(hFile)){
+				LOG_WARNING(L"Unable to flush file cache " << wsPath << L" (error " << GetLastError() << L")");
+			}
+			LOG_VERBOSE(1, L"Closed file cache " << wsPath);
+		}
+
+		// The view is replaced before the mapping and file are closed, so that it is unmapped first
+		lpView = { VirtualAlloc(nullptr, GetTableSize(dwSlotCount), MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE),
+		           [](LPVOID lpView){ VirtualFree(lpView, 0, MEM_RELEASE); }, nullptr };
+		hMapping = nullptr;
+		hFile = nullptr;
+		wsPath.clear();
+		dwHits = 0;
+		dwMisses = 0;
+
+		if(lpView){
+			Initialize();
+		}
+	}
+
+	std::optional<FileVerdicts> FileCache::Find(const FileIdentity& identity){
+		auto lock{ BeginCriticalSection(hSection) };
+		if(!lpView){
+			return std::nullopt;
+		}
+
+		auto slots{ reinterpret_cast<CacheSlot*>(reinterpret_cast<BYTE*>(lpView.Get()) + sizeof(CacheHeader)) };
+		auto dwHome{ HashFileIdentity(identity) % dwSlotCount };
+		for(DWORD dwProbe = 0; dwProbe < dwProbeCount; dwProbe++){
+			auto slot{ slots[(dwHome + dwProbe) % dwSlotCount] };
+			if(!IsSlotValid(slot) || !SlotMatches(slot, identity)){
+				continue;
+			}
+
+			dwHits++;
+			return ReadSlot(slot);
+		}
+
+		dwMisses++;
+		return std::nullopt;
+	}
+
+	void FileCache::Update(const FileIdentity& identity, const std::function<void(FileVerdicts&)>& update){
+		auto lock{ BeginCriticalSection(hSection) };
+		if(!lpView){
+			return;
+		}
+
+		// Use the slot already holding the file, or else an empty slot, or else the oldest slot the file may occupy
+		auto slots{ reinterpret_cast<CacheSlot*>(reinterpret_cast<BYTE*>(lpView.Get()) + sizeof(CacheHeader)) };
+		auto dwHome{ HashFileIdentity(identity) % dwSlotCount };
+		std::optional<DWORD> dwExisting{ std::nullopt };
+		std::optional<DWORD> dwEmpty{ std::nullopt };
+		auto dwOldest{ dwHome };
+		for(DWORD dwProbe = 0; dwProbe < dwProbeCount && !dwExisting; dwProbe++){
+			auto dwIndex{ static_cast<DWORD>((dwHome + dwProbe) % dwSlotCount) };
+			if(!IsSlotValid(slots[dwIndex])){
+				if(!dwEmpty){
+					dwEmpty = dwIndex;
+				}
+			} else if(SlotMatches(slots[dwIndex], identity)){
+				dwExisting = dwIndex;
+			} else if(slots[dwIndex].qwRecorded < slots[dwOldest].qwRecorded){
+				dwOldest = dwIndex;
+			}
+		}
+		auto dwIndex{ dwExisting ? *dwExisting : dwEmpty ? *dwEmpty : dwOldest };
+
+		CacheSlot record{};
+		if(dwExisting){
+			record = slots[dwIndex];
+		}
+
+		auto verdicts{ ReadSlot(record) };
+		update(verdicts);
+
+		record.dwVolumeSerial = identity.dwVolumeSerial;
+		record.qwFileIndex = identity.dwFileIndex;
+		record.qwFileSize = identity.dwFileSize;
+		record.ftLastWrite = identity.ftLastWrite;
+		record.llUsn = identity.llUsn;
+		record.dwFlags = 0;
+		for(auto& digest : GetSlotDigests(record)){
+			auto hash{ verdicts.hashes.find(std::get<0>(digest)) };
+			if(hash != verdicts.hashes.end() && FromHex(hash->second, std::get<2>(digest), std::get<3>(digest))){
+				record.dwFlags |= std::get<1>(digest);
+			}
+		}
+		if(verdicts.bSigned){
+			record.dwFlags |= SLOT_SIGNATURE_CHECKED | (*verdicts.bSigned ? SLOT_SIGNED : 0);
+		}
+		if(verdicts.qwYaraCleanRules){
+			record.dwFlags |= SLOT_YARA_CLEAN;
+			record.qwYaraRules = *verdicts.qwYaraCleanRules;
+		}
+
+		FILETIME ftNow{};
+		GetSystemTimeAsFileTime(&ftNow);
+		record.qwRecorded = (static_cast<DWORD64>(ftNow.dwHighDateTime) << 32) | ftNow.dwLowDateTime;
+		record.qwChecksum = GetSlotChecksum(record);
+
+		// The slot is marked empty while it's being written, so that an interrupted write leaves it empty rather
+		// than holding a mix of two entries
+		auto& slot{ slots[dwIndex] };
+		slot.qwChecksum = 0;
+		MemoryBarrier();
+		CopyMemory(reinterpret_cast<BYTE*>(&slot) + SLOT_DATA_OFFSET, reinterpret_cast<BYTE*>(&record) + SLOT_DATA_OFFSET, SLOT_DATA_SIZE);
+		MemoryBarrier();
+		slot.qwChecksum = record.qwChecksum;
+	}
+
+	void FileCache::Flush(){
+		auto lock{ BeginCriticalSection(hSection) };
+		if(!IsPersistent()){
+			return;
+		}
+
+		if(!FlushViewOfFile(lpView, 0) || !FlushFileBuffers(hFile)){
+			LOG_WARNING(L"Unable to flush file cache " << wsPath << L" (error " << GetLastError() << L")");
+			return;
+		}
+		LOG_VERBOSE(1, L"Flushed file cache " << wsPath << L" (" << dwHits.load() << L" hits, " << dwMisses.load() << L" misses)");
+	}
+
+	std::pair<DWORD, DWORD> FileCache::GetStatistics() const {
+		return { dwHits.load(), dwMisses.load() };
+	}
+
+	std::wstring FileCache::GetDefaultPath(){
+		WCHAR path[MAX_PATH]{};
+		GetModuleFileNameW(nullptr, path, MAX_PATH);
+
+		std::wstring directory{ path };
+		directory = directory.substr(0, directory.find_last_of(L'\\') + 1);
+		return directory + L"bluespawn-file-cache.dat";
+	}
+}
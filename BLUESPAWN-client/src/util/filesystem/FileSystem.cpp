@@ -1,6 +1,9 @@
 #include "util/filesystem/FileSystem.h"
+#include "util/filesystem/FileCache.h"
+#include "util/filesystem/DirectoryWalker.h"
 #include "util/log/Log.h"
 #include "common/StringUtils.h"
+#include "util/accounting/ResourceUsage.h"
 
 #include <windows.h>
 #include <Wincrypt.h>
@@ -16,11 +19,118 @@
 #include <mscat.h>
 #include "common/wrappers.hpp"
 #include "common/StringUtils.h"
+#include "common/Utils.h"
 #include "aclapi.h"
+#include <sddl.h>
+#include <winioctl.h>
 
 LINK_FUNCTION(NtCreateFile, ntdll.dll)
 
 namespace FileSystem{
+	namespace {
+		/// The size of the chunks in which files are read to be hashed
+		const DWORD HASH_CHUNK_SIZE{ 1 << 20 };
+
+		/// The security descriptor given to files created by OpenProtectedFile
+		LPCWSTR PROTECTED_FILE_SDDL{ L"O:BAD:P(A;;FA;;;SY)(A;;FA;;;BA)" };
+
+		/// Access rights that allow a file to be changed
+		const ACCESS_MASK FILE_CHANGE_ACCESS{ FILE_WRITE_DATA | FILE_APPEND_DATA | FILE_WRITE_EA | FILE_WRITE_ATTRIBUTES | DELETE |
+			WRITE_DAC | WRITE_OWNER | GENERIC_WRITE | GENERIC_ALL };
+
+		/// Checks whether a SID is SYSTEM or the Administrators group
+		bool IsTrustedSid(PSID sid){
+			return IsWellKnownSid(sid, WinLocalSystemSid) || IsWellKnownSid(sid, WinBuiltinAdministratorsSid);
+		}
+
+		/// Retrieves the CryptoAPI algorithm computing a type of hash
+		ALG_ID GetHashAlgorithm(HashType type){
+			if(type == HashType::SHA1_HASH){
+				return CALG_SHA1;
+			} else if(type == HashType::SHA256_HASH){
+				return CALG_SHA_256;
+			} else if(type == HashType::SHA384_HASH){
+				return CALG_SHA_384;
+			} else if(type == HashType::SHA512_HASH){
+				return CALG_SHA_512;
+			}
+			return CALG_MD5;
+		}
+	}
+
+	DWORD64 HashFileIdentity(const FileIdentity& identity){
+		// The fields are hashed individually since the struct contains padding
+		auto dwHash{ HashData(&identity.dwVolumeSerial, sizeof(identity.dwVolumeSerial)) };
+		dwHash = HashData(&identity.dwFileIndex, sizeof(identity.dwFileIndex), dwHash);
+		dwHash = HashData(&identity.dwFileSize, sizeof(identity.dwFileSize), dwHash);
+		dwHash = HashData(&identity.ftLastWrite, sizeof(identity.ftLastWrite), dwHash);
+		return HashData(&identity.llUsn, sizeof(identity.llUsn), dwHash);
+	}
+
+	bool IsFileProtected(HANDLE hFile){
+		PSID lpOwner{ nullptr };
+		PACL lpDacl{ nullptr };
+		PSECURITY_DESCRIPTOR lpDescriptor{ nullptr };
+		auto dwStatus{ GetSecurityInfo(hFile, SE_FILE_OBJECT, OWNER_SECURITY_INFORMATION | DACL_SECURITY_INFORMATION, &lpOwner, nullptr,
+		                               &lpDacl, nullptr, &lpDescriptor) };
+		if(dwStatus != ERROR_SUCCESS){
+			SetLastError(dwStatus);
+			return false;
+		}
+		auto descriptor{ GenericWrapper<PSECURITY_DESCRIPTOR>(lpDescriptor, [](PSECURITY_DESCRIPTOR lpDescriptor){ LocalFree(lpDescriptor); }, nullptr) };
+
+		// A null DACL grants everyone full access
+		if(!lpOwner || !IsTrustedSid(lpOwner) || !lpDacl){
+			return false;
+		}
+
+		for(DWORD idx = 0; idx < lpDacl->AceCount; idx++){
+			LPVOID lpAce{ nullptr };
+			if(!GetAce(lpDacl, idx, &lpAce)){
+				return false;
+			}
+
+			auto header{ reinterpret_cast<PACE_HEADER>(lpAce) };
+			if(header->AceType == ACCESS_DENIED_ACE_TYPE || (header->AceFlags & INHERIT_ONLY_ACE)){
+				continue;
+			}
+			if(header->AceType != ACCESS_ALLOWED_ACE_TYPE){
+				return false;
+			}
+
+			auto ace{ reinterpret_cast<PACCESS_ALLOWED_ACE>(lpAce) };
+			if((ace->Mask & FILE_CHANGE_ACCESS) && !IsTrustedSid(&ace->SidStart)){
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	HandleWrapper OpenProtectedFile(const std::wstring& path, DWORD dwAccess, DWORD dwShareMode, DWORD dwDisposition){
+		PSECURITY_DESCRIPTOR lpDescriptor{ nullptr };
+		if(!ConvertStringSecurityDescriptorToSecurityDescriptorW(PROTECTED_FILE_SDDL, SDDL_REVISION_1, &lpDescriptor, nullptr)){
+			return INVALID_HANDLE_VALUE;
+		}
+		auto descriptor{ GenericWrapper<PSECURITY_DESCRIPTOR>(lpDescriptor, [](PSECURITY_DESCRIPTOR lpDescriptor){ LocalFree(lpDescriptor); }, nullptr) };
+
+		SECURITY_ATTRIBUTES attributes{ sizeof(attributes), lpDescriptor, FALSE };
+		HandleWrapper hFile{ CreateFileW(path.c_str(), dwAccess | READ_CONTROL, dwShareMode, &attributes, dwDisposition, FILE_ATTRIBUTE_NORMAL,
+		                                 nullptr) };
+		if(!hFile){
+			return INVALID_HANDLE_VALUE;
+		}
+		Accounting::RecordFileOpened();
+
+		if(!IsFileProtected(hFile)){
+			LOG_WARNING(L"Refusing to use " << path << L" since users other than SYSTEM and Administrators may be able to write it");
+			SetLastError(ERROR_ACCESS_DENIED);
+			return INVALID_HANDLE_VALUE;
+		}
+
+		return hFile;
+	}
+
 	bool CheckFileExists(const std::wstring& path) {
 		auto attribs = GetFileAttributesW(path.c_str());
 		if(INVALID_FILE_ATTRIBUTES == attribs && GetLastError() == ERROR_FILE_NOT_FOUND){
@@ -118,7 +228,100 @@ namespace FileSystem{
 		return GetCatalog(hFile) != std::nullopt;
 	}
 
-	std::optional<std::wstring> File::CalculateHashType(HashType sHashType) const {
+	bool File::ReadChunks(const std::function<bool(const BYTE*, DWORD)>& callback) const {
+		auto lpBuffers{ VirtualAlloc(nullptr, 2 * HASH_CHUNK_SIZE, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE) };
+		if(!lpBuffers){
+			return false;
+		}
+		GenericWrapper<LPVOID> buffers{ lpBuffers, [](LPVOID lpMemory){ VirtualFree(lpMemory, 0, MEM_RELEASE); } };
+		auto lpChunks{ reinterpret_cast<BYTE*>(lpBuffers) };
+
+		HandleWrapper hOverlapped{ ReOpenFile(hFile, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+											  FILE_FLAG_OVERLAPPED | FILE_FLAG_SEQUENTIAL_SCAN) };
+		if(!hOverlapped){
+			LOG_VERBOSE(3, "Unable to reopen " << FilePath << " for overlapped reads; reading it synchronously");
+
+			SetFilePointer(0);
+			DWORD cbRead{};
+			bool bResult{ false };
+			while((bResult = ReadFile(hFile, lpChunks, HASH_CHUNK_SIZE, &cbRead, nullptr)) && cbRead){
+				Accounting::RecordBytesRead(cbRead);
+				if(!callback(lpChunks, cbRead)){
+					bResult = false;
+					break;
+				}
+			}
+			SetFilePointer(0);
+			return bResult;
+		}
+
+		// At most one read is in flight at a time: the next chunk is read into one buffer while the other is processed
+		HandleWrapper hEvents[2]{ CreateEventW(nullptr, true, false, nullptr), CreateEventW(nullptr, true, false, nullptr) };
+		if(!hEvents[0] || !hEvents[1]){
+			return false;
+		}
+
+		OVERLAPPED overlapped[2]{};
+		bool bEndOfFile[2]{};
+		auto Issue{ [&](DWORD dwBuffer, DWORD64 qwOffset){
+			overlapped[dwBuffer] = {};
+			overlapped[dwBuffer].Offset = static_cast<DWORD>(qwOffset);
+			overlapped[dwBuffer].OffsetHigh = static_cast<DWORD>(qwOffset >> 32);
+			overlapped[dwBuffer].hEvent = hEvents[dwBuffer];
+			bEndOfFile[dwBuffer] = false;
+			if(!ReadFile(hOverlapped, lpChunks + dwBuffer * HASH_CHUNK_SIZE, HASH_CHUNK_SIZE, nullptr, &overlapped[dwBuffer])){
+				if(GetLastError() == ERROR_HANDLE_EOF){
+					bEndOfFile[dwBuffer] = true;
+				} else if(GetLastError() != ERROR_IO_PENDING){
+					return false;
+				}
+			}
+			return true;
+		} };
+
+		DWORD64 qwOffset{ 0 };
+		DWORD dwCurrent{ 0 };
+		if(!Issue(dwCurrent, qwOffset)){
+			LOG_ERROR("ReadFile failed: " << GetLastError() << " while reading " << FilePath);
+			return false;
+		}
+
+		while(true){
+			DWORD cbRead{ 0 };
+			if(!bEndOfFile[dwCurrent] && !GetOverlappedResult(hOverlapped, &overlapped[dwCurrent], &cbRead, true)){
+				if(GetLastError() != ERROR_HANDLE_EOF){
+					LOG_ERROR("ReadFile failed: " << GetLastError() << " while reading " << FilePath);
+					return false;
+				}
+				cbRead = 0;
+			}
+			if(!cbRead){
+				return true;
+			}
+
+			Accounting::RecordBytesRead(cbRead);
+			qwOffset += cbRead;
+
+			auto dwNext{ 1 - dwCurrent };
+			if(!Issue(dwNext, qwOffset)){
+				LOG_ERROR("ReadFile failed: " << GetLastError() << " while reading " << FilePath);
+				return false;
+			}
+
+			if(!callback(lpChunks + dwCurrent * HASH_CHUNK_SIZE, cbRead)){
+				// The buffer must not be freed while a read into it is still in flight
+				if(!bEndOfFile[dwNext]){
+					DWORD cbIgnored{};
+					CancelIoEx(hOverlapped, &overlapped[dwNext]);
+					GetOverlappedResult(hOverlapped, &overlapped[dwNext], &cbIgnored, true);
+				}
+				return false;
+			}
+			dwCurrent = dwNext;
+		}
+	}
+
+	std::optional<std::map<HashType, std::wstring>> File::GetHashes(const std::set<HashType>& types) const {
 		if (!bFileExists) {
 			LOG_ERROR("Can't get hash of " << FilePath << ". File doesn't exist");
 			SetLastError(ERROR_FILE_NOT_FOUND);
@@ -129,8 +332,25 @@ namespace FileSystem{
 			SetLastError(ERROR_ACCESS_DENIED);
 			return std::nullopt;
 		}
-		//Function from Microsoft
-		//https://docs.microsoft.com/en-us/windows/desktop/SecCrypto/example-c-program--creating-an-md-5-hash-from-file-content
+
+		// Digests recorded for this version of the file are reused rather than reading the file again
+		auto identity{ GetFileIdentity() };
+		if(identity){
+			auto cached{ FileCache::GetInstance().Find(*identity) };
+			if(cached){
+				std::map<HashType, std::wstring> hashes{};
+				for(auto type : types){
+					auto hash{ cached->hashes.find(type) };
+					if(hash != cached->hashes.end()){
+						hashes.emplace(*hash);
+					}
+				}
+				if(hashes.size() == types.size()){
+					LOG_VERBOSE(2, "Reusing the hashes of " << FilePath);
+					return hashes;
+				}
+			}
+		}
 
 		// Get handle to the crypto provider
 		HCRYPTPROV hProv{};
@@ -143,71 +363,75 @@ namespace FileSystem{
 			return std::nullopt;
 		}
 		auto provider{ GenericWrapper<HCRYPTPROV>(hProv, [hProv](auto v) { CryptReleaseContext(hProv, 0); }) };
-		
-		HCRYPTHASH hHash = 0;
-		auto rgbHash = AllocationWrapper{ nullptr, 0 };
-		DWORD cbHash = 0;
-		if (sHashType == HashType::SHA1_HASH) {
-			rgbHash = AllocationWrapper{ new BYTE[SHA1LEN], SHA1LEN, AllocationWrapper::CPP_ARRAY_ALLOC };
-			cbHash = SHA1LEN;
-			if (!CryptCreateHash(hProv, CALG_SHA1, 0, 0, &hHash)) {
-				LOG_ERROR("CryptCreateHash failed: " << GetLastError() << " while getting hash of " << FilePath);
-				return std::nullopt;
-			}
-		}
-		else if (sHashType == HashType::SHA256_HASH) {
-			rgbHash = AllocationWrapper{ new BYTE[SHA256LEN], SHA256LEN, AllocationWrapper::CPP_ARRAY_ALLOC };
-			cbHash = SHA256LEN;
-			if (!CryptCreateHash(hProv, CALG_SHA_256, 0, 0, &hHash)) {
-				LOG_ERROR("CryptCreateHash failed: " << GetLastError() << " while getting hash of " << FilePath);
-				LOG_SYSTEM_ERROR(GetLastError());
-				return std::nullopt;
-			}
-		}
-		else {
-			rgbHash = AllocationWrapper{ new BYTE[MD5LEN], MD5LEN, AllocationWrapper::CPP_ARRAY_ALLOC };
-			cbHash = MD5LEN;
-			if (!CryptCreateHash(hProv, CALG_MD5, 0, 0, &hHash)) {
+
+		std::vector<std::pair<HashType, GenericWrapper<HCRYPTHASH>>> digests{};
+		for(auto type : types){
+			HCRYPTHASH hHash{ 0 };
+			if (!CryptCreateHash(hProv, GetHashAlgorithm(type), 0, 0, &hHash)) {
 				LOG_ERROR("CryptCreateHash failed: " << GetLastError() << " while getting hash of " << FilePath);
 				return std::nullopt;
 			}
+			digests.emplace_back(type, GenericWrapper<HCRYPTHASH>(hHash, CryptDestroyHash));
 		}
-		auto HashData{ GenericWrapper<HCRYPTHASH>(hHash, CryptDestroyHash) };
-		
-		DWORD cbRead{};
-		std::wstring digits{ L"0123456789abcdef" };
-		std::vector<BYTE> file(BUFSIZE);
-		bool bResult{ false };
-		while((bResult = ReadFile(hFile, file.data(), file.size(), &cbRead, nullptr)) && cbRead){
-			if (!CryptHashData(hHash, file.data(), cbRead, 0)) {
-				LOG_ERROR("CryptHashData failed: " << GetLastError() << " while getting hash of " << FilePath);
-				return std::nullopt;
-			}
-		}
-		SetFilePointer(0);
 
-		if (!bResult) {
-			LOG_ERROR("ReadFile failed: " << GetLastError() << " while getting hash of " << FilePath);
+		auto start{ GetTickCount64() };
+		DWORD64 qwBytesHashed{ 0 };
+		auto bRead{ ReadChunks([&](const BYTE* lpChunk, DWORD dwSize){
+			for(auto& digest : digests){
+				if (!CryptHashData(digest.second, lpChunk, dwSize, 0)) {
+					LOG_ERROR("CryptHashData failed: " << GetLastError() << " while getting hash of " << FilePath);
+					return false;
+				}
+			}
+			qwBytesHashed += dwSize;
+			return true;
+		}) };
+		if(!bRead){
+			LOG_ERROR("Unable to read " << FilePath << " while getting its hashes");
 			return std::nullopt;
 		}
 
-		std::wstring buffer{};
+		auto dwElapsed{ GetTickCount64() - start };
+		LOG_VERBOSE(2, "Computed " << digests.size() << " hashes of " << FilePath << " (" << qwBytesHashed << " bytes) in " << dwElapsed <<
+			" ms" << (dwElapsed ? L" (" + std::to_wstring(qwBytesHashed / 1000 / dwElapsed) + L" MB/s)" : L""));
+
+		std::map<HashType, std::wstring> hashes{};
 		std::wstring rgbDigits{ L"0123456789abcdef" };
-		if (CryptGetHashParam(hHash, HP_HASHVAL, reinterpret_cast<PBYTE>(LPVOID(rgbHash)), &cbHash, 0)) {
+		for(auto& digest : digests){
+			BYTE rgbHash[SHA512LEN]{};
+			DWORD cbHash{ sizeof(rgbHash) };
+			if (!CryptGetHashParam(digest.second, HP_HASHVAL, rgbHash, &cbHash, 0)) {
+				LOG_ERROR("CryptGetHashParam failed: " << GetLastError() << " while getting hash of " << FilePath);
+				return std::nullopt;
+			}
+
+			std::wstring buffer{};
 			for (DWORD i = 0; i < cbHash; i++) {
 				buffer += rgbDigits[(rgbHash[i] >> 4) & 0xf];
 				buffer += rgbDigits[rgbHash[i] & 0xf];
 			}
-			LOG_VERBOSE(3, "Successfully got hash of " << FilePath);
-			return buffer;
+			hashes.emplace(digest.first, std::move(buffer));
 		}
-		else {
-			LOG_ERROR("CryptGetHashParam failed: " << GetLastError() << " while getting hash of " << FilePath);
+
+		if(identity){
+			FileCache::GetInstance().Update(*identity, [&hashes](FileVerdicts& verdicts){
+				for(auto& hash : hashes){
+					verdicts.hashes[hash.first] = hash.second;
+				}
+			});
 		}
 
-		return std::nullopt;
+		LOG_VERBOSE(3, "Successfully got hashes of " << FilePath);
+		return hashes;
 	}
 
+	std::optional<std::wstring> File::GetHash(HashType type) const {
+		auto hashes{ GetHashes({ type }) };
+		if(!hashes){
+			return std::nullopt;
+		}
+		return hashes->at(type);
+	}
 
 	File::File(IN const std::wstring& path) : hFile{ nullptr }{
 		if(!path.length()){
@@ -297,6 +521,10 @@ namespace FileSystem{
 			}
 			Attribs.extension = PathFindExtensionW(FilePath.c_str());
 		}
+
+		if(hFile){
+			Accounting::RecordFileOpened();
+		}
 	}
 
 
@@ -412,6 +640,7 @@ namespace FileSystem{
 			LOG_ERROR("Failed to read from " << FilePath << " at offset " << offset << " with error " << GetLastError());
 			return false;
 		}
+		Accounting::RecordBytesRead(*amountRead);
 		LOG_VERBOSE(1, "Successfully wrote " << amount << " bytes to " << FilePath);
 		return true;
 	}
@@ -447,6 +676,26 @@ namespace FileSystem{
 			SetLastError(ERROR_ACCESS_DENIED);
 			return false;
 		}
+
+		auto identity{ GetFileIdentity() };
+		if(!identity){
+			return VerifyFileSignature();
+		}
+
+		auto cached{ FileCache::GetInstance().Find(*identity) };
+		if(cached && cached->bSigned){
+			LOG_VERBOSE(2, "Reusing the signature verdict for " << FilePath);
+			return *cached->bSigned;
+		}
+
+		auto bSigned{ VerifyFileSignature() };
+		FileCache::GetInstance().Update(*identity, [bSigned](FileVerdicts& verdicts){
+			verdicts.bSigned = bSigned;
+		});
+		return bSigned;
+	}
+
+	bool File::VerifyFileSignature() const {
 		WINTRUST_FILE_INFO FileData{};
 		FileData.cbStruct = sizeof(WINTRUST_FILE_INFO);
 		FileData.pcwszFilePath = FilePath.c_str();
@@ -565,17 +814,17 @@ namespace FileSystem{
 
 	std::optional<std::wstring> File::GetMD5Hash() const {
 		LOG_VERBOSE(3, "Attempting to get MD5 hash of " << FilePath);
-		return CalculateHashType(HashType::MD5_HASH);
+		return GetHash(HashType::MD5_HASH);
 	}
 
 	std::optional<std::wstring> File::GetSHA1Hash() const {
 		LOG_VERBOSE(3, "Attempting to get SHA1 hash of " << FilePath);
-		return CalculateHashType(HashType::SHA1_HASH);
+		return GetHash(HashType::SHA1_HASH);
 	}
 
 	std::optional<std::wstring> File::GetSHA256Hash() const {
 		LOG_VERBOSE(3, "Attempting to get SHA256 hash of " << FilePath);
-		return CalculateHashType(HashType::SHA256_HASH);
+		return GetHash(HashType::SHA256_HASH);
 	}
 
 	bool File::Create() {
@@ -801,6 +1050,43 @@ namespace FileSystem{
 		}
 	}
 
+	std::optional<FileIdentity> File::GetFileIdentity() const {
+		if (!bFileExists) {
+			LOG_ERROR("Can't get identity of " << FilePath << ", file doesn't exist");
+			SetLastError(ERROR_FILE_NOT_FOUND);
+			return std::nullopt;
+		}
+		BY_HANDLE_FILE_INFORMATION info{};
+		if (GetFileInformationByHandle(hFile, &info)) {
+			// Volumes without a change journal, such as FAT volumes, fail this request; their files are identified
+			// without a USN. ReFS volumes return version 3 records, whose 128-bit file IDs move the USN.
+			LONGLONG llUsn{ 0 };
+			alignas(USN_RECORD_V3) BYTE rgbRecord[sizeof(USN_RECORD_V3) + MAX_PATH * sizeof(WCHAR)]{};
+			DWORD dwReturned{};
+			if(DeviceIoControl(hFile, FSCTL_READ_FILE_USN_DATA, nullptr, 0, rgbRecord, sizeof(rgbRecord), &dwReturned, nullptr) &&
+			   dwReturned >= sizeof(USN_RECORD_COMMON_HEADER)){
+				auto wMajorVersion{ reinterpret_cast<PUSN_RECORD_COMMON_HEADER>(rgbRecord)->MajorVersion };
+				if(wMajorVersion == 2 && dwReturned >= sizeof(USN_RECORD_V2)){
+					llUsn = reinterpret_cast<PUSN_RECORD_V2>(rgbRecord)->Usn;
+				} else if(wMajorVersion == 3 && dwReturned >= sizeof(USN_RECORD_V3)){
+					llUsn = reinterpret_cast<PUSN_RECORD_V3>(rgbRecord)->Usn;
+				}
+			}
+
+			return FileIdentity{
+				info.dwVolumeSerialNumber,
+				(static_cast<DWORD64>(info.nFileIndexHigh) << 32) | info.nFileIndexLow,
+				(static_cast<DWORD64>(info.nFileSizeHigh) << 32) | info.nFileSizeLow,
+				info.ftLastWriteTime,
+				llUsn
+			};
+		}
+		else {
+			LOG_ERROR("Error getting identity of " << FilePath << ". (Error: " << GetLastError() << ")");
+			return std::nullopt;
+		}
+	}
+
 	Folder::Folder(const std::wstring& path) : hCurFile{ nullptr } {
 		FolderPath = ExpandEnvStringsW(path);
 		std::wstring searchName = FolderPath;
@@ -911,69 +1197,61 @@ namespace FileSystem{
 	}
 
 	std::vector<File> Folder::GetFiles(__in_opt std::optional<FileSearchAttribs> attribs, __in_opt int recurDepth) {
-		if(MoveToBeginning() == 0) {
+		if(!bFolderExists) {
 			LOG_ERROR("Couldn't get to beginning of folder " << FolderPath);
 			return std::vector<File>();
 		}
 		std::vector<File> toRet = std::vector<File>();
-		do {
-			if(GetCurIsFile()) {
-				std::optional<File> f = Open();
-				if(f) {
-					if(!attribs) {
-						toRet.emplace_back(*f);
-					}
-					else {
-						if (f->MatchesAttributes(attribs.value())) {
-							toRet.emplace_back(*f);
-						}
-					}
-				}
-			} else if(recurDepth != 0 && ffd.cFileName != std::wstring{ L"." } && ffd.cFileName != std::wstring{ L".." }){
-				std::vector<File> temp;
-				std::optional<Folder> f = EnterDir();
-				if(f) {
-					if(recurDepth == -1) {
-						temp = f->GetFiles(attribs, recurDepth);
-					} else {
-						temp = f->GetFiles(attribs, recurDepth - 1);
-					}
-					while(!temp.empty()) {
-						File file = temp.at(temp.size() - 1);
-						temp.pop_back();
-						toRet.emplace_back(file);
-					}
-				}
+		EnumerateFiles([&toRet](const std::wstring& path){
+			File file{ path };
+			if(file.GetFileExists()) {
+				toRet.emplace_back(file);
 			}
-		} while(MoveToNextFile());
+			return true;
+		}, attribs, recurDepth);
 		return toRet;
 	}
 
+	bool Folder::EnumerateFiles(__in const std::function<bool(const std::wstring&)>& callback,
+		__in_opt std::optional<FileSearchAttribs> attribs, __in_opt int recurDepth,
+		__in_opt const std::function<bool(const std::wstring&)>& folderFilter) const {
+
+		WalkOptions options{};
+		if(attribs) {
+			for(auto& extension : attribs->extensions) {
+				options.extensions.emplace(ToLowerCaseW(extension));
+			}
+		}
+		options.iMaxDepth = recurDepth;
+		options.folderFilter = folderFilter;
+
+		DirectoryWalker walker{ options };
+		return walker.Walk(FolderPath, [&callback](const DirectoryEntry& entry) {
+			return callback(entry.wsPath);
+		});
+	}
+
 	std::vector<Folder> Folder::GetSubdirectories(__in_opt int recurDepth) {
-		if(MoveToBeginning() == 0) {
+		if(!bFolderExists) {
 			LOG_ERROR("Couldn't get to beginning of folder " << FolderPath);
 			return {};
 		}
+		if(recurDepth == 0) {
+			return {};
+		}
+
+		// Subdirectories are reported at the depth of the folder holding them, so the walk stops one level short
+		WalkOptions options{};
+		options.bReportFiles = false;
+		options.bReportDirectories = true;
+		options.iMaxDepth = recurDepth == -1 ? -1 : recurDepth - 1;
+
 		std::vector<Folder> toRet = {};
-		do {
-			if(!GetCurIsFile() && recurDepth != 0 && ffd.cFileName != std::wstring{ L"." } && ffd.cFileName != std::wstring{ L".." }){
-				std::vector<Folder> temp;
-				std::optional<Folder> f = EnterDir();
-				if(f.has_value()) {
-					toRet.emplace_back(f.value());
-					if(recurDepth == -1) {
-						temp = f->GetSubdirectories(recurDepth);
-					} else {
-						temp = f->GetSubdirectories(recurDepth - 1);
-					}
-					while(!temp.empty()) {
-						auto folder = temp.at(temp.size() - 1);
-						temp.pop_back();
-						toRet.emplace_back(folder);
-					}
-				}
-			}
-		} while(MoveToNextFile());
+		DirectoryWalker walker{ options };
+		walker.Walk(FolderPath, [&toRet](const DirectoryEntry& entry) {
+			toRet.emplace_back(Folder{ entry.wsPath });
+			return true;
+		});
 		return toRet;
 	}
 
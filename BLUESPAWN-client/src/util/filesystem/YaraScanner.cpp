@@ -1,7 +1,10 @@
 #include "util/filesystem/YaraScanner.h"
+#include "util/filesystem/FileCache.h"
 #include "../resources/resource.h"
 #include "common/wrappers.hpp"
+#include "common/Utils.h"
 #include "util/log/Log.h"
+#include "util/accounting/ResourceUsage.h"
 
 #include <zip.h>
 
@@ -50,6 +53,20 @@ AllocationWrapper GetResourceRule(DWORD identifier){
 	return { nullptr, 0 };
 }
 
+DWORD64 HashResourceRule(DWORD identifier, DWORD64 dwSeed){
+	auto hRsrcInfo = FindResourceW(nullptr, MAKEINTRESOURCE(identifier), L"yararule");
+	if(!hRsrcInfo){
+		return dwSeed;
+	}
+
+	auto hRsrc = LoadResource(nullptr, hRsrcInfo);
+	if(!hRsrc){
+		return dwSeed;
+	}
+
+	return HashData(LockResource(hRsrc), SizeofResource(nullptr, hRsrcInfo), dwSeed);
+}
+
 struct AllocationWrapperStream {
 	AllocationWrapper wrapper;
 	size_t offset;
@@ -80,7 +97,8 @@ YR_RULES* LoadRules(const AllocationWrapper& memory){
 }
 
 YaraScanner::YaraScanner() :
-	status{ YaraStatus::Success }{
+	status{ YaraStatus::Success },
+	dwRulesFingerprint{ HashResourceRule(YaraIndicators, HashResourceRule(YaraSevere2, HashResourceRule(YaraSevere, 0))) }{
 	yr_initialize();
 
 	auto hSevereYara = GetResourceRule(YaraSevere);
@@ -139,6 +157,10 @@ const YaraScanner& YaraScanner::GetInstance(){
 	return instance;
 }
 
+DWORD64 YaraScanner::GetRulesFingerprint() const {
+	return dwRulesFingerprint;
+}
+
 struct YaraScanArg {
 	YaraScanResult result;
 	enum {
@@ -168,12 +190,25 @@ YaraScanResult YaraScanner::ScanFile(const FileSystem::File& file) const {
 
 	YaraScanArg arg = {};
 	arg.result.status = YaraStatus::Success;
+
+	// A file which matched no rules isn't read again until either it or the rules change
+	auto identity{ file.GetFileIdentity() };
+	if(identity){
+		auto cached{ FileSystem::FileCache::GetInstance().Find(*identity) };
+		if(cached && cached->qwYaraCleanRules == dwRulesFingerprint){
+			LOG_VERBOSE(2, L"Reusing the YARA verdict for " << file.GetFilePath());
+			return arg.result;
+		}
+	}
+
 	auto memory = file.Read();
 	if(!memory){
 		arg.result.status = YaraStatus::Failure;
 		return arg.result;
 	}
 
+	Accounting::RecordYaraScan();
+
 	arg.type = arg.Severe;
 	auto status = yr_rules_scan_mem(KnownBad, reinterpret_cast<const uint8_t*>((LPVOID) memory), memory.GetSize(), 0, YR_CALLBACK_FUNC(YaraCallbackFunction), &arg, 0);
 	if(status != ERROR_SUCCESS){
@@ -199,6 +234,13 @@ YaraScanResult YaraScanner::ScanFile(const FileSystem::File& file) const {
 		LOG_INFO(file.GetFilePath() << L" matches known indicator identifier " << StringToWidestring(identifier));
 	}
 
+	// Files which match a rule are scanned again each time so that the rules they match are reported
+	if(identity && arg.result.status == YaraStatus::Success && arg.result.vKnownBadRules.empty() && arg.result.vIndicatorRules.empty()){
+		FileSystem::FileCache::GetInstance().Update(*identity, [this](FileSystem::FileVerdicts& verdicts){
+			verdicts.qwYaraCleanRules = dwRulesFingerprint;
+		});
+	}
+
 	return arg.result;
 }
 
@@ -1,6 +1,7 @@
 #include "util/log/HuntLogMessage.h"
 
 #include "util/log/LogLevel.h"
+#include "common/StringUtils.h"
 
 namespace Log {
 
@@ -25,7 +26,7 @@ namespace Log {
 
 		InternalStream.str(std::string{});
 		for(int idx = 0; idx < Sinks.size(); idx++){
-			Sinks[idx]->LogMessage(Level, message, HuntName, Detections);
+			LogCapture::Dispatch(Sinks[idx], Level, message, HuntName, Detections);
 		}
 
 		Detections = {};
@@ -33,6 +34,19 @@ namespace Log {
 		return *this;
 	}
 
+	void LogHuntResourceUsage(const HuntInfo& info){
+		std::wstring aggressiveness = info.HuntAggressiveness == Aggressiveness::Intensive ? L"Intensive" :
+			info.HuntAggressiveness == Aggressiveness::Normal ? L"Normal" : L"Cursory";
+		std::string message{ WidestringToString(L"[" + info.HuntName + L": " + aggressiveness + L"] resource usage: ") };
+		if(info.HuntUsage){
+			message += info.HuntUsage->ToString();
+		}
+
+		for(auto& sink : _LogHuntSinks){
+			LogCapture::Dispatch(sink, LogLevel::LogUsage, message, info);
+		}
+	}
+
 	bool AddHuntSink(const std::shared_ptr<LogSink>& sink){
 		for(int idx = 0; idx < _LogHuntSinks.size(); idx++){
 			if(*_LogHuntSinks[idx] == *sink){
@@ -21,7 +21,7 @@ namespace Log {
 
 		InternalStream = std::stringstream();
 		for(int idx = 0; idx < Sinks.size(); idx++){
-			Sinks[idx]->LogMessage(Level, message);
+			LogCapture::Dispatch(Sinks[idx], Level, message);
 		}
 		return *this;
 	}
@@ -36,6 +36,46 @@ namespace Log {
 		InternalStream << StreamContents;
 	}
 
+	namespace {
+		thread_local LogCapture* lpActiveCapture{ nullptr };
+	}
+
+	void LogCapture::Record(const std::shared_ptr<LogSink>& sink, const LogLevel& level, const std::string& message,
+		                    const std::optional<HuntInfo>& info, const std::vector<std::shared_ptr<DETECTION>>& detections){
+		vMessages.emplace_back(CapturedMessage{ sink, level, message, info, detections });
+	}
+
+	void LogCapture::Replay(){
+		auto messages{ std::move(vMessages) };
+		vMessages = {};
+
+		for(auto& entry : messages){
+			Dispatch(entry.sink, entry.level, entry.message, entry.info, entry.detections);
+		}
+	}
+
+	void LogCapture::Dispatch(const std::shared_ptr<LogSink>& sink, const LogLevel& level, const std::string& message,
+		                      const std::optional<HuntInfo>& info, const std::vector<std::shared_ptr<DETECTION>>& detections){
+		auto capture{ GetCurrent() };
+		if(capture){
+			capture->Record(sink, level, message, info, detections);
+		} else {
+			sink->LogMessage(level, message, info, detections);
+		}
+	}
+
+	LogCapture* LogCapture::GetCurrent(){
+		return lpActiveCapture;
+	}
+
+	BeginLogCapture::BeginLogCapture(LogCapture& capture) : lpPrevious{ lpActiveCapture }{
+		lpActiveCapture = &capture;
+	}
+
+	BeginLogCapture::~BeginLogCapture(){
+		lpActiveCapture = lpPrevious;
+	}
+
 	bool AddSink(const std::shared_ptr<LogSink>& Sink){
 		for(int idx = 0; idx < _LogCurrentSinks.size(); idx++){
 			if(*_LogCurrentSinks[idx] == *Sink){
@@ -19,6 +19,8 @@ namespace Log {
 
 	LogLevel LogLevel::LogVerbose3{ Severity::LogInfo, false };
 
+	LogLevel LogLevel::LogUsage{ Severity::LogOther, true };
+
 	void LogLevel::Enable(){ enabled = true; }
 	void LogLevel::Disable(){ enabled = false; }
 	bool LogLevel::Toggle(){ return enabled = !enabled; }
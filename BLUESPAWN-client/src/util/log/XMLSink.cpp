@@ -171,6 +171,21 @@ namespace Log{
 			}
 
 			Root->InsertEndChild(hunt);
+		} else if(level.Enabled() && info && info->HuntUsage){
+			auto usage = XMLDoc.NewElement("usage");
+			usage->SetAttribute("hunt", WidestringToString(info->HuntName).c_str());
+			usage->SetAttribute("agressiveness", info->HuntAggressiveness == Aggressiveness::Intensive ? "Intensive" :
+				info->HuntAggressiveness == Aggressiveness::Normal ? "Normal" : "Cursory");
+			usage->SetAttribute("time", SystemTimeToInteger(info->HuntStartTime));
+			usage->SetAttribute("walltime", static_cast<int64_t>(info->HuntUsage->WallTimeMs));
+			usage->SetAttribute("cputime", static_cast<int64_t>(info->HuntUsage->CpuTimeMs));
+			usage->SetAttribute("bytesread", static_cast<int64_t>(info->HuntUsage->BytesRead));
+			usage->SetAttribute("filesopened", static_cast<int64_t>(info->HuntUsage->FilesOpened));
+			usage->SetAttribute("keysopened", static_cast<int64_t>(info->HuntUsage->RegistryKeysOpened));
+			usage->SetAttribute("eventsrendered", static_cast<int64_t>(info->HuntUsage->EventRecordsRendered));
+			usage->SetAttribute("yarascans", static_cast<int64_t>(info->HuntUsage->YaraScans));
+			usage->SetAttribute("peakworkingsetdelta", static_cast<int64_t>(info->HuntUsage->PeakWorkingSetDelta));
+			Root->InsertEndChild(usage);
 		} else if(level.Enabled()) {
 			auto msg = XMLDoc.NewElement(MessageTags[static_cast<DWORD>(level.severity)].c_str());
 			SYSTEMTIME st;
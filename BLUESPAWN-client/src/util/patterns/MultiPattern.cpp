@@ -0,0 +1,265 @@
+#include "util/patterns/MultiPattern.h"
+
+#include <algorithm>
+#include <numeric>
+
+#include "util/patterns/Pattern.h"
+#include "util/log/Log.h"
+#include "util/accounting/ResourceUsage.h"
+#include "common/wrappers.hpp"
+
+namespace Patterns {
+
+	namespace {
+
+		/// Marks a state out of which no edge has been added yet while the trie is built
+		const DWORD NO_EDGE{ 0xFFFFFFFF };
+
+		/// The largest file of strings that will be read
+		const LONGLONG MAX_FILE_SIZE{ 1ll << 30 };
+	}
+
+	MultiPattern::MultiPattern(const std::vector<std::wstring>& vPatterns) :
+		vPatterns{ vPatterns },
+		vClasses(0x10000),
+		dwClassCount{ 1 }{
+
+		auto& lower{ GetLowerCase() };
+
+		// Characters appearing in the strings are numbered in ascending order, so that sorting the folded strings
+		// also sorts the edges out of each state of the trie by class
+		std::vector<std::wstring> vFolded(vPatterns.size());
+		std::vector<bool> vUsed(0x10000);
+		for(SIZE_T idx = 0; idx < vPatterns.size(); idx++){
+			vFolded[idx].resize(vPatterns[idx].length());
+			for(SIZE_T ch = 0; ch < vPatterns[idx].length(); ch++){
+				vFolded[idx][ch] = lower[vPatterns[idx][ch]];
+				vUsed[vFolded[idx][ch]] = true;
+			}
+		}
+
+		std::vector<WORD> vFoldedClasses(0x10000);
+		for(DWORD ch = 0; ch < 0x10000; ch++){
+			if(vUsed[ch]){
+				vFoldedClasses[ch] = static_cast<WORD>(dwClassCount++);
+			}
+		}
+		for(DWORD ch = 0; ch < 0x10000; ch++){
+			vClasses[ch] = vFoldedClasses[lower[ch]];
+		}
+
+		std::vector<DWORD> vOrder(vPatterns.size());
+		std::iota(vOrder.begin(), vOrder.end(), 0);
+		std::sort(vOrder.begin(), vOrder.end(), [&vFolded](DWORD first, DWORD second){
+			return vFolded[first] < vFolded[second];
+		});
+
+		// Since the strings are inserted in sorted order, the edge for a class out of a state, if there is one,
+		// is always the last edge added to that state
+		struct Edge {
+			DWORD dwFrom;
+			WORD wClass;
+			DWORD dwTo;
+		};
+		std::vector<Edge> vTrie{};
+		std::vector<DWORD> vLastEdge{ NO_EDGE };
+		std::vector<std::pair<DWORD, DWORD>> vEnds{};
+		for(auto idx : vOrder){
+			if(vFolded[idx].empty()){
+				continue;
+			}
+
+			DWORD dwState{ 0 };
+			for(auto ch : vFolded[idx]){
+				auto wClass{ vFoldedClasses[ch] };
+				auto dwLast{ vLastEdge[dwState] };
+				if(dwLast != NO_EDGE && vTrie[dwLast].wClass == wClass){
+					dwState = vTrie[dwLast].dwTo;
+				} else {
+					auto dwNext{ static_cast<DWORD>(vLastEdge.size()) };
+					vLastEdge[dwState] = static_cast<DWORD>(vTrie.size());
+					vTrie.emplace_back(Edge{ dwState, wClass, dwNext });
+					vLastEdge.emplace_back(NO_EDGE);
+					dwState = dwNext;
+				}
+			}
+			vEnds.emplace_back(dwState, idx);
+		}
+
+		auto dwStates{ static_cast<DWORD>(vLastEdge.size()) };
+
+		// Group the edges and the strings ending at each state by state, keeping edges in the order they were added
+		vEdgeStarts.assign(static_cast<SIZE_T>(dwStates) + 1, 0);
+		for(auto& edge : vTrie){
+			vEdgeStarts[edge.dwFrom + 1]++;
+		}
+		std::partial_sum(vEdgeStarts.begin(), vEdgeStarts.end(), vEdgeStarts.begin());
+
+		vEdges.resize(vTrie.size());
+		auto vPositions{ vEdgeStarts };
+		for(auto& edge : vTrie){
+			vEdges[vPositions[edge.dwFrom]++] = { edge.wClass, edge.dwTo };
+		}
+
+		vOutputStarts.assign(static_cast<SIZE_T>(dwStates) + 1, 0);
+		for(auto& end : vEnds){
+			vOutputStarts[end.first + 1]++;
+		}
+		std::partial_sum(vOutputStarts.begin(), vOutputStarts.end(), vOutputStarts.begin());
+
+		vOutputs.resize(vEnds.size());
+		vPositions = vOutputStarts;
+		for(auto& end : vEnds){
+			vOutputs[vPositions[end.first]++] = end.second;
+		}
+
+		vRootTransitions.assign(dwClassCount, 0);
+		for(auto edge = vEdgeStarts[0]; edge < vEdgeStarts[1]; edge++){
+			vRootTransitions[vEdges[edge].first] = vEdges[edge].second;
+		}
+
+		// Failure links are found breadth-first, since each state's link is to a shallower state
+		vFailures.assign(dwStates, 0);
+		vOutputLinks.assign(dwStates, 0);
+		std::vector<DWORD> vQueue{};
+		vQueue.reserve(dwStates);
+		for(auto edge = vEdgeStarts[0]; edge < vEdgeStarts[1]; edge++){
+			vQueue.emplace_back(vEdges[edge].second);
+		}
+		for(SIZE_T head = 0; head < vQueue.size(); head++){
+			auto dwState{ vQueue[head] };
+			for(auto edge = vEdgeStarts[dwState]; edge < vEdgeStarts[dwState + 1]; edge++){
+				auto dwNext{ vEdges[edge].second };
+				auto dwFailure{ Advance(vFailures[dwState], vEdges[edge].first) };
+				vFailures[dwNext] = dwFailure;
+				vOutputLinks[dwNext] = vOutputStarts[dwFailure] != vOutputStarts[dwFailure + 1] ? dwFailure : vOutputLinks[dwFailure];
+				vQueue.emplace_back(dwNext);
+			}
+		}
+	}
+
+	std::shared_ptr<MultiPattern> MultiPattern::LoadFromFile(const std::wstring& wsPath){
+		auto start{ GetTickCount64() };
+
+		HandleWrapper hFile{ CreateFileW(wsPath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, 0, nullptr) };
+		if(!hFile){
+			LOG_ERROR(L"Unable to open " << wsPath << L" (Error " << GetLastError() << L")");
+			return nullptr;
+		}
+		Accounting::RecordFileOpened();
+
+		LARGE_INTEGER size{};
+		if(!GetFileSizeEx(hFile, &size) || size.QuadPart > MAX_FILE_SIZE){
+			LOG_ERROR(L"Unable to read " << wsPath << L": the file is too large or its size couldn't be determined");
+			return nullptr;
+		}
+
+		std::vector<BYTE> vData(static_cast<SIZE_T>(size.QuadPart));
+		DWORD dwBytesRead{};
+		if(vData.size() && (!ReadFile(hFile, vData.data(), static_cast<DWORD>(vData.size()), &dwBytesRead, nullptr) ||
+							dwBytesRead != vData.size())){
+			LOG_ERROR(L"Unable to read " << wsPath << L" (Error " << GetLastError() << L")");
+			return nullptr;
+		}
+
+		std::wstring text{};
+		if(vData.size() >= 2 && vData[0] == 0xFF && vData[1] == 0xFE){
+			text.assign(reinterpret_cast<LPCWSTR>(vData.data() + 2), (vData.size() - 2) / sizeof(WCHAR));
+		} else {
+			SIZE_T dwOffset{ vData.size() >= 3 && vData[0] == 0xEF && vData[1] == 0xBB && vData[2] == 0xBF ? 3u : 0u };
+			auto lpData{ reinterpret_cast<LPCSTR>(vData.data() + dwOffset) };
+			auto dwSize{ static_cast<int>(vData.size() - dwOffset) };
+			if(dwSize){
+				text.resize(MultiByteToWideChar(CP_UTF8, 0, lpData, dwSize, nullptr, 0));
+				MultiByteToWideChar(CP_UTF8, 0, lpData, dwSize, &text[0], static_cast<int>(text.length()));
+			}
+		}
+
+		std::vector<std::wstring> vLines{};
+		SIZE_T dwStart{ 0 };
+		while(dwStart < text.length()){
+			auto dwEnd{ text.find(L'\n', dwStart) };
+			if(dwEnd == std::wstring::npos){
+				dwEnd = text.length();
+			}
+
+			auto dwFirst{ text.find_first_not_of(L" \t\r", dwStart) };
+			if(dwFirst < dwEnd && text[dwFirst] != L'#'){
+				auto dwLast{ text.find_last_not_of(L" \t\r", dwEnd - 1) };
+				vLines.emplace_back(text.substr(dwFirst, dwLast - dwFirst + 1));
+			}
+			dwStart = dwEnd + 1;
+		}
+
+		auto patterns{ std::make_shared<MultiPattern>(vLines) };
+		LOG_INFO(L"Compiled " << vLines.size() << L" strings from " << wsPath << L" into " << patterns->GetStateCount() <<
+			L" states in " << GetTickCount64() - start << L" ms");
+		return patterns;
+	}
+
+	DWORD MultiPattern::FindEdge(DWORD dwState, WORD wClass) const {
+		auto begin{ vEdges.begin() + vEdgeStarts[dwState] };
+		auto end{ vEdges.begin() + vEdgeStarts[dwState + 1] };
+		auto edge{ std::lower_bound(begin, end, wClass, [](const std::pair<WORD, DWORD>& edge, WORD wClass){
+			return edge.first < wClass;
+		}) };
+		return edge != end && edge->first == wClass ? edge->second : 0;
+	}
+
+	DWORD MultiPattern::Advance(DWORD dwState, WORD wClass) const {
+		while(dwState){
+			auto dwNext{ FindEdge(dwState, wClass) };
+			if(dwNext){
+				return dwNext;
+			}
+			dwState = vFailures[dwState];
+		}
+		return vRootTransitions[wClass];
+	}
+
+	void MultiPattern::Search(LPCWSTR text, SIZE_T dwLength, std::vector<DWORD>& vMatches) const {
+		DWORD dwState{ 0 };
+		for(SIZE_T idx = 0; idx < dwLength; idx++){
+			auto wClass{ vClasses[text[idx]] };
+			if(!wClass){
+				dwState = 0;
+				continue;
+			}
+
+			dwState = Advance(dwState, wClass);
+			auto dwMatch{ vOutputStarts[dwState] != vOutputStarts[dwState + 1] ? dwState : vOutputLinks[dwState] };
+			for(; dwMatch; dwMatch = vOutputLinks[dwMatch]){
+				vMatches.insert(vMatches.end(), vOutputs.begin() + vOutputStarts[dwMatch], vOutputs.begin() + vOutputStarts[dwMatch + 1]);
+			}
+		}
+	}
+
+	bool MultiPattern::Contains(LPCWSTR text, SIZE_T dwLength) const {
+		DWORD dwState{ 0 };
+		for(SIZE_T idx = 0; idx < dwLength; idx++){
+			auto wClass{ vClasses[text[idx]] };
+			if(!wClass){
+				dwState = 0;
+				continue;
+			}
+
+			dwState = Advance(dwState, wClass);
+			if(vOutputStarts[dwState] != vOutputStarts[dwState + 1] || vOutputLinks[dwState]){
+				return true;
+			}
+		}
+		return false;
+	}
+
+	DWORD MultiPattern::GetPatternCount() const {
+		return static_cast<DWORD>(vPatterns.size());
+	}
+
+	const std::wstring& MultiPattern::GetPattern(DWORD dwPattern) const {
+		return vPatterns[dwPattern];
+	}
+
+	DWORD MultiPattern::GetStateCount() const {
+		return static_cast<DWORD>(vFailures.size());
+	}
+}
@@ -0,0 +1,758 @@
+#include "util/patterns/Pattern.h"
+
+#include <map>
+#include <cwctype>
+#include <algorithm>
+
+#include "util/log/Log.h"
+
+namespace Patterns {
+
+	const std::vector<WCHAR>& GetLowerCase(){
+		static const std::vector<WCHAR> table{ [](){
+			std::vector<WCHAR> table(0x10000);
+			for(DWORD ch = 0; ch < 0x10000; ch++){
+				table[ch] = static_cast<WCHAR>(ch);
+			}
+
+			// Surrogates are left alone, since they only have a case as part of a pair
+			CharLowerBuffW(table.data(), 0xD800);
+			CharLowerBuffW(table.data() + 0xE000, 0x2000);
+			return table;
+		}() };
+		return table;
+	}
+
+	namespace {
+
+		/// The most times a bounded repetition, such as a{2,5}, may repeat what it applies to
+		const DWORD MAX_REPEAT{ 1000 };
+
+		/// Marks a repetition with no upper bound
+		const DWORD UNBOUNDED{ 0xFFFFFFFF };
+
+		/// The most NFA states and DFA states a pattern may compile into before falling back to std::wregex
+		const size_t MAX_NFA_STATES{ 10000 };
+		const size_t MAX_DFA_STATES{ 4096 };
+
+		/// The most transitions a DFA may have, since each state has one for every class of characters
+		const size_t MAX_TRANSITIONS{ 1 << 22 };
+
+		/// A set of characters, as inclusive ranges
+		typedef std::vector<std::pair<DWORD, DWORD>> CharSet;
+
+		/// Sorts the ranges of a set and merges those that overlap or touch
+		void Normalize(CharSet& set){
+			std::sort(set.begin(), set.end());
+			CharSet merged{};
+			for(auto& range : set){
+				if(merged.size() && range.first <= merged.back().second + 1){
+					merged.back().second = (std::max)(merged.back().second, range.second);
+				} else {
+					merged.emplace_back(range);
+				}
+			}
+			set = std::move(merged);
+		}
+
+		/// Retrieves every UTF-16 code unit not in a normalized set
+		CharSet Negate(const CharSet& set){
+			CharSet negated{};
+			DWORD dwNext{ 0 };
+			for(auto& range : set){
+				if(range.first > dwNext){
+					negated.emplace_back(dwNext, range.first - 1);
+				}
+				dwNext = range.second + 1;
+			}
+			if(dwNext <= 0xFFFF){
+				negated.emplace_back(dwNext, 0xFFFF);
+			}
+			return negated;
+		}
+
+		/// Checks whether a normalized set contains a character
+		bool Contains(const CharSet& set, DWORD ch){
+			auto range{ std::upper_bound(set.begin(), set.end(), std::make_pair(ch, DWORD{ 0xFFFFFFFF })) };
+			return range != set.begin() && (range - 1)->second >= ch;
+		}
+
+		/// Adds every character whose lowercase form is that of a character in a normalized set
+		CharSet FoldCase(const CharSet& set){
+			auto& lower{ GetLowerCase() };
+
+			std::vector<bool> folded(0x10000);
+			for(auto& range : set){
+				for(DWORD ch = range.first; ch <= range.second; ch++){
+					folded[lower[ch]] = true;
+				}
+			}
+
+			CharSet result{};
+			for(DWORD ch = 0; ch < 0x10000; ch++){
+				if(folded[lower[ch]]){
+					if(result.size() && result.back().second + 1 == ch){
+						result.back().second = ch;
+					} else {
+						result.emplace_back(ch, ch);
+					}
+				}
+			}
+			return result;
+		}
+
+		/// A node of a parsed pattern
+		struct Node {
+			enum class Kind { Empty, Set, Concatenation, Alternation, Repetition } kind;
+
+			/// The index of the set of characters matched by a Set node
+			size_t dwSet;
+
+			/// The bounds of a Repetition node
+			DWORD dwMin;
+			DWORD dwMax;
+
+			/// The nodes joined by a Concatenation or Alternation node, or the node repeated by a Repetition node
+			std::vector<Node> children;
+
+			Node(Kind kind) : kind{ kind }, dwSet{ 0 }, dwMin{ 0 }, dwMax{ 0 }{}
+		};
+
+		/**
+		 * Parses patterns written in the subset of ECMAScript syntax a DFA can match. Anything outside of that
+		 * subset, including anything std::wregex would reject, fails to parse, so that std::wregex is left to
+		 * interpret or reject it.
+		 */
+		class Parser {
+		private:
+			const std::wstring& wsPattern;
+			size_t dwPosition;
+			bool bCaseInsensitive;
+			std::vector<CharSet>& vSets;
+
+			bool AtEnd() const {
+				return dwPosition >= wsPattern.size();
+			}
+
+			WCHAR Peek() const {
+				return wsPattern[dwPosition];
+			}
+
+			/// Records a set of characters and creates a node matching it
+			Node MakeSet(CharSet set, bool bNegated){
+				Normalize(set);
+				if(bCaseInsensitive){
+					set = FoldCase(set);
+				}
+				if(bNegated){
+					set = Negate(set);
+				}
+				vSets.emplace_back(std::move(set));
+
+				Node node{ Node::Kind::Set };
+				node.dwSet = vSets.size() - 1;
+				return node;
+			}
+
+			std::optional<DWORD> ParseNumber(){
+				DWORD dwValue{ 0 };
+				auto dwStart{ dwPosition };
+				while(!AtEnd() && Peek() >= L'0' && Peek() <= L'9'){
+					dwValue = dwValue * 10 + (Peek() - L'0');
+					if(dwValue > MAX_REPEAT){
+						return std::nullopt;
+					}
+					dwPosition++;
+				}
+				if(dwStart == dwPosition){
+					return std::nullopt;
+				}
+				return dwValue;
+			}
+
+			std::optional<WCHAR> ParseHex(DWORD dwDigits){
+				WCHAR value{ 0 };
+				for(DWORD i = 0; i < dwDigits; i++){
+					if(AtEnd() || !iswxdigit(Peek())){
+						return std::nullopt;
+					}
+					auto ch{ Peek() };
+					value = static_cast<WCHAR>(value * 16 + (ch <= L'9' ? ch - L'0' : (ch | 0x20) - L'a' + 10));
+					dwPosition++;
+				}
+				return value;
+			}
+
+			/**
+			 * Parses an escape, after its backslash
+			 *
+			 * @return The set of characters the escape matches and whether that set is negated
+			 */
+			std::optional<std::pair<CharSet, bool>> ParseEscape(){
+				if(AtEnd()){
+					return std::nullopt;
+				}
+
+				CharSet digits{ { L'0', L'9' } };
+				CharSet word{ { L'0', L'9' }, { L'A', L'Z' }, { L'_', L'_' }, { L'a', L'z' } };
+				CharSet space{ { 0x09, 0x0D }, { 0x20, 0x20 }, { 0xA0, 0xA0 }, { 0x1680, 0x1680 }, { 0x2000, 0x200A },
+					{ 0x2028, 0x2029 }, { 0x202F, 0x202F }, { 0x205F, 0x205F }, { 0x3000, 0x3000 }, { 0xFEFF, 0xFEFF } };
+
+				auto ch{ wsPattern[dwPosition++] };
+				switch(ch){
+				case L'd': return std::make_pair(digits, false);
+				case L'D': return std::make_pair(digits, true);
+				case L'w': return std::make_pair(word, false);
+				case L'W': return std::make_pair(word, true);
+				case L's': return std::make_pair(space, false);
+				case L'S': return std::make_pair(space, true);
+				case L't': return std::make_pair(CharSet{ { 0x09, 0x09 } }, false);
+				case L'n': return std::make_pair(CharSet{ { 0x0A, 0x0A } }, false);
+				case L'v': return std::make_pair(CharSet{ { 0x0B, 0x0B } }, false);
+				case L'f': return std::make_pair(CharSet{ { 0x0C, 0x0C } }, false);
+				case L'r': return std::make_pair(CharSet{ { 0x0D, 0x0D } }, false);
+				case L'0':
+					if(!AtEnd() && Peek() >= L'0' && Peek() <= L'9'){
+						return std::nullopt;
+					}
+					return std::make_pair(CharSet{ { 0, 0 } }, false);
+				case L'x':
+				case L'u': {
+					auto value{ ParseHex(ch == L'x' ? 2 : 4) };
+					if(!value){
+						return std::nullopt;
+					}
+					return std::make_pair(CharSet{ { *value, *value } }, false);
+				}
+				default:
+					// Backreferences, word boundaries, and control escapes are all letters or digits
+					if(ch < 0x80 && iswpunct(ch) && ch != L'_'){
+						return std::make_pair(CharSet{ { ch, ch } }, false);
+					}
+					return std::nullopt;
+				}
+			}
+
+			/// Parses a bracketed class of characters, after its opening bracket
+			std::optional<Node> ParseClass(){
+				bool bNegated{ false };
+				if(!AtEnd() && Peek() == L'^'){
+					bNegated = true;
+					dwPosition++;
+				}
+
+				CharSet set{};
+				bool bFirst{ true };
+				while(true){
+					if(AtEnd()){
+						return std::nullopt;
+					}
+
+					if(Peek() == L']'){
+						if(bFirst){
+							return std::nullopt;
+						}
+						dwPosition++;
+						break;
+					}
+					bFirst = false;
+
+					auto low{ ParseClassAtom() };
+					if(!low){
+						return std::nullopt;
+					}
+
+					if(!AtEnd() && Peek() == L'-' && dwPosition + 1 < wsPattern.size() && wsPattern[dwPosition + 1] != L']'){
+						dwPosition++;
+						auto high{ ParseClassAtom() };
+						if(!high || low->second || high->second || low->first.size() != 1 || high->first.size() != 1 ||
+						   low->first[0].first != low->first[0].second || high->first[0].first != high->first[0].second ||
+						   low->first[0].first > high->first[0].first){
+							return std::nullopt;
+						}
+						set.emplace_back(low->first[0].first, high->first[0].first);
+					} else if(low->second){
+						// A negated escape folded with the rest of the class would match the case variants of what it excludes
+						if(bCaseInsensitive){
+							return std::nullopt;
+						}
+						for(auto& range : Negate(low->first)){
+							set.emplace_back(range);
+						}
+					} else {
+						set.insert(set.end(), low->first.begin(), low->first.end());
+					}
+				}
+
+				return MakeSet(set, bNegated);
+			}
+
+			std::optional<std::pair<CharSet, bool>> ParseClassAtom(){
+				auto ch{ wsPattern[dwPosition++] };
+				if(ch == L'\\'){
+					return ParseEscape();
+				} else if(ch == L'['){
+					// Character class names, such as [[:alpha:]], are left to std::wregex
+					return std::nullopt;
+				}
+				return std::make_pair(CharSet{ { ch, ch } }, false);
+			}
+
+			std::optional<Node> ParseAtom(){
+				auto ch{ wsPattern[dwPosition++] };
+				switch(ch){
+				case L'(': {
+					if(!AtEnd() && Peek() == L'?'){
+						if(dwPosition + 1 >= wsPattern.size() || wsPattern[dwPosition + 1] != L':'){
+							return std::nullopt;
+						}
+						dwPosition += 2;
+					}
+
+					auto inner{ ParseAlternation() };
+					if(!inner || AtEnd() || Peek() != L')'){
+						return std::nullopt;
+					}
+					dwPosition++;
+					return inner;
+				}
+				case L'[':
+					return ParseClass();
+				case L'.':
+					return MakeSet({ { 0x0A, 0x0A }, { 0x0D, 0x0D }, { 0x2028, 0x2029 } }, true);
+				case L'\\': {
+					auto escape{ ParseEscape() };
+					if(!escape){
+						return std::nullopt;
+					}
+					return MakeSet(escape->first, escape->second);
+				}
+				case L'^': case L'$': case L'*': case L'+': case L'?': case L'{': case L'}': case L']':
+					return std::nullopt;
+				default:
+					return MakeSet({ { ch, ch } }, false);
+				}
+			}
+
+			std::optional<Node> ParseRepetition(){
+				auto atom{ ParseAtom() };
+				if(!atom || AtEnd()){
+					return atom;
+				}
+
+				DWORD dwMin{ 0 };
+				DWORD dwMax{ UNBOUNDED };
+				auto ch{ Peek() };
+				if(ch == L'*'){
+					dwPosition++;
+				} else if(ch == L'+'){
+					dwMin = 1;
+					dwPosition++;
+				} else if(ch == L'?'){
+					dwMax = 1;
+					dwPosition++;
+				} else if(ch == L'{'){
+					dwPosition++;
+					auto min{ ParseNumber() };
+					if(!min || AtEnd()){
+						return std::nullopt;
+					}
+					dwMin = dwMax = *min;
+					if(Peek() == L','){
+						dwPosition++;
+						dwMax = UNBOUNDED;
+						if(!AtEnd() && Peek() != L'}'){
+							auto max{ ParseNumber() };
+							if(!max || *max < dwMin){
+								return std::nullopt;
+							}
+							dwMax = *max;
+						}
+					}
+					if(AtEnd() || Peek() != L'}'){
+						return std::nullopt;
+					}
+					dwPosition++;
+				} else {
+					return atom;
+				}
+
+				// Laziness changes which match is found, but not whether the whole string matches
+				if(!AtEnd() && Peek() == L'?'){
+					dwPosition++;
+				}
+
+				// A quantifier applied to another quantifier is left for std::wregex to reject
+				if(!AtEnd() && (Peek() == L'*' || Peek() == L'+' || Peek() == L'?' || Peek() == L'{')){
+					return std::nullopt;
+				}
+
+				Node node{ Node::Kind::Repetition };
+				node.dwMin = dwMin;
+				node.dwMax = dwMax;
+				node.children.emplace_back(std::move(*atom));
+				return node;
+			}
+
+			std::optional<Node> ParseConcatenation(){
+				std::vector<Node> items{};
+				while(!AtEnd() && Peek() != L'|' && Peek() != L')'){
+					auto item{ ParseRepetition() };
+					if(!item){
+						return std::nullopt;
+					}
+					items.emplace_back(std::move(*item));
+				}
+
+				if(items.size() == 0){
+					return Node{ Node::Kind::Empty };
+				} else if(items.size() == 1){
+					return std::move(items[0]);
+				}
+
+				Node node{ Node::Kind::Concatenation };
+				node.children = std::move(items);
+				return node;
+			}
+
+			std::optional<Node> ParseAlternation(){
+				std::vector<Node> branches{};
+				while(true){
+					auto branch{ ParseConcatenation() };
+					if(!branch){
+						return std::nullopt;
+					}
+					branches.emplace_back(std::move(*branch));
+
+					if(AtEnd() || Peek() != L'|'){
+						break;
+					}
+					dwPosition++;
+				}
+
+				if(branches.size() == 1){
+					return std::move(branches[0]);
+				}
+
+				Node node{ Node::Kind::Alternation };
+				node.children = std::move(branches);
+				return node;
+			}
+
+		public:
+			Parser(const std::wstring& wsPattern, bool bCaseInsensitive, std::vector<CharSet>& vSets) :
+				wsPattern{ wsPattern },
+				dwPosition{ 0 },
+				bCaseInsensitive{ bCaseInsensitive },
+				vSets{ vSets }{}
+
+			/**
+			 * Parses the pattern
+			 *
+			 * @return The root node of the pattern, or std::nullopt if it can't be matched by a DFA
+			 */
+			std::optional<Node> Parse(){
+				auto root{ ParseAlternation() };
+				if(!root || !AtEnd()){
+					return std::nullopt;
+				}
+				return root;
+			}
+		};
+
+		/// A state of a Thompson NFA
+		struct NfaState {
+			/// The set of characters consumed to move to out, or SPLIT or ACCEPT
+			int set;
+
+			/// The states this one moves to
+			int out;
+			int out1;
+		};
+
+		/// Marks a state that moves to out and out1 without consuming a character
+		const int SPLIT{ -1 };
+
+		/// Marks the state reached when the pattern has matched
+		const int ACCEPT{ -2 };
+
+		/// Builds a Thompson NFA from a parsed pattern, from the last state back to the first
+		class NfaBuilder {
+		public:
+			std::vector<NfaState> vStates{};
+			bool bTooLarge{ false };
+
+			int Add(int set, int out, int out1 = -1){
+				if(vStates.size() >= MAX_NFA_STATES){
+					bTooLarge = true;
+				}
+				vStates.emplace_back(NfaState{ set, out, out1 });
+				return static_cast<int>(vStates.size() - 1);
+			}
+
+			/**
+			 * Builds the states matching a node
+			 *
+			 * @param node The node to match
+			 * @param next The state to move to once the node has matched
+			 *
+			 * @return The first state of the node
+			 */
+			int Build(const Node& node, int next){
+				if(bTooLarge){
+					return next;
+				}
+
+				switch(node.kind){
+				case Node::Kind::Set:
+					return Add(static_cast<int>(node.dwSet), next);
+				case Node::Kind::Concatenation:
+					for(auto child = node.children.rbegin(); child != node.children.rend(); child++){
+						next = Build(*child, next);
+					}
+					return next;
+				case Node::Kind::Alternation: {
+					auto start{ Build(node.children.back(), next) };
+					for(auto idx = node.children.size() - 1; idx > 0; idx--){
+						auto branch{ Build(node.children[idx - 1], next) };
+						start = Add(SPLIT, branch, start);
+					}
+					return start;
+				}
+				case Node::Kind::Repetition: {
+					auto& child{ node.children[0] };
+					auto start{ next };
+					if(node.dwMax == UNBOUNDED){
+						auto loop{ Add(SPLIT, -1, next) };
+						auto body{ Build(child, loop) };
+						vStates[loop].out = body;
+						start = loop;
+					} else {
+						for(auto i = node.dwMin; i < node.dwMax && !bTooLarge; i++){
+							auto body{ Build(child, start) };
+							start = Add(SPLIT, body, next);
+						}
+					}
+					for(DWORD i = 0; i < node.dwMin && !bTooLarge; i++){
+						start = Build(child, start);
+					}
+					return start;
+				}
+				default:
+					return next;
+				}
+			}
+		};
+
+		/// Adds the states reachable from a state without consuming a character to a DFA state
+		void AddClosure(const std::vector<NfaState>& vStates, int state, std::vector<int>& vClosure, std::vector<DWORD>& vMarks, DWORD dwMark){
+			std::vector<int> vPending{ state };
+			while(vPending.size()){
+				auto current{ vPending.back() };
+				vPending.pop_back();
+				if(current < 0 || vMarks[current] == dwMark){
+					continue;
+				}
+				vMarks[current] = dwMark;
+
+				if(vStates[current].set == SPLIT){
+					vPending.emplace_back(vStates[current].out1);
+					vPending.emplace_back(vStates[current].out);
+				} else {
+					vClosure.emplace_back(current);
+				}
+			}
+		}
+
+		/**
+		 * Builds a DFA from a Thompson NFA by subset construction. Characters are split into classes, each of
+		 * which every set in the pattern either entirely contains or entirely excludes, so that each DFA state
+		 * needs one transition per class rather than one per character.
+		 *
+		 * @return True if the DFA was built; false if it would be too large
+		 */
+		bool BuildDfa(const std::vector<NfaState>& vStates, int start, const std::vector<CharSet>& vSets,
+			std::vector<DWORD>& vClassStarts, std::vector<int>& vTransitions, std::vector<bool>& vAccepting){
+			vClassStarts = { 0 };
+			for(auto& set : vSets){
+				for(auto& range : set){
+					vClassStarts.emplace_back(range.first);
+					if(range.second < 0xFFFF){
+						vClassStarts.emplace_back(range.second + 1);
+					}
+				}
+			}
+			std::sort(vClassStarts.begin(), vClassStarts.end());
+			vClassStarts.erase(std::unique(vClassStarts.begin(), vClassStarts.end()), vClassStarts.end());
+			auto dwClasses{ vClassStarts.size() };
+
+			std::vector<DWORD> vMarks(vStates.size());
+			DWORD dwMark{ 0 };
+
+			std::map<std::vector<int>, int> mIds{};
+			std::vector<std::vector<int>> vDfaStates{};
+			auto GetId{ [&](std::vector<int>&& vClosure){
+				if(vClosure.empty()){
+					return -1;
+				}
+				std::sort(vClosure.begin(), vClosure.end());
+				auto existing{ mIds.find(vClosure) };
+				if(existing != mIds.end()){
+					return existing->second;
+				}
+				auto id{ static_cast<int>(vDfaStates.size()) };
+				mIds.emplace(vClosure, id);
+				vDfaStates.emplace_back(std::move(vClosure));
+				return id;
+			} };
+
+			std::vector<int> vInitial{};
+			AddClosure(vStates, start, vInitial, vMarks, ++dwMark);
+			if(GetId(std::move(vInitial)) < 0){
+				return false;
+			}
+
+			for(size_t idx = 0; idx < vDfaStates.size(); idx++){
+				if(vDfaStates.size() > MAX_DFA_STATES || vDfaStates.size() * dwClasses > MAX_TRANSITIONS){
+					return false;
+				}
+
+				auto current{ vDfaStates[idx] };
+				vTransitions.resize((idx + 1) * dwClasses);
+				for(size_t cls = 0; cls < dwClasses; cls++){
+					std::vector<int> vNext{};
+					dwMark++;
+					for(auto state : current){
+						if(vStates[state].set >= 0 && Contains(vSets[vStates[state].set], vClassStarts[cls])){
+							AddClosure(vStates, vStates[state].out, vNext, vMarks, dwMark);
+						}
+					}
+					vTransitions[idx * dwClasses + cls] = GetId(std::move(vNext));
+				}
+			}
+
+			vAccepting.resize(vDfaStates.size());
+			for(size_t idx = 0; idx < vDfaStates.size(); idx++){
+				for(auto state : vDfaStates[idx]){
+					if(vStates[state].set == ACCEPT){
+						vAccepting[idx] = true;
+					}
+				}
+			}
+			return true;
+		}
+	}
+
+	Pattern::Pattern(const std::wstring& wsPattern, bool bCaseInsensitive) :
+		wsPattern{ wsPattern },
+		fallback{ std::nullopt },
+		bValid{ true }{
+
+		std::vector<CharSet> vSets{};
+		auto root{ Parser{ wsPattern, bCaseInsensitive, vSets }.Parse() };
+		if(root){
+			NfaBuilder builder{};
+			auto accept{ builder.Add(ACCEPT, -1) };
+			auto start{ builder.Build(*root, accept) };
+			if(!builder.bTooLarge && BuildDfa(builder.vStates, start, vSets, vClassStarts, vTransitions, vAccepting)){
+				vLowClasses.resize(0x100);
+				for(DWORD ch = 0; ch < 0x100; ch++){
+					vLowClasses[ch] = static_cast<WORD>(std::upper_bound(vClassStarts.begin(), vClassStarts.end(), ch) - vClassStarts.begin() - 1);
+				}
+				return;
+			}
+
+			vClassStarts.clear();
+			vTransitions.clear();
+			vAccepting.clear();
+		}
+
+		try {
+			fallback = std::wregex(wsPattern, bCaseInsensitive ? std::regex::ECMAScript | std::regex::icase : std::regex::ECMAScript);
+		} catch(const std::regex_error&){
+			bValid = false;
+		}
+	}
+
+	WORD Pattern::GetClass(WCHAR ch) const {
+		if(ch < 0x100){
+			return vLowClasses[ch];
+		}
+		return static_cast<WORD>(std::upper_bound(vClassStarts.begin(), vClassStarts.end(), static_cast<DWORD>(ch)) - vClassStarts.begin() - 1);
+	}
+
+	bool Pattern::Matches(const std::wstring& text) const {
+		return Matches(text.c_str(), text.length());
+	}
+
+	bool Pattern::Matches(LPCWSTR text, SIZE_T dwLength) const {
+		if(!bValid){
+			return false;
+		}
+		if(fallback){
+			return std::regex_match(text, text + dwLength, *fallback);
+		}
+
+		auto dwClasses{ vClassStarts.size() };
+		int state{ 0 };
+		for(SIZE_T idx = 0; idx < dwLength; idx++){
+			state = vTransitions[state * dwClasses + GetClass(text[idx])];
+			if(state < 0){
+				return false;
+			}
+		}
+		return vAccepting[state];
+	}
+
+	const std::wstring& Pattern::GetPattern() const {
+		return wsPattern;
+	}
+
+	bool Pattern::IsDeterministic() const {
+		return bValid && !fallback;
+	}
+
+	bool Pattern::IsValid() const {
+		return bValid;
+	}
+
+	PatternRegistry::PatternRegistry() :
+		dwCompiled{ 0 },
+		dwFallbacks{ 0 }{}
+
+	PatternRegistry& PatternRegistry::GetInstance(){
+		// Constructed on first use, since patterns may be compiled while other static objects are initialized
+		static PatternRegistry instance{};
+		return instance;
+	}
+
+	PatternHandle PatternRegistry::Compile(const std::wstring& wsPattern, bool bCaseInsensitive){
+		auto wsKey{ std::wstring{ bCaseInsensitive ? L"i|" : L"c|" } + wsPattern };
+
+		auto lock{ BeginCriticalSection(hSection) };
+		auto existing{ mPatterns.find(wsKey) };
+		if(existing != mPatterns.end()){
+			return existing->second;
+		}
+
+		// The constructor is private, so the pattern can't be created through std::make_shared
+		PatternHandle pattern{ new Pattern{ wsPattern, bCaseInsensitive } };
+		dwCompiled++;
+		if(!pattern->IsValid()){
+			LOG_ERROR(L"Unable to compile the pattern " << wsPattern << L"; it will never match");
+		} else if(!pattern->IsDeterministic()){
+			dwFallbacks++;
+			LOG_VERBOSE(2, L"The pattern " << wsPattern << L" can't be matched by a DFA and will be matched with std::wregex");
+		} else {
+			LOG_VERBOSE(3, L"Compiled the pattern " << wsPattern << L" into a DFA with " << pattern->vAccepting.size() << L" states over "
+				<< pattern->vClassStarts.size() << L" character classes");
+		}
+
+		mPatterns.emplace(wsKey, pattern);
+		return pattern;
+	}
+
+	std::pair<DWORD, DWORD> PatternRegistry::GetCompileCounts() const {
+		return { dwCompiled, dwFallbacks };
+	}
+}
@@ -0,0 +1,90 @@
+#include "util/threadpool/IOExecutor.h"
+#include "util/threadpool/ThreadPool.h"
+
+#include <memory>
+
+#include "util/log/Log.h"
+#include "common/Utils.h"
+
+namespace {
+	/// The number of threads started for each thread the port allows to run, leaving spares to run while others are blocked
+	const DWORD THREADS_PER_PROCESSOR{ 4 };
+}
+
+IOExecutor::IOExecutor() :
+	dwConcurrency{ ThreadPool::GetDefaultWorkerCount() },
+	hPort{ CreateIoCompletionPort(INVALID_HANDLE_VALUE, nullptr, 0, dwConcurrency) },
+	dwTasksRun{ 0 }{
+
+	if(!hPort){
+		LOG_ERROR("Unable to create an I/O completion port for the IO executor (Error " << GetLastError() << "); tasks will be run synchronously");
+		return;
+	}
+
+	for(DWORD idx = 0; idx < dwConcurrency * THREADS_PER_PROCESSOR; idx++){
+		vThreads.emplace_back(&IOExecutor::RunThread, this);
+	}
+
+	LOG_VERBOSE(2, "Started an IO executor with " << vThreads.size() << " threads, " << dwConcurrency << " of which may run at once");
+}
+
+IOExecutor& IOExecutor::GetInstance(){
+	static IOExecutor instance{};
+	return instance;
+}
+
+IOExecutor::~IOExecutor(){
+	// Packets are dequeued in order, so each thread receives a null task only after every queued task
+	for(SIZE_T idx = 0; idx < vThreads.size(); idx++){
+		PostQueuedCompletionStatus(hPort, 0, 0, nullptr);
+	}
+
+	for(auto& thread : vThreads){
+		thread.join();
+	}
+}
+
+void IOExecutor::RunThread(){
+	while(true){
+		DWORD dwBytesTransferred{ 0 };
+		ULONG_PTR lpCompletionKey{ 0 };
+		LPOVERLAPPED lpOverlapped{ nullptr };
+		GetQueuedCompletionStatus(hPort, &dwBytesTransferred, &lpCompletionKey, &lpOverlapped, INFINITE);
+
+		// A null task is posted to stop the thread; a failed dequeue also yields no task
+		if(!lpOverlapped){
+			return;
+		}
+
+		std::unique_ptr<std::function<void()>> task{ reinterpret_cast<std::function<void()>*>(lpOverlapped) };
+		if(!CallFunctionSafe(*task)){
+			LOG_ERROR("A task on the IO executor raised an exception and was abandoned");
+		}
+		dwTasksRun++;
+	}
+}
+
+void IOExecutor::Post(const std::function<void()>& task){
+	if(hPort){
+		auto lpTask{ new std::function<void()>(task) };
+		if(PostQueuedCompletionStatus(hPort, 0, 0, reinterpret_cast<LPOVERLAPPED>(lpTask))){
+			return;
+		}
+
+		LOG_ERROR("Unable to queue a task on the IO executor (Error " << GetLastError() << "); running it synchronously");
+		delete lpTask;
+	}
+
+	if(!CallFunctionSafe(task)){
+		LOG_ERROR("A task on the IO executor raised an exception and was abandoned");
+	}
+	dwTasksRun++;
+}
+
+DWORD IOExecutor::GetConcurrency() const {
+	return dwConcurrency;
+}
+
+DWORD IOExecutor::GetTasksRun() const {
+	return dwTasksRun;
+}
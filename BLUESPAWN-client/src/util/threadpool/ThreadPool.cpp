@@ -0,0 +1,130 @@
+#include "util/threadpool/ThreadPool.h"
+
+#include "util/log/Log.h"
+
+namespace {
+	/// Identifies the pool and the worker index of the current thread, if it is a worker
+	thread_local ThreadPool* lpCurrentPool{ nullptr };
+	thread_local DWORD dwCurrentWorker{ 0 };
+}
+
+ThreadPool::ThreadPool(DWORD dwWorkers) :
+	hTasksAvailable{ CreateSemaphoreW(nullptr, 0, LONG_MAX, nullptr) },
+	dwPendingTasks{ 0 },
+	dwNextQueue{ 0 },
+	terminate{ false }{
+
+	InitializeConditionVariable(&cvIdle);
+
+	if(!dwWorkers){
+		dwWorkers = GetDefaultWorkerCount();
+	}
+
+	for(DWORD idx = 0; idx < dwWorkers; idx++){
+		vQueues.emplace_back(std::make_unique<WorkQueue>());
+	}
+	for(DWORD idx = 0; idx < dwWorkers; idx++){
+		vWorkers.emplace_back(&ThreadPool::RunWorker, this, idx);
+	}
+
+	LOG_VERBOSE(2, "Started a thread pool with " << dwWorkers << " workers");
+}
+
+ThreadPool::~ThreadPool(){
+	Wait();
+
+	terminate = true;
+	ReleaseSemaphore(hTasksAvailable, static_cast<LONG>(vWorkers.size()), nullptr);
+
+	for(auto& worker : vWorkers){
+		worker.join();
+	}
+}
+
+bool ThreadPool::TryTakeTask(DWORD dwWorker, std::function<void()>& task){
+	auto& own{ *vQueues[dwWorker] };
+	{
+		auto lock{ BeginCriticalSection(own.hSection) };
+		if(own.tasks.size()){
+			task = std::move(own.tasks.back());
+			own.tasks.pop_back();
+			return true;
+		}
+	}
+
+	for(DWORD offset = 1; offset < vQueues.size(); offset++){
+		auto& victim{ *vQueues[(dwWorker + offset) % vQueues.size()] };
+		auto lock{ BeginCriticalSection(victim.hSection) };
+		if(victim.tasks.size()){
+			task = std::move(victim.tasks.front());
+			victim.tasks.pop_front();
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void ThreadPool::RunWorker(DWORD dwWorker){
+	lpCurrentPool = this;
+	dwCurrentWorker = dwWorker;
+
+	while(true){
+		WaitForSingleObject(hTasksAvailable, INFINITE);
+
+		// Every count in the semaphore corresponds to a task that has not yet been claimed, so a
+		// task will be found unless the pool is terminating. A scan may miss a task that is being
+		// moved between queues by another worker, in which case the scan is repeated.
+		std::function<void()> task{};
+		while(!TryTakeTask(dwWorker, task)){
+			if(terminate){
+				return;
+			}
+			SwitchToThread();
+		}
+
+		task();
+
+		EnterCriticalSection(hIdleSection);
+		if(!--dwPendingTasks){
+			WakeAllConditionVariable(&cvIdle);
+		}
+		LeaveCriticalSection(hIdleSection);
+	}
+}
+
+void ThreadPool::Submit(const std::function<void()>& task){
+	EnterCriticalSection(hIdleSection);
+	dwPendingTasks++;
+	LeaveCriticalSection(hIdleSection);
+
+	auto dwQueue{ lpCurrentPool == this ? dwCurrentWorker : dwNextQueue++ % static_cast<DWORD>(vQueues.size()) };
+	{
+		auto& queue{ *vQueues[dwQueue] };
+		auto lock{ BeginCriticalSection(queue.hSection) };
+		queue.tasks.emplace_back(task);
+	}
+
+	ReleaseSemaphore(hTasksAvailable, 1, nullptr);
+}
+
+void ThreadPool::Wait(){
+	EnterCriticalSection(hIdleSection);
+	while(dwPendingTasks){
+		SleepConditionVariableCS(&cvIdle, hIdleSection, INFINITE);
+	}
+	LeaveCriticalSection(hIdleSection);
+}
+
+DWORD ThreadPool::GetWorkerCount() const {
+	return static_cast<DWORD>(vWorkers.size());
+}
+
+bool ThreadPool::IsCurrentThreadWorker() const {
+	return lpCurrentPool == this;
+}
+
+DWORD ThreadPool::GetDefaultWorkerCount(){
+	auto dwProcessors{ std::thread::hardware_concurrency() };
+	return dwProcessors ? dwProcessors : 1;
+}
@@ -3,6 +3,7 @@
 #include <Windows.h>
 #include <vector>
 #include <string>
+#include <functional>
 
 #define ADD_ALL_VECTOR(v1, v2)  \
     {                           \
@@ -15,4 +16,26 @@
 int64_t SystemTimeToInteger(const SYSTEMTIME st);
 std::wstring FormatWindowsTime(const SYSTEMTIME systemtime);
 std::wstring FormatWindowsTime(const FILETIME systemtime);
-std::wstring FormatWindowsTime(const std::wstring& windowsTime);
\ No newline at end of file
+std::wstring FormatWindowsTime(const std::wstring& windowsTime);
+
+/**
+ * Computes a 64-bit FNV-1a hash of a buffer. This is not a cryptographic hash; it is intended for
+ * fingerprinting data that is stored or compared locally.
+ *
+ * @param lpData The data to hash
+ * @param dwSize The number of bytes to hash
+ * @param dwSeed The hash to continue from, allowing several buffers to be hashed together
+ *
+ * @return The hash of the data
+ */
+DWORD64 HashData(LPCVOID lpData, SIZE_T dwSize, DWORD64 dwSeed = 0xCBF29CE484222325);
+
+/**
+ * Calls a function, containing any C++ exception or structured exception it raises so that a failure in
+ * one task doesn't bring down the process.
+ *
+ * @param func The function to call
+ *
+ * @return true if the function returned normally; false if it raised an exception
+ */
+bool CallFunctionSafe(const std::function<void()>& func);
\ No newline at end of file
@@ -88,13 +88,15 @@ public:
 };
 
 class BeginCriticalSection {
-	CriticalSection critsec;
+	// Copying a CRITICAL_SECTION does not produce a usable lock, so the address of the
+	// original section is held rather than a copy of the CriticalSection.
+	PCRITICAL_SECTION critsec;
 	std::shared_ptr<void> tracker;
 
 public:
 	explicit BeginCriticalSection(const CriticalSection& section) :
-		critsec{ section },
-		tracker{ nullptr, [&](LPVOID nul){ LeaveCriticalSection(critsec); } }{
+		critsec{ const_cast<CriticalSection&>(section) },
+		tracker{ nullptr, [critsec = critsec](LPVOID nul){ LeaveCriticalSection(critsec); } }{
 		::EnterCriticalSection(critsec);
 	}
 };
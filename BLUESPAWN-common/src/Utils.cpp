@@ -55,4 +55,21 @@ std::wstring FormatWindowsTime(const std::wstring& windowsTime) {
 		std::setw(2) << st.wHour << ":" << std::setw(2) << st.wMinute << ":" << std::setw(2) << st.wSecond << "." <<
 		nano << "Z";
 	return w.str();
-}
\ No newline at end of file
+}
+DWORD64 HashData(LPCVOID lpData, SIZE_T dwSize, DWORD64 dwSeed){
+	auto bytes{ reinterpret_cast<const BYTE*>(lpData) };
+	for(SIZE_T idx = 0; idx < dwSize; idx++){
+		dwSeed ^= bytes[idx];
+		dwSeed *= 0x100000001B3;
+	}
+	return dwSeed;
+}
+
+bool CallFunctionSafe(const std::function<void()>& func){
+	__try{
+		func();
+		return true;
+	} __except(EXCEPTION_EXECUTE_HANDLER){
+		return false;
+	}
+}